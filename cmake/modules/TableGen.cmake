@@ -12,9 +12,19 @@ macro(tablegen project ofn)
     set(LLVM_TARGET_DEFINITIONS_ABSOLUTE 
       ${CMAKE_CURRENT_SOURCE_DIR}/${LLVM_TARGET_DEFINITIONS})
   endif()
+
+  # Targets listed in LLVM_DIRECT_DAG_ISEL_TARGETS get a direct matcher.
+  set(tblgen_args ${ARGN})
+  list(FIND tblgen_args "-gen-dag-isel" gen_dag_isel)
+  get_filename_component(td_target ${LLVM_TARGET_DEFINITIONS} NAME_WE)
+  list(FIND LLVM_DIRECT_DAG_ISEL_TARGETS ${td_target} direct_dag_isel)
+  if( NOT gen_dag_isel EQUAL -1 AND NOT direct_dag_isel EQUAL -1 )
+    list(APPEND tblgen_args -direct-dag-isel)
+  endif()
+
   add_custom_command(OUTPUT ${CMAKE_CURRENT_BINARY_DIR}/${ofn}.tmp
     # Generate tablegen output in a temporary file.
-    COMMAND ${${project}_TABLEGEN_EXE} ${ARGN} -I ${CMAKE_CURRENT_SOURCE_DIR}
+    COMMAND ${${project}_TABLEGEN_EXE} ${tblgen_args} -I ${CMAKE_CURRENT_SOURCE_DIR}
     -I ${LLVM_MAIN_SRC_DIR}/lib/Target -I ${LLVM_MAIN_INCLUDE_DIR}
     ${LLVM_TARGET_DEFINITIONS_ABSOLUTE} 
     -o ${CMAKE_CURRENT_BINARY_DIR}/${ofn}.tmp
@@ -0,0 +1,174 @@
+//===-- examples/ParallelUniquing/ParallelUniquing.cpp - Context benchmark ===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Parallel Uniquing
+//
+// This program measures how quickly several threads can create types and
+// constants, and instructions that use shared constants.  It runs the same
+// work with every thread using an LLVMContext of its own, and with all of the
+// threads sharing a single context that has been put in concurrent mode with
+// LLVMContext::enableConcurrentUniquing, and prints the wall time of each.
+// The context-per-thread runs are repeated once a context has been put in
+// concurrent mode, which makes all use list updates in the process check
+// whether they need to lock.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <vector>
+using namespace llvm;
+
+static cl::opt<unsigned>
+NumThreads("threads", cl::desc("Number of threads to create objects on"),
+           cl::init(4));
+
+static cl::opt<unsigned>
+NumValues("values", cl::desc("Number of distinct constants per thread"),
+          cl::init(200000));
+
+static cl::opt<unsigned>
+Overlap("overlap", cl::desc("Percentage of each thread's constants that the "
+                            "other threads create too"),
+        cl::init(50));
+
+static cl::opt<unsigned>
+NumInstructions("instructions", cl::desc("Number of instructions per thread"),
+                cl::init(200000));
+
+namespace {
+struct WorkerArgs {
+  LLVMContext *Ctx;
+  unsigned ThreadNo;
+};
+}
+
+/// createObjects - Create NumValues integer and floating point constants and a
+/// matching set of types.  Overlap percent of them are the same on every
+/// thread, the rest are unique to this thread.
+static void createObjects(void *Arg) {
+  WorkerArgs &W = *static_cast<WorkerArgs*>(Arg);
+  LLVMContext &C = *W.Ctx;
+  Type *I64 = Type::getInt64Ty(C);
+  Type *Double = Type::getDoubleTy(C);
+  unsigned Shared = NumValues / 100 * Overlap;
+
+  for (unsigned i = 0; i != NumValues; ++i) {
+    uint64_t V = i < Shared ? i : (uint64_t(W.ThreadNo + 1) << 32) + i;
+    ConstantInt::get(I64, V);
+    ConstantFP::get(Double, double(V));
+
+    if (i % 16 == 0) {
+      IntegerType *ITy = IntegerType::get(C, 2 + (V % 1000));
+      Type *Params[] = { ITy, PointerType::getUnqual(ITy) };
+      FunctionType::get(ITy, Params, false);
+      StructType::get(C, Params);
+      ArrayType::get(ITy, V);
+    }
+  }
+}
+
+/// createInstructions - Build a function of NumInstructions instructions in a
+/// module of this thread's own.  All of them use one of a few constants, which
+/// every thread shares when the context is shared.
+static void createInstructions(void *Arg) {
+  WorkerArgs &W = *static_cast<WorkerArgs*>(Arg);
+  LLVMContext &C = *W.Ctx;
+  Type *I64 = Type::getInt64Ty(C);
+  Module M("bench", C);
+  Function *F = Function::Create(FunctionType::get(I64, I64, false),
+                                 GlobalValue::ExternalLinkage, "f", &M);
+  IRBuilder<> Builder(BasicBlock::Create(C, "entry", F));
+
+  Value *Sum = F->arg_begin();
+  for (unsigned i = 0; i != NumInstructions; ++i)
+    Sum = Builder.CreateAdd(Sum, ConstantInt::get(I64, i % 16));
+  Builder.CreateRet(Sum);
+}
+
+/// runOnThreads - Run Worker on NumThreads threads, giving thread i the
+/// context Contexts[i], and return the wall time it took.
+static double runOnThreads(void (*Worker)(void*),
+                           ArrayRef<LLVMContext*> Contexts) {
+  std::vector<WorkerArgs> Args(NumThreads);
+  std::vector<void*> ArgPtrs(NumThreads);
+  for (unsigned i = 0; i != NumThreads; ++i) {
+    Args[i].Ctx = Contexts[i];
+    Args[i].ThreadNo = i;
+    ArgPtrs[i] = &Args[i];
+  }
+
+  double Start = TimeRecord::getCurrentTime(true).getWallTime();
+  llvm_execute_on_threads(Worker, ArgPtrs);
+  return TimeRecord::getCurrentTime(false).getWallTime() - Start;
+}
+
+/// printTimes - Print the wall times of both workloads for one setup.
+static void printTimes(const char *Name, double Constants,
+                       double Instructions) {
+  outs() << format("  %-27s constants %7.3fs, instructions %7.3fs", Name,
+                   Constants, Instructions) << "\n";
+}
+
+/// runPerThread - Time both workloads with one context per thread.
+static void runPerThread(const char *Name) {
+  SmallVector<LLVMContext*, 8> Contexts;
+  for (unsigned i = 0; i != NumThreads; ++i)
+    Contexts.push_back(new LLVMContext());
+  double Constants = runOnThreads(createObjects, Contexts);
+  double Instructions = runOnThreads(createInstructions, Contexts);
+  printTimes(Name, Constants, Instructions);
+  for (unsigned i = 0; i != NumThreads; ++i)
+    delete Contexts[i];
+}
+
+int main(int argc, char **argv) {
+  llvm_shutdown_obj Y;
+  cl::ParseCommandLineOptions(argc, argv, "context uniquing benchmark\n");
+  if (NumThreads == 0 || Overlap > 100) {
+    errs() << argv[0] << ": -threads must be positive and -overlap at most "
+           << "100\n";
+    return 1;
+  }
+
+  outs() << "Creating " << NumValues << " constants and " << NumInstructions
+         << " instructions on each of " << NumThreads << " threads, "
+         << Overlap << "% of the constants shared\n";
+
+  // One context per thread, before any context is in concurrent mode.
+  runPerThread("context per thread:");
+
+  // One shared context in concurrent mode.
+  {
+    OwningPtr<LLVMContext> Shared(new LLVMContext());
+    Shared->enableConcurrentUniquing();
+    SmallVector<LLVMContext*, 8> Contexts(NumThreads, Shared.get());
+    double Constants = runOnThreads(createObjects, Contexts);
+    double Instructions = runOnThreads(createInstructions, Contexts);
+    printTimes("shared concurrent context:", Constants, Instructions);
+  }
+
+  // One context per thread again, now that use list updates check for
+  // shared values.
+  runPerThread("context per thread after:");
+
+  return 0;
+}
@@ -28,6 +28,7 @@
 
 #include "llvm/Support/Atomic.h"
 #include "llvm/Support/Valgrind.h"
+#include <vector>
 
 namespace llvm {
 class raw_ostream;
@@ -38,74 +39,77 @@ public:
   const char *Desc;
   volatile llvm::sys::cas_flag Value;
   bool Initialized;
+  unsigned ID;
 
-  llvm::sys::cas_flag getValue() const { return Value; }
+  /// getValue - Return the statistic's value, summing up the counts of all
+  /// threads that have bumped it.
+  llvm::sys::cas_flag getValue() const;
   const char *getName() const { return Name; }
   const char *getDesc() const { return Desc; }
 
   /// construct - This should only be called for non-global statistics.
   void construct(const char *name, const char *desc) {
     Name = name; Desc = desc;
-    Value = 0; Initialized = 0;
+    Value = 0; Initialized = 0; ID = 0;
   }
 
   // Allow use of this class as the value itself.
-  operator unsigned() const { return Value; }
+  operator unsigned() const { return getValue(); }
 
 #if !defined(NDEBUG) || defined(LLVM_ENABLE_STATS)
    const Statistic &operator=(unsigned Val) {
-    Value = Val;
-    return init();
+    init().set(Val);
+    return *this;
   }
 
   const Statistic &operator++() {
-    // FIXME: This function and all those that follow carefully use an
-    // atomic operation to update the value safely in the presence of
-    // concurrent accesses, but not to read the return value, so the
-    // return value is not thread safe.
-    sys::AtomicIncrement(&Value);
-    return init();
+    // Increments, decrements, additions and subtractions go to a counter
+    // private to the calling thread, so threads bumping the same statistic
+    // don't contend.  The counters are summed up when the value is read;
+    // the value returned by the postfix operators is not thread safe.
+    init().add(1);
+    return *this;
   }
 
   unsigned operator++(int) {
     init();
-    unsigned OldValue = Value;
-    sys::AtomicIncrement(&Value);
+    unsigned OldValue = getValue();
+    add(1);
     return OldValue;
   }
 
   const Statistic &operator--() {
-    sys::AtomicDecrement(&Value);
-    return init();
+    init().add(-1);
+    return *this;
   }
 
   unsigned operator--(int) {
     init();
-    unsigned OldValue = Value;
-    sys::AtomicDecrement(&Value);
+    unsigned OldValue = getValue();
+    add(-1);
     return OldValue;
   }
 
   const Statistic &operator+=(const unsigned &V) {
     if (!V) return *this;
-    sys::AtomicAdd(&Value, V);
-    return init();
+    init().add(V);
+    return *this;
   }
 
   const Statistic &operator-=(const unsigned &V) {
     if (!V) return *this;
-    sys::AtomicAdd(&Value, -V);
-    return init();
+    init().add(-V);
+    return *this;
   }
 
   const Statistic &operator*=(const unsigned &V) {
-    sys::AtomicMul(&Value, V);
-    return init();
+    init().multiply(V);
+    return *this;
   }
 
   const Statistic &operator/=(const unsigned &V) {
-    sys::AtomicDiv(&Value, V);
-    return init();
+    init().divide(V);
+    return *this;
   }
 
 #else  // Statistics are disabled in release builds.
@@ -157,12 +161,21 @@ protected:
     return *this;
   }
   void RegisterStatistic();
+
+  /// add - Add V to the calling thread's count.
+  void add(unsigned V);
+
+  /// set, multiply, divide - These apply to the value summed over all threads,
+  /// and so take a lock.
+  void set(unsigned V);
+  void multiply(unsigned V);
+  void divide(unsigned V);
 };
 
 // STATISTIC - A macro to make definition of statistics really simple.  This
 // automatically passes the DEBUG_TYPE of the file into the statistic.
 #define STATISTIC(VARNAME, DESC) \
-  static llvm::Statistic VARNAME = { DEBUG_TYPE, DESC, 0, 0 }
+  static llvm::Statistic VARNAME = { DEBUG_TYPE, DESC, 0, 0, 0 }
 
 /// \brief Enable the collection and printing of statistics.
 void EnableStatistics();
@@ -176,6 +189,29 @@ void PrintStatistics();
 /// \brief Print statistics to the given output stream.
 void PrintStatistics(raw_ostream &OS);
 
+/// \brief The value of a statistic at the time GetStatistics was called.
+struct StatisticValue {
+  const char *Name;
+  const char *Desc;
+  unsigned Value;
+};
+
+/// \brief Return the values of all statistics bumped so far, sorted by name.
+///
+/// If \p ThisThreadOnly is set, return only what the calling thread added to
+/// each statistic (with ++, --, += and -=) since its last call to
+/// ResetStatistics(true).  A compilation job that runs on one thread, such as
+/// a request to a JIT server, can use this to report its own statistics while
+/// other jobs run concurrently.
+std::vector<StatisticValue> GetStatistics(bool ThisThreadOnly = false);
+
+/// \brief Set all statistics back to zero.
+///
+/// If \p ThisThreadOnly is set, only forget the calling thread's own counts
+/// for the purpose of GetStatistics(true); the statistics' values are not
+/// changed.
+void ResetStatistics(bool ThisThreadOnly = false);
+
 } // End llvm namespace
 
 #endif
@@ -513,6 +513,37 @@ public:
     return canInstructionRangeModify(I1, I2, Location(Ptr, Size));
   }
 
+  //===--------------------------------------------------------------------===//
+  /// Caches that implementations keep across queries.
+  ///
+
+  /// beginCacheScope - Called by a client before it makes many queries about
+  /// one function.  Until the matching endCacheScope, implementations may keep
+  /// the results of the queries, so the client must not change what any
+  /// existing value computes: it may only add instructions, delete values or
+  /// replace uses of a value with an equivalent one, and must report new
+  /// escaping uses with addEscapingUse.  In particular a pass must not leave
+  /// a scope open for the passes that run after it.
+  ///
+  virtual void beginCacheScope();
+
+  /// endCacheScope - Drop what was kept since the matching beginCacheScope.
+  ///
+  virtual void endCacheScope();
+
+  /// CacheCounts - The number of lookups done in the caches of alias query
+  /// results and of decomposed GEPs, and how many of them found the answer.
+  struct CacheCounts {
+    uint64_t AliasLookups, AliasHits;
+    uint64_t GEPLookups, GEPHits;
+    CacheCounts() : AliasLookups(0), AliasHits(0), GEPLookups(0), GEPHits(0) {}
+  };
+
+  /// addCacheCounts - Add the counts of the caches of this implementation and
+  /// of the ones it chains to.  This is used by -count-aa.
+  ///
+  virtual void addCacheCounts(CacheCounts &Counts);
+
   //===--------------------------------------------------------------------===//
   /// Methods that clients should call when they transform the program to allow
   /// alias analyses to update their internal data structures.  Note that these
@@ -0,0 +1,264 @@
+//===- llvm/Analysis/MemorySSA.h - Memory SSA -------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines Memory SSA, a form of SSA for the memory state of a
+// function.  Every instruction that may write memory is a MemoryDef of a new
+// version of memory, every instruction that only reads memory is a MemoryUse of
+// the version that reaches it, and blocks where different versions meet start
+// with a MemoryPhi.  Memory is treated as a single variable, so the def-use
+// chains are cheap to build; a walker then skips the definitions that don't
+// touch a given location to find the one that actually clobbers it:
+//
+//   define void @f(i32* %p, i32* %q) {
+//   entry:
+//   ; 1 = MemoryDef(liveOnEntry)
+//     store i32 0, i32* %p
+//   ; 2 = MemoryDef(1)
+//     store i32 1, i32* %q
+//   ; MemoryUse(2)
+//     %v = load i32* %p
+//     ...
+//
+// Here the load uses version 2, and is clobbered by 1 if %p and %q don't alias.
+//
+// Unlike MemoryDependenceAnalysis, which answers each query by scanning the
+// instructions backwards, the cost of a query is bounded by the number of
+// memory definitions on the way, and the answers of the walker are cached.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ANALYSIS_MEMORYSSA_H
+#define LLVM_ANALYSIS_MEMORYSSA_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Support/Casting.h"
+#include "llvm/Support/Compiler.h"
+
+namespace llvm {
+
+class BasicBlock;
+class DominatorTree;
+class Function;
+class Instruction;
+class MemoryPhi;
+class raw_ostream;
+
+/// MemoryAccess - The common base of the nodes of Memory SSA.
+class MemoryAccess {
+public:
+  enum AccessKind { AccessUse, AccessDef, AccessPhi };
+
+  typedef SmallPtrSet<MemoryAccess *, 4> UserSet;
+  typedef UserSet::iterator user_iterator;
+
+  virtual ~MemoryAccess() {}
+
+  AccessKind getKind() const { return Kind; }
+  BasicBlock *getBlock() const { return Block; }
+
+  /// getID - Return the number of the memory version defined by this access.
+  /// MemoryUses don't define a version and return 0, as does the live on
+  /// entry definition.
+  unsigned getID() const { return ID; }
+
+  /// The MemoryUses, MemoryDefs and MemoryPhis that use this version.
+  user_iterator user_begin() const { return Users.begin(); }
+  user_iterator user_end() const { return Users.end(); }
+  bool hasUsers() const { return !Users.empty(); }
+
+  void print(raw_ostream &OS) const;
+  void dump() const;
+
+protected:
+  friend class MemorySSA;
+
+  MemoryAccess(AccessKind K, BasicBlock *BB, unsigned ID)
+    : Kind(K), Block(BB), ID(ID) {}
+
+  void addUser(MemoryAccess *MA) { Users.insert(MA); }
+  void removeUser(MemoryAccess *MA) { Users.erase(MA); }
+  void setID(unsigned N) { ID = N; }
+
+private:
+  MemoryAccess(const MemoryAccess &) LLVM_DELETED_FUNCTION;
+  void operator=(const MemoryAccess &) LLVM_DELETED_FUNCTION;
+
+  AccessKind Kind;
+  BasicBlock *Block;
+  unsigned ID;
+  UserSet Users;
+};
+
+inline raw_ostream &operator<<(raw_ostream &OS, const MemoryAccess &MA) {
+  MA.print(OS);
+  return OS;
+}
+
+/// MemoryUseOrDef - The access of an instruction, along with the version of
+/// memory that reaches it.
+class MemoryUseOrDef : public MemoryAccess {
+public:
+  Instruction *getMemoryInst() const { return MemoryInst; }
+  MemoryAccess *getDefiningAccess() const { return DefiningAccess; }
+
+  static inline bool classof(const MemoryAccess *MA) {
+    return MA->getKind() != AccessPhi;
+  }
+
+protected:
+  friend class MemorySSA;
+
+  MemoryUseOrDef(AccessKind K, Instruction *I, MemoryAccess *Def,
+                 BasicBlock *BB, unsigned ID)
+    : MemoryAccess(K, BB, ID), MemoryInst(I), DefiningAccess(Def) {}
+
+  void setDefiningAccess(MemoryAccess *MA) { DefiningAccess = MA; }
+
+private:
+  Instruction *MemoryInst;
+  MemoryAccess *DefiningAccess;
+};
+
+/// MemoryUse - An instruction that reads memory without writing it.
+class MemoryUse : public MemoryUseOrDef {
+public:
+  static inline bool classof(const MemoryAccess *MA) {
+    return MA->getKind() == AccessUse;
+  }
+
+protected:
+  friend class MemorySSA;
+
+  MemoryUse(Instruction *I, MemoryAccess *Def, BasicBlock *BB)
+    : MemoryUseOrDef(AccessUse, I, Def, BB, 0) {}
+};
+
+/// MemoryDef - An instruction that may write memory, which defines a new
+/// version of it.  The live on entry definition is a MemoryDef without an
+/// instruction.
+class MemoryDef : public MemoryUseOrDef {
+public:
+  static inline bool classof(const MemoryAccess *MA) {
+    return MA->getKind() == AccessDef;
+  }
+
+protected:
+  friend class MemorySSA;
+
+  MemoryDef(Instruction *I, MemoryAccess *Def, BasicBlock *BB, unsigned ID)
+    : MemoryUseOrDef(AccessDef, I, Def, BB, ID) {}
+};
+
+/// MemoryPhi - The version of memory at the start of a block where different
+/// versions meet, with one incoming version per reachable predecessor.
+class MemoryPhi : public MemoryAccess {
+public:
+  unsigned getNumIncomingValues() const { return Operands.size(); }
+  MemoryAccess *getIncomingValue(unsigned i) const {
+    return Operands[i].first;
+  }
+  BasicBlock *getIncomingBlock(unsigned i) const { return Operands[i].second; }
+
+  static inline bool classof(const MemoryAccess *MA) {
+    return MA->getKind() == AccessPhi;
+  }
+
+protected:
+  friend class MemorySSA;
+
+  MemoryPhi(BasicBlock *BB) : MemoryAccess(AccessPhi, BB, 0) {}
+
+  void addIncoming(MemoryAccess *MA, BasicBlock *BB) {
+    Operands.push_back(std::make_pair(MA, BB));
+  }
+  void replaceIncomingValue(MemoryAccess *From, MemoryAccess *To);
+
+private:
+  SmallVector<std::pair<MemoryAccess *, BasicBlock *>, 4> Operands;
+};
+
+/// MemorySSA - The Memory SSA form of a function.  It is built for the blocks
+/// reachable from the entry and kept up to date by clients that erase memory
+/// instructions through removeMemoryAccess.  Clients that change the CFG or
+/// insert memory instructions must build it again.
+class MemorySSA {
+public:
+  MemorySSA(Function &F, AliasAnalysis *AA, DominatorTree *DT);
+  ~MemorySSA();
+
+  /// getMemoryAccess - Return the MemoryUse or MemoryDef of the specified
+  /// instruction, or null if it doesn't access memory or is unreachable.
+  MemoryUseOrDef *getMemoryAccess(const Instruction *I) const {
+    return InstructionToAccess.lookup(I);
+  }
+
+  /// getMemoryPhi - Return the MemoryPhi at the start of BB, if any.
+  MemoryPhi *getMemoryPhi(const BasicBlock *BB) const {
+    return PhiMap.lookup(BB);
+  }
+
+  MemoryDef *getLiveOnEntryDef() const { return LiveOnEntry; }
+  bool isLiveOnEntryDef(const MemoryAccess *MA) const {
+    return MA == LiveOnEntry;
+  }
+
+  /// getClobberingMemoryAccess - Return the nearest access that may clobber
+  /// the memory read by I.  For loads this skips the definitions that don't
+  /// modify the loaded location, and the result is cached until a MemoryDef
+  /// is removed.  For other instructions it is the defining access.  Returns
+  /// null if I has no access.
+  MemoryAccess *getClobberingMemoryAccess(Instruction *I);
+
+  /// getClobberingMemoryAccess - Return the nearest access, starting at and
+  /// including Start, that may modify Loc.  The result is a MemoryDef that
+  /// modifies Loc, the live on entry definition, or a MemoryPhi where the
+  /// incoming versions have different clobbers.  The walk gives up at a
+  /// conservative answer if it visits too many accesses.
+  MemoryAccess *getClobberingMemoryAccess(MemoryAccess *Start,
+                                          const AliasAnalysis::Location &Loc);
+
+  /// removeMemoryAccess - Remove the access of I, which is about to be erased.
+  /// The users of a MemoryDef are changed to use its defining access.
+  void removeMemoryAccess(Instruction *I);
+
+  /// print - Print the function with each access as a comment before its
+  /// instruction or at the start of its block.
+  void print(raw_ostream &OS) const;
+  void dump() const;
+
+private:
+  typedef DenseMap<MemoryPhi *, MemoryAccess *> PhiResultMap;
+
+  void placePhis();
+  void renameBlock(BasicBlock *BB, MemoryAccess *&Incoming);
+  void rename();
+  MemoryAccess *walk(MemoryAccess *MA, const AliasAnalysis::Location &Loc,
+                     PhiResultMap &PhiResults, unsigned &Steps);
+  MemoryAccess *resolvePhi(MemoryPhi *Phi, const AliasAnalysis::Location &Loc,
+                           PhiResultMap &PhiResults, unsigned &Steps);
+
+  Function &F;
+  AliasAnalysis *AA;
+  DominatorTree *DT;
+
+  DenseMap<const Instruction *, MemoryUseOrDef *> InstructionToAccess;
+  DenseMap<const BasicBlock *, MemoryPhi *> PhiMap;
+  MemoryDef *LiveOnEntry;
+  unsigned NextID;
+
+  /// ClobberCache - The answers of the walker for loads.
+  DenseMap<const MemoryUse *, MemoryAccess *> ClobberCache;
+};
+
+} // End llvm namespace
+
+#endif
@@ -214,6 +214,13 @@ namespace llvm {
   // information and prints it with -analyze.
   //
   FunctionPass *createMemDepPrinter();
+
+  //===--------------------------------------------------------------------===//
+  //
+  // createMemorySSAPrinter - This pass builds Memory SSA and prints it, along
+  // with the clobbers of the loads, with -analyze.
+  //
+  FunctionPass *createMemorySSAPrinter();
 }
 
 #endif
@@ -308,6 +308,17 @@ public:
                                    unsigned Alignment,
                                    unsigned AddressSpace) const;
 
+  /// \return The cost of an interleaved Load or Store, which accesses the
+  /// wide vector VecTy and splits it into (or builds it from) Factor vectors.
+  /// Member i of the group is made of the elements i, i + Factor, ... of
+  /// VecTy. Indices holds the members that are used; a Store uses all of
+  /// them.
+  virtual unsigned getInterleavedMemoryOpCost(unsigned Opcode, Type *VecTy,
+                                              unsigned Factor,
+                                              ArrayRef<unsigned> Indices,
+                                              unsigned Alignment,
+                                              unsigned AddressSpace) const;
+
   /// \returns The cost of Intrinsic instructions.
   virtual unsigned getIntrinsicInstrCost(Intrinsic::ID ID, Type *RetTy,
                                          ArrayRef<Type *> Tys) const;
@@ -19,6 +19,7 @@
 #define LLVM_BITCODE_BITCODES_H
 
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Atomic.h"
 #include "llvm/Support/DataTypes.h"
 #include "llvm/Support/ErrorHandling.h"
 #include <cassert>
@@ -163,13 +164,16 @@ template <> struct isPodLike<BitCodeAbbrevOp> { static const bool value=true; };
 /// specialized format instead of the fully-general, fully-vbr, format.
 class BitCodeAbbrev {
   SmallVector<BitCodeAbbrevOp, 32> OperandList;
-  unsigned char RefCount; // Number of things using this.
+  // Number of things using this.  Cursors reading the same bitstream on
+  // different threads share the abbreviations from the BLOCKINFO block, so
+  // this is updated atomically.
+  volatile sys::cas_flag RefCount;
   ~BitCodeAbbrev() {}
 public:
   BitCodeAbbrev() : RefCount(1) {}
 
-  void addRef() { ++RefCount; }
-  void dropRef() { if (--RefCount == 0) delete this; }
+  void addRef() { sys::AtomicIncrement(&RefCount); }
+  void dropRef() { if (sys::AtomicDecrement(&RefCount) == 0) delete this; }
 
   unsigned getNumOperandInfos() const {
     return static_cast<unsigned>(OperandList.size());
@@ -14,6 +14,7 @@
 #ifndef LLVM_BITCODE_READERWRITER_H
 #define LLVM_BITCODE_READERWRITER_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include <string>
 
 namespace llvm {
@@ -23,6 +24,7 @@ namespace llvm {
   class LLVMContext;
   class Module;
   class ModulePass;
+  class StructType;
   class raw_ostream;
 
   /// getLazyBitcodeModule - Read the header of the specified bitcode buffer
@@ -58,6 +60,17 @@ namespace llvm {
   Module *ParseBitcodeFile(MemoryBuffer *Buffer, LLVMContext &Context,
                            std::string *ErrMsg = 0);
 
+  /// ParseBitcodeFile - Read the specified bitcode file like above, but
+  /// instead of creating the identified struct types of the bitcode, take the
+  /// ones of the same names from StructTypes.  This is for reading bitcode
+  /// back into the context it was written from.  It is an error for the
+  /// bitcode to use an identified struct type that is not in StructTypes or
+  /// has a different body there, and no identified struct types are created
+  /// in Context in any case.
+  Module *ParseBitcodeFile(MemoryBuffer *Buffer, LLVMContext &Context,
+                           ArrayRef<StructType*> StructTypes,
+                           std::string *ErrMsg = 0);
+
   /// WriteBitcodeToFile - Write the specified module to the specified
   /// raw output stream.  For streams where it matters, the given stream
   /// should be in "binary" mode.
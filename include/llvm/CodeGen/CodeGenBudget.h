@@ -0,0 +1,66 @@
+//===-- llvm/CodeGen/CodeGenBudget.h - Compile time budget ------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// With -codegen-budget=N, every machine function may spend N units of compile
+// time on the optional optimization passes listed below. Before doing its work
+// on a function, such a pass asks for a decision: run normally, run a cheaper
+// variant, or skip the function. The cost of each choice is estimated from the
+// number of instructions in the function, and the estimate of what runs is
+// charged to the function's budget, so the passes coming late in the pipeline
+// are the first to be cut back.
+//
+// The costs are estimates rather than measured times, so the generated code
+// does not depend on the load of the machine. The decisions are counted in
+// statistics, and -codegen-budget-report prints each one.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CODEGEN_CODEGENBUDGET_H
+#define LLVM_CODEGEN_CODEGENBUDGET_H
+
+namespace llvm {
+
+class MachineFunction;
+
+namespace CodeGenBudget {
+  /// The passes that consult the budget.
+  enum BudgetedPass {
+    EarlyIfConversion,
+    MachineLICM,
+    MachineCSE,
+    MachineScheduler,
+    /// Greedy's live range splitting.  The cheaper variant splits around
+    /// single blocks only, never around regions of several blocks.
+    GreedySplitting,
+    MachineBlockPlacement
+  };
+
+  enum Decision {
+    /// Run the pass as usual.
+    Full,
+    /// Run the cheaper variant of the pass.
+    Cheap,
+    /// Leave the function alone.
+    Skip
+  };
+
+  /// isEnabled - Return true if a budget was given.
+  bool isEnabled();
+
+  /// decide - Decide how pass P processes MF, and charge the estimated cost of
+  /// that to the budget of MF. Passes without a cheaper variant are either
+  /// run in full or skipped, and passes that cannot be skipped run their
+  /// cheaper variant when the budget is exhausted. Without a budget this
+  /// always returns Full.
+  Decision decide(MachineFunction &MF, BudgetedPass P);
+}
+
+} // End llvm namespace
+
+#endif
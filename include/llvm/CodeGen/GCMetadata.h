@@ -180,6 +180,10 @@ namespace llvm {
     GCModuleInfo();
     ~GCModuleInfo();
 
+    /// createClone - The clone starts out empty; modules that use garbage
+    /// collection are not run on worker threads.
+    virtual Pass *createClone() const { return new GCModuleInfo(); }
+
     /// clear - Resets the pass. Any pass, which uses GCModuleInfo, should
     /// call it in doFinalization().
     ///
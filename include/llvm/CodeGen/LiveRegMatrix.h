@@ -28,6 +28,7 @@
 #include "llvm/ADT/OwningPtr.h"
 #include "llvm/CodeGen/LiveIntervalUnion.h"
 #include "llvm/CodeGen/MachineFunctionPass.h"
+#include <vector>
 
 namespace llvm {
 
@@ -46,6 +47,9 @@ class LiveRegMatrix : public MachineFunctionPass {
   // UserTag changes whenever virtual registers have been modified.
   unsigned UserTag;
 
+  // Generation changes whenever a virtual register is assigned or unassigned.
+  unsigned Generation;
+
   // The matrix is represented as a LiveIntervalUnion per register unit.
   LiveIntervalUnion::Allocator LIUAlloc;
   LiveIntervalUnion::Array Matrix;
@@ -103,6 +107,11 @@ public:
   /// If this function returns IK_Free, it is legal to assign(VirtReg, PhysReg).
   /// When there is more than one kind of interference, the InterferenceKind
   /// with the highest enum value is returned.
+  ///
+  /// The result is remembered per PhysReg until the virtual registers are
+  /// invalidated. Regmask and regunit interference don't depend on the
+  /// assignments, so only the matrix is checked again after an assign() or
+  /// unassign().
   InterferenceKind checkInterference(LiveInterval &VirtReg, unsigned PhysReg);
 
   /// Assign VirtReg to PhysReg.
@@ -141,6 +150,22 @@ public:
   /// Directly access the live interval unions per regunit.
   /// This returns an array indexed by the regunit number.
   LiveIntervalUnion *getLiveUnions() { return &Matrix[0]; }
+
+private:
+  // A checkInterference() result for one PhysReg.
+  struct CheckResult {
+    unsigned VirtReg;
+    unsigned UserTag;
+    unsigned Generation;
+    InterferenceKind Kind;
+    CheckResult() : VirtReg(0), UserTag(0), Generation(0), Kind(IK_Free) {}
+  };
+
+  // Cached checkInterference() results, indexed by PhysReg.
+  std::vector<CheckResult> Checks;
+
+  /// Check the matrix for virtual register interference only.
+  bool checkVirtRegInterference(LiveInterval &VirtReg, unsigned PhysReg);
 };
 
 } // end namespace llvm
@@ -134,6 +134,10 @@ class MachineFunction {
   /// True if the function includes MS-style inline assembly.
   bool HasMSInlineAsm;
 
+  /// BudgetSpent - The compile time budget units charged to this function so
+  /// far, see CodeGenBudget.h.
+  uint64_t BudgetSpent;
+
   MachineFunction(const MachineFunction &) LLVM_DELETED_FUNCTION;
   void operator=(const MachineFunction&) LLVM_DELETED_FUNCTION;
 public:
@@ -228,6 +232,13 @@ public:
   void setHasMSInlineAsm(bool B) {
     HasMSInlineAsm = B;
   }
+
+  /// getBudgetSpent - Return the compile time budget units charged to this
+  /// function so far.
+  uint64_t getBudgetSpent() const { return BudgetSpent; }
+
+  /// chargeBudget - Charge Units compile time budget units to this function.
+  void chargeBudget(uint64_t Units) { BudgetSpent += Units; }
   
   /// getInfo - Keep track of various per-function pieces of information for
   /// backends that would like to do so.
@@ -187,6 +187,12 @@ namespace llvm {
     /// input.
     void buildSchedGraph(AliasAnalysis *AA, RegPressureTracker *RPTracker = 0);
 
+    /// getMaxRegionSize - Return the largest number of instructions that the
+    /// schedulers put in one region.  Longer sequences without a scheduling
+    /// boundary are split into several regions, which bounds the cost of
+    /// building the graph.  Zero means no limit.
+    static unsigned getMaxRegionSize();
+
     /// addSchedBarrierDeps - Add dependencies from instructions in the current
     /// list of instructions being scheduled to scheduling barrier. We want to
     /// make sure instructions which define registers that are either used by
@@ -22,6 +22,7 @@
 
 namespace llvm {
   class FastISel;
+  class FastISelFallbackReport;
   class SelectionDAGBuilder;
   class SDValue;
   class MachineRegisterInfo;
@@ -66,6 +67,8 @@ public:
 
   virtual bool runOnMachineFunction(MachineFunction &MF);
 
+  virtual bool doFinalization(Module &M);
+
   virtual void EmitFunctionEntryCode() {}
 
   /// PreprocessISelDAG - This hook allows targets to hack on the graph before
@@ -236,12 +239,64 @@ public:
                            const unsigned char *MatcherTable,
                            unsigned TableSize);
 
+  /// SelectCodeDirect - Select NodeToMatch with the direct matcher that tblgen
+  /// generates for targets built with -direct-dag-isel.  MatcherTable is
+  /// still needed: the direct matcher hands each match to the table
+  /// interpreter once the checks are done and the nodes are to be emitted.
+  SDNode *SelectCodeDirect(SDNode *NodeToMatch,
+                           const unsigned char *MatcherTable,
+                           unsigned TableSize);
+
+protected:
+  /// MatcherState - The state of a match in progress, shared between the
+  /// table interpreter and the direct matcher.
+  struct MatcherState {
+    SDNode *NodeToMatch;
+    const unsigned char *MatcherTable;
+    unsigned TableSize;
+
+    /// RecordedNodes - The nodes recorded by the matcher.  The second value is
+    /// the parent of the node, or null if the root is recorded.
+    SmallVector<std::pair<SDValue, SDNode*>, 8> RecordedNodes;
+
+    /// MatchedMemRefs - The MemRefs seen in the input pattern.
+    SmallVector<MachineMemOperand*, 2> MatchedMemRefs;
+
+    /// InputChain/InputGlue - The current input chain and glue for use when
+    /// generating nodes.
+    SDValue InputChain, InputGlue;
+
+    /// ChainNodesMatched - The matched nodes with chains, recorded by
+    /// OPC_EmitMergeInputChains so that their chain results can be updated
+    /// when the pattern is complete.
+    SmallVector<SDNode*, 3> ChainNodesMatched;
+    SmallVector<SDNode*, 3> GlueResultNodesMatched;
+
+    MatcherState(SDNode *N, const unsigned char *Table, unsigned Size)
+      : NodeToMatch(N), MatcherTable(Table), TableSize(Size) {}
+  };
+
+  /// RunMatcherTable - Interpret the matcher table of State starting at
+  /// MatcherIndex, with N as the current node.  Returns true and sets Result
+  /// if a pattern matched.  Otherwise returns false and leaves State as it
+  /// was on entry.
+  bool RunMatcherTable(MatcherState &State, SDValue N, unsigned MatcherIndex,
+                       SDNode *&Result);
+
+  /// MatchDirect - This function is generated by tblgen in targets built with
+  /// -direct-dag-isel.  It matches State.NodeToMatch against the target's
+  /// patterns and returns true and sets Result if one of them matched.
+  virtual bool MatchDirect(MatcherState &State, SDNode *&Result) {
+    llvm_unreachable("Tblgen should generate the implementation of this!");
+  }
+
 private:
 
   // Calls to these functions are generated by tblgen.
   SDNode *Select_INLINEASM(SDNode *N);
   SDNode *Select_UNDEF(SDNode *N);
   void CannotYetSelect(SDNode *N);
+  bool SelectWithoutPattern(SDNode *N, SDNode *&Result);
 
 private:
   void DoInstructionSelection();
@@ -278,6 +333,11 @@ private:
   ///
   ScheduleDAGSDNodes *CreateScheduler();
 
+  /// FallbackReport - With -fast-isel-report, the instructions FastISel left
+  /// to SelectionDAG, counted by opcode and type for the current function and
+  /// for the whole module.  Null otherwise.
+  FastISelFallbackReport *FallbackReport;
+
   /// OpcodeOffset - This is a cache used to dispatch efficiently into isel
   /// state machines that start with a OPC_SwitchOpcode node.
   std::vector<unsigned> OpcodeOffset;
@@ -92,6 +92,29 @@ public:
   void *RemoveMapping(const MutexGuard &, const GlobalValue *ToUnmap);
 };
 
+/// \brief A future-like handle to the background code generation of a module
+/// started with ExecutionEngine::compileModuleAsync.
+///
+/// Poll it with isReady() or block on it with wait().  Once it is ready,
+/// looking up the module's functions only has to link the generated code,
+/// which happens on the thread doing the lookup.
+class AsyncCompileHandle {
+  ExecutionEngine *EE;
+  Module *M;
+
+public:
+  AsyncCompileHandle() : EE(0), M(0) {}
+  AsyncCompileHandle(ExecutionEngine *EE, Module *M) : EE(EE), M(M) {}
+
+  Module *getModule() const { return M; }
+
+  /// \brief Returns true if the module's code has been generated.
+  bool isReady() const;
+
+  /// \brief Blocks until the module's code has been generated.
+  void wait() const;
+};
+
 /// \brief Abstract interface for implementation execution of LLVM modules,
 /// designed to support both interpreter and just-in-time (JIT) compiler
 /// implementations.
@@ -256,6 +279,26 @@ public:
   // interpeter.
   virtual void finalizeObject() {}
 
+  /// compileModuleAsync - Start generating code for M, which must already have
+  /// been added to the engine, on a background thread and return at once.
+  /// The caller can keep running other code (in an interpreter, or a version
+  /// of the code compiled earlier) until the returned handle is ready.  No
+  /// other thread may touch M or anything else in its LLVMContext while it is
+  /// being compiled, so give each module compiled this way its own context.
+  /// Engines without background compilation generate the code on first use,
+  /// as usual.
+  virtual AsyncCompileHandle compileModuleAsync(Module *M) {
+    return AsyncCompileHandle(this, M);
+  }
+
+  /// isAsyncCompileDone - Return true unless code generation started by
+  /// compileModuleAsync is still pending for M.
+  virtual bool isAsyncCompileDone(Module *M) { return true; }
+
+  /// waitForAsyncCompile - Block until code generation started by
+  /// compileModuleAsync for M has finished.
+  virtual void waitForAsyncCompile(Module *M) {}
+
   /// runStaticConstructorsDestructors - This method is used to execute all of
   /// the static constructors or destructors for a program.
   ///
@@ -470,6 +513,15 @@ protected:
                            Type *Ty);
 };
 
+inline bool AsyncCompileHandle::isReady() const {
+  return !EE || EE->isAsyncCompileDone(M);
+}
+
+inline void AsyncCompileHandle::wait() const {
+  if (EE)
+    EE->waitForAsyncCompile(M);
+}
+
 namespace EngineKind {
   // These are actually bitmasks that get or-ed together.
   enum Kind {
@@ -66,6 +66,12 @@ public:
   ///
   /// Returns true if an error occurred, false otherwise.
   virtual bool applyPermissions(std::string *ErrMsg = 0) = 0;
+
+  /// This method is called when the object that owns a section is unloaded.
+  /// Addr is the address previously returned by allocateCodeSection or
+  /// allocateDataSection for SectionID.  Memory managers that do not reclaim
+  /// memory may ignore it.
+  virtual void deallocateSection(uint8_t *Addr, unsigned SectionID) {}
 };
 
 class RuntimeDyld {
@@ -90,6 +96,11 @@ public:
   /// failure, the input buffer will be deleted.
   ObjectImage *loadObject(ObjectBuffer *InputBuffer);
 
+  /// Unload an object previously returned by loadObject.  Its sections are
+  /// handed back to the memory manager and its symbols are removed from the
+  /// global symbol table.  Ownership of Obj stays with the caller.
+  void unloadObject(ObjectImage *Obj);
+
   /// Get the address of our local copy of the symbol. This may or may not
   /// be the address used for relocation (clients can copy the data around
   /// and resolve relocatons based on where they put it).
@@ -102,6 +113,12 @@ public:
   /// Resolve the relocations for all symbols we currently know about.
   void resolveRelocations();
 
+  /// Resolve the relocations for all symbols we currently know about and then
+  /// forget them.  Call this right before the memory manager applies its final
+  /// page permissions: sections loaded so far are never written to again, so
+  /// later calls only relocate objects loaded after this point.
+  void finalizeRelocations();
+
   /// Map a section to its target address space value.
   /// Map the address of a JIT section as returned from the memory manager
   /// to the address in the target process as the running code will see it.
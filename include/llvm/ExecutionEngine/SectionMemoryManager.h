@@ -72,6 +72,12 @@ public:
   /// \returns true if an error occurred, false otherwise.
   virtual bool applyPermissions(std::string *ErrMsg = 0);
 
+  /// \brief Releases a section allocated by this memory manager.
+  ///
+  /// Sections are carved out of larger mapped blocks.  A block is unmapped
+  /// once the last section allocated from it has been released.
+  virtual void deallocateSection(uint8_t *Addr, unsigned SectionID);
+
   /// This method returns the address of the specified function. As such it is
   /// only useful for resolving library symbols, not code generated symbols.
   ///
@@ -95,6 +101,8 @@ public:
 private:
   struct MemoryGroup {
       SmallVector<sys::MemoryBlock, 16> AllocatedMem;
+      // The number of live sections in each block of AllocatedMem.
+      SmallVector<unsigned, 16> SectionCount;
       SmallVector<sys::MemoryBlock, 16> FreeMem;
       sys::MemoryBlock Near;
   };
@@ -102,6 +110,8 @@ private:
   uint8_t *allocateSection(MemoryGroup &MemGroup, uintptr_t Size,
                            unsigned Alignment);
 
+  bool deallocateSection(MemoryGroup &MemGroup, uint8_t *Addr);
+
   error_code applyMemoryGroupPermissions(MemoryGroup &MemGroup,
                                          unsigned Permissions);
 
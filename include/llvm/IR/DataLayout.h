@@ -24,6 +24,7 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/DataTypes.h"
+#include "llvm/Support/Mutex.h"
 
 namespace llvm {
 
@@ -117,8 +118,10 @@ private:
   /// type and bit width were not found in the DenseSet.
   static const PointerAlignElem InvalidPointerElem;
 
-  // The StructType -> StructLayout map.
+  // The StructType -> StructLayout map, and the lock that guards it when
+  // LLVM is multithreaded.
   mutable void *LayoutMap;
+  mutable sys::SmartMutex<true> LayoutMapLock;
 
   //! Set/initialize target alignments
   void setAlignment(AlignTypeEnum align_type, unsigned abi_align,
@@ -179,6 +182,8 @@ public:
     LayoutMap(0)
   { }
 
+  virtual Pass *createClone() const { return new DataLayout(*this); }
+
   ~DataLayout();  // Not virtual, do not subclass this class
 
   /// DataLayout is an immutable pass, but holds state.  This allows the pass
@@ -31,7 +31,8 @@ template <typename T> class SmallVectorImpl;
 /// (opaquely) owns and manages the core "global" data of LLVM's core 
 /// infrastructure, including the type and constant uniquing tables.
 /// LLVMContext itself provides no locking guarantees, so you should be careful
-/// to have one context per thread.
+/// to have one context per thread, unless the context has been put in
+/// concurrent mode with enableConcurrentUniquing.
 class LLVMContext {
 public:
   LLVMContextImpl *const pImpl;
@@ -57,6 +58,29 @@ public:
   /// getMDKindNames - Populate client supplied SmallVector with the name for
   /// custom metadata IDs registered in this LLVMContext.
   void getMDKindNames(SmallVectorImpl<StringRef> &Result) const;
+
+  /// enableConcurrentUniquing - Put this context in concurrent mode, in which
+  /// its type, constant, metadata and attribute uniquing tables (and the
+  /// other context-wide maps, such as those for value handles and instruction
+  /// metadata) may be read and inserted into by several threads at once.
+  /// This lets threads share types and constants instead of each needing a
+  /// context of its own.  It must be called before the context is used by
+  /// more than one thread, and cannot be undone.
+  ///
+  /// Threads may create, modify and delete instructions that use the same
+  /// constants, globals or metadata, as the use lists of those values are
+  /// locked while they change.  Enabling concurrent mode on any context makes
+  /// every use list update in the process check for this, which is why it is
+  /// off by default.  The IR is otherwise not synchronized: a module,
+  /// function or instruction must only be modified by one thread at a time,
+  /// and walking the use list of a shared value (use_begin, hasOneUse, RAUW
+  /// and so on) or destroying a constant must not race with other threads
+  /// using that value.
+  void enableConcurrentUniquing();
+
+  /// isConcurrentUniquingEnabled - Return true if enableConcurrentUniquing
+  /// has been called on this context.
+  bool isConcurrentUniquingEnabled() const;
   
   
   typedef void (*InlineAsmDiagHandlerTy)(const SMDiagnostic&, void *Context,
@@ -70,7 +70,11 @@ private:
 
   /// Destructor - Only for zap()
   ~Use() {
-    if (Val) removeFromList();
+    if (!Val) return;
+    if (LLVM_UNLIKELY(LockSharedLists))
+      removeFromListLocked();
+    else
+      removeFromList();
   }
 
   enum PrevPtrTag { zeroDigitTag
@@ -120,6 +124,12 @@ public:
   /// a User changes.
   static void zap(Use *Start, const Use *Stop, bool del = false);
 
+  /// LockSharedLists - Set once some LLVMContext has been put in concurrent
+  /// mode.  The use list operations then go through the out-of-line versions
+  /// in Use.cpp, which lock the use lists of values that may be shared between
+  /// threads (constants, globals, metadata and inline asm).
+  static bool LockSharedLists;
+
 private:
   const Use* getImpliedUser() const;
   
@@ -142,6 +152,10 @@ private:
     if (Next) Next->setPrev(StrippedPrev);
   }
 
+  void setLocked(Value *V);
+  void addToListLocked();
+  void removeFromListLocked();
+
   friend class Value;
 };
 
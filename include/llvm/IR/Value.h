@@ -323,6 +323,10 @@ inline raw_ostream &operator<<(raw_ostream &OS, const Value &V) {
 }
   
 void Use::set(Value *V) {
+  if (LLVM_UNLIKELY(LockSharedLists)) {
+    setLocked(V);
+    return;
+  }
   if (Val) removeFromList();
   Val = V;
   if (V) V->addUse(*this);
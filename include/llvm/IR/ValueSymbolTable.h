@@ -77,6 +77,12 @@ public:
   /// @brief The number of name/type pairs is returned.
   inline unsigned size() const { return unsigned(vmap.size()); }
 
+  /// The suffix appended to the last name that had to be made unique.  Along
+  /// with the names in the table, it determines how later conflicting names
+  /// are renamed.
+  /// @brief Get the counter used to make names unique.
+  unsigned getLastUnique() const { return LastUnique; }
+
   /// This function can be used from the debugger to display the
   /// content of the symbol table while debugging.
   /// @brief Print out symbol table on stderr
@@ -101,6 +107,12 @@ public:
 /// @}
 /// @name Mutators
 /// @{
+public:
+  /// This is used to carry the counter over to a copy of the owner of the
+  /// table, so that both rename conflicting names the same way.
+  /// @brief Set the counter used to make names unique.
+  void setLastUnique(unsigned Counter) { LastUnique = Counter; }
+
 private:
   /// This method adds the provided value \p N to the symbol table.  The Value
   /// must have a name which is used to place the value in the symbol table. 
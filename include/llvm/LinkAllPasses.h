@@ -159,9 +159,11 @@ namespace {
       (void) llvm::createLowerAtomicPass();
       (void) llvm::createCorrelatedValuePropagationPass();
       (void) llvm::createMemDepPrinter();
+      (void) llvm::createMemorySSAPrinter();
       (void) llvm::createInstructionSimplifierPass();
       (void) llvm::createLoopVectorizePass();
       (void) llvm::createBBVectorizePass();
+      (void) llvm::createSLPVectorizerPass();
 
       (void)new llvm::IntervalPartition();
       (void)new llvm::FindUsedTypes();
@@ -53,7 +53,8 @@ class Linker {
 
     enum LinkerMode {
       DestroySource = 0, // Allow source module to be destroyed.
-      PreserveSource = 1 // Preserve the source module.
+      PreserveSource = 1, // Preserve the source module.
+      LinkOnlyNeeded = 2 // Only link in functions the destination refers to.
     };
 
   /// @}
@@ -166,6 +167,12 @@ class Linker {
     /// and etc. are matched and resolved.  If an error occurs, this function
     /// returns true and ErrorMsg is set to a descriptive message about the
     /// error.
+    ///
+    /// \p Mode is DestroySource or PreserveSource, optionally or'd with
+    /// LinkOnlyNeeded.  Function bodies of a lazily loaded \p Src are only
+    /// read when they are linked in.  With LinkOnlyNeeded, a function defined
+    /// in \p Src is only linked in if something linked into \p Dest refers
+    /// to it, so the bodies of unreferenced functions are never read at all.
     /// @returns True if an error occurs, false otherwise.
     /// @brief Generically link two modules together.
     static bool LinkModules(Module* Dest, Module* Src, unsigned Mode,
@@ -12,6 +12,7 @@
 
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
+#include <vector>
 
 namespace llvm {
 class MCAssembler;
@@ -42,6 +43,18 @@ private:
   /// lower ordinal will be valid.
   mutable DenseMap<const MCSectionData*, MCFragment*> LastValidFragment;
 
+  /// The offset changes made by updateFragmentOffsets() that haven't been
+  /// applied to the fragments yet, for each section.  This is a Fenwick tree
+  /// indexed by layout order: the sum of the entries up to a fragment's order
+  /// is how far it has moved.
+  DenseMap<const MCSectionData*, std::vector<int64_t> > PendingShifts;
+
+  /// The fragments of each section whose offset can't simply move along with
+  /// the fragments before them: the ones following an alignment or org
+  /// fragment and, with bundling, the ones with instructions.  Only computed
+  /// for the sections that had fragments resized.
+  DenseMap<const MCSectionData*, std::vector<MCFragment*> > OffsetDependent;
+
   /// \brief Make sure that the layout for the given fragment is valid, lazily
   /// computing it if necessary.
   void ensureValid(const MCFragment *F) const;
@@ -54,6 +67,21 @@ private:
   uint64_t computeBundlePadding(const MCFragment *F,
                                 uint64_t FOffset, uint64_t FSize);
 
+  /// \brief Get how far F has moved since its offset was last set.
+  int64_t getPendingShift(const MCFragment *F) const;
+
+  /// \brief Record that F and the fragments after it have moved by Delta.
+  void addPendingShift(const MCFragment *F, int64_t Delta);
+
+  /// \brief Compute and set the bundle padding of F when placed at FOffset.
+  uint64_t computeFragmentBundlePadding(MCFragment *F, uint64_t FOffset);
+
+  /// \brief Compute the offset of F from the end of the fragment before it,
+  /// along with its bundle padding, and record the change.  If F has moved,
+  /// the fragment before it is appended to Moved.  Returns how far F has
+  /// moved.
+  int64_t relayoutFragment(MCFragment *F, SmallVectorImpl<MCFragment*> &Moved);
+
 public:
   MCAsmLayout(MCAssembler &_Assembler);
 
@@ -65,6 +93,20 @@ public:
   /// its bundle padding will be recomputed.
   void invalidateFragmentsFrom(MCFragment *F);
 
+  /// \brief Update the offsets of the fragments that follow Resized, whose
+  /// size has changed.  Its section must have been laid out completely.
+  /// Rather than setting the offset of every fragment that follows, the
+  /// change is recorded as a delta which getFragmentOffset() adds, and only
+  /// the fragments whose offset doesn't simply move along are laid out again.
+  /// Every fragment after which the offsets moved by a different amount than
+  /// before it is appended to Moved.
+  void updateFragmentOffsets(MCFragment *Resized,
+                             SmallVectorImpl<MCFragment*> &Moved);
+
+  /// \brief Apply the offset changes made by updateFragmentOffsets() to the
+  /// fragments of every section.
+  void applyPendingShifts();
+
   /// \brief Perform layout for a single fragment, assuming that the previous
   /// fragment has already been laid out correctly, and the parent section has
   /// been initialized.
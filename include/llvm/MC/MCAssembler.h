@@ -904,13 +904,14 @@ private:
   bool fragmentNeedsRelaxation(const MCRelaxableFragment *IF,
                                const MCAsmLayout &Layout) const;
 
-  /// \brief Perform one layout iteration and return true if any offsets
-  /// were adjusted.
-  bool layoutOnce(MCAsmLayout &Layout);
+  /// \brief Relax the fragments until the layout no longer changes.  After a
+  /// first visit of every fragment, only the fragments whose value depends on
+  /// fragments that moved are visited again.
+  void relaxFragments(MCAsmLayout &Layout);
 
-  /// \brief Perform one layout iteration of the given section and return true
-  /// if any offsets were adjusted.
-  bool layoutSectionOnce(MCAsmLayout &Layout, MCSectionData &SD);
+  /// \brief Relax the given fragment if it is of a relaxable kind and return
+  /// true if its size changed.
+  bool relaxFragment(MCAsmLayout &Layout, MCFragment &F);
 
   bool relaxInstruction(MCAsmLayout &Layout, MCRelaxableFragment &IF);
 
@@ -946,6 +947,13 @@ public:
   void writeSectionData(const MCSectionData *Section,
                         const MCAsmLayout &Layout) const;
 
+  /// Emit the section contents using \p OW instead of the assembler's own
+  /// object writer.  Once layout is complete this only reads the assembler and
+  /// the layout, so different sections may be written concurrently, each
+  /// through its own writer.
+  void writeSectionData(const MCSectionData *Section,
+                        const MCAsmLayout &Layout, MCObjectWriter &OW) const;
+
   /// Check whether a given symbol has been flagged with .thumb_func.
   bool isThumbFunc(const MCSymbol *Func) const {
     return ThumbFuncs.count(Func);
@@ -15,6 +15,7 @@
 #include "llvm/Support/DataTypes.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cassert>
+#include <string>
 
 namespace llvm {
 class MCAsmLayout;
@@ -45,6 +46,9 @@ protected:
 
   unsigned IsLittleEndian : 1;
 
+  /// The path of the regular file written by the stream, if known.
+  std::string OutputFile;
+
 protected: // Can only create subclasses.
   MCObjectWriter(raw_ostream &_OS, bool _IsLittleEndian)
     : OS(_OS), IsLittleEndian(_IsLittleEndian) {}
@@ -59,6 +63,15 @@ public:
 
   raw_ostream &getStream() { return OS; }
 
+  /// \brief Tell the writer that its stream writes to the regular file \p
+  /// Path.
+  ///
+  /// A writer which knows the size of the whole object file up front may then
+  /// write it directly into a mapping of the file rather than through the
+  /// stream, in which case nothing is written to the stream.
+  void setOutputFile(StringRef Path) { OutputFile = Path; }
+  StringRef getOutputFile() const { return OutputFile; }
+
   /// @name High-Level API
   /// @{
 
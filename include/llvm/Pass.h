@@ -163,6 +163,14 @@ public:
   ///
   virtual void releaseMemory();
 
+  /// createClone - Return a new pass configured the same way as this one, so
+  /// that it can run on a copy of the module in another LLVMContext on a
+  /// worker thread (see -function-pass-threads), or null if the pass does not
+  /// support this, which is the default.  The clone must not share mutable
+  /// state with this pass, and the pass must not carry state from one
+  /// function to the next or into doFinalization.
+  virtual Pass *createClone() const;
+
   /// getAdjustedAnalysisPointer - This method is used when a pass implements
   /// an analysis interface through multiple inheritance.  If needed, it should
   /// override this to adjust the this pointer as needed for the specified pass
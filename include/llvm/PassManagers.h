@@ -347,6 +347,13 @@ public:
     return (unsigned)PassVector.size();
   }
 
+  /// getContainedPassAt - Return the N'th pass managed by this manager,
+  /// whatever the kind of the manager.
+  Pass *getContainedPassAt(unsigned N) const {
+    assert(N < PassVector.size() && "Pass number out of range!");
+    return PassVector[N];
+  }
+
   virtual PassManagerType getPassManagerType() const {
     assert ( 0 && "Invalid use of getPassManagerType");
     return PMT_Unknown;
@@ -398,6 +405,37 @@ private:
   unsigned Depth;
 };
 
+/// FunctionShards - The functions of a module that an FPPassManager hands to
+/// worker threads when -function-pass-threads is given.  The workers run the
+/// first passes of the manager on copies of the functions in their own
+/// LLVMContext, and the results are moved back into the module one function
+/// at a time, in module order, by takeFunction.
+class FunctionShards {
+  unsigned NumPasses;
+  SmallVector<unsigned, 4> RecomputedPasses;
+
+public:
+  FunctionShards(unsigned NumPasses, ArrayRef<unsigned> Recomputed)
+    : NumPasses(NumPasses), RecomputedPasses(Recomputed.begin(),
+                                             Recomputed.end()) {}
+  virtual ~FunctionShards();
+
+  /// getNumPasses - Return the number of passes at the start of the manager
+  /// that the workers run.
+  unsigned getNumPasses() const { return NumPasses; }
+
+  /// getRecomputedPasses - Return the indices, in increasing order, of the
+  /// analyses among the passes the workers run whose results are used by the
+  /// rest of the manager.  They are run again on each function that is taken.
+  ArrayRef<unsigned> getRecomputedPasses() const { return RecomputedPasses; }
+
+  /// takeFunction - If F was handled by a worker, replace its body with the
+  /// worker's result, set Changed to whether the worker changed it, and
+  /// return true.  Otherwise return false, and F must be run through the
+  /// whole manager on the calling thread.
+  virtual bool takeFunction(Function &F, bool &Changed) = 0;
+};
+
 //===----------------------------------------------------------------------===//
 // FPPassManager
 //
@@ -413,9 +451,29 @@ public:
 
   /// run - Execute all of the passes scheduled for execution.  Keep track of
   /// whether any of the passes modifies the module, and if so, return true.
-  bool runOnFunction(Function &F);
+  bool runOnFunction(Function &F, unsigned FirstPass = 0);
   bool runOnModule(Module &M);
 
+  /// recomputeAnalysis - Run the analysis at Index on F again, for the passes
+  /// after the ones that ran on a worker thread.
+  void recomputeAnalysis(Function &F, unsigned Index);
+
+  /// getNumShardablePasses - Return the number of passes at the start of this
+  /// manager that can be run on functions on worker threads: each of them
+  /// either is an analysis or supports Pass::createClone, and only uses
+  /// analyses that are computed by these passes or are cloneable immutable
+  /// passes.  Nothing they compute may be used by the remaining passes,
+  /// except for analyses that only use immutable passes; the indices of those
+  /// are added to Recomputed, and they must be run again on the calling
+  /// thread.
+  unsigned getNumShardablePasses(SmallVectorImpl<unsigned> &Recomputed);
+
+  /// ShardFunctions - If set, called by runOnModule to hand the functions of
+  /// M to worker threads.  It returns null if it does not shard M.  This is a
+  /// hook because the workers need the bitcode reader and writer, which the
+  /// IR library cannot depend on; see llvm::enableFunctionPassThreads.
+  static FunctionShards *(*ShardFunctions)(FPPassManager &FPPM, Module &M);
+
   /// cleanup - After running all passes, clean up pass manager cache.
   void cleanup();
 
@@ -465,6 +523,34 @@ public:
 
 Timer *getPassTimer(Pass *);
 
+/// PassTraceRegion - Records a run of a pass over a unit of IR in the report
+/// written when -pass-trace is given, along with the wall time it took, the
+/// number of instructions in the unit before and after, and how far the
+/// process' peak resident set size grew meanwhile.  Runs of pass managers are
+/// recorded too, so events nest the way the PMDataManagers do.  Does nothing
+/// unless -pass-trace is enabled.
+class PassTraceRegion {
+  Pass *P;
+  const Module *M;
+  const Function *F;
+  const BasicBlock *BB;
+  std::string Unit;
+  uint64_t StartTime;
+  unsigned InstsBefore;
+  size_t PeakRSSBefore;
+
+  void start();
+
+public:
+  PassTraceRegion(Pass *P, Module &M);
+  PassTraceRegion(Pass *P, Function &F);
+  PassTraceRegion(Pass *P, BasicBlock &BB);
+  /// Record a run over a unit of IR the pass may delete, such as a call graph
+  /// SCC; instructions are not counted.
+  PassTraceRegion(Pass *P, StringRef Unit);
+  ~PassTraceRegion();
+};
+
 }
 
 #endif
@@ -0,0 +1,78 @@
+//===-- llvm/Support/FileCache.h - Content addressed file cache -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the FileCache class, an on-disk cache of files keyed by
+// a hash of everything that went into producing them.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_FILECACHE_H
+#define LLVM_SUPPORT_FILECACHE_H
+
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/DataTypes.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/system_error.h"
+
+namespace llvm {
+
+class MemoryBuffer;
+
+/// FileCache - A directory of files named after the MD5 digest of their key.
+///
+/// Entries are written to a temporary file that is renamed into place, so
+/// several processes can share one cache directory without ever observing a
+/// partially written entry.  The cache can be bounded in size, in which case
+/// the least recently used entries are evicted first.
+class FileCache {
+  SmallString<128> Directory;
+  uint64_t MaxSize;
+
+public:
+  /// Key - Accumulates the inputs that determine a cache entry.
+  class Key {
+    MD5 Hash;
+
+  public:
+    /// add - Add \p Data to the key.  Every piece of data is prefixed by its
+    /// length, so that adjacent strings cannot be confused with each other.
+    Key &add(StringRef Data);
+    Key &add(uint64_t Value);
+
+    /// str - Return the key as a hexadecimal string.  The key must not be
+    /// modified afterwards.
+    std::string str();
+  };
+
+  /// Create a cache in \p Dir.  If \p MaxSize is not zero, prune() keeps the
+  /// total size of the entries at or below that many bytes.
+  FileCache(StringRef Dir, uint64_t MaxSize = 0);
+
+  /// lookup - If the cache has an entry for \p K, read it into \p Result,
+  /// mark it as recently used and return true.
+  bool lookup(StringRef K, OwningPtr<MemoryBuffer> &Result);
+
+  /// store - Add \p Data to the cache under \p K, replacing any existing
+  /// entry.
+  error_code store(StringRef K, StringRef Data);
+
+  /// prune - Evict least recently used entries until the cache fits in its
+  /// size limit.  If another process is already pruning the cache, this
+  /// does nothing.
+  void prune();
+
+private:
+  void getEntryPath(StringRef K, SmallVectorImpl<char> &Path) const;
+};
+
+} // end namespace llvm
+
+#endif
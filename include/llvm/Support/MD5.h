@@ -0,0 +1,57 @@
+//===- llvm/Support/MD5.h - MD5 message digest algorithm --------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the MD5 class, which computes the MD5 digest (RFC 1321)
+// of a stream of bytes.  Unlike the hash_code machinery in ADT/Hashing.h, the
+// result is stable across executions and hosts, so it can be used to name
+// things that are stored on disk.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_MD5_H
+#define LLVM_SUPPORT_MD5_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/DataTypes.h"
+
+namespace llvm {
+
+class MD5 {
+  uint32_t A, B, C, D;
+  uint64_t Length;
+  uint8_t Buffer[64];
+
+public:
+  typedef uint8_t MD5Result[16];
+
+  MD5();
+
+  /// update - Add the bytes in \p Data to the digest.
+  void update(ArrayRef<uint8_t> Data);
+
+  /// update - Add the bytes of \p Str to the digest.
+  void update(StringRef Str);
+
+  /// final - Finish the digest and store it in \p Result.  The object must
+  /// not be updated afterwards.
+  void final(MD5Result &Result);
+
+  /// stringifyResult - Translate \p Result to a 32 character lowercase
+  /// hexadecimal string in \p Str.
+  static void stringifyResult(const MD5Result &Result, SmallString<32> &Str);
+
+private:
+  const uint8_t *body(const uint8_t *Data, size_t Size);
+};
+
+}
+
+#endif
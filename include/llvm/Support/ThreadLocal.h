@@ -33,7 +33,7 @@ namespace llvm {
         ThreadLocalDataTy align_data;
       };
     public:
-      ThreadLocalImpl();
+      explicit ThreadLocalImpl(void (*Destructor)(void *) = 0);
       virtual ~ThreadLocalImpl();
       void setInstance(const void* d);
       const void* getInstance();
@@ -47,6 +47,12 @@ namespace llvm {
     public:
       ThreadLocal() : ThreadLocalImpl() { }
 
+      /// ThreadLocal - Call \p Destructor with the pointer of each thread that
+      /// exits while it has a non-null one.  This is only done on hosts with
+      /// pthreads; elsewhere the pointers of exited threads are left alone.
+      explicit ThreadLocal(void (*Destructor)(void *))
+        : ThreadLocalImpl(Destructor) { }
+
       /// get - Fetches a pointer to the object associated with the current
       /// thread.  If no object has yet been associated, it returns NULL;
       T* get() { return static_cast<T*>(getInstance()); }
@@ -14,6 +14,8 @@
 #ifndef LLVM_SUPPORT_THREADING_H
 #define LLVM_SUPPORT_THREADING_H
 
+#include "llvm/ADT/ArrayRef.h"
+
 namespace llvm {
   /// llvm_start_multithreaded - Allocate and initialize structures needed to
   /// make LLVM safe for multithreading.  The return value indicates whether
@@ -54,6 +56,41 @@ namespace llvm {
   /// the thread stack.
   void llvm_execute_on_thread(void (*UserFn)(void*), void *UserData,
                               unsigned RequestedStackSize = 0);
+
+  /// llvm_execute_on_threads - Execute the given \p UserFn once for each
+  /// element of \p UserData, running the calls concurrently on separate
+  /// threads, and wait until all of them have finished.
+  ///
+  /// As with llvm_execute_on_thread, this function does not guarantee that
+  /// the calls are actually executed on separate threads.  Calls for which no
+  /// thread could be created are executed on the calling thread.
+  ///
+  /// \param UserFn - The callback to execute.
+  /// \param UserData - The arguments to pass to the callback, one per call.
+  /// \param RequestedStackSize - If non-zero, a requested size (in bytes) for
+  /// the thread stacks.
+  void llvm_execute_on_threads(void (*UserFn)(void*),
+                               ArrayRef<void*> UserData,
+                               unsigned RequestedStackSize = 0);
+
+  /// llvm_start_thread - Start executing the given \p UserFn on a separate
+  /// thread, passing it the provided \p UserData, and return without waiting
+  /// for it to finish.
+  ///
+  /// \returns An opaque handle that must be passed to llvm_join_thread
+  /// exactly once, or null if no thread could be started; the caller is then
+  /// responsible for getting the work done some other way.
+  ///
+  /// \param UserFn - The callback to execute.
+  /// \param UserData - An argument to pass to the callback function.
+  /// \param RequestedStackSize - If non-zero, a requested size (in bytes) for
+  /// the thread stack.
+  void *llvm_start_thread(void (*UserFn)(void*), void *UserData,
+                          unsigned RequestedStackSize = 0);
+
+  /// llvm_join_thread - Wait for a thread started by llvm_start_thread to
+  /// finish and release its resources.
+  void llvm_join_thread(void *Thread);
 }
 
 #endif
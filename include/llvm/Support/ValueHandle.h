@@ -72,7 +72,7 @@ public:
   ValueHandleBase(HandleBaseKind Kind, const ValueHandleBase &RHS)
     : PrevPair(0, Kind), Next(0), VP(RHS.VP) {
     if (isValid(VP.getPointer()))
-      AddToExistingUseList(RHS.getPrevPtr());
+      AddToUseListOf(RHS);
   }
   ~ValueHandleBase() {
     if (isValid(VP.getPointer()))
@@ -91,7 +91,7 @@ public:
     if (VP.getPointer() == RHS.VP.getPointer()) return RHS.VP.getPointer();
     if (isValid(VP.getPointer())) RemoveFromUseList();
     VP.setPointer(RHS.VP.getPointer());
-    if (isValid(VP.getPointer())) AddToExistingUseList(RHS.getPrevPtr());
+    if (isValid(VP.getPointer())) AddToUseListOf(RHS);
     return VP.getPointer();
   }
 
@@ -132,6 +132,9 @@ private:
 
   /// AddToUseList - Add this ValueHandle to the use list for VP.
   void AddToUseList();
+  /// AddToUseListOf - Add this ValueHandle to the use list of RHS, which
+  /// watches the same value, just before RHS.
+  void AddToUseListOf(const ValueHandleBase &RHS);
   /// RemoveFromUseList - Remove this ValueHandle from its current use list.
   void RemoveFromUseList();
 };
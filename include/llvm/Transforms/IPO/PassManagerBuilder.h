@@ -105,6 +105,7 @@ public:
   bool DisableUnrollLoops;
   bool Vectorize;
   bool LoopVectorize;
+  bool SLPVectorize;
 
 private:
   /// ExtensionList - This is list of all of the extensions that are registered.
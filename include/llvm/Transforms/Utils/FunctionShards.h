@@ -0,0 +1,39 @@
+//===-- FunctionShards.h - Run function passes on worker threads -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the hook that lets function pass managers run their
+// first passes on worker threads when -function-pass-threads is given.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_UTILS_FUNCTIONSHARDS_H
+#define LLVM_TRANSFORMS_UTILS_FUNCTIONSHARDS_H
+
+namespace llvm {
+
+/// Make function pass managers honor -function-pass-threads=N.  With N > 1,
+/// the definitions of a module are divided into N contiguous shards, and the
+/// passes at the start of the manager that support Pass::createClone (along
+/// with the analyses they use) run on each shard on its own thread, in a
+/// copy of the module in a separate LLVMContext.  Analyses among them that
+/// the rest of the passes use, like the dominator tree, do not stop the
+/// workers; they are computed again on the calling thread, so in llc every
+/// IR pass before instruction selection runs on the workers.  The results
+/// are moved back into the module one function at a time, in module order,
+/// before the rest of the passes run on the function on the calling thread,
+/// so the output is the same as without threads.  A function whose passes
+/// changed anything besides its own body, other than adding declarations or
+/// local globals, is run again on the calling thread, as are the functions
+/// after it in its shard.  libLTO honors the option too, given as a code
+/// generator option.
+void enableFunctionPassThreads();
+
+} // End llvm namespace
+
+#endif
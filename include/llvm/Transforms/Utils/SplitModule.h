@@ -0,0 +1,56 @@
+//===-- SplitModule.h - Split a module into partitions ----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This family of functions divides the definitions of a module into
+// partitions that can be code generated independently, and restricts copies
+// of the module to one partition each.  Linking the restricted copies back
+// together gives the module the partitions were computed for.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_UTILS_SPLITMODULE_H
+#define LLVM_TRANSFORMS_UTILS_SPLITMODULE_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringSet.h"
+
+namespace llvm {
+
+class GlobalValue;
+class Module;
+
+/// ModulePartitionMap - The partition that defines each global value.
+typedef DenseMap<const GlobalValue*, unsigned> ModulePartitionMap;
+
+/// Assign every global value defined in \p M to one of \p NumPartitions
+/// partitions.  Functions are grouped by call graph SCC and the groups are
+/// distributed so as to balance the number of instructions per partition.
+/// Aliases stay with their aliasees, functions whose blockaddresses are used
+/// stay with their users, and global variables follow their first user.
+void partitionModule(Module &M, unsigned NumPartitions,
+                     ModulePartitionMap &Partitions);
+
+/// Give every local global value of \p M that is referenced from a partition
+/// other than its own a unique external (but hidden) name, and name all
+/// unnamed definitions, so that the partitions can refer to each other's
+/// symbols.  This must be done before \p M is copied for each partition.
+void promoteCrossPartitionReferences(Module &M,
+                                     const ModulePartitionMap &Partitions);
+
+/// Turn every global value in \p M, a copy of the module the partitions were
+/// computed for, that is not named in \p Defined into an external
+/// declaration, and drop the ones the partition does not refer to.  Appending
+/// globals such as llvm.global_ctors are kept only if \p KeepAppending is set,
+/// which should be the case for exactly one partition.
+void restrictToPartition(Module &M, const StringSet<> &Defined,
+                         bool KeepAppending);
+
+} // End llvm namespace
+
+#endif // LLVM_TRANSFORMS_UTILS_SPLITMODULE_H
@@ -59,6 +59,21 @@ bool AliasAnalysis::pointsToConstantMemory(const Location &Loc,
   return AA->pointsToConstantMemory(Loc, OrLocal);
 }
 
+void AliasAnalysis::beginCacheScope() {
+  assert(AA && "AA didn't call InitializeAliasAnalysis in its run method!");
+  AA->beginCacheScope();
+}
+
+void AliasAnalysis::endCacheScope() {
+  assert(AA && "AA didn't call InitializeAliasAnalysis in its run method!");
+  AA->endCacheScope();
+}
+
+void AliasAnalysis::addCacheCounts(CacheCounts &Counts) {
+  assert(AA && "AA didn't call InitializeAliasAnalysis in its run method!");
+  AA->addCacheCounts(Counts);
+}
+
 void AliasAnalysis::deleteValue(Value *V) {
   assert(AA && "AA didn't call InitializeAliasAnalysis in its run method!");
   AA->deleteValue(V);
@@ -31,6 +31,7 @@ namespace {
   class AliasAnalysisCounter : public ModulePass, public AliasAnalysis {
     unsigned No, May, Partial, Must;
     unsigned NoMR, JustRef, JustMod, MR;
+    CacheCounts Cache;
     Module *M;
   public:
     static char ID; // Class identification, replacement for typeinfo
@@ -44,6 +45,16 @@ namespace {
       errs() <<  "  " << Val << " " << Desc << " responses ("
              << Val*100/Sum << "%)\n";
     }
+    void printCacheLine(const char *Desc, uint64_t Lookups, uint64_t Hits) {
+      errs() << "  " << Lookups << " " << Desc << " Cache Lookups, " << Hits
+             << " hits (" << (Lookups ? Hits*100/Lookups : 0) << "%)\n";
+    }
+    /// updateCacheCounts - Take the counts of the caches of the analyses below
+    /// after a query, as they may be gone by the time the report is printed.
+    void updateCacheCounts() {
+      Cache = CacheCounts();
+      getAnalysis<AliasAnalysis>().addCacheCounts(Cache);
+    }
     ~AliasAnalysisCounter() {
       unsigned AASum = No+May+Partial+Must;
       unsigned MRSum = NoMR+JustRef+JustMod+MR;
@@ -72,6 +83,12 @@ namespace {
                  << "%/" << JustRef*100/MRSum << "%/" << JustMod*100/MRSum
                  << "%/" << MR*100/MRSum <<"%\n\n";
         }
+
+        if (Cache.AliasLookups + Cache.GEPLookups) {
+          printCacheLine("Alias Query", Cache.AliasLookups, Cache.AliasHits);
+          printCacheLine("GEP Decomposition", Cache.GEPLookups, Cache.GEPHits);
+          errs() << "\n";
+        }
       }
     }
 
@@ -126,6 +143,7 @@ ModulePass *llvm::createAliasAnalysisCounterPass() {
 AliasAnalysis::AliasResult
 AliasAnalysisCounter::alias(const Location &LocA, const Location &LocB) {
   AliasResult R = getAnalysis<AliasAnalysis>().alias(LocA, LocB);
+  updateCacheCounts();
 
   const char *AliasString = 0;
   switch (R) {
@@ -152,6 +170,7 @@ AliasAnalysis::ModRefResult
 AliasAnalysisCounter::getModRefInfo(ImmutableCallSite CS,
                                     const Location &Loc) {
   ModRefResult R = getAnalysis<AliasAnalysis>().getModRefInfo(CS, Loc);
+  updateCacheCounts();
 
   const char *MRString = 0;
   switch (R) {
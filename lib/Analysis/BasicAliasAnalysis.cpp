@@ -32,12 +32,20 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Operator.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/GetElementPtrTypeIterator.h"
+#include "llvm/Support/ValueHandle.h"
 #include "llvm/Target/TargetLibraryInfo.h"
 #include <algorithm>
 using namespace llvm;
 
+static cl::opt<bool>
+EnableCache("basicaa-cache", cl::init(false), cl::Hidden,
+            cl::desc("Keep the results of alias queries and decomposed GEPs "
+                     "while a client pass is in a cache scope, until the "
+                     "values they depend on are deleted or replaced"));
+
 //===----------------------------------------------------------------------===//
 // Useful predicates
 //===----------------------------------------------------------------------===//
@@ -138,6 +146,13 @@ namespace {
       return !operator==(Other);
     }
   };
+
+  /// DecomposedGEP - The result of DecomposeGEPExpression for a pointer.
+  struct DecomposedGEP {
+    const Value *Base;
+    int64_t BaseOffs;
+    SmallVector<VariableGEPIndex, 4> VarIndices;
+  };
 }
 
 
@@ -428,10 +443,12 @@ namespace {
   /// BasicAliasAnalysis - This is the primary alias analysis implementation.
   struct BasicAliasAnalysis : public ImmutablePass, public AliasAnalysis {
     static char ID; // Class identification, replacement for typeinfo
-    BasicAliasAnalysis() : ImmutablePass(ID) {
+    BasicAliasAnalysis() : ImmutablePass(ID), CacheScopes(0) {
       initializeBasicAliasAnalysisPass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *createClone() const { return new BasicAliasAnalysis(); }
+
     virtual void initializePass() {
       InitializeAliasAnalysis(this);
     }
@@ -446,6 +463,8 @@ namespace {
       assert(AliasCache.empty() && "AliasCache must be cleared after use!");
       assert(notDifferentParent(LocA.Ptr, LocB.Ptr) &&
              "BasicAliasAnalysis doesn't support interprocedural queries.");
+      if (isCaching())
+        return cachedAlias(LocA, LocB);
       AliasResult Alias = aliasCheck(LocA.Ptr, LocA.Size, LocA.TBAATag,
                                      LocB.Ptr, LocB.Size, LocB.TBAATag);
       // AliasCache rarely has more than 1 or 2 elements, always use
@@ -477,6 +496,39 @@ namespace {
     /// For use when the call site is not known.
     virtual ModRefBehavior getModRefBehavior(const Function *F);
 
+    /// beginCacheScope - Start keeping results under -basicaa-cache.  Scopes
+    /// may nest, the cache starts empty at the outermost one.
+    virtual void beginCacheScope() {
+      if (CacheScopes++ == 0)
+        clearCache();
+      AliasAnalysis::beginCacheScope();
+    }
+
+    /// endCacheScope - Drop the results when the outermost scope ends, the
+    /// next client may have changed the IR in ways the handles don't see.
+    virtual void endCacheScope() {
+      assert(CacheScopes && "endCacheScope without beginCacheScope!");
+      if (--CacheScopes == 0)
+        clearCache();
+      AliasAnalysis::endCacheScope();
+    }
+
+    /// addCacheCounts - Report the lookups in QueryCache and GEPCache.
+    virtual void addCacheCounts(CacheCounts &Counts) {
+      Counts.AliasLookups += CacheStats.AliasLookups;
+      Counts.AliasHits += CacheStats.AliasHits;
+      Counts.GEPLookups += CacheStats.GEPLookups;
+      Counts.GEPHits += CacheStats.GEPHits;
+      AliasAnalysis::addCacheCounts(Counts);
+    }
+
+    /// addEscapingUse - Cached results may rely on a pointer not escaping,
+    /// drop them all.
+    virtual void addEscapingUse(Use &U) {
+      clearCache();
+      AliasAnalysis::addEscapingUse(U);
+    }
+
     /// getAdjustedAnalysisPointer - This method is used when a pass implements
     /// an analysis interface through multiple inheritance.  If needed, it
     /// should override this to adjust the this pointer as needed for the
@@ -496,6 +548,50 @@ namespace {
     // Visited - Track instructions visited by pointsToConstantMemory.
     SmallPtrSet<const Value*, 16> Visited;
 
+    /// AliasCacheVH - A handle on a value that cached results depend on,
+    /// which drops them when the value is deleted or replaced.
+    class AliasCacheVH : public CallbackVH {
+      BasicAliasAnalysis *BAA;
+      virtual void deleted();
+      virtual void allUsesReplacedWith(Value *New);
+    public:
+      AliasCacheVH(Value *V, BasicAliasAnalysis *BAA = 0)
+        : CallbackVH(V), BAA(BAA) {}
+    };
+    friend class AliasCacheVH;
+
+    /// CacheDependents - The cached results that depend on a value.
+    struct CacheDependents {
+      SmallVector<LocPair, 2> Queries;
+      SmallVector<const Value *, 1> GEPs;
+    };
+
+    // QueryCache, GEPCache - Under -basicaa-cache, the results of the alias
+    // queries and of DecomposeGEPExpression made in the current cache scope.
+    // Dependents maps each value they were derived from to the entries to
+    // drop when it changes, and QueryDeps collects the values of the query
+    // being answered.
+    typedef DenseMap<LocPair, AliasResult> QueryCacheTy;
+    QueryCacheTy QueryCache;
+    typedef DenseMap<const Value *, DecomposedGEP> GEPCacheTy;
+    GEPCacheTy GEPCache;
+    typedef DenseMap<AliasCacheVH, CacheDependents, DenseMapInfo<Value *> >
+      DependentsTy;
+    DependentsTy Dependents;
+    SmallPtrSet<const Value *, 16> QueryDeps;
+    unsigned CacheScopes;
+    CacheCounts CacheStats;
+
+    /// isCaching - Return true if results are kept across queries.
+    bool isCaching() const { return EnableCache && CacheScopes; }
+    AliasResult cachedAlias(const Location &LocA, const Location &LocB);
+    const Value *decomposeGEP(const Value *V, int64_t &BaseOffs,
+                              SmallVectorImpl<VariableGEPIndex> &VarIndices);
+    void addQueryDep(const Value *V);
+    CacheDependents &getDependents(const Value *V);
+    void forgetValue(Value *V);
+    void clearCache();
+
     // aliasGEP - Provide a bunch of ad-hoc rules to disambiguate a GEP
     // instruction against another.
     AliasResult aliasGEP(const GEPOperator *V1, uint64_t V1Size,
@@ -864,9 +960,9 @@ BasicAliasAnalysis::aliasGEP(const GEPOperator *GEP1, uint64_t V1Size,
         int64_t GEP2BaseOffset;
         SmallVector<VariableGEPIndex, 4> GEP2VariableIndices;
         const Value *GEP2BasePtr =
-          DecomposeGEPExpression(GEP2, GEP2BaseOffset, GEP2VariableIndices, TD);
+          decomposeGEP(GEP2, GEP2BaseOffset, GEP2VariableIndices);
         const Value *GEP1BasePtr =
-          DecomposeGEPExpression(GEP1, GEP1BaseOffset, GEP1VariableIndices, TD);
+          decomposeGEP(GEP1, GEP1BaseOffset, GEP1VariableIndices);
         // DecomposeGEPExpression and GetUnderlyingObject should return the
         // same result except when DecomposeGEPExpression has no DataLayout.
         if (GEP1BasePtr != UnderlyingV1 || GEP2BasePtr != UnderlyingV2) {
@@ -894,12 +990,12 @@ BasicAliasAnalysis::aliasGEP(const GEPOperator *GEP1, uint64_t V1Size,
     // exactly, see if the computed offset from the common pointer tells us
     // about the relation of the resulting pointer.
     const Value *GEP1BasePtr =
-      DecomposeGEPExpression(GEP1, GEP1BaseOffset, GEP1VariableIndices, TD);
+      decomposeGEP(GEP1, GEP1BaseOffset, GEP1VariableIndices);
     
     int64_t GEP2BaseOffset;
     SmallVector<VariableGEPIndex, 4> GEP2VariableIndices;
     const Value *GEP2BasePtr =
-      DecomposeGEPExpression(GEP2, GEP2BaseOffset, GEP2VariableIndices, TD);
+      decomposeGEP(GEP2, GEP2BaseOffset, GEP2VariableIndices);
     
     // DecomposeGEPExpression and GetUnderlyingObject should return the
     // same result except when DecomposeGEPExpression has no DataLayout.
@@ -934,7 +1030,7 @@ BasicAliasAnalysis::aliasGEP(const GEPOperator *GEP1, uint64_t V1Size,
       return R;
 
     const Value *GEP1BasePtr =
-      DecomposeGEPExpression(GEP1, GEP1BaseOffset, GEP1VariableIndices, TD);
+      decomposeGEP(GEP1, GEP1BaseOffset, GEP1VariableIndices);
     
     // DecomposeGEPExpression and GetUnderlyingObject should return the
     // same result except when DecomposeGEPExpression has no DataLayout.
@@ -1157,6 +1253,13 @@ BasicAliasAnalysis::aliasCheck(const Value *V1, uint64_t V1Size,
   const Value *O1 = GetUnderlyingObject(V1, TD);
   const Value *O2 = GetUnderlyingObject(V2, TD);
 
+  if (isCaching()) {
+    addQueryDep(V1);
+    addQueryDep(V2);
+    addQueryDep(O1);
+    addQueryDep(O2);
+  }
+
   // Null values in the default address space don't point to any object, so they
   // don't alias any other pointer.
   if (const ConstantPointerNull *CPN = dyn_cast<ConstantPointerNull>(O1))
@@ -1268,3 +1371,125 @@ BasicAliasAnalysis::aliasCheck(const Value *V1, uint64_t V1Size,
                          Location(V2, V2Size, V2TBAAInfo));
   return AliasCache[Locs] = Result;
 }
+
+//===----------------------------------------------------------------------===//
+// Caching of results across queries
+//===----------------------------------------------------------------------===//
+
+/// mayChange - Return true if V can be deleted or replaced during a cache
+/// scope.  Other constants than globals and constant expressions live
+/// as long as the context.
+static bool mayChange(const Value *V) {
+  return !isa<Constant>(V) || isa<GlobalValue>(V) || isa<ConstantExpr>(V);
+}
+
+void BasicAliasAnalysis::AliasCacheVH::deleted() {
+  assert(BAA && "AliasCacheVH called with a null BasicAliasAnalysis!");
+  BAA->forgetValue(getValPtr());
+  // this now dangles!
+}
+
+void BasicAliasAnalysis::AliasCacheVH::allUsesReplacedWith(Value *) {
+  assert(BAA && "AliasCacheVH called with a null BasicAliasAnalysis!");
+  BAA->forgetValue(getValPtr());
+  // this now dangles!
+}
+
+/// cachedAlias - Answer an alias query from QueryCache, or compute the answer
+/// and remember the values it was derived from.  Only the final result of a
+/// query is kept: the entries of AliasCache may rest on assumptions made
+/// while looking through PHIs.
+AliasAnalysis::AliasResult
+BasicAliasAnalysis::cachedAlias(const Location &LocA, const Location &LocB) {
+  LocPair Locs(LocA, LocB);
+  if (Locs.first.Ptr > Locs.second.Ptr)
+    std::swap(Locs.first, Locs.second);
+  ++CacheStats.AliasLookups;
+  QueryCacheTy::iterator I = QueryCache.find(Locs);
+  if (I != QueryCache.end()) {
+    ++CacheStats.AliasHits;
+    return I->second;
+  }
+
+  addQueryDep(LocA.Ptr);
+  addQueryDep(LocB.Ptr);
+  AliasResult Alias = aliasCheck(LocA.Ptr, LocA.Size, LocA.TBAATag,
+                                 LocB.Ptr, LocB.Size, LocB.TBAATag);
+  AliasCache.shrink_and_clear();
+
+  QueryCache[Locs] = Alias;
+  for (SmallPtrSet<const Value *, 16>::iterator DI = QueryDeps.begin(),
+       DE = QueryDeps.end(); DI != DE; ++DI)
+    getDependents(*DI).Queries.push_back(Locs);
+  QueryDeps.clear();
+  return Alias;
+}
+
+/// decomposeGEP - Call DecomposeGEPExpression, or take its result from
+/// GEPCache under -basicaa-cache.  VarIndices must be empty.
+const Value *
+BasicAliasAnalysis::decomposeGEP(const Value *V, int64_t &BaseOffs,
+                               SmallVectorImpl<VariableGEPIndex> &VarIndices) {
+  if (!isCaching())
+    return DecomposeGEPExpression(V, BaseOffs, VarIndices, TD);
+
+  assert(VarIndices.empty() && "Decomposing into a non-empty index list!");
+  ++CacheStats.GEPLookups;
+  GEPCacheTy::iterator I = GEPCache.find(V);
+  if (I != GEPCache.end()) {
+    ++CacheStats.GEPHits;
+  } else {
+    DecomposedGEP D;
+    D.Base = DecomposeGEPExpression(V, D.BaseOffs, D.VarIndices, TD);
+    I = GEPCache.insert(std::make_pair(V, D)).first;
+    getDependents(V).GEPs.push_back(V);
+    if (mayChange(D.Base))
+      getDependents(D.Base).GEPs.push_back(V);
+    for (unsigned i = 0, e = D.VarIndices.size(); i != e; ++i)
+      if (mayChange(D.VarIndices[i].V))
+        getDependents(D.VarIndices[i].V).GEPs.push_back(V);
+  }
+
+  const DecomposedGEP &D = I->second;
+  addQueryDep(V);
+  addQueryDep(D.Base);
+  for (unsigned i = 0, e = D.VarIndices.size(); i != e; ++i)
+    addQueryDep(D.VarIndices[i].V);
+  BaseOffs = D.BaseOffs;
+  VarIndices.append(D.VarIndices.begin(), D.VarIndices.end());
+  return D.Base;
+}
+
+/// addQueryDep - Record that the result of the query being answered depends
+/// on V.
+void BasicAliasAnalysis::addQueryDep(const Value *V) {
+  if (mayChange(V))
+    QueryDeps.insert(V);
+}
+
+BasicAliasAnalysis::CacheDependents &
+BasicAliasAnalysis::getDependents(const Value *V) {
+  AliasCacheVH VH(const_cast<Value *>(V), this);
+  return Dependents.insert(std::make_pair(VH, CacheDependents())).first->second;
+}
+
+/// forgetValue - Drop the cached results that depend on V.  Entries of the
+/// other values that refer to them are left behind, and at worst drop newer
+/// results for the same key later.
+void BasicAliasAnalysis::forgetValue(Value *V) {
+  DependentsTy::iterator I = Dependents.find(V);
+  if (I == Dependents.end())
+    return;
+  CacheDependents &D = I->second;
+  for (unsigned i = 0, e = D.Queries.size(); i != e; ++i)
+    QueryCache.erase(D.Queries[i]);
+  for (unsigned i = 0, e = D.GEPs.size(); i != e; ++i)
+    GEPCache.erase(D.GEPs[i]);
+  Dependents.erase(I);
+}
+
+void BasicAliasAnalysis::clearCache() {
+  QueryCache.clear();
+  GEPCache.clear();
+  Dependents.clear();
+}
@@ -121,6 +121,11 @@ bool CGPassManager::RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
 
     {
       TimeRegion PassTimer(getPassTimer(CGSP));
+      // The SCC is recorded under the name of one of its functions; the pass
+      // may delete them, so no instructions are counted.
+      Function *SCCF = (*CurSCC.begin())->getFunction();
+      PassTraceRegion PassTrace(CGSP, SCCF ? SCCF->getName()
+                                           : StringRef("<external node>"));
       Changed = CGSP->runOnSCC(CurSCC);
     }
     
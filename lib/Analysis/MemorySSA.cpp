@@ -0,0 +1,452 @@
+//===- MemorySSA.cpp - Memory SSA -----------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the construction of Memory SSA, its clobber walker and
+// a pass that prints it.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "memoryssa"
+#include "llvm/Analysis/MemorySSA.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/Dominators.h"
+#include "llvm/Analysis/Passes.h"
+#include "llvm/Assembly/AssemblyAnnotationWriter.h"
+#include "llvm/Assembly/Writer.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/CFG.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/FormattedStream.h"
+#include "llvm/Support/raw_ostream.h"
+using namespace llvm;
+
+STATISTIC(NumMemoryPhis,     "Number of MemoryPhis created");
+STATISTIC(NumClobberQueries, "Number of clobber queries of loads");
+STATISTIC(NumClobberCached,  "Number of clobber queries answered by the cache");
+STATISTIC(NumWalkLimit,      "Number of walks stopped by the step limit");
+
+static cl::opt<unsigned>
+WalkLimit("memoryssa-walk-limit", cl::Hidden, cl::init(500),
+          cl::desc("The maximum number of accesses the Memory SSA walker "
+                   "visits to answer a clobber query"));
+
+//===----------------------------------------------------------------------===//
+// MemoryAccess
+//===----------------------------------------------------------------------===//
+
+/// printVersion - Print the version defined by MA as it is referred to by its
+/// users.
+static void printVersion(raw_ostream &OS, const MemoryAccess *MA) {
+  const MemoryDef *Def = dyn_cast<MemoryDef>(MA);
+  if (Def && !Def->getMemoryInst())
+    OS << "liveOnEntry";
+  else
+    OS << MA->getID();
+}
+
+void MemoryAccess::print(raw_ostream &OS) const {
+  if (const MemoryPhi *Phi = dyn_cast<MemoryPhi>(this)) {
+    OS << getID() << " = MemoryPhi(";
+    for (unsigned i = 0, e = Phi->getNumIncomingValues(); i != e; ++i) {
+      if (i)
+        OS << ',';
+      OS << '{';
+      WriteAsOperand(OS, Phi->getIncomingBlock(i), /*PrintType=*/false);
+      OS << ',';
+      printVersion(OS, Phi->getIncomingValue(i));
+      OS << '}';
+    }
+    OS << ')';
+    return;
+  }
+
+  const MemoryUseOrDef *MA = cast<MemoryUseOrDef>(this);
+  if (isa<MemoryUse>(MA)) {
+    OS << "MemoryUse(";
+  } else if (!MA->getMemoryInst()) {
+    OS << "liveOnEntry";
+    return;
+  } else {
+    OS << getID() << " = MemoryDef(";
+  }
+  printVersion(OS, MA->getDefiningAccess());
+  OS << ')';
+}
+
+void MemoryAccess::dump() const {
+  print(dbgs());
+  dbgs() << '\n';
+}
+
+void MemoryPhi::replaceIncomingValue(MemoryAccess *From, MemoryAccess *To) {
+  for (unsigned i = 0, e = Operands.size(); i != e; ++i)
+    if (Operands[i].first == From)
+      Operands[i].first = To;
+}
+
+//===----------------------------------------------------------------------===//
+// Construction
+//===----------------------------------------------------------------------===//
+
+MemorySSA::MemorySSA(Function &Fn, AliasAnalysis *AA, DominatorTree *DT)
+  : F(Fn), AA(AA), DT(DT), NextID(1) {
+  LiveOnEntry = new MemoryDef(0, 0, &F.getEntryBlock(), 0);
+  placePhis();
+  rename();
+}
+
+MemorySSA::~MemorySSA() {
+  for (DenseMap<const Instruction *, MemoryUseOrDef *>::iterator
+       I = InstructionToAccess.begin(), E = InstructionToAccess.end();
+       I != E; ++I)
+    delete I->second;
+  for (DenseMap<const BasicBlock *, MemoryPhi *>::iterator
+       I = PhiMap.begin(), E = PhiMap.end(); I != E; ++I)
+    delete I->second;
+  delete LiveOnEntry;
+}
+
+/// placePhis - Create a MemoryPhi in each block of the iterated dominance
+/// frontier of the blocks that define memory.
+void MemorySSA::placePhis() {
+  // Compute the dominance frontiers with the algorithm of Cooper, Harvey and
+  // Kennedy: a join is in the frontier of the blocks that dominate one of its
+  // predecessors without strictly dominating the join itself.
+  DenseMap<BasicBlock *, SmallVector<BasicBlock *, 2> > Frontiers;
+  SmallVector<BasicBlock *, 32> Worklist;
+  for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB) {
+    if (!DT->isReachableFromEntry(BB))
+      continue;
+
+    for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I)
+      if (I->mayWriteToMemory()) {
+        Worklist.push_back(BB);
+        break;
+      }
+
+    DomTreeNode *IDom = DT->getNode(BB)->getIDom();
+    for (pred_iterator PI = pred_begin(BB), PE = pred_end(BB); PI != PE; ++PI) {
+      if (!DT->isReachableFromEntry(*PI))
+        continue;
+      for (DomTreeNode *Runner = DT->getNode(*PI); Runner != IDom;
+           Runner = Runner->getIDom()) {
+        SmallVectorImpl<BasicBlock *> &DF = Frontiers[Runner->getBlock()];
+        if (DF.empty() || DF.back() != BB)
+          DF.push_back(BB);
+      }
+    }
+  }
+
+  SmallPtrSet<BasicBlock *, 32> Visited;
+  Visited.insert(Worklist.begin(), Worklist.end());
+  while (!Worklist.empty()) {
+    BasicBlock *BB = Worklist.pop_back_val();
+    DenseMap<BasicBlock *, SmallVector<BasicBlock *, 2> >::iterator DF =
+      Frontiers.find(BB);
+    if (DF == Frontiers.end())
+      continue;
+    for (unsigned i = 0, e = DF->second.size(); i != e; ++i) {
+      BasicBlock *Join = DF->second[i];
+      if (PhiMap.count(Join))
+        continue;
+      PhiMap[Join] = new MemoryPhi(Join);
+      ++NumMemoryPhis;
+      if (Visited.insert(Join))
+        Worklist.push_back(Join);
+    }
+  }
+}
+
+/// renameBlock - Create the accesses of BB, given the version of memory that
+/// reaches its start, and leave the version at its end in Incoming.
+void MemorySSA::renameBlock(BasicBlock *BB, MemoryAccess *&Incoming) {
+  if (MemoryPhi *Phi = PhiMap.lookup(BB)) {
+    Phi->setID(NextID++);
+    Incoming = Phi;
+  }
+
+  for (BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E; ++I) {
+    MemoryUseOrDef *MA;
+    if (I->mayWriteToMemory())
+      MA = new MemoryDef(I, Incoming, BB, NextID++);
+    else if (I->mayReadFromMemory())
+      MA = new MemoryUse(I, Incoming, BB);
+    else
+      continue;
+    Incoming->addUser(MA);
+    InstructionToAccess[I] = MA;
+    if (isa<MemoryDef>(MA))
+      Incoming = MA;
+  }
+
+  SmallPtrSet<BasicBlock *, 8> Seen;
+  for (succ_iterator SI = succ_begin(BB), SE = succ_end(BB); SI != SE; ++SI) {
+    if (!Seen.insert(*SI))
+      continue;
+    if (MemoryPhi *Phi = PhiMap.lookup(*SI)) {
+      Phi->addIncoming(Incoming, BB);
+      Incoming->addUser(Phi);
+    }
+  }
+}
+
+/// rename - Create the accesses of all reachable blocks in a preorder walk of
+/// the dominator tree, which numbers the versions in that order.
+void MemorySSA::rename() {
+  SmallVector<std::pair<DomTreeNode *, MemoryAccess *>, 32> Worklist;
+  Worklist.push_back(std::make_pair(DT->getRootNode(),
+                                    static_cast<MemoryAccess *>(LiveOnEntry)));
+  while (!Worklist.empty()) {
+    DomTreeNode *Node = Worklist.back().first;
+    MemoryAccess *Incoming = Worklist.back().second;
+    Worklist.pop_back();
+
+    renameBlock(Node->getBlock(), Incoming);
+    const std::vector<DomTreeNode *> &Children = Node->getChildren();
+    for (std::vector<DomTreeNode *>::const_reverse_iterator
+         I = Children.rbegin(), E = Children.rend(); I != E; ++I)
+      Worklist.push_back(std::make_pair(*I, Incoming));
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// Clobber walker
+//===----------------------------------------------------------------------===//
+
+MemoryAccess *MemorySSA::getClobberingMemoryAccess(Instruction *I) {
+  MemoryUseOrDef *MA = getMemoryAccess(I);
+  if (!MA)
+    return 0;
+  MemoryUse *MU = dyn_cast<MemoryUse>(MA);
+  LoadInst *LI = dyn_cast<LoadInst>(I);
+  if (!MU || !LI)
+    return MA->getDefiningAccess();
+
+  ++NumClobberQueries;
+  DenseMap<const MemoryUse *, MemoryAccess *>::iterator Cached =
+    ClobberCache.find(MU);
+  if (Cached != ClobberCache.end()) {
+    ++NumClobberCached;
+    return Cached->second;
+  }
+
+  MemoryAccess *Clobber =
+    getClobberingMemoryAccess(MU->getDefiningAccess(), AA->getLocation(LI));
+  ClobberCache[MU] = Clobber;
+  return Clobber;
+}
+
+MemoryAccess *
+MemorySSA::getClobberingMemoryAccess(MemoryAccess *Start,
+                                     const AliasAnalysis::Location &Loc) {
+  PhiResultMap PhiResults;
+  unsigned Steps = 0;
+  return walk(Start, Loc, PhiResults, Steps);
+}
+
+/// walk - Follow the defining accesses from MA until one may modify Loc.
+MemoryAccess *MemorySSA::walk(MemoryAccess *MA,
+                              const AliasAnalysis::Location &Loc,
+                              PhiResultMap &PhiResults, unsigned &Steps) {
+  while (true) {
+    if (MemoryPhi *Phi = dyn_cast<MemoryPhi>(MA))
+      return resolvePhi(Phi, Loc, PhiResults, Steps);
+
+    // Uses are never the defining access of anything.
+    MemoryDef *Def = cast<MemoryDef>(MA);
+    if (Def == LiveOnEntry)
+      return Def;
+    // Any definition on the chain is a correct, if pessimistic, answer.
+    if (++Steps > WalkLimit) {
+      if (Steps == WalkLimit + 1)
+        ++NumWalkLimit;
+      return Def;
+    }
+    if (AA->getModRefInfo(Def->getMemoryInst(), Loc) & AliasAnalysis::Mod)
+      return Def;
+    MA = Def->getDefiningAccess();
+  }
+}
+
+/// resolvePhi - Return the clobber of Loc at the start of the block of Phi:
+/// the common clobber of the incoming versions if they agree, or Phi itself.
+/// While the incoming versions are walked, a walk that comes back to Phi
+/// stands for Phi, and does not disagree with the others as a cycle that
+/// doesn't modify Loc doesn't change the clobber of the other incoming
+/// versions.
+MemoryAccess *MemorySSA::resolvePhi(MemoryPhi *Phi,
+                                    const AliasAnalysis::Location &Loc,
+                                    PhiResultMap &PhiResults, unsigned &Steps) {
+  PhiResultMap::iterator Known = PhiResults.find(Phi);
+  if (Known != PhiResults.end())
+    return Known->second;
+  PhiResults[Phi] = Phi;
+
+  // The location is only the same on all the incoming paths if its address
+  // is computed before the join; otherwise it may refer to a different
+  // address in the previous iteration of a loop.
+  if (const Instruction *Ptr = dyn_cast<Instruction>(Loc.Ptr))
+    if (!DT->properlyDominates(Ptr->getParent(), Phi->getBlock()))
+      return Phi;
+  if (++Steps > WalkLimit) {
+    if (Steps == WalkLimit + 1)
+      ++NumWalkLimit;
+    return Phi;
+  }
+
+  MemoryAccess *Result = 0;
+  for (unsigned i = 0, e = Phi->getNumIncomingValues(); i != e; ++i) {
+    MemoryAccess *Clobber =
+      walk(Phi->getIncomingValue(i), Loc, PhiResults, Steps);
+    if (Clobber == Phi)
+      continue;
+    if (!Result) {
+      Result = Clobber;
+    } else if (Result != Clobber) {
+      Result = Phi;
+      break;
+    }
+  }
+  if (!Result)
+    Result = Phi;
+
+  PhiResults[Phi] = Result;
+  return Result;
+}
+
+//===----------------------------------------------------------------------===//
+// Updates
+//===----------------------------------------------------------------------===//
+
+void MemorySSA::removeMemoryAccess(Instruction *I) {
+  DenseMap<const Instruction *, MemoryUseOrDef *>::iterator It =
+    InstructionToAccess.find(I);
+  if (It == InstructionToAccess.end())
+    return;
+  MemoryUseOrDef *MA = It->second;
+  InstructionToAccess.erase(It);
+
+  MemoryAccess *Def = MA->getDefiningAccess();
+  Def->removeUser(MA);
+  if (MemoryUse *MU = dyn_cast<MemoryUse>(MA)) {
+    ClobberCache.erase(MU);
+  } else {
+    for (MemoryAccess::user_iterator UI = MA->user_begin(),
+         UE = MA->user_end(); UI != UE; ++UI) {
+      if (MemoryUseOrDef *User = dyn_cast<MemoryUseOrDef>(*UI))
+        User->setDefiningAccess(Def);
+      else
+        cast<MemoryPhi>(*UI)->replaceIncomingValue(MA, Def);
+      Def->addUser(*UI);
+    }
+    // Cached clobbers may be the removed definition.
+    ClobberCache.clear();
+  }
+  delete MA;
+}
+
+//===----------------------------------------------------------------------===//
+// Printing
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// MemorySSAAnnotatedWriter - Print the accesses as comments.  If Walker is
+/// set, loads also show the clobber found by the walker when it is not their
+/// defining access.
+class MemorySSAAnnotatedWriter : public AssemblyAnnotationWriter {
+  const MemorySSA &MSSA;
+  MemorySSA *Walker;
+
+public:
+  MemorySSAAnnotatedWriter(const MemorySSA &MSSA, MemorySSA *Walker)
+    : MSSA(MSSA), Walker(Walker) {}
+
+  virtual void emitBasicBlockStartAnnot(const BasicBlock *BB,
+                                        formatted_raw_ostream &OS) {
+    if (MemoryPhi *Phi = MSSA.getMemoryPhi(BB))
+      OS << "; " << *Phi << '\n';
+  }
+
+  virtual void emitInstructionAnnot(const Instruction *I,
+                                    formatted_raw_ostream &OS) {
+    MemoryUseOrDef *MA = MSSA.getMemoryAccess(I);
+    if (!MA)
+      return;
+    OS << "; " << *MA;
+    if (Walker && isa<MemoryUse>(MA) && isa<LoadInst>(I)) {
+      MemoryAccess *Clobber =
+        Walker->getClobberingMemoryAccess(const_cast<Instruction *>(I));
+      if (Clobber != MA->getDefiningAccess()) {
+        OS << " clobbered by ";
+        printVersion(OS, Clobber);
+      }
+    }
+    OS << '\n';
+  }
+};
+}
+
+void MemorySSA::print(raw_ostream &OS) const {
+  MemorySSAAnnotatedWriter Writer(*this, 0);
+  F.print(OS, &Writer);
+}
+
+void MemorySSA::dump() const {
+  print(dbgs());
+}
+
+namespace {
+  struct MemorySSAPrinter : public FunctionPass {
+    OwningPtr<MemorySSA> MSSA;
+    const Function *F;
+
+    static char ID; // Pass identification, replacement for typeid
+    MemorySSAPrinter() : FunctionPass(ID), F(0) {
+      initializeMemorySSAPrinterPass(*PassRegistry::getPassRegistry());
+    }
+
+    virtual bool runOnFunction(Function &Fn) {
+      F = &Fn;
+      MSSA.reset(new MemorySSA(Fn, &getAnalysis<AliasAnalysis>(),
+                               &getAnalysis<DominatorTree>()));
+      return false;
+    }
+
+    virtual void print(raw_ostream &OS, const Module * = 0) const {
+      MemorySSAAnnotatedWriter Writer(*MSSA, MSSA.get());
+      F->print(OS, &Writer);
+    }
+
+    virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+      AU.addRequiredTransitive<AliasAnalysis>();
+      AU.addRequiredTransitive<DominatorTree>();
+      AU.setPreservesAll();
+    }
+
+    virtual void releaseMemory() {
+      MSSA.reset();
+      F = 0;
+    }
+  };
+}
+
+char MemorySSAPrinter::ID = 0;
+INITIALIZE_PASS_BEGIN(MemorySSAPrinter, "print-memoryssa",
+                      "Print Memory SSA of function", false, true)
+INITIALIZE_PASS_DEPENDENCY(DominatorTree)
+INITIALIZE_AG_DEPENDENCY(AliasAnalysis)
+INITIALIZE_PASS_END(MemorySSAPrinter, "print-memoryssa",
+                    "Print Memory SSA of function", false, true)
+
+FunctionPass *llvm::createMemorySSAPrinter() {
+  return new MemorySSAPrinter();
+}
@@ -30,6 +30,8 @@ namespace {
       initializeNoAAPass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *createClone() const { return new NoAA(); }
+
     virtual void getAnalysisUsage(AnalysisUsage &AU) const {
     }
 
@@ -63,6 +65,9 @@ namespace {
       return ModRef;
     }
 
+    virtual void beginCacheScope() {}
+    virtual void endCacheScope() {}
+    virtual void addCacheCounts(CacheCounts &Counts) {}
     virtual void deleteValue(Value *V) {}
     virtual void copyValue(Value *From, Value *To) {}
     virtual void addEscapingUse(Use &U) {}
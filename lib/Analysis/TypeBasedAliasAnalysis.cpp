@@ -122,6 +122,8 @@ namespace {
       initializeTypeBasedAliasAnalysisPass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *createClone() const { return new TypeBasedAliasAnalysis(); }
+
     virtual void initializePass() {
       InitializeAliasAnalysis(this);
     }
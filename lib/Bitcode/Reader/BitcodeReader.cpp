@@ -7,10 +7,12 @@
 //
 //===----------------------------------------------------------------------===//
 
+#define DEBUG_TYPE "bitcode-reader"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "BitcodeReader.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/AutoUpgrade.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DerivedTypes.h"
@@ -19,11 +21,20 @@
 #include "llvm/IR/Module.h"
 #include "llvm/IR/OperandTraits.h"
 #include "llvm/IR/Operator.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/DataStream.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Threading.h"
 using namespace llvm;
 
+STATISTIC(NumDecodedAhead, "Number of function bodies decoded ahead of time");
+
+static cl::opt<unsigned>
+DecodeThreads("bitcode-decode-threads", cl::Hidden, cl::init(0),
+  cl::desc("Number of threads decoding function blocks ahead of the IR being "
+           "built when bitcode is read from memory (0 = none)"));
+
 enum {
   SWITCH_INST_MAGIC = 0x4B5 // May 2012 => 1205 => Hex
 };
@@ -36,6 +47,9 @@ void BitcodeReader::materializeForwardReferencedFunctions() {
 }
 
 void BitcodeReader::FreeState() {
+  // The decoding threads read from Buffer.
+  delete ReadAhead;
+  ReadAhead = 0;
   if (BufferOwned)
     delete Buffer;
   Buffer = 0;
@@ -419,10 +433,53 @@ Type *BitcodeReader::getTypeByID(unsigned ID) {
     return Ty;
 
   // If we have a forward reference, the only possible case is when it is to a
-  // named struct.  Just create a placeholder for now.
+  // named struct.  Just create a placeholder for now, unless the structs are
+  // not to be created.
+  if (!ReusedStructTypes.empty())
+    return TypeList[ID] = ReusedStructIDs.lookup(ID);
   return TypeList[ID] = StructType::create(Context);
 }
 
+void BitcodeReader::reuseStructTypes(ArrayRef<StructType*> Types) {
+  for (unsigned i = 0, e = Types.size(); i != e; ++i)
+    ReusedStructTypes[Types[i]->getName()] = Types[i];
+}
+
+/// ScanReusedStructTypes - Read ahead through the type table, which Stream has
+/// just entered, to find the type IDs of the reused struct types.
+bool BitcodeReader::ScanReusedStructTypes() {
+  BitstreamCursor Scan(Stream);
+  SmallVector<uint64_t, 64> Record;
+  SmallString<64> TypeName;
+  unsigned NumRecords = 0;
+  while (1) {
+    BitstreamEntry Entry = Scan.advanceSkippingSubblocks();
+    if (Entry.Kind == BitstreamEntry::EndBlock)
+      return false;
+    if (Entry.Kind != BitstreamEntry::Record)
+      return Error("Error in the type table block");
+
+    Record.clear();
+    switch (Scan.readRecord(Entry.ID, Record)) {
+    case bitc::TYPE_CODE_NUMENTRY:
+      continue;
+    case bitc::TYPE_CODE_STRUCT_NAME:
+      if (ConvertToString(Record, 0, TypeName))
+        return Error("Invalid STRUCT_NAME record");
+      continue;
+    case bitc::TYPE_CODE_STRUCT_NAMED:
+    case bitc::TYPE_CODE_OPAQUE:
+      if (StructType *STy = ReusedStructTypes.lookup(TypeName))
+        ReusedStructIDs[NumRecords] = STy;
+      TypeName.clear();
+      break;
+    default:
+      break;
+    }
+    ++NumRecords;
+  }
+}
+
 
 //===----------------------------------------------------------------------===//
 //  Functions for parsing blocks from the bitcode file
@@ -597,6 +654,9 @@ bool BitcodeReader::ParseTypeTableBody() {
 
   SmallString<64> TypeName;
 
+  if (!ReusedStructTypes.empty() && ScanReusedStructTypes())
+    return true;
+
   // Read all the records for this type table.
   while (1) {
     BitstreamEntry Entry = Stream.advanceSkippingSubblocks();
@@ -741,6 +801,21 @@ bool BitcodeReader::ParseTypeTableBody() {
       if (NumRecords >= TypeList.size())
         return Error("invalid TYPE table");
 
+      if (!ReusedStructTypes.empty()) {
+        // The reused struct must have the same body.
+        StructType *Res = ReusedStructTypes.lookup(TypeName);
+        TypeName.clear();
+        if (!Res || Res->isOpaque() || Res->isPacked() != (Record[0] != 0) ||
+            Res->getNumElements() != Record.size() - 1)
+          return Error("STRUCT type record does not match the reused type");
+        for (unsigned i = 1, e = Record.size(); i != e; ++i)
+          if (getTypeByID(Record[i]) != Res->getElementType(i - 1))
+            return Error("STRUCT type record does not match the reused type");
+        TypeList[NumRecords] = 0;
+        ResultTy = Res;
+        break;
+      }
+
       // Check to see if this was forward referenced, if so fill in the temp.
       StructType *Res = cast_or_null<StructType>(TypeList[NumRecords]);
       if (Res) {
@@ -770,6 +845,16 @@ bool BitcodeReader::ParseTypeTableBody() {
       if (NumRecords >= TypeList.size())
         return Error("invalid TYPE table");
 
+      if (!ReusedStructTypes.empty()) {
+        StructType *Res = ReusedStructTypes.lookup(TypeName);
+        TypeName.clear();
+        if (!Res || !Res->isOpaque())
+          return Error("OPAQUE type record does not match the reused type");
+        TypeList[NumRecords] = 0;
+        ResultTy = Res;
+        break;
+      }
+
       // Check to see if this was forward referenced, if so fill in the temp.
       StructType *Res = cast_or_null<StructType>(TypeList[NumRecords]);
       if (Res) {
@@ -808,7 +893,7 @@ bool BitcodeReader::ParseTypeTableBody() {
 }
 
 bool BitcodeReader::ParseValueSymbolTable() {
-  if (Stream.EnterSubBlock(bitc::VALUE_SYMTAB_BLOCK_ID))
+  if (enterBlock(bitc::VALUE_SYMTAB_BLOCK_ID))
     return Error("Malformed block record");
 
   SmallVector<uint64_t, 64> Record;
@@ -816,7 +901,7 @@ bool BitcodeReader::ParseValueSymbolTable() {
   // Read all the records for this value table.
   SmallString<128> ValueName;
   while (1) {
-    BitstreamEntry Entry = Stream.advanceSkippingSubblocks();
+    BitstreamEntry Entry = advanceSkippingSubblocks();
 
     switch (Entry.Kind) {
     case BitstreamEntry::SubBlock: // Handled for us already.
@@ -831,7 +916,7 @@ bool BitcodeReader::ParseValueSymbolTable() {
 
     // Read a record.
     Record.clear();
-    switch (Stream.readRecord(Entry.ID, Record)) {
+    switch (readRecord(Entry.ID, Record)) {
     default:  // Default behavior: unknown type.
       break;
     case bitc::VST_CODE_ENTRY: {  // VST_ENTRY: [valueid, namechar x N]
@@ -864,14 +949,14 @@ bool BitcodeReader::ParseValueSymbolTable() {
 bool BitcodeReader::ParseMetadata() {
   unsigned NextMDValueNo = MDValueList.size();
 
-  if (Stream.EnterSubBlock(bitc::METADATA_BLOCK_ID))
+  if (enterBlock(bitc::METADATA_BLOCK_ID))
     return Error("Malformed block record");
 
   SmallVector<uint64_t, 64> Record;
 
   // Read all the records.
   while (1) {
-    BitstreamEntry Entry = Stream.advanceSkippingSubblocks();
+    BitstreamEntry Entry = advanceSkippingSubblocks();
 
     switch (Entry.Kind) {
     case BitstreamEntry::SubBlock: // Handled for us already.
@@ -888,7 +973,7 @@ bool BitcodeReader::ParseMetadata() {
     bool IsFunctionLocal = false;
     // Read a record.
     Record.clear();
-    unsigned Code = Stream.readRecord(Entry.ID, Record);
+    unsigned Code = readRecord(Entry.ID, Record);
     switch (Code) {
     default:  // Default behavior: ignore.
       break;
@@ -896,10 +981,10 @@ bool BitcodeReader::ParseMetadata() {
       // Read name of the named metadata.
       SmallString<8> Name(Record.begin(), Record.end());
       Record.clear();
-      Code = Stream.ReadCode();
+      Code = readCode();
 
       // METADATA_NAME is always followed by METADATA_NAMED_NODE.
-      unsigned NextBitCode = Stream.readRecord(Code, Record);
+      unsigned NextBitCode = readRecord(Code, Record);
       assert(NextBitCode == bitc::METADATA_NAMED_NODE); (void)NextBitCode;
 
       // Read named metadata elements.
@@ -1017,7 +1102,7 @@ static APInt ReadWideAPInt(ArrayRef<uint64_t> Vals, unsigned TypeBits) {
 }
 
 bool BitcodeReader::ParseConstants() {
-  if (Stream.EnterSubBlock(bitc::CONSTANTS_BLOCK_ID))
+  if (enterBlock(bitc::CONSTANTS_BLOCK_ID))
     return Error("Malformed block record");
 
   SmallVector<uint64_t, 64> Record;
@@ -1026,7 +1111,7 @@ bool BitcodeReader::ParseConstants() {
   Type *CurTy = Type::getInt32Ty(Context);
   unsigned NextCstNo = ValueList.size();
   while (1) {
-    BitstreamEntry Entry = Stream.advanceSkippingSubblocks();
+    BitstreamEntry Entry = advanceSkippingSubblocks();
 
     switch (Entry.Kind) {
     case BitstreamEntry::SubBlock: // Handled for us already.
@@ -1048,7 +1133,7 @@ bool BitcodeReader::ParseConstants() {
     // Read a record.
     Record.clear();
     Value *V = 0;
-    unsigned BitCode = Stream.readRecord(Entry.ID, Record);
+    unsigned BitCode = readRecord(Entry.ID, Record);
     switch (BitCode) {
     default:  // Default behavior: unknown constant
     case bitc::CST_CODE_UNDEF:     // UNDEF
@@ -1929,12 +2014,12 @@ bool BitcodeReader::ParseTriple(std::string &Triple) {
 
 /// ParseMetadataAttachment - Parse metadata attachments.
 bool BitcodeReader::ParseMetadataAttachment() {
-  if (Stream.EnterSubBlock(bitc::METADATA_ATTACHMENT_ID))
+  if (enterBlock(bitc::METADATA_ATTACHMENT_ID))
     return Error("Malformed block record");
 
   SmallVector<uint64_t, 64> Record;
   while (1) {
-    BitstreamEntry Entry = Stream.advanceSkippingSubblocks();
+    BitstreamEntry Entry = advanceSkippingSubblocks();
 
     switch (Entry.Kind) {
     case BitstreamEntry::SubBlock: // Handled for us already.
@@ -1949,7 +2034,7 @@ bool BitcodeReader::ParseMetadataAttachment() {
 
     // Read a metadata attachment record.
     Record.clear();
-    switch (Stream.readRecord(Entry.ID, Record)) {
+    switch (readRecord(Entry.ID, Record)) {
     default:  // Default behavior: ignore.
       break;
     case bitc::METADATA_ATTACHMENT: {
@@ -1974,7 +2059,7 @@ bool BitcodeReader::ParseMetadataAttachment() {
 
 /// ParseFunctionBody - Lazily parse the specified function body block.
 bool BitcodeReader::ParseFunctionBody(Function *F) {
-  if (Stream.EnterSubBlock(bitc::FUNCTION_BLOCK_ID))
+  if (enterBlock(bitc::FUNCTION_BLOCK_ID))
     return Error("Malformed block record");
 
   InstructionList.clear();
@@ -1994,7 +2079,7 @@ bool BitcodeReader::ParseFunctionBody(Function *F) {
   // Read all the records.
   SmallVector<uint64_t, 64> Record;
   while (1) {
-    BitstreamEntry Entry = Stream.advance();
+    BitstreamEntry Entry = advance();
 
     switch (Entry.Kind) {
     case BitstreamEntry::Error:
@@ -2005,7 +2090,7 @@ bool BitcodeReader::ParseFunctionBody(Function *F) {
     case BitstreamEntry::SubBlock:
       switch (Entry.ID) {
       default:  // Skip unknown content.
-        if (Stream.SkipBlock())
+        if (skipBlock())
           return Error("Malformed block record");
         break;
       case bitc::CONSTANTS_BLOCK_ID:
@@ -2032,7 +2117,7 @@ bool BitcodeReader::ParseFunctionBody(Function *F) {
     // Read a record.
     Record.clear();
     Instruction *I = 0;
-    unsigned BitCode = Stream.readRecord(Entry.ID, Record);
+    unsigned BitCode = readRecord(Entry.ID, Record);
     switch (BitCode) {
     default: // Default behavior: reject
       return Error("Unknown instruction");
@@ -2892,10 +2977,19 @@ bool BitcodeReader::Materialize(GlobalValue *GV, std::string *ErrInfo) {
   if (DFII->second == 0)
     if (LazyStreamer && FindFunctionInStream(F, DFII)) return true;
 
-  // Move the bit stream to the saved position of the deferred function body.
-  Stream.JumpToBit(DFII->second);
+  // Replay the body if it has been decoded ahead of time, otherwise move the
+  // bit stream to its saved position.
+  if (const DecodedBlock *Body = getDecodedBody(F)) {
+    ++NumDecodedAhead;
+    Replay = Body;
+    ReplayPos = 0;
+  } else {
+    Stream.JumpToBit(DFII->second);
+  }
 
-  if (ParseFunctionBody(F)) {
+  bool Err = ParseFunctionBody(F);
+  Replay = 0;
+  if (Err) {
     if (ErrInfo) *ErrInfo = ErrorString;
     return true;
   }
@@ -2974,6 +3068,224 @@ bool BitcodeReader::MaterializeModule(Module *M, std::string *ErrInfo) {
   return false;
 }
 
+//===----------------------------------------------------------------------===//
+// Parallel decoding of function blocks
+//===----------------------------------------------------------------------===//
+
+bool DecodedBlock::decode(BitstreamCursor &Cursor, uint64_t BitNo,
+                          unsigned BlockID) {
+  clear();
+  Cursor.JumpToBit(BitNo);
+  SmallVector<uint64_t, 64> Record;
+  return decodeBlock(Cursor, BlockID, Record);
+}
+
+bool DecodedBlock::decodeBlock(BitstreamCursor &Cursor, unsigned BlockID,
+                               SmallVectorImpl<uint64_t> &Record) {
+  if (Cursor.EnterSubBlock(BlockID))
+    return true;
+
+  while (1) {
+    Entry NewEntry;
+    NewEntry.E = Cursor.advance();
+    NewEntry.FirstOp = NewEntry.NumOps = NewEntry.EndIdx = 0;
+
+    switch (NewEntry.E.Kind) {
+    case BitstreamEntry::Error:
+      return true;
+    case BitstreamEntry::EndBlock:
+      Entries.push_back(NewEntry);
+      return false;
+    case BitstreamEntry::SubBlock: {
+      // Decode nested blocks too, even the ones the parser will skip.
+      unsigned Idx = Entries.size();
+      Entries.push_back(NewEntry);
+      if (decodeBlock(Cursor, NewEntry.E.ID, Record))
+        return true;
+      Entries[Idx].EndIdx = Entries.size() - 1;
+      break;
+    }
+    case BitstreamEntry::Record:
+      Record.clear();
+      NewEntry.E = BitstreamEntry::getRecord(
+        Cursor.readRecord(NewEntry.E.ID, Record));
+      NewEntry.FirstOp = Ops.size();
+      NewEntry.NumOps = Record.size();
+      Ops.insert(Ops.end(), Record.begin(), Record.end());
+      Entries.push_back(NewEntry);
+      break;
+    }
+  }
+}
+
+namespace {
+/// DecodeJob - The function blocks one thread decodes out of a batch: every
+/// Stride'th one, starting at First.
+struct DecodeJob {
+  BitstreamReader *Reader;
+  const uint64_t *BitNos;
+  DecodedBlock *Blocks;
+  char *Failed;
+  unsigned First, Stride, NumBlocks;
+};
+}
+
+static void DecodeFunctionBlocks(void *Arg) {
+  DecodeJob *Job = static_cast<DecodeJob*>(Arg);
+  for (unsigned i = Job->First; i < Job->NumBlocks; i += Job->Stride) {
+    BitstreamCursor Cursor(*Job->Reader);
+    Job->Failed[i] = Job->Blocks[i].decode(Cursor, Job->BitNos[i],
+                                           bitc::FUNCTION_BLOCK_ID);
+  }
+}
+
+/// StartDecoding - Start decoding NumBlocks function blocks at BitNos into
+/// Blocks, one job per thread.  Jobs for which no thread can be started are
+/// run right away.
+static void StartDecoding(std::vector<DecodeJob> &Jobs,
+                          std::vector<void*> &Threads,
+                          BitstreamReader &Reader, const uint64_t *BitNos,
+                          DecodedBlock *Blocks, char *Failed,
+                          unsigned NumBlocks) {
+  for (unsigned i = 0, e = Jobs.size(); i != e; ++i) {
+    DecodeJob &Job = Jobs[i];
+    Job.Reader = &Reader;
+    Job.BitNos = BitNos;
+    Job.Blocks = Blocks;
+    Job.Failed = Failed;
+    Job.First = i;
+    Job.Stride = e;
+    Job.NumBlocks = NumBlocks;
+    if (void *Thread = llvm_start_thread(DecodeFunctionBlocks, &Job))
+      Threads.push_back(Thread);
+    else
+      DecodeFunctionBlocks(&Job);
+  }
+}
+
+static void JoinDecoding(std::vector<void*> &Threads) {
+  for (unsigned i = 0, e = Threads.size(); i != e; ++i)
+    llvm_join_thread(Threads[i]);
+  Threads.clear();
+}
+
+namespace llvm {
+/// FunctionReadAhead - Decodes the function blocks of a module on worker
+/// threads, in the order of the module, while the reader builds the IR of the
+/// ones before.  Clients that materialize one function at a time, like the
+/// linker, mostly go in that order too.  A function that is asked for out of
+/// order is read from the stream by the caller, and reading ahead restarts
+/// after it.
+class FunctionReadAhead {
+  /// Batch - Decoded blocks for the functions [Begin, End).
+  struct Batch {
+    unsigned Begin, End;
+    std::vector<DecodedBlock> Blocks;
+    std::vector<char> Failed;
+
+    Batch() : Begin(0), End(0) {}
+    bool contains(unsigned i) const { return Begin <= i && i < End; }
+  };
+
+  BitstreamReader &Reader;
+  unsigned BatchSize;
+  std::vector<uint64_t> BitNos;
+  DenseMap<Function*, unsigned> Index;
+
+  /// Batches[Cur] is decoded, Batches[Cur ^ 1] may be in flight.
+  Batch Batches[2];
+  unsigned Cur;
+  std::vector<DecodeJob> Jobs;
+  std::vector<void*> Threads;
+
+  void start(Batch &B, unsigned Begin);
+
+public:
+  FunctionReadAhead(BitstreamReader &Reader, unsigned NumThreads,
+                    ArrayRef<Function*> Functions, ArrayRef<uint64_t> BitNos);
+  ~FunctionReadAhead() { JoinDecoding(Threads); }
+
+  /// getDecodedBody - Return the decoded body of F, or null if F has to be
+  /// read from the stream.
+  const DecodedBlock *getDecodedBody(Function *F);
+};
+}
+
+FunctionReadAhead::FunctionReadAhead(BitstreamReader &Reader,
+                                     unsigned NumThreads,
+                                     ArrayRef<Function*> Functions,
+                                     ArrayRef<uint64_t> BitNos)
+  : Reader(Reader), BatchSize(16 * NumThreads),
+    BitNos(BitNos.begin(), BitNos.end()), Cur(0), Jobs(NumThreads) {
+  for (unsigned i = 0, e = Functions.size(); i != e; ++i)
+    Index[Functions[i]] = i;
+  for (unsigned i = 0; i != 2; ++i) {
+    Batches[i].Blocks.resize(BatchSize);
+    Batches[i].Failed.resize(BatchSize);
+  }
+}
+
+void FunctionReadAhead::start(Batch &B, unsigned Begin) {
+  unsigned NumFunctions = BitNos.size();
+  B.Begin = std::min(Begin, NumFunctions);
+  B.End = std::min(B.Begin + BatchSize, NumFunctions);
+  if (B.Begin != B.End)
+    StartDecoding(Jobs, Threads, Reader, &BitNos[B.Begin], &B.Blocks[0],
+                  &B.Failed[0], B.End - B.Begin);
+}
+
+const DecodedBlock *FunctionReadAhead::getDecodedBody(Function *F) {
+  DenseMap<Function*, unsigned>::iterator I = Index.find(F);
+  if (I == Index.end())
+    return 0;
+  unsigned i = I->second;
+
+  if (!Batches[Cur].contains(i)) {
+    JoinDecoding(Threads);
+    if (!Batches[Cur ^ 1].contains(i)) {
+      // Out of order.  Don't wait for a whole batch; decode the functions
+      // after F while the caller reads F itself.
+      Batches[Cur].Begin = Batches[Cur].End = 0;
+      start(Batches[Cur ^ 1], i + 1);
+      return 0;
+    }
+    Cur ^= 1;
+    start(Batches[Cur ^ 1], Batches[Cur].End);
+  }
+
+  Batch &B = Batches[Cur];
+  // If the block could not be decoded, it is read from the stream, which
+  // reports the error.
+  if (B.Failed[i - B.Begin])
+    return 0;
+  return &B.Blocks[i - B.Begin];
+}
+
+/// getDecodedBody - Return the body of F if it was decoded ahead of time.
+/// The positions of all function bodies are only known up front when the
+/// whole file is in memory.
+const DecodedBlock *BitcodeReader::getDecodedBody(Function *F) {
+  if (!DecodeThreads || LazyStreamer)
+    return 0;
+
+  if (!ReadAhead) {
+    std::vector<Function*> Functions;
+    std::vector<uint64_t> BitNos;
+    for (Module::iterator I = TheModule->begin(), E = TheModule->end();
+         I != E; ++I) {
+      DenseMap<Function*, uint64_t>::iterator DFII =
+        DeferredFunctionInfo.find(I);
+      if (DFII != DeferredFunctionInfo.end()) {
+        Functions.push_back(I);
+        BitNos.push_back(DFII->second);
+      }
+    }
+    ReadAhead = new FunctionReadAhead(*StreamFile, DecodeThreads, Functions,
+                                      BitNos);
+  }
+  return ReadAhead->getDecodedBody(F);
+}
+
 bool BitcodeReader::InitStream() {
   if (LazyStreamer) return InitLazyStream();
   return InitStreamFromBuffer();
@@ -3032,11 +3344,15 @@ bool BitcodeReader::InitLazyStream() {
 
 /// getLazyBitcodeModule - lazy function-at-a-time loading from a file.
 ///
-Module *llvm::getLazyBitcodeModule(MemoryBuffer *Buffer,
-                                   LLVMContext& Context,
-                                   std::string *ErrMsg) {
+/// getLazyBitcodeModuleImpl - Implement getLazyBitcodeModule, taking the
+/// identified struct types of the bitcode from StructTypes if it is not empty.
+static Module *getLazyBitcodeModuleImpl(MemoryBuffer *Buffer,
+                                        LLVMContext &Context,
+                                        ArrayRef<StructType*> StructTypes,
+                                        std::string *ErrMsg) {
   Module *M = new Module(Buffer->getBufferIdentifier(), Context);
   BitcodeReader *R = new BitcodeReader(Buffer, Context);
+  R->reuseStructTypes(StructTypes);
   M->setMaterializer(R);
   if (R->ParseBitcodeInto(M)) {
     if (ErrMsg)
@@ -3053,6 +3369,13 @@ Module *llvm::getLazyBitcodeModule(MemoryBuffer *Buffer,
   return M;
 }
 
+Module *llvm::getLazyBitcodeModule(MemoryBuffer *Buffer,
+                                   LLVMContext& Context,
+                                   std::string *ErrMsg) {
+  return getLazyBitcodeModuleImpl(Buffer, Context,
+                                  ArrayRef<StructType*>(), ErrMsg);
+}
+
 
 Module *llvm::getStreamedBitcodeModule(const std::string &name,
                                        DataStreamer *streamer,
@@ -3075,7 +3398,13 @@ Module *llvm::getStreamedBitcodeModule(const std::string &name,
 /// If an error occurs, return null and fill in *ErrMsg if non-null.
 Module *llvm::ParseBitcodeFile(MemoryBuffer *Buffer, LLVMContext& Context,
                                std::string *ErrMsg){
-  Module *M = getLazyBitcodeModule(Buffer, Context, ErrMsg);
+  return ParseBitcodeFile(Buffer, Context, ArrayRef<StructType*>(), ErrMsg);
+}
+
+Module *llvm::ParseBitcodeFile(MemoryBuffer *Buffer, LLVMContext& Context,
+                               ArrayRef<StructType*> StructTypes,
+                               std::string *ErrMsg) {
+  Module *M = getLazyBitcodeModuleImpl(Buffer, Context, StructTypes, ErrMsg);
   if (!M) return 0;
 
   // Don't let the BitcodeReader dtor delete 'Buffer', regardless of whether
@@ -15,6 +15,7 @@
 #define BITCODE_READER_H
 
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Bitcode/BitstreamReader.h"
 #include "llvm/Bitcode/LLVMBitCodes.h"
 #include "llvm/GVMaterializer.h"
@@ -121,6 +122,46 @@ public:
   void AssignValue(Value *V, unsigned Idx);
 };
 
+//===----------------------------------------------------------------------===//
+//                          DecodedBlock Class
+//===----------------------------------------------------------------------===//
+
+/// DecodedBlock - The entries of a function block and of the blocks nested in
+/// it, decoded from the bitstream ahead of time.  Decoding only needs a cursor
+/// of its own, so several function blocks can be decoded on different threads
+/// while the reader builds IR, which has to stay on one thread because it
+/// touches the LLVMContext, from the blocks decoded earlier.
+class DecodedBlock {
+public:
+  struct Entry {
+    /// Kind and ID of the entry.  For records the ID is the record code, for
+    /// sub-blocks the block ID.
+    BitstreamEntry E;
+    /// For records, the operands are Ops[FirstOp, FirstOp+NumOps).
+    unsigned FirstOp, NumOps;
+    /// For sub-blocks, the index of the entry that ends the block.
+    unsigned EndIdx;
+  };
+
+  std::vector<Entry> Entries;
+  std::vector<uint64_t> Ops;
+
+  /// decode - Decode the block with the given ID starting at BitNo, just past
+  /// its ENTER_SUBBLOCK record, with Cursor.  Returns true on error.
+  bool decode(BitstreamCursor &Cursor, uint64_t BitNo, unsigned BlockID);
+
+  void clear() {
+    Entries.clear();
+    Ops.clear();
+  }
+
+private:
+  bool decodeBlock(BitstreamCursor &Cursor, unsigned BlockID,
+                   SmallVectorImpl<uint64_t> &Record);
+};
+
+class FunctionReadAhead;
+
 class BitcodeReader : public GVMaterializer {
   LLVMContext &Context;
   Module *TheModule;
@@ -135,6 +176,14 @@ class BitcodeReader : public GVMaterializer {
   const char *ErrorString;
 
   std::vector<Type*> TypeList;
+
+  /// ReusedStructTypes - If not empty, the identified struct types of the
+  /// bitcode are taken from here by name instead of being created (see
+  /// reuseStructTypes).  ReusedStructIDs holds the type IDs they are given in
+  /// the type table, so that forward references to them can be resolved.
+  StringMap<StructType*> ReusedStructTypes;
+  DenseMap<unsigned, StructType*> ReusedStructIDs;
+
   BitcodeReaderValueList ValueList;
   BitcodeReaderMDValueList MDValueList;
   SmallVector<Instruction *, 64> InstructionList;
@@ -191,18 +240,31 @@ class BitcodeReader : public GVMaterializer {
   /// not need this flag.
   bool UseRelativeIDs;
 
+  /// Replay, ReplayPos - While a function body that was decoded ahead of time
+  /// is parsed, the records are read from Replay rather than from Stream.  See
+  /// the record reading helpers below.
+  const DecodedBlock *Replay;
+  unsigned ReplayPos;
+
+  /// ReadAhead - Under -bitcode-decode-threads, the function bodies that
+  /// follow the one being materialized are decoded on worker threads.  Created
+  /// on the first materialization.
+  FunctionReadAhead *ReadAhead;
+
 public:
   explicit BitcodeReader(MemoryBuffer *buffer, LLVMContext &C)
     : Context(C), TheModule(0), Buffer(buffer), BufferOwned(false),
       LazyStreamer(0), NextUnreadBit(0), SeenValueSymbolTable(false),
       ErrorString(0), ValueList(C), MDValueList(C),
-      SeenFirstFunctionBody(false), UseRelativeIDs(false) {
+      SeenFirstFunctionBody(false), UseRelativeIDs(false), Replay(0),
+      ReplayPos(0), ReadAhead(0) {
   }
   explicit BitcodeReader(DataStreamer *streamer, LLVMContext &C)
     : Context(C), TheModule(0), Buffer(0), BufferOwned(false),
       LazyStreamer(streamer), NextUnreadBit(0), SeenValueSymbolTable(false),
       ErrorString(0), ValueList(C), MDValueList(C),
-      SeenFirstFunctionBody(false), UseRelativeIDs(false) {
+      SeenFirstFunctionBody(false), UseRelativeIDs(false), Replay(0),
+      ReplayPos(0), ReadAhead(0) {
   }
   ~BitcodeReader() {
     FreeState();
@@ -216,6 +278,11 @@ public:
   /// when the reader is destroyed.
   void setBufferOwned(bool Owned) { BufferOwned = Owned; }
 
+  /// reuseStructTypes - Take the identified struct types of the bitcode from
+  /// Types, by name, instead of creating them.  Must be called before
+  /// ParseBitcodeInto.
+  void reuseStructTypes(ArrayRef<StructType*> Types);
+
   virtual bool isMaterializable(const GlobalValue *GV) const;
   virtual bool isDematerializable(const GlobalValue *GV) const;
   virtual bool Materialize(GlobalValue *GV, std::string *ErrInfo = 0);
@@ -321,11 +388,59 @@ private:
     return getFnValueByID(ValNo, Ty);
   }
 
+  // The parsers for blocks that can appear in a function body read records
+  // through these, which forward to Stream unless a decoded function body is
+  // being replayed.
+  bool enterBlock(unsigned BlockID) {
+    // When replaying, the position is already inside the block.
+    return Replay ? false : Stream.EnterSubBlock(BlockID);
+  }
+  BitstreamEntry advance() {
+    if (!Replay)
+      return Stream.advance();
+    if (ReplayPos == Replay->Entries.size())
+      return BitstreamEntry::getError();
+    return Replay->Entries[ReplayPos++].E;
+  }
+  BitstreamEntry advanceSkippingSubblocks() {
+    if (!Replay)
+      return Stream.advanceSkippingSubblocks();
+    while (1) {
+      BitstreamEntry Entry = advance();
+      if (Entry.Kind != BitstreamEntry::SubBlock)
+        return Entry;
+      skipBlock();
+    }
+  }
+  bool skipBlock() {
+    if (!Replay)
+      return Stream.SkipBlock();
+    // The sub-block was the entry just returned by advance().
+    ReplayPos = Replay->Entries[ReplayPos-1].EndIdx + 1;
+    return false;
+  }
+  unsigned readCode() {
+    if (!Replay)
+      return Stream.ReadCode();
+    // Step onto the record; readRecord then reads it.
+    return Replay->Entries[ReplayPos++].E.ID;
+  }
+  unsigned readRecord(unsigned AbbrevID, SmallVectorImpl<uint64_t> &Vals) {
+    if (!Replay)
+      return Stream.readRecord(AbbrevID, Vals);
+    // The record is the entry just returned by advance() or readCode().
+    const DecodedBlock::Entry &Entry = Replay->Entries[ReplayPos-1];
+    Vals.append(Replay->Ops.begin() + Entry.FirstOp,
+                Replay->Ops.begin() + Entry.FirstOp + Entry.NumOps);
+    return Entry.E.ID;
+  }
+
   bool ParseModule(bool Resume);
   bool ParseAttributeBlock();
   bool ParseAttributeGroupBlock();
   bool ParseTypeTable();
   bool ParseTypeTableBody();
+  bool ScanReusedStructTypes();
 
   bool ParseValueSymbolTable();
   bool ParseConstants();
@@ -340,6 +455,7 @@ private:
   bool InitStream();
   bool InitStreamFromBuffer();
   bool InitLazyStream();
+  const DecodedBlock *getDecodedBody(Function *F);
   bool FindFunctionInStream(Function *F,
          DenseMap<Function*, uint64_t>::iterator DeferredFunctionInfoIterator);
 };
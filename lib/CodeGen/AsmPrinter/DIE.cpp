@@ -108,8 +108,25 @@ void DIEAbbrev::dump() { print(dbgs()); }
 //===----------------------------------------------------------------------===//
 
 DIE::~DIE() {
-  for (unsigned i = 0, N = Children.size(); i < N; ++i)
-    delete Children[i];
+}
+
+/// growValues - Move the values to a larger array from Allocator.
+void DIE::growValues(BumpPtrAllocator &Allocator) {
+  unsigned NewCapacity = ValuesCapacity * 2;
+  DIEValue **NewValues = Allocator.Allocate<DIEValue*>(NewCapacity);
+  std::copy(Values, Values + NumValues, NewValues);
+  Values = NewValues;
+  ValuesCapacity = NewCapacity;
+}
+
+/// destroyTree - Run the destructors of this DIE and of its descendants.
+void DIE::destroyTree() {
+  for (DIE *Child = FirstChild; Child;) {
+    DIE *Next = Child->Sibling;
+    Child->destroyTree();
+    Child = Next;
+  }
+  this->~DIE();
 }
 
 /// Climb up the parent chain to get the compile unit DIE this DIE belongs to.
@@ -163,9 +180,8 @@ void DIE::print(raw_ostream &O, unsigned IncIndent) {
   }
   IndentCount -= 2;
 
-  for (unsigned j = 0, M = Children.size(); j < M; ++j) {
-    Children[j]->print(O, 4);
-  }
+  for (DIE *Child = FirstChild; Child; Child = Child->Sibling)
+    Child->print(O, 4);
 
   if (!isBlock) O << "\n";
   IndentCount -= IncIndent;
@@ -325,7 +341,7 @@ void DIEEntry::print(raw_ostream &O) {
 unsigned DIEBlock::ComputeSize(AsmPrinter *AP) {
   if (!Size) {
     const SmallVector<DIEAbbrevData, 8> &AbbrevData = Abbrev.getData();
-    for (unsigned i = 0, N = Values.size(); i < N; ++i)
+    for (unsigned i = 0, N = NumValues; i < N; ++i)
       Size += Values[i]->SizeOf(AP, AbbrevData[i].getForm());
   }
 
@@ -344,7 +360,7 @@ void DIEBlock::EmitValue(AsmPrinter *Asm, unsigned Form) const {
   }
 
   const SmallVector<DIEAbbrevData, 8> &AbbrevData = Abbrev.getData();
-  for (unsigned i = 0, N = Values.size(); i < N; ++i)
+  for (unsigned i = 0, N = NumValues; i < N; ++i)
     Values[i]->EmitValue(Asm, AbbrevData[i].getForm());
 }
 
@@ -14,8 +14,10 @@
 #ifndef CODEGEN_ASMPRINTER_DIE_H__
 #define CODEGEN_ASMPRINTER_DIE_H__
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/FoldingSet.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Allocator.h"
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/Dwarf.h"
 #include <vector>
@@ -108,7 +110,9 @@ namespace llvm {
 
   //===--------------------------------------------------------------------===//
   /// DIE - A structured debug information entry.  Has an abbreviation which
-  /// describes it's organization.
+  /// describes it's organization.  DIEs and their values are allocated from
+  /// the BumpPtrAllocator of their compile unit, and a DIE only refers to its
+  /// children and values, it doesn't own them.
   class DIEValue;
 
   class DIE {
@@ -125,22 +129,33 @@ namespace llvm {
     ///
     DIEAbbrev Abbrev;
 
-    /// Children DIEs.
+    /// Parent - The DIE this is a child of, or null.
     ///
-    std::vector<DIE *> Children;
-
     DIE *Parent;
 
-    /// Attribute values.
+    /// FirstChild, LastChild - The children of this DIE, linked through their
+    /// Sibling pointers.
+    DIE *FirstChild, *LastChild;
+
+    /// Sibling - The next child of Parent.
     ///
-    SmallVector<DIEValue*, 32> Values;
+    DIE *Sibling;
+
+    /// Values - Attribute values.  They are stored in InlineValues until they
+    /// no longer fit, and then in an array allocated by addValue.
+    DIEValue **Values;
+    unsigned NumValues, ValuesCapacity;
+
+    enum { NumInlineValues = 4 };
+    DIEValue *InlineValues[NumInlineValues];
 
     // Private data for print()
     mutable unsigned IndentCount;
   public:
     explicit DIE(unsigned Tag)
       : Offset(0), Size(0), Abbrev(Tag, dwarf::DW_CHILDREN_no), Parent(0),
-        IndentCount(0) {}
+        FirstChild(0), LastChild(0), Sibling(0), Values(InlineValues),
+        NumValues(0), ValuesCapacity(NumInlineValues), IndentCount(0) {}
     virtual ~DIE();
 
     // Accessors.
@@ -149,8 +164,12 @@ namespace llvm {
     unsigned getTag() const { return Abbrev.getTag(); }
     unsigned getOffset() const { return Offset; }
     unsigned getSize() const { return Size; }
-    const std::vector<DIE *> &getChildren() const { return Children; }
-    const SmallVector<DIEValue*, 32> &getValues() const { return Values; }
+    bool hasChildren() const { return FirstChild != 0; }
+    DIE *getFirstChild() const { return FirstChild; }
+    DIE *getSibling() const { return Sibling; }
+    ArrayRef<DIEValue*> getValues() const {
+      return ArrayRef<DIEValue*>(Values, NumValues);
+    }
     DIE *getParent() const { return Parent; }
     /// Climb up the parent chain to get the compile unit DIE this DIE belongs
     /// to.
@@ -159,11 +178,15 @@ namespace llvm {
     void setOffset(unsigned O) { Offset = O; }
     void setSize(unsigned S) { Size = S; }
 
-    /// addValue - Add a value and attributes to a DIE.
-    ///
-    void addValue(unsigned Attribute, unsigned Form, DIEValue *Value) {
+    /// addValue - Add a value and attributes to a DIE.  Once the values no
+    /// longer fit in the DIE, they are moved to memory from Allocator, which
+    /// must be the allocator the DIE belongs to.
+    void addValue(BumpPtrAllocator &Allocator, unsigned Attribute,
+                  unsigned Form, DIEValue *Value) {
       Abbrev.AddAttribute(Attribute, Form);
-      Values.push_back(Value);
+      if (NumValues == ValuesCapacity)
+        growValues(Allocator);
+      Values[NumValues++] = Value;
     }
 
     /// addChild - Add a child to the DIE.
@@ -174,14 +197,26 @@ namespace llvm {
         return;
       }
       Abbrev.setChildrenFlag(dwarf::DW_CHILDREN_yes);
-      Children.push_back(Child);
+      if (LastChild)
+        LastChild->Sibling = Child;
+      else
+        FirstChild = Child;
+      LastChild = Child;
       Child->Parent = this;
     }
 
+    /// destroyTree - Run the destructors of this DIE and of its descendants,
+    /// whose memory belongs to the allocator they were created with.
+    void destroyTree();
+
 #ifndef NDEBUG
     void print(raw_ostream &O, unsigned IncIndent = 0);
     void dump();
 #endif
+
+  private:
+    /// growValues - Move the values to a larger array from Allocator.
+    void growValues(BumpPtrAllocator &Allocator);
   };
 
   //===--------------------------------------------------------------------===//
@@ -42,9 +42,13 @@ class CompileUnit {
   ///
   unsigned Language;
 
+  /// DIEAllocator - All the DIEs and DIEValues of the unit are allocated
+  /// through this allocator.
+  BumpPtrAllocator DIEAllocator;
+
   /// Die - Compile unit debug information entry.
   ///
-  const OwningPtr<DIE> CUDie;
+  DIE *CUDie;
 
   /// Asm - Target of Dwarf emission.
   AsmPrinter *Asm;
@@ -98,14 +102,14 @@ class CompileUnit {
   DIE *getOrCreateContextDIE(DIDescriptor Context);
 
 public:
-  CompileUnit(unsigned UID, unsigned L, DIE *D, AsmPrinter *A, DwarfDebug *DW,
+  CompileUnit(unsigned UID, unsigned L, AsmPrinter *A, DwarfDebug *DW,
               DwarfUnits *);
   ~CompileUnit();
 
   // Accessors.
   unsigned getUniqueID()            const { return UniqueID; }
   unsigned getLanguage()            const { return Language; }
-  DIE* getCUDie()                   const { return CUDie.get(); }
+  DIE* getCUDie()                   const { return CUDie; }
   unsigned getDebugInfoOffset()     const { return DebugInfoOffset; }
   const StringMap<DIE*> &getGlobalNames() const { return GlobalNames; }
   const StringMap<DIE*> &getGlobalTypes() const { return GlobalTypes; }
@@ -127,7 +131,7 @@ public:
   void setDebugInfoOffset(unsigned DbgInfoOff) { DebugInfoOffset = DbgInfoOff; }
   /// hasContent - Return true if this compile unit has something to write out.
   ///
-  bool hasContent() const { return !CUDie->getChildren().empty(); }
+  bool hasContent() const { return CUDie->hasChildren(); }
 
   /// addGlobalName - Add a new global entity to the compile unit.
   ///
@@ -161,7 +165,12 @@ public:
   DIE *getDIE(const MDNode *N) { return MDNodeToDieMap.lookup(N); }
 
   DIEBlock *getDIEBlock() {
-    return new (DIEValueAllocator) DIEBlock();
+    return new (DIEAllocator) DIEBlock();
+  }
+
+  /// createDIE - Create a DIE with the given tag, which belongs to this unit.
+  DIE *createDIE(unsigned Tag) {
+    return new (DIEAllocator) DIE(Tag);
   }
 
   /// insertDIE - Insert DIE into the map.
@@ -374,8 +383,6 @@ public:
 
 private:
 
-  // DIEValueAllocator - All DIEValues are allocated through this allocator.
-  BumpPtrAllocator DIEValueAllocator;
   DIEInteger *DIEIntegerOne;
 };
 
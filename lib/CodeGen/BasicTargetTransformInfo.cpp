@@ -41,6 +41,8 @@ public:
     initializeBasicTTIPass(*PassRegistry::getPassRegistry());
   }
 
+  virtual Pass *createClone() const { return new BasicTTI(TLI); }
+
   virtual void initializePass() {
     pushTTIStack(this);
   }
@@ -98,6 +100,11 @@ public:
   virtual unsigned getMemoryOpCost(unsigned Opcode, Type *Src,
                                    unsigned Alignment,
                                    unsigned AddressSpace) const;
+  virtual unsigned getInterleavedMemoryOpCost(unsigned Opcode, Type *VecTy,
+                                              unsigned Factor,
+                                              ArrayRef<unsigned> Indices,
+                                              unsigned Alignment,
+                                              unsigned AddressSpace) const;
   virtual unsigned getIntrinsicInstrCost(Intrinsic::ID, Type *RetTy,
                                          ArrayRef<Type*> Tys) const;
   virtual unsigned getNumberOfParts(Type *Tp) const;
@@ -379,6 +386,45 @@ unsigned BasicTTI::getMemoryOpCost(unsigned Opcode, Type *Src,
   return LT.first;
 }
 
+unsigned BasicTTI::getInterleavedMemoryOpCost(unsigned Opcode, Type *VecTy,
+                                              unsigned Factor,
+                                              ArrayRef<unsigned> Indices,
+                                              unsigned Alignment,
+                                              unsigned AddressSpace) const {
+  assert(VecTy->isVectorTy() && "Expect a vector type");
+  unsigned NumElts = VecTy->getVectorNumElements();
+  assert(Factor > 1 && NumElts % Factor == 0 && "Invalid interleave factor");
+  unsigned NumSubElts = NumElts / Factor;
+  Type *SubTy = VectorType::get(VecTy->getVectorElementType(), NumSubElts);
+
+  // The cost of the wide load or store.
+  unsigned Cost = TopTTI->getMemoryOpCost(Opcode, VecTy, Alignment,
+                                          AddressSpace);
+
+  // Assume that the shuffles are scalarized: every element of a member is
+  // extracted from one vector and inserted into the other.
+  unsigned NumMembers = Opcode == Instruction::Load ? Indices.size() : Factor;
+  for (unsigned i = 0; i < NumMembers; ++i) {
+    unsigned Index = Opcode == Instruction::Load ? Indices[i] : i;
+    for (unsigned j = 0; j < NumSubElts; ++j) {
+      unsigned WideIdx = j * Factor + Index;
+      if (Opcode == Instruction::Load) {
+        Cost += TopTTI->getVectorInstrCost(Instruction::ExtractElement, VecTy,
+                                           WideIdx);
+        Cost += TopTTI->getVectorInstrCost(Instruction::InsertElement, SubTy,
+                                           j);
+      } else {
+        Cost += TopTTI->getVectorInstrCost(Instruction::ExtractElement, SubTy,
+                                           j);
+        Cost += TopTTI->getVectorInstrCost(Instruction::InsertElement, VecTy,
+                                           WideIdx);
+      }
+    }
+  }
+
+  return Cost;
+}
+
 unsigned BasicTTI::getIntrinsicInstrCost(Intrinsic::ID IID, Type *RetTy,
                                          ArrayRef<Type *> Tys) const {
   unsigned ISD = 0;
@@ -0,0 +1,103 @@
+//===-- CodeGenBudget.cpp - Compile time budget ---------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the compile time budget of machine functions.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "codegen-budget"
+#include "llvm/CodeGen/CodeGenBudget.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/CodeGen/MachineFunction.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/raw_ostream.h"
+using namespace llvm;
+
+STATISTIC(NumFull,  "Number of functions given the full pass");
+STATISTIC(NumCheap, "Number of functions given the cheaper variant of a pass");
+STATISTIC(NumSkip,  "Number of functions skipped by a pass");
+
+static cl::opt<unsigned>
+Budget("codegen-budget", cl::Hidden, cl::init(0),
+       cl::desc("Compile time budget of each machine function for the "
+                "optional optimization passes, in units of roughly one "
+                "instruction visit (0 = unlimited)"));
+
+static cl::opt<bool>
+PrintDecisions("codegen-budget-report", cl::Hidden,
+               cl::desc("Print the decision taken for each pass and function "
+                        "under -codegen-budget"));
+
+namespace {
+/// The estimated cost of a budgeted pass, per instruction of the function.
+struct PassCost {
+  const char *Name;
+  unsigned Full;
+  /// The cost of the cheaper variant, or 0 if the pass doesn't have one.
+  unsigned Cheap;
+  /// Whether the pass may leave a function alone.  If not, the cheaper
+  /// variant runs even when the budget cannot pay for it.
+  bool Skippable;
+};
+}
+
+// Indexed by CodeGenBudget::BudgetedPass. The costs are rough ratios of the
+// time the passes take on typical functions.
+static const PassCost Costs[] = {
+  { "early-ifcvt",       2, 0, true  },
+  { "machinelicm",       4, 0, true  },
+  { "machine-cse",       3, 0, true  },
+  { "misched",           8, 2, true  },
+  { "greedy-splitting",  8, 2, false },
+  { "block-placement",   2, 0, true  }
+};
+
+bool CodeGenBudget::isEnabled() {
+  return Budget != 0;
+}
+
+CodeGenBudget::Decision
+CodeGenBudget::decide(MachineFunction &MF, BudgetedPass P) {
+  if (!Budget)
+    return Full;
+
+  uint64_t NumInstrs = 0;
+  for (MachineFunction::iterator MBB = MF.begin(), E = MF.end(); MBB != E;
+       ++MBB)
+    NumInstrs += MBB->size();
+
+  const PassCost &PC = Costs[P];
+  uint64_t Spent = MF.getBudgetSpent();
+  uint64_t Remaining = Spent < Budget ? Budget - Spent : 0;
+  Decision D;
+  uint64_t Cost;
+  if (NumInstrs * PC.Full <= Remaining) {
+    D = Full;
+    Cost = NumInstrs * PC.Full;
+    ++NumFull;
+  } else if (PC.Cheap &&
+             (!PC.Skippable || NumInstrs * PC.Cheap <= Remaining)) {
+    D = Cheap;
+    Cost = NumInstrs * PC.Cheap;
+    ++NumCheap;
+  } else {
+    D = Skip;
+    Cost = 0;
+    ++NumSkip;
+  }
+  MF.chargeBudget(Cost);
+
+  if (PrintDecisions) {
+    static const char *const Names[] = { "full", "cheap", "skip" };
+    errs() << "codegen-budget: " << MF.getName() << ": " << PC.Name << ' '
+           << Names[D] << ", " << NumInstrs << " instrs, cost " << Cost
+           << " of " << Remaining << '\n';
+  }
+  return D;
+}
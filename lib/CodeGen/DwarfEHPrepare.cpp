@@ -49,6 +49,8 @@ namespace {
         initializeDominatorTreePass(*PassRegistry::getPassRegistry());
       }
 
+    virtual Pass *createClone() const { return new DwarfEHPrepare(TM); }
+
     virtual bool runOnFunction(Function &Fn);
 
     virtual void getAnalysisUsage(AnalysisUsage &AU) const { }
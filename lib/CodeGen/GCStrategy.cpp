@@ -53,6 +53,7 @@ namespace {
     static char ID;
 
     LowerIntrinsics();
+    virtual Pass *createClone() const { return new LowerIntrinsics(); }
     const char *getPassName() const;
     void getAnalysisUsage(AnalysisUsage &AU) const;
 
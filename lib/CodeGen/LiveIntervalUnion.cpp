@@ -16,13 +16,19 @@
 #define DEBUG_TYPE "regalloc"
 #include "llvm/CodeGen/LiveIntervalUnion.h"
 #include "llvm/ADT/SparseBitVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Pass.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetRegisterInfo.h"
 #include <algorithm>
 
 using namespace llvm;
 
+STATISTIC(NumQueries   , "Number of interfering vreg collections");
+STATISTIC(NumQueryHits , "Number of collections answered by the query state");
+
 
 // Merge a LiveInterval's segments. Guarantee no overlaps.
 void LiveIntervalUnion::unify(LiveInterval &VirtReg) {
@@ -117,9 +123,16 @@ bool LiveIntervalUnion::Query::isSeenInterference(LiveInterval *VirtReg) const {
 //
 unsigned LiveIntervalUnion::Query::
 collectInterferingVRegs(unsigned MaxInterferingRegs) {
+  ++NumQueries;
+
   // Fast path return if we already have the desired information.
-  if (SeenAllInterferences || InterferingVRegs.size() >= MaxInterferingRegs)
+  if (SeenAllInterferences || InterferingVRegs.size() >= MaxInterferingRegs) {
+    ++NumQueryHits;
     return InterferingVRegs.size();
+  }
+
+  NamedRegionTimer T("Collect Interfering VRegs", "Register Allocation",
+                     TimePassesIsEnabled);
 
   // Set up iterators on the first call.
   if (!CheckedFirstInterference) {
@@ -18,6 +18,7 @@
 #include "llvm/CodeGen/LiveIntervalAnalysis.h"
 #include "llvm/CodeGen/MachineRegisterInfo.h"
 #include "llvm/CodeGen/VirtRegMap.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetMachine.h"
@@ -27,6 +28,14 @@ using namespace llvm;
 
 STATISTIC(NumAssigned   , "Number of registers assigned");
 STATISTIC(NumUnassigned , "Number of registers unassigned");
+STATISTIC(NumChecks     , "Number of interference checks");
+STATISTIC(NumCheckHits  , "Number of interference checks answered from cache");
+STATISTIC(NumCheckRedos , "Number of cached checks redone for the matrix only");
+
+static cl::opt<bool>
+CacheChecks("regalloc-interference-cache", cl::Hidden, cl::init(true),
+            cl::desc("Remember interference checks until the virtual "
+                     "registers or the assignments change"));
 
 char LiveRegMatrix::ID = 0;
 INITIALIZE_PASS_BEGIN(LiveRegMatrix, "liveregmatrix",
@@ -37,7 +46,7 @@ INITIALIZE_PASS_END(LiveRegMatrix, "liveregmatrix",
                     "Live Register Matrix", false, false)
 
 LiveRegMatrix::LiveRegMatrix() : MachineFunctionPass(ID),
-  UserTag(0), RegMaskTag(0), RegMaskVirtReg(0) {}
+  UserTag(0), Generation(0), RegMaskTag(0), RegMaskVirtReg(0) {}
 
 void LiveRegMatrix::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.setPreservesAll();
@@ -56,6 +65,7 @@ bool LiveRegMatrix::runOnMachineFunction(MachineFunction &MF) {
   if (NumRegUnits != Matrix.size())
     Queries.reset(new LiveIntervalUnion::Query[NumRegUnits]);
   Matrix.init(LIUAlloc, NumRegUnits);
+  Checks.resize(TRI->getNumRegs());
 
   // Make sure no stale queries get reused.
   invalidateVirtRegs();
@@ -79,6 +89,7 @@ void LiveRegMatrix::assign(LiveInterval &VirtReg, unsigned PhysReg) {
     DEBUG(dbgs() << ' ' << PrintRegUnit(*Units, TRI));
     Matrix[*Units].unify(VirtReg);
   }
+  ++Generation;
   ++NumAssigned;
   DEBUG(dbgs() << '\n');
 }
@@ -92,6 +103,7 @@ void LiveRegMatrix::unassign(LiveInterval &VirtReg) {
     DEBUG(dbgs() << ' ' << PrintRegUnit(*Units, TRI));
     Matrix[*Units].extract(VirtReg);
   }
+  ++Generation;
   ++NumUnassigned;
   DEBUG(dbgs() << '\n');
 }
@@ -132,23 +144,49 @@ LiveIntervalUnion::Query &LiveRegMatrix::query(LiveInterval &VirtReg,
   return Q;
 }
 
+bool LiveRegMatrix::checkVirtRegInterference(LiveInterval &VirtReg,
+                                             unsigned PhysReg) {
+  for (MCRegUnitIterator Units(PhysReg, TRI); Units.isValid(); ++Units)
+    if (query(VirtReg, *Units).checkInterference())
+      return true;
+  return false;
+}
+
 LiveRegMatrix::InterferenceKind
 LiveRegMatrix::checkInterference(LiveInterval &VirtReg, unsigned PhysReg) {
   if (VirtReg.empty())
     return IK_Free;
 
+  ++NumChecks;
+  CheckResult &C = Checks[PhysReg];
+  if (CacheChecks && C.VirtReg == VirtReg.reg && C.UserTag == UserTag) {
+    // Fixed interference only depends on the live range of VirtReg.
+    if (C.Kind > IK_VirtReg || C.Generation == Generation) {
+      ++NumCheckHits;
+      return C.Kind;
+    }
+    // Assignments changed since, but there is no fixed interference.
+    ++NumCheckRedos;
+    C.Kind = checkVirtRegInterference(VirtReg, PhysReg) ? IK_VirtReg : IK_Free;
+    C.Generation = Generation;
+    return C.Kind;
+  }
+
+  C.VirtReg = VirtReg.reg;
+  C.UserTag = UserTag;
+  C.Generation = Generation;
+
   // Regmask interference is the fastest check.
   if (checkRegMaskInterference(VirtReg, PhysReg))
-    return IK_RegMask;
+    return C.Kind = IK_RegMask;
 
   // Check for fixed interference.
   if (checkRegUnitInterference(VirtReg, PhysReg))
-    return IK_RegUnit;
+    return C.Kind = IK_RegUnit;
 
   // Check the matrix for virtual register interference.
-  for (MCRegUnitIterator Units(PhysReg, TRI); Units.isValid(); ++Units)
-    if (query(VirtReg, *Units).checkInterference())
-      return IK_VirtReg;
+  if (checkVirtRegInterference(VirtReg, PhysReg))
+    return C.Kind = IK_VirtReg;
 
-  return IK_Free;
+  return C.Kind = IK_Free;
 }
@@ -31,6 +31,7 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/CodeGen/CodeGenBudget.h"
 #include "llvm/CodeGen/MachineBasicBlock.h"
 #include "llvm/CodeGen/MachineBlockFrequencyInfo.h"
 #include "llvm/CodeGen/MachineBranchProbabilityInfo.h"
@@ -1076,6 +1077,10 @@ bool MachineBlockPlacement::runOnMachineFunction(MachineFunction &F) {
   if (llvm::next(F.begin()) == F.end())
     return false;
 
+  if (CodeGenBudget::decide(F, CodeGenBudget::MachineBlockPlacement) ==
+      CodeGenBudget::Skip)
+    return false;
+
   MBPI = &getAnalysis<MachineBranchProbabilityInfo>();
   MBFI = &getAnalysis<MachineBlockFrequencyInfo>();
   MLI = &getAnalysis<MachineLoopInfo>();
@@ -73,6 +73,7 @@ MachineFunction::MachineFunction(const Function *F, const TargetMachine &TM,
                          TM.getTargetLowering()->getPrefFunctionAlignment());
   FunctionNumber = FunctionNum;
   JumpTableInfo = 0;
+  BudgetSpent = 0;
 }
 
 MachineFunction::~MachineFunction() {
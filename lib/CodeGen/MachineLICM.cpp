@@ -26,6 +26,7 @@
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/CodeGen/CodeGenBudget.h"
 #include "llvm/CodeGen/MachineDominators.h"
 #include "llvm/CodeGen/MachineFrameInfo.h"
 #include "llvm/CodeGen/MachineLoopInfo.h"
@@ -320,6 +321,10 @@ static bool LoopIsOuterMostWithPredecessor(MachineLoop *CurLoop) {
 
 bool MachineLICM::runOnMachineFunction(MachineFunction &MF) {
   Changed = FirstInLoop = false;
+  if (CodeGenBudget::decide(MF, CodeGenBudget::MachineLICM) ==
+      CodeGenBudget::Skip)
+    return false;
+
   TM = &MF.getTarget();
   TII = TM->getInstrInfo();
   TLI = TM->getTargetLowering();
@@ -17,7 +17,9 @@
 #include "llvm/CodeGen/MachineScheduler.h"
 #include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/PriorityQueue.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/CodeGen/CodeGenBudget.h"
 #include "llvm/CodeGen/LiveIntervalAnalysis.h"
 #include "llvm/CodeGen/MachineDominators.h"
 #include "llvm/CodeGen/MachineLoopInfo.h"
@@ -34,6 +36,8 @@
 
 using namespace llvm;
 
+STATISTIC(NumSplitRegions, "Number of scheduling regions split by size");
+
 namespace llvm {
 cl::opt<bool> ForceTopDown("misched-topdown", cl::Hidden,
                            cl::desc("Force top-down list scheduling"));
@@ -59,6 +63,10 @@ static cl::opt<bool> EnableLoadCluster("misched-cluster", cl::Hidden,
 static cl::opt<bool> EnableMacroFusion("misched-fusion", cl::Hidden,
   cl::desc("Enable scheduling for macro fusion."), cl::init(true));
 
+/// The largest scheduling region of the cheaper variant of the scheduler, which
+/// is used when the compile time budget of a function runs low.
+static const unsigned CheapMaxRegionSize = 64;
+
 static cl::opt<bool> VerifyScheduling("verify-misched", cl::Hidden,
   cl::desc("Verify machine instrs before and after machine scheduling"));
 
@@ -202,6 +210,19 @@ bool MachineScheduler::runOnMachineFunction(MachineFunction &mf) {
   LIS = &getAnalysis<LiveIntervals>();
   const TargetInstrInfo *TII = MF->getTarget().getInstrInfo();
 
+  // The cheaper variant schedules smaller regions, which bounds the cost of
+  // building and scheduling their DAGs.
+  CodeGenBudget::Decision Budget =
+    CodeGenBudget::decide(*MF, CodeGenBudget::MachineScheduler);
+  if (Budget == CodeGenBudget::Skip)
+    return false;
+  // The IR isn't changed during scheduling.
+  AA->beginCacheScope();
+  unsigned MaxRegionSize = ScheduleDAGInstrs::getMaxRegionSize();
+  if (Budget == CodeGenBudget::Cheap &&
+      (!MaxRegionSize || MaxRegionSize > CheapMaxRegionSize))
+    MaxRegionSize = CheapMaxRegionSize;
+
   if (VerifyScheduling) {
     DEBUG(LIS->print(dbgs()));
     MF->verify(this, "Before machine scheduling.");
@@ -253,11 +274,20 @@ bool MachineScheduler::runOnMachineFunction(MachineFunction &mf) {
       }
 
       // The next region starts above the previous region. Look backward in the
-      // instruction stream until we find the nearest boundary.
+      // instruction stream until we find the nearest boundary, or until the
+      // region is as large as allowed. In that case the instruction above the
+      // region stays in place, as if it were a boundary.
+      unsigned NumRegionInstrs = 0;
       MachineBasicBlock::iterator I = RegionEnd;
       for(;I != MBB->begin(); --I, --RemainingInstrs) {
         if (TII->isSchedulingBoundary(llvm::prior(I), MBB, *MF))
           break;
+        if (NumRegionInstrs == MaxRegionSize && MaxRegionSize) {
+          ++NumSplitRegions;
+          break;
+        }
+        if (!llvm::prior(I)->isDebugValue())
+          ++NumRegionInstrs;
       }
       // Notify the scheduler of the region, even if we may skip scheduling
       // it. Perhaps it still needs to be bundled.
@@ -296,6 +326,7 @@ bool MachineScheduler::runOnMachineFunction(MachineFunction &mf) {
   DEBUG(LIS->print(dbgs()));
   if (VerifyScheduling)
     MF->verify(this, "After machine scheduling.");
+  AA->endCacheScope();
   return true;
 }
 
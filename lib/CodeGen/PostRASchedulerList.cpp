@@ -51,6 +51,7 @@ using namespace llvm;
 STATISTIC(NumNoops, "Number of noops inserted");
 STATISTIC(NumStalls, "Number of pipeline stalls");
 STATISTIC(NumFixedAnti, "Number of fixed anti-dependencies");
+STATISTIC(NumSplitRegions, "Number of scheduling regions split by size");
 
 // Post-RA scheduling is enabled with
 // TargetSubtargetInfo.enablePostRAScheduler(). This flag can be used to
@@ -308,14 +309,20 @@ bool PostRAScheduler::runOnMachineFunction(MachineFunction &Fn) {
 
     // Schedule each sequence of instructions not interrupted by a label
     // or anything else that effectively needs to shut down scheduling.
+    // Sequences longer than the maximum region size are split, leaving the
+    // instruction at the split in place.
+    unsigned MaxRegionSize = ScheduleDAGInstrs::getMaxRegionSize();
     MachineBasicBlock::iterator Current = MBB->end();
     unsigned Count = MBB->size(), CurrentCount = Count;
     for (MachineBasicBlock::iterator I = Current; I != MBB->begin(); ) {
       MachineInstr *MI = llvm::prior(I);
+      bool Split = MaxRegionSize && CurrentCount - Count >= MaxRegionSize;
+      if (Split)
+        ++NumSplitRegions;
       // Calls are not scheduling boundaries before register allocation, but
       // post-ra we don't gain anything by scheduling across calls since we
       // don't need to worry about register pressure.
-      if (MI->isCall() || TII->isSchedulingBoundary(MI, MBB, Fn)) {
+      if (Split || MI->isCall() || TII->isSchedulingBoundary(MI, MBB, Fn)) {
         Scheduler.enterRegion(MBB, I, Current, CurrentCount);
         Scheduler.schedule();
         Scheduler.exitRegion();
@@ -17,6 +17,7 @@
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallSet.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/CodeGen/LiveIntervalAnalysis.h"
@@ -42,6 +43,24 @@ static cl::opt<bool> EnableAASchedMI("enable-aa-sched-mi", cl::Hidden,
     cl::ZeroOrMore, cl::init(false),
     cl::desc("Enable use of AA during MI GAD construction"));
 
+static cl::opt<unsigned> MaxRegionSize("sched-max-region-size", cl::Hidden,
+    cl::init(4096),
+    cl::desc("Split scheduling regions larger than this many instructions "
+             "(0 = no limit)"));
+
+static cl::opt<unsigned> MemDepBudget("sched-mem-dep-budget", cl::Hidden,
+    cl::init(1024),
+    cl::desc("Number of memory operations to track while building the "
+             "scheduling graph before chaining them all together "
+             "(0 = no limit)"));
+
+STATISTIC(NumTruncatedRegions,
+          "Number of scheduling regions with truncated memory dependencies");
+
+unsigned ScheduleDAGInstrs::getMaxRegionSize() {
+  return MaxRegionSize;
+}
+
 ScheduleDAGInstrs::ScheduleDAGInstrs(MachineFunction &mf,
                                      const MachineLoopInfo &mli,
                                      const MachineDominatorTree &mdt,
@@ -707,6 +726,14 @@ void ScheduleDAGInstrs::buildSchedGraph(AliasAnalysis *AA,
   MapVector<const Value *, std::vector<SUnit *> > AliasMemUses, NonAliasMemUses;
   std::set<SUnit*> RejectMemNodes;
 
+  // The number of memory operations recorded in the maps and lists above,
+  // counted separately for the ones a new alias chain clears.  Once their
+  // sum reaches MemDepBudget, the next memory operation is treated as a
+  // barrier, so that the cost of adding chain dependencies stays bounded in
+  // huge regions.
+  unsigned NumAliasMemNodes = 0, NumNonAliasMemNodes = 0;
+  bool Truncated = false;
+
   // Remove any stale debug info; sometimes BuildSchedGraph is called again
   // without emitting the info from the previous call.
   DbgValues.clear();
@@ -795,7 +822,16 @@ void ScheduleDAGInstrs::buildSchedGraph(AliasAnalysis *AA,
     // TODO: Use an AliasAnalysis and do real alias-analysis queries, and
     // produce more precise dependence information.
     unsigned TrueMemOrderLatency = MI->mayStore() ? 1 : 0;
-    if (isGlobalMemoryObject(AA, MI)) {
+    bool OverBudget = MemDepBudget &&
+                      NumAliasMemNodes + NumNonAliasMemNodes >= MemDepBudget &&
+                      (MI->mayStore() || MI->mayLoad());
+    if (OverBudget && !Truncated) {
+      DEBUG(dbgs() << "Truncating memory dependencies at SU(" << SU->NodeNum
+            << ")\n");
+      Truncated = true;
+      ++NumTruncatedRegions;
+    }
+    if (OverBudget || isGlobalMemoryObject(AA, MI)) {
       // Be conservative with these and add dependencies on all memory
       // references, even those that are known to not alias.
       for (MapVector<const Value *, SUnit *>::iterator I =
@@ -821,6 +857,7 @@ void ScheduleDAGInstrs::buildSchedGraph(AliasAnalysis *AA,
       RejectMemNodes.clear();
       NonAliasMemDefs.clear();
       NonAliasMemUses.clear();
+      NumNonAliasMemNodes = 0;
 
       // fall-through
     new_alias_chain:
@@ -850,6 +887,7 @@ void ScheduleDAGInstrs::buildSchedGraph(AliasAnalysis *AA,
       PendingLoads.clear();
       AliasMemDefs.clear();
       AliasMemUses.clear();
+      NumAliasMemNodes = 0;
     } else if (MI->mayStore()) {
       SmallVector<std::pair<const Value *, bool>, 4> Objs;
       getUnderlyingObjectsForInstr(MI, MFI, Objs);
@@ -878,10 +916,13 @@ void ScheduleDAGInstrs::buildSchedGraph(AliasAnalysis *AA,
           addChainDependency(AA, MFI, SU, I->second, RejectMemNodes, 0, true);
           I->second = SU;
         } else {
-          if (ThisMayAlias)
+          if (ThisMayAlias) {
             AliasMemDefs[V] = SU;
-          else
+            ++NumAliasMemNodes;
+          } else {
             NonAliasMemDefs[V] = SU;
+            ++NumNonAliasMemNodes;
+          }
         }
         // Handle the uses in MemUses, if there are any.
         MapVector<const Value *, std::vector<SUnit *> >::iterator J =
@@ -936,6 +977,7 @@ void ScheduleDAGInstrs::buildSchedGraph(AliasAnalysis *AA,
             addChainDependency(AA, MFI, SU, I->second, RejectMemNodes);
 
           PendingLoads.push_back(SU);
+          ++NumAliasMemNodes;
           MayAlias = true;
         } else {
           MayAlias = false;
@@ -956,10 +998,13 @@ void ScheduleDAGInstrs::buildSchedGraph(AliasAnalysis *AA,
             ((ThisMayAlias) ? AliasMemDefs.end() : NonAliasMemDefs.end());
           if (I != IE)
             addChainDependency(AA, MFI, SU, I->second, RejectMemNodes, 0, true);
-          if (ThisMayAlias)
+          if (ThisMayAlias) {
             AliasMemUses[V].push_back(SU);
-          else
+            ++NumAliasMemNodes;
+          } else {
             NonAliasMemUses[V].push_back(SU);
+            ++NumNonAliasMemNodes;
+          }
         }
         if (MayAlias)
           adjustChainDeps(AA, MFI, SU, &ExitSU, RejectMemNodes, /*Latency=*/0);
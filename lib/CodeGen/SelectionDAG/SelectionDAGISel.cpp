@@ -44,6 +44,7 @@
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetInstrInfo.h"
@@ -56,6 +57,7 @@
 #include "llvm/Target/TargetSubtargetInfo.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
 #include <algorithm>
+#include <map>
 using namespace llvm;
 
 STATISTIC(NumFastIselFailures, "Number of instructions fast isel failed on");
@@ -150,12 +152,21 @@ static cl::opt<bool>
 EnableFastISelAbortArgs("fast-isel-abort-args", cl::Hidden,
           cl::desc("Enable abort calls when \"fast\" instruction selection "
                    "fails to lower a formal argument"));
+static cl::opt<bool>
+EnableFastISelReport("fast-isel-report", cl::Hidden,
+          cl::desc("Report the instructions the \"fast\" instruction "
+                   "selector leaves to SelectionDAG, by opcode and type"));
 
 static cl::opt<bool>
 UseMBPI("use-mbpi",
         cl::desc("use Machine Branch Probability Info"),
         cl::init(true), cl::Hidden);
 
+static cl::opt<bool>
+DisableDirectISel("disable-direct-isel", cl::Hidden,
+          cl::desc("Select with the matcher table interpreter even if the "
+                   "target was built with a direct matcher"));
+
 #ifndef NDEBUG
 static cl::opt<bool>
 ViewDAGCombine1("view-dag-combine1-dags", cl::Hidden,
@@ -279,7 +290,8 @@ SelectionDAGISel::SelectionDAGISel(const TargetMachine &tm,
   SDB(new SelectionDAGBuilder(*CurDAG, *FuncInfo, OL)),
   GFI(),
   OptLevel(OL),
-  DAGSize(0) {
+  DAGSize(0),
+  FallbackReport(0) {
     initializeGCModuleInfoPass(*PassRegistry::getPassRegistry());
     initializeAliasAnalysisAnalysisGroup(*PassRegistry::getPassRegistry());
     initializeBranchProbabilityInfoPass(*PassRegistry::getPassRegistry());
@@ -290,6 +302,7 @@ SelectionDAGISel::~SelectionDAGISel() {
   delete SDB;
   delete CurDAG;
   delete FuncInfo;
+  delete FallbackReport;
 }
 
 void SelectionDAGISel::getAnalysisUsage(AnalysisUsage &AU) const {
@@ -997,12 +1010,111 @@ static void collectFailStats(const Instruction *I) {
 }
 #endif
 
+namespace llvm {
+/// FastISelFallbackReport - Counts the instructions FastISel could not select
+/// by opcode and type, along with how many instructions each of them left to
+/// SelectionDAG, for one function at a time and for the whole module.
+class FastISelFallbackReport {
+  struct Entry {
+    unsigned Misses, Insts;
+    Entry() : Misses(0), Insts(0) {}
+  };
+  typedef std::map<std::pair<std::string, std::string>, Entry> EntryMap;
+  EntryMap FunctionEntries, ModuleEntries;
+
+  static void print(const EntryMap &Entries, raw_ostream &OS);
+
+public:
+  /// add - Record a miss on an instruction of the given opcode and type, which
+  /// left NumInsts instructions to SelectionDAG.
+  void add(StringRef Opcode, Type *Ty, unsigned NumInsts);
+  void add(const Instruction *I, unsigned NumInsts);
+
+  /// finishFunction - Print the misses of function F, if any, and add them to
+  /// the module totals.
+  void finishFunction(const Function &F, raw_ostream &OS);
+
+  /// finishModule - Print the misses of all the functions of module M.
+  void finishModule(const Module &M, raw_ostream &OS);
+};
+}
+
+void FastISelFallbackReport::add(StringRef Opcode, Type *Ty,
+                                 unsigned NumInsts) {
+  std::string TyStr;
+  raw_string_ostream TyOS(TyStr);
+  Ty->print(TyOS);
+  Entry &E = FunctionEntries[std::make_pair(Opcode.str(), TyOS.str())];
+  ++E.Misses;
+  E.Insts += NumInsts;
+}
+
+void FastISelFallbackReport::add(const Instruction *I, unsigned NumInsts) {
+  std::string Opcode = I->getOpcodeName();
+  Type *Ty = I->getType();
+  if (const CallInst *CI = dyn_cast<CallInst>(I)) {
+    // Calls are told apart by the type of the callee, and intrinsics and
+    // inline asm by name.
+    const Value *Callee = CI->getCalledValue();
+    Ty = cast<PointerType>(Callee->getType())->getElementType();
+    if (isa<InlineAsm>(Callee))
+      Opcode += " asm";
+    else if (const Function *F = CI->getCalledFunction())
+      if (Intrinsic::ID IID = (Intrinsic::ID)F->getIntrinsicID())
+        Opcode += " " + Intrinsic::getName(IID);
+  } else if (Ty->isVoidTy() && I->getNumOperands() != 0) {
+    // Stores, returns and branches are told apart by their first operand.
+    Ty = I->getOperand(0)->getType();
+  }
+  add(Opcode, Ty, NumInsts);
+}
+
+void FastISelFallbackReport::print(const EntryMap &Entries, raw_ostream &OS) {
+  OS << "    misses    insts  opcode                   type\n";
+  unsigned Misses = 0, Insts = 0;
+  for (EntryMap::const_iterator I = Entries.begin(), E = Entries.end();
+       I != E; ++I) {
+    OS << format("  %8u %8u  %-24s ", I->second.Misses, I->second.Insts,
+                 I->first.first.c_str())
+       << I->first.second << '\n';
+    Misses += I->second.Misses;
+    Insts += I->second.Insts;
+  }
+  OS << format("  %8u %8u  total\n", Misses, Insts);
+}
+
+void FastISelFallbackReport::finishFunction(const Function &F,
+                                            raw_ostream &OS) {
+  if (FunctionEntries.empty())
+    return;
+  OS << "FastISel fallbacks in function '" << F.getName() << "':\n";
+  print(FunctionEntries, OS);
+  for (EntryMap::const_iterator I = FunctionEntries.begin(),
+       E = FunctionEntries.end(); I != E; ++I) {
+    Entry &ME = ModuleEntries[I->first];
+    ME.Misses += I->second.Misses;
+    ME.Insts += I->second.Insts;
+  }
+  FunctionEntries.clear();
+}
+
+void FastISelFallbackReport::finishModule(const Module &M, raw_ostream &OS) {
+  if (ModuleEntries.empty())
+    return;
+  OS << "FastISel fallbacks in module '" << M.getModuleIdentifier() << "':\n";
+  print(ModuleEntries, OS);
+  ModuleEntries.clear();
+}
+
 void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
   // Initialize the Fast-ISel state, if needed.
   FastISel *FastIS = 0;
   if (TM.Options.EnableFastISel)
     FastIS = TLI.createFastISel(*FuncInfo, LibInfo);
 
+  if (FastIS && EnableFastISelReport && !FallbackReport)
+    FallbackReport = new FastISelFallbackReport();
+
   // Iterate over all basic blocks in the function.
   ReversePostOrderTraversal<const Function*> RPOT(&Fn);
   for (ReversePostOrderTraversal<const Function*>::rpo_iterator
@@ -1055,6 +1167,8 @@ void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
           // Fast isel failed to lower these arguments
           if (EnableFastISelAbortArgs)
             llvm_unreachable("FastISel didn't lower all arguments");
+          if (FallbackReport)
+            FallbackReport->add("arguments", Fn.getFunctionType(), 0);
 
           // Use SelectionDAG argument lowering
           LowerArguments(Fn);
@@ -1137,19 +1251,28 @@ void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
           // If the call was emitted as a tail call, we're done with the block.
           // We also need to delete any previously emitted instructions.
           if (HadTailCall) {
+            if (FallbackReport)
+              FallbackReport->add(Inst, NumFastIselRemaining);
             FastIS->removeDeadCode(SavedInsertPt, FuncInfo->MBB->end());
             --BI;
             break;
           }
 
           // Recompute NumFastIselRemaining as Selection DAG instruction
-          // selection may have handled the call, input args, etc.
-          unsigned RemainingNow = std::distance(Begin, BI);
+          // selection may have handled the call, input args, etc.  BI still
+          // points past the call, which is no longer remaining.
+          unsigned RemainingNow =
+            std::distance(Begin, BasicBlock::const_iterator(Inst));
           NumFastIselFailures += NumFastIselRemaining - RemainingNow;
+          if (FallbackReport)
+            FallbackReport->add(Inst, NumFastIselRemaining - RemainingNow);
           NumFastIselRemaining = RemainingNow;
           continue;
         }
 
+        if (FallbackReport)
+          FallbackReport->add(Inst, NumFastIselRemaining);
+
         if (isa<TerminatorInst>(Inst) && !isa<BranchInst>(Inst)) {
           // Don't abort, and use a different message for terminator misses.
           NumFastIselFailures += NumFastIselRemaining;
@@ -1197,6 +1320,18 @@ void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
 
   delete FastIS;
   SDB->clearDanglingDebugInfo();
+
+  if (FallbackReport)
+    FallbackReport->finishFunction(Fn, errs());
+}
+
+bool SelectionDAGISel::doFinalization(Module &M) {
+  if (FallbackReport) {
+    FallbackReport->finishModule(M, errs());
+    delete FallbackReport;
+    FallbackReport = 0;
+  }
+  return MachineFunctionPass::doFinalization(M);
 }
 
 void
@@ -2199,13 +2334,16 @@ struct MatchScope {
 
 }
 
-SDNode *SelectionDAGISel::
-SelectCodeCommon(SDNode *NodeToMatch, const unsigned char *MatcherTable,
-                 unsigned TableSize) {
+/// SelectWithoutPattern - Select the nodes that the patterns never see, such
+/// as the ones that remain the same.  Returns true and sets Result if N was
+/// one of them.
+bool SelectionDAGISel::SelectWithoutPattern(SDNode *NodeToMatch,
+                                            SDNode *&Result) {
+  Result = 0;
   // FIXME: Should these even be selected?  Handle these cases in the caller?
   switch (NodeToMatch->getOpcode()) {
   default:
-    break;
+    return false;
   case ISD::EntryToken:       // These nodes remain the same.
   case ISD::BasicBlock:
   case ISD::Register:
@@ -2230,47 +2368,30 @@ SelectCodeCommon(SDNode *NodeToMatch, const unsigned char *MatcherTable,
   case ISD::LIFETIME_START:
   case ISD::LIFETIME_END:
     NodeToMatch->setNodeId(-1); // Mark selected.
-    return 0;
+    return true;
   case ISD::AssertSext:
   case ISD::AssertZext:
     CurDAG->ReplaceAllUsesOfValueWith(SDValue(NodeToMatch, 0),
                                       NodeToMatch->getOperand(0));
-    return 0;
-  case ISD::INLINEASM: return Select_INLINEASM(NodeToMatch);
-  case ISD::UNDEF:     return Select_UNDEF(NodeToMatch);
+    return true;
+  case ISD::INLINEASM:
+    Result = Select_INLINEASM(NodeToMatch);
+    return true;
+  case ISD::UNDEF:
+    Result = Select_UNDEF(NodeToMatch);
+    return true;
   }
+}
 
-  assert(!NodeToMatch->isMachineOpcode() && "Node already selected!");
+SDNode *SelectionDAGISel::
+SelectCodeCommon(SDNode *NodeToMatch, const unsigned char *MatcherTable,
+                 unsigned TableSize) {
+  SDNode *Result;
+  if (SelectWithoutPattern(NodeToMatch, Result))
+    return Result;
 
-  // Set up the node stack with NodeToMatch as the only node on the stack.
-  SmallVector<SDValue, 8> NodeStack;
+  assert(!NodeToMatch->isMachineOpcode() && "Node already selected!");
   SDValue N = SDValue(NodeToMatch, 0);
-  NodeStack.push_back(N);
-
-  // MatchScopes - Scopes used when matching, if a match failure happens, this
-  // indicates where to continue checking.
-  SmallVector<MatchScope, 8> MatchScopes;
-
-  // RecordedNodes - This is the set of nodes that have been recorded by the
-  // state machine.  The second value is the parent of the node, or null if the
-  // root is recorded.
-  SmallVector<std::pair<SDValue, SDNode*>, 8> RecordedNodes;
-
-  // MatchedMemRefs - This is the set of MemRef's we've seen in the input
-  // pattern.
-  SmallVector<MachineMemOperand*, 2> MatchedMemRefs;
-
-  // These are the current input chain and glue for use when generating nodes.
-  // Various Emit operations change these.  For example, emitting a copytoreg
-  // uses and updates these.
-  SDValue InputChain, InputGlue;
-
-  // ChainNodesMatched - If a pattern matches nodes that have input/output
-  // chains, the OPC_EmitMergeInputChains operation is emitted which indicates
-  // which ones they are.  The result is captured into this list so that we can
-  // update the chain results when the pattern is complete.
-  SmallVector<SDNode*, 3> ChainNodesMatched;
-  SmallVector<SDNode*, 3> GlueResultNodesMatched;
 
   DEBUG(errs() << "ISEL: Starting pattern match on root node: ";
         NodeToMatch->dump(CurDAG);
@@ -2314,6 +2435,63 @@ SelectCodeCommon(SDNode *NodeToMatch, const unsigned char *MatcherTable,
       MatcherIndex = OpcodeOffset[N.getOpcode()];
   }
 
+  MatcherState State(NodeToMatch, MatcherTable, TableSize);
+  if (!RunMatcherTable(State, N, MatcherIndex, Result))
+    CannotYetSelect(NodeToMatch);
+  return Result;
+}
+
+SDNode *SelectionDAGISel::
+SelectCodeDirect(SDNode *NodeToMatch, const unsigned char *MatcherTable,
+                 unsigned TableSize) {
+  if (DisableDirectISel)
+    return SelectCodeCommon(NodeToMatch, MatcherTable, TableSize);
+
+  SDNode *Result;
+  if (SelectWithoutPattern(NodeToMatch, Result))
+    return Result;
+
+  assert(!NodeToMatch->isMachineOpcode() && "Node already selected!");
+
+  DEBUG(errs() << "ISEL: Starting direct match on root node: ";
+        NodeToMatch->dump(CurDAG);
+        errs() << '\n');
+
+  MatcherState State(NodeToMatch, MatcherTable, TableSize);
+  if (!MatchDirect(State, Result))
+    CannotYetSelect(NodeToMatch);
+  return Result;
+}
+
+bool SelectionDAGISel::
+RunMatcherTable(MatcherState &State, SDValue N, unsigned MatcherIndex,
+                SDNode *&Result) {
+  SDNode *NodeToMatch = State.NodeToMatch;
+  const unsigned char *MatcherTable = State.MatcherTable;
+  unsigned TableSize = State.TableSize; (void)TableSize;
+  SmallVectorImpl<std::pair<SDValue, SDNode*> > &RecordedNodes =
+    State.RecordedNodes;
+  SmallVectorImpl<MachineMemOperand*> &MatchedMemRefs = State.MatchedMemRefs;
+  SDValue &InputChain = State.InputChain, &InputGlue = State.InputGlue;
+  SmallVectorImpl<SDNode*> &ChainNodesMatched = State.ChainNodesMatched;
+  SmallVectorImpl<SDNode*> &GlueResultNodesMatched =
+    State.GlueResultNodesMatched;
+
+  // The state to restore if nothing matches.
+  unsigned EntryNumRecordedNodes = RecordedNodes.size();
+  unsigned EntryNumMatchedMemRefs = MatchedMemRefs.size();
+  SDValue EntryInputChain = InputChain, EntryInputGlue = InputGlue;
+  unsigned EntryNumChainNodes = ChainNodesMatched.size();
+  unsigned EntryNumGlueResultNodes = GlueResultNodesMatched.size();
+
+  // Set up the node stack with N as the only node on the stack.
+  SmallVector<SDValue, 8> NodeStack;
+  NodeStack.push_back(N);
+
+  // MatchScopes - Scopes used when matching, if a match failure happens, this
+  // indicates where to continue checking.
+  SmallVector<MatchScope, 8> MatchScopes;
+
   while (1) {
     assert(MatcherIndex < TableSize && "Invalid index");
 #ifndef NDEBUG
@@ -2799,7 +2977,8 @@ SelectCodeCommon(SDNode *NodeToMatch, const unsigned char *MatcherTable,
         // NodeToMatch was eliminated by CSE when the target changed the DAG.
         // We will visit the equivalent node later.
         DEBUG(dbgs() << "Node was eliminated by CSE\n");
-        return 0;
+        Result = 0;
+        return true;
       }
 
       // If the node had chain/glue results, update our notion of the current
@@ -2868,7 +3047,8 @@ SelectCodeCommon(SDNode *NodeToMatch, const unsigned char *MatcherTable,
         // Update chain and glue uses.
         UpdateChainsAndGlue(NodeToMatch, InputChain, ChainNodesMatched,
                             InputGlue, GlueResultNodesMatched, true);
-        return Res;
+        Result = Res;
+        return true;
       }
 
       continue;
@@ -2929,7 +3109,8 @@ SelectCodeCommon(SDNode *NodeToMatch, const unsigned char *MatcherTable,
 
       // FIXME: We just return here, which interacts correctly with SelectRoot
       // above.  We should fix this to not return an SDNode* anymore.
-      return 0;
+      Result = 0;
+      return true;
     }
     }
 
@@ -2940,8 +3121,13 @@ SelectCodeCommon(SDNode *NodeToMatch, const unsigned char *MatcherTable,
     ++NumDAGIselRetries;
     while (1) {
       if (MatchScopes.empty()) {
-        CannotYetSelect(NodeToMatch);
-        return 0;
+        RecordedNodes.resize(EntryNumRecordedNodes);
+        MatchedMemRefs.resize(EntryNumMatchedMemRefs);
+        InputChain = EntryInputChain;
+        InputGlue = EntryInputGlue;
+        ChainNodesMatched.resize(EntryNumChainNodes);
+        GlueResultNodesMatched.resize(EntryNumGlueResultNodes);
+        return false;
       }
 
       // Restore the interpreter state back to the point where the scope was
@@ -88,6 +88,8 @@ namespace {
       initializeStackProtectorPass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *createClone() const { return new StackProtector(TLI); }
+
     virtual void getAnalysisUsage(AnalysisUsage &AU) const {
       AU.addPreserved<DominatorTree>();
     }
@@ -48,6 +48,8 @@ namespace {
       initializeUnreachableBlockElimPass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *createClone() const { return new UnreachableBlockElim(); }
+
     virtual void getAnalysisUsage(AnalysisUsage &AU) const {
       AU.addPreserved<DominatorTree>();
       AU.addPreserved<ProfileInfo>();
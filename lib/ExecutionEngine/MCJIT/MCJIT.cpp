@@ -17,14 +17,24 @@
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
 #include "llvm/MC/MCAsmInfo.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/DynamicLibrary.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/Threading.h"
+#include <algorithm>
 
 using namespace llvm;
 
+static cl::opt<unsigned>
+AsyncCompileThreads("mcjit-async-compile-threads", cl::Hidden, cl::init(2),
+  cl::desc("Maximum number of threads MCJIT uses to compile modules "
+           "queued with compileModuleAsync"));
+
 namespace {
 
 static struct RegisterJIT {
@@ -51,95 +61,403 @@ ExecutionEngine *MCJIT::createJIT(Module *M,
 
 MCJIT::MCJIT(Module *m, TargetMachine *tm, RTDyldMemoryManager *MM,
              bool AllocateGVsWithCode)
-  : ExecutionEngine(m), TM(tm), Ctx(0), MemMgr(MM), Dyld(MM),
-    isCompiled(false), M(m)  {
+  : ExecutionEngine(m), TM(tm), Ctx(0), MemMgr(MM), LinkingMemMgr(this, MM),
+    Dyld(&LinkingMemMgr), ActiveWorkers(0) {
 
+  ModuleObjects[m] = 0;
+  UnindexedModules.push_back(m);
   setDataLayout(TM->getDataLayout());
 }
 
 MCJIT::~MCJIT() {
-  if (LoadedObject)
-    NotifyFreeingObject(*LoadedObject.get());
+  // Cancel the compile jobs no worker has picked up yet, wait for the others
+  // and for the workers themselves, which exit once the queue is empty.
+  {
+    MutexGuard queued(QueueLock);
+    for (unsigned i = 0, e = CompileQueue.size(); i != e; ++i) {
+      CompileJobs.erase(CompileQueue[i]->M);
+      delete CompileQueue[i];
+    }
+    CompileQueue.clear();
+  }
+  for (DenseMap<Module*, CompileJob*>::iterator I = CompileJobs.begin(),
+       E = CompileJobs.end(); I != E; ++I) {
+    CompileJob *Job = I->second;
+    Job->Busy.acquire();
+    Job->Busy.release();
+    delete Job->Buffer;
+    delete Job;
+  }
+  for (unsigned i = 0, e = CompileWorkers.size(); i != e; ++i) {
+    llvm_join_thread(CompileWorkers[i]->Thread);
+    delete CompileWorkers[i];
+  }
+
+  for (unsigned i = 0, e = Modules.size(); i != e; ++i) {
+    ObjectImage *Obj = ModuleObjects.lookup(Modules[i]);
+    if (!Obj)
+      continue;
+    NotifyFreeingObject(*Obj);
+    delete Obj;
+  }
   delete MemMgr;
   delete TM;
 }
 
-void MCJIT::emitObject(Module *m) {
-  /// Currently, MCJIT only supports a single module and the module passed to
-  /// this function call is expected to be the contained module.  The module
-  /// is passed as a parameter here to prepare for multiple module support in
-  /// the future.
-  assert(M == m);
-
-  // Get a thread lock to make sure we aren't trying to compile multiple times
+void MCJIT::addModule(Module *M) {
   MutexGuard locked(lock);
+  ExecutionEngine::addModule(M);
+  ModuleObjects[M] = 0;
+  UnindexedModules.push_back(M);
+}
 
-  // FIXME: Track compilation state on a per-module basis when multiple modules
-  //        are supported.
-  // Re-compilation is not supported
-  if (isCompiled)
-    return;
+bool MCJIT::removeModule(Module *M) {
+  MutexGuard locked(lock);
+  ModuleObjectMap::iterator I = ModuleObjects.find(M);
+  if (I == ModuleObjects.end())
+    return false;
+  delete takeCompileJobResult(M);
+  SmallVectorImpl<Module*>::iterator U =
+    std::find(UnindexedModules.begin(), UnindexedModules.end(), M);
+  if (U != UnindexedModules.end())
+    UnindexedModules.erase(U);
+  else if (!I->second)
+    unindexModule(M);
+  if (ObjectImage *Obj = I->second) {
+    NotifyFreeingObject(*Obj);
+    Dyld.unloadObject(Obj);
+    delete Obj;
+  }
+  ModuleObjects.erase(I);
+  return ExecutionEngine::removeModule(M);
+}
 
+ObjectBufferStream *MCJIT::emitObjectBuffer(Module &M, TargetMachine &TM,
+                                            MCContext *&Ctx) {
   PassManager PM;
 
-  PM.add(new DataLayout(*TM->getDataLayout()));
+  PM.add(new DataLayout(*TM.getDataLayout()));
 
   // The RuntimeDyld will take ownership of this shortly
   OwningPtr<ObjectBufferStream> Buffer(new ObjectBufferStream());
 
   // Turn the machine code intermediate representation into bytes in memory
   // that may be executed.
-  if (TM->addPassesToEmitMC(PM, Ctx, Buffer->getOStream(), false)) {
+  if (TM.addPassesToEmitMC(PM, Ctx, Buffer->getOStream(), false)) {
     report_fatal_error("Target does not support MC emission!");
   }
 
   // Initialize passes.
-  PM.run(*m);
+  PM.run(M);
   // Flush the output buffer to get the generated code into memory
   Buffer->flush();
 
+  return Buffer.take();
+}
+
+void MCJIT::emitObject(Module *M) {
+  // Get a thread lock to make sure we aren't trying to compile multiple times
+  MutexGuard locked(lock);
+
+  assert(ModuleObjects.count(M) && "Module is not owned by this MCJIT!");
+
+  // Re-compilation is not supported
+  if (ModuleObjects[M])
+    return;
+
+  // Use the object a worker generated if the module was queued with
+  // compileModuleAsync, unless no worker has got round to it yet.
+  ObjectBufferStream *Buffer = takeCompileJobResult(M);
+  if (!Buffer)
+    Buffer = emitObjectBuffer(*M, *TM, Ctx);
+
+  // From now on the dynamic linker knows the module's symbols.
+  SmallVectorImpl<Module*>::iterator U =
+    std::find(UnindexedModules.begin(), UnindexedModules.end(), M);
+  if (U != UnindexedModules.end())
+    UnindexedModules.erase(U);
+  else
+    unindexModule(M);
+
   // Load the object into the dynamic linker.
   // handing off ownership of the buffer
-  LoadedObject.reset(Dyld.loadObject(Buffer.take()));
+  ObjectImage *LoadedObject = Dyld.loadObject(Buffer);
   if (!LoadedObject)
     report_fatal_error(Dyld.getErrorString());
-
-  // Resolve any relocations.
-  Dyld.resolveRelocations();
+  ModuleObjects[M] = LoadedObject;
 
   // FIXME: Make this optional, maybe even move it to a JIT event listener
   LoadedObject->registerWithDebugger();
 
   NotifyObjectEmitted(*LoadedObject);
+}
+
+AsyncCompileHandle MCJIT::compileModuleAsync(Module *M) {
+  MutexGuard locked(lock);
 
-  // FIXME: Add support for per-module compilation state
-  isCompiled = true;
+  assert(ModuleObjects.count(M) && "Module is not owned by this MCJIT!");
+  if (ModuleObjects[M])
+    return AsyncCompileHandle(this, M);
+
+  // Workers may add declarations to the module, so its definitions have to
+  // be indexed before any of them gets to it.
+  SmallVectorImpl<Module*>::iterator U =
+    std::find(UnindexedModules.begin(), UnindexedModules.end(), M);
+  if (U != UnindexedModules.end()) {
+    indexModule(M);
+    UnindexedModules.erase(U);
+  }
+
+  MutexGuard queued(QueueLock);
+  if (CompileJobs.count(M))
+    return AsyncCompileHandle(this, M);
+
+  CompileJob *Job = new CompileJob(M);
+  CompileJobs[M] = Job;
+  CompileQueue.push_back(Job);
+
+  joinExitedCompileWorkers();
+  if (ActiveWorkers < AsyncCompileThreads) {
+    // The workers share the pass registry and other global state with this
+    // thread.
+    if (!llvm_is_multithreaded())
+      llvm_start_multithreaded();
+
+    // If no thread can be started the job just stays queued, and the module
+    // is compiled on the calling thread when it is first needed.
+    CompileWorker *W = new CompileWorker();
+    W->Engine = this;
+    W->Exited = false;
+    W->Thread = llvm_start_thread(runCompileWorker, W);
+    if (W->Thread) {
+      CompileWorkers.push_back(W);
+      ++ActiveWorkers;
+    } else {
+      delete W;
+    }
+  }
+  return AsyncCompileHandle(this, M);
 }
 
-// FIXME: Add a parameter to identify which object is being finalized when
-// MCJIT supports multiple modules.
-// FIXME: Provide a way to separate code emission, relocations and page 
-// protection in the interface.
-void MCJIT::finalizeObject() {
-  // If the module hasn't been compiled, just do that.
-  if (!isCompiled) {
-    // If the call to Dyld.resolveRelocations() is removed from emitObject()
-    // we'll need to do that here.
-    emitObject(M);
+bool MCJIT::isAsyncCompileDone(Module *M) {
+  MutexGuard queued(QueueLock);
+  DenseMap<Module*, CompileJob*>::iterator I = CompileJobs.find(M);
+  return I == CompileJobs.end() || I->second->State == CompileJob::Done;
+}
 
-    // Set page permissions.
-    MemMgr->applyPermissions();
+void MCJIT::waitForAsyncCompile(Module *M) {
+  MutexGuard locked(lock);
+
+  CompileJob *Job;
+  bool Claimed = false;
+  {
+    MutexGuard queued(QueueLock);
+    DenseMap<Module*, CompileJob*>::iterator I = CompileJobs.find(M);
+    if (I == CompileJobs.end())
+      return;
+    Job = I->second;
+    if (Job->State == CompileJob::Queued) {
+      // Don't wait for a worker to become free; do the job here.
+      CompileQueue.erase(std::find(CompileQueue.begin(), CompileQueue.end(),
+                                   Job));
+      Job->Busy.acquire();
+      Job->State = CompileJob::Running;
+      Claimed = true;
+    }
+  }
 
+  if (Claimed) {
+    runCompileJob(Job);
     return;
   }
+  Job->Busy.acquire();
+  Job->Busy.release();
+}
+
+ObjectBufferStream *MCJIT::takeCompileJobResult(Module *M) {
+  CompileJob *Job;
+  {
+    MutexGuard queued(QueueLock);
+    DenseMap<Module*, CompileJob*>::iterator I = CompileJobs.find(M);
+    if (I == CompileJobs.end())
+      return 0;
+    Job = I->second;
+    CompileJobs.erase(I);
+    if (Job->State == CompileJob::Queued) {
+      CompileQueue.erase(std::find(CompileQueue.begin(), CompileQueue.end(),
+                                   Job));
+      delete Job;
+      return 0;
+    }
+  }
+
+  // Wait for the worker to let go of the job.
+  Job->Busy.acquire();
+  Job->Busy.release();
+  ObjectBufferStream *Buffer = Job->Buffer;
+  delete Job;
+  return Buffer;
+}
+
+void MCJIT::runCompileWorker(void *Arg) {
+  CompileWorker *W = static_cast<CompileWorker*>(Arg);
+  W->Engine->compileQueuedModules(W);
+}
+
+void MCJIT::compileQueuedModules(CompileWorker *W) {
+  for (;;) {
+    CompileJob *Job;
+    {
+      MutexGuard queued(QueueLock);
+      if (CompileQueue.empty()) {
+        --ActiveWorkers;
+        W->Exited = true;
+        return;
+      }
+      Job = CompileQueue.front();
+      CompileQueue.pop_front();
+      Job->Busy.acquire();
+      Job->State = CompileJob::Running;
+    }
+    runCompileJob(Job);
+  }
+}
+
+void MCJIT::runCompileJob(CompileJob *Job) {
+  // The engine's TargetMachine belongs to the thread linking the code; give
+  // the job one of its own.
+  OwningPtr<TargetMachine> JobTM(
+    TM->getTarget().createTargetMachine(TM->getTargetTriple(),
+                                        TM->getTargetCPU(),
+                                        TM->getTargetFeatureString(),
+                                        TM->Options,
+                                        TM->getRelocationModel(),
+                                        TM->getCodeModel(),
+                                        TM->getOptLevel()));
+  MCContext *JobCtx = 0;
+  ObjectBufferStream *Buffer = emitObjectBuffer(*Job->M, *JobTM, JobCtx);
+
+  {
+    MutexGuard queued(QueueLock);
+    Job->Buffer = Buffer;
+    Job->State = CompileJob::Done;
+  }
+  Job->Busy.release();
+}
+
+void MCJIT::joinExitedCompileWorkers() {
+  // Called with QueueLock held. An exited worker has nothing left to do but
+  // return from its thread function.
+  unsigned Live = 0;
+  for (unsigned i = 0, e = CompileWorkers.size(); i != e; ++i) {
+    CompileWorker *W = CompileWorkers[i];
+    if (W->Exited) {
+      llvm_join_thread(W->Thread);
+      delete W;
+    } else {
+      CompileWorkers[Live++] = W;
+    }
+  }
+  CompileWorkers.resize(Live);
+}
+
+// FIXME: Provide a way to separate code emission, relocations and page 
+// protection in the interface.
+void MCJIT::finalizeObject() {
+  MutexGuard locked(lock);
+
+  // Generate code for the modules nobody has looked into yet. Modules still
+  // being compiled in the background are left for a later call.
+  for (unsigned i = 0, e = Modules.size(); i != e; ++i)
+    if (isAsyncCompileDone(Modules[i]))
+      emitObject(Modules[i]);
 
-  // Resolve any relocations.
-  Dyld.resolveRelocations();
+  // Resolve any relocations for the last time. Sections finalized by an
+  // earlier call are not written to again.
+  Dyld.finalizeRelocations();
 
   // Set page permissions.
   MemMgr->applyPermissions();
 }
 
+std::string MCJIT::getMangledName(StringRef Name) {
+  // FIXME: Should we be using the mangler for this? Probably.
+  if (!Name.empty() && Name[0] == '\1')
+    return Name.substr(1);
+  return (TM->getMCAsmInfo()->getGlobalPrefix() + Name).str();
+}
+
+/// collectExportedDefinitions - Append the globals that M defines and other
+/// modules can refer to.
+static void collectExportedDefinitions(Module *M,
+                                       SmallVectorImpl<GlobalValue*> &GVs) {
+  for (Module::iterator I = M->begin(), E = M->end(); I != E; ++I)
+    if (!I->isDeclaration() && !I->hasLocalLinkage())
+      GVs.push_back(I);
+  for (Module::global_iterator I = M->global_begin(), E = M->global_end();
+       I != E; ++I)
+    if (!I->isDeclaration() && !I->hasLocalLinkage())
+      GVs.push_back(I);
+  for (Module::alias_iterator I = M->alias_begin(), E = M->alias_end();
+       I != E; ++I)
+    if (!I->hasLocalLinkage())
+      GVs.push_back(I);
+}
+
+void MCJIT::indexModule(Module *M) {
+  SmallVector<GlobalValue*, 16> GVs;
+  collectExportedDefinitions(M, GVs);
+  // The first module to define a symbol keeps it.
+  for (unsigned i = 0, e = GVs.size(); i != e; ++i)
+    UnemittedSymbols.GetOrCreateValue(getMangledName(GVs[i]->getName()), M);
+}
+
+void MCJIT::unindexModule(Module *M) {
+  SmallVector<GlobalValue*, 16> GVs;
+  collectExportedDefinitions(M, GVs);
+  for (unsigned i = 0, e = GVs.size(); i != e; ++i) {
+    StringMap<Module*>::iterator I =
+      UnemittedSymbols.find(getMangledName(GVs[i]->getName()));
+    if (I != UnemittedSymbols.end() && I->second == M)
+      UnemittedSymbols.erase(I);
+  }
+}
+
+Module *MCJIT::findUnemittedModule(StringRef Name) {
+  // None of the unindexed modules has been queued, so no worker is looking
+  // into them.
+  for (unsigned i = 0, e = UnindexedModules.size(); i != e; ++i)
+    indexModule(UnindexedModules[i]);
+  UnindexedModules.clear();
+
+  return UnemittedSymbols.lookup(Name);
+}
+
+uint64_t MCJIT::getSymbolAddress(const std::string &Name) {
+  MutexGuard locked(lock);
+
+  // Symbols of modules we have already loaded.
+  if (uint64_t Addr = Dyld.getSymbolLoadAddress(Name))
+    return Addr;
+
+  // Otherwise, generate code for the module that defines it, if any. The
+  // caller takes care of resolving relocations.
+  if (Module *M = findUnemittedModule(Name)) {
+    emitObject(M);
+    return Dyld.getSymbolLoadAddress(Name);
+  }
+  return 0;
+}
+
+void *LinkingMemoryManager::getPointerToNamedFunction(const std::string &Name,
+                                                      bool AbortOnFailure) {
+  // Symbols defined by the engine's own modules come first.
+  if (uint64_t Addr = ParentEngine->getSymbolAddress(Name))
+    return (void*)Addr;
+
+  return ClientMM->getPointerToNamedFunction(Name, AbortOnFailure);
+}
+
 void *MCJIT::getPointerToBasicBlock(BasicBlock *BB) {
   report_fatal_error("not yet implemented");
 }
@@ -149,10 +467,7 @@ void *MCJIT::getPointerToFunction(Function *F) {
   // target address space, not our local address space. That's part of the
   // ExecutionEngine interface, though. Fix that when the old JIT finally
   // dies.
-
-  // FIXME: Add support for per-module compilation state
-  if (!isCompiled)
-    emitObject(M);
+  MutexGuard locked(lock);
 
   if (F->isDeclaration() || F->hasAvailableExternallyLinkage()) {
     bool AbortOnFailure = !F->hasExternalWeakLinkage();
@@ -161,16 +476,17 @@ void *MCJIT::getPointerToFunction(Function *F) {
     return Addr;
   }
 
-  // FIXME: Should the Dyld be retaining module information? Probably not.
-  // FIXME: Should we be using the mangler for this? Probably.
-  //
+  // Generate code for the module F lives in, and for whatever modules it
+  // refers to, on first use.
+  ModuleObjectMap::iterator I = ModuleObjects.find(F->getParent());
+  if (I != ModuleObjects.end() && !I->second) {
+    emitObject(F->getParent());
+    Dyld.resolveRelocations();
+  }
+
   // This is the accessor for the target address, so make sure to check the
   // load address of the symbol, not the local address.
-  StringRef BaseName = F->getName();
-  if (BaseName[0] == '\1')
-    return (void*)Dyld.getSymbolLoadAddress(BaseName.substr(1));
-  return (void*)Dyld.getSymbolLoadAddress((TM->getMCAsmInfo()->getGlobalPrefix()
-                                       + BaseName).str());
+  return (void*)Dyld.getSymbolLoadAddress(getMangledName(F->getName()));
 }
 
 void *MCJIT::recompileAndRelinkFunction(Function *F) {
@@ -283,9 +599,18 @@ GenericValue MCJIT::runFunction(Function *F,
 
 void *MCJIT::getPointerToNamedFunction(const std::string &Name,
                                        bool AbortOnFailure) {
-  // FIXME: Add support for per-module compilation state
-  if (!isCompiled)
+  MutexGuard locked(lock);
+
+  // A function defined by one of our modules may be referenced from another
+  // one through a declaration.
+  std::string MangledName = getMangledName(Name);
+  if (uint64_t Addr = Dyld.getSymbolLoadAddress(MangledName))
+    return (void*)Addr;
+  if (Module *M = findUnemittedModule(MangledName)) {
     emitObject(M);
+    Dyld.resolveRelocations();
+    return (void*)Dyld.getSymbolLoadAddress(MangledName);
+  }
 
   if (!isSymbolSearchingDisabled() && MemMgr) {
     void *ptr = MemMgr->getPointerToNamedFunction(Name, false);
@@ -10,18 +10,63 @@
 #ifndef LLVM_LIB_EXECUTIONENGINE_MCJIT_H
 #define LLVM_LIB_EXECUTIONENGINE_MCJIT_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/ExecutionEngine/RuntimeDyld.h"
 #include "llvm/PassManager.h"
+#include "llvm/Support/Mutex.h"
+#include <deque>
+#include <vector>
 
 namespace llvm {
 
+class MCJIT;
+class ObjectBufferStream;
 class ObjectImage;
 
+// This is a helper class that the MCJIT execution engine uses for linking
+// functions across modules that it owns.  It aggregates the memory manager
+// that is passed in to the MCJIT constructor and defers most functionality
+// to that object, but resolves external symbols through the engine first so
+// that a reference to a function in another module generates code for that
+// module on demand.
+class LinkingMemoryManager : public RTDyldMemoryManager {
+public:
+  LinkingMemoryManager(MCJIT *Parent, RTDyldMemoryManager *MM)
+    : ParentEngine(Parent), ClientMM(MM) {}
+
+  virtual void *getPointerToNamedFunction(const std::string &Name,
+                                          bool AbortOnFailure = true);
+
+  virtual uint8_t *allocateCodeSection(uintptr_t Size, unsigned Alignment,
+                                       unsigned SectionID) {
+    return ClientMM->allocateCodeSection(Size, Alignment, SectionID);
+  }
+
+  virtual uint8_t *allocateDataSection(uintptr_t Size, unsigned Alignment,
+                                       unsigned SectionID, bool IsReadOnly) {
+    return ClientMM->allocateDataSection(Size, Alignment,
+                                         SectionID, IsReadOnly);
+  }
+
+  virtual bool applyPermissions(std::string *ErrMsg = 0) {
+    return ClientMM->applyPermissions(ErrMsg);
+  }
+
+  virtual void deallocateSection(uint8_t *Addr, unsigned SectionID) {
+    ClientMM->deallocateSection(Addr, SectionID);
+  }
+
+private:
+  MCJIT *ParentEngine;
+  RTDyldMemoryManager *ClientMM;
+};
+
 // FIXME: This makes all kinds of horrible assumptions for the time being,
-// like only having one module, not needing to worry about multi-threading,
-// blah blah. Purely in get-it-up-and-limping mode for now.
+// like not needing to worry about multi-threading, blah blah. Purely in
+// get-it-up-and-limping mode for now.
 
 class MCJIT : public ExecutionEngine {
   MCJIT(Module *M, TargetMachine *tm, RTDyldMemoryManager *MemMgr,
@@ -30,13 +75,58 @@ class MCJIT : public ExecutionEngine {
   TargetMachine *TM;
   MCContext *Ctx;
   RTDyldMemoryManager *MemMgr;
+  LinkingMemoryManager LinkingMemMgr;
   RuntimeDyld Dyld;
   SmallVector<JITEventListener*, 2> EventListeners;
 
-  // FIXME: Add support for multiple modules
-  bool isCompiled;
-  Module *M;
-  OwningPtr<ObjectImage> LoadedObject;
+  // The loaded object for each module we own. A module is code generated the
+  // first time one of its symbols is looked up, so the object is null until
+  // then. Objects stay loaded until their module is removed.
+  typedef DenseMap<Module*, ObjectImage*> ModuleObjectMap;
+  ModuleObjectMap ModuleObjects;
+
+  // The module that defines each exported symbol, by mangled name, among the
+  // modules that have not been loaded yet. A module is indexed when it is
+  // queued for background compilation, or else when a symbol is first looked
+  // up after it was added, so clients can fill it in after addModule. Its
+  // entries are dropped once it is loaded or removed.
+  StringMap<Module*> UnemittedSymbols;
+  SmallVector<Module*, 2> UnindexedModules;
+
+  // Background code generation of a module queued by compileModuleAsync.
+  // Workers only produce the object; it is loaded into the dynamic linker
+  // by whichever thread first needs the module.
+  struct CompileJob {
+    enum JobState { Queued, Running, Done };
+
+    explicit CompileJob(Module *M) : M(M), State(Queued), Buffer(0) {}
+
+    Module *M;
+    JobState State;
+    // Held by the worker compiling the module, so waiters can block on it.
+    sys::Mutex Busy;
+    ObjectBufferStream *Buffer;
+  };
+
+  struct CompileWorker {
+    MCJIT *Engine;
+    void *Thread;
+    bool Exited;
+  };
+
+  // Protects everything below. Workers never take the engine lock, so it is
+  // fine to wait for them while holding it.
+  sys::Mutex QueueLock;
+  DenseMap<Module*, CompileJob*> CompileJobs;
+  std::deque<CompileJob*> CompileQueue;
+  std::vector<CompileWorker*> CompileWorkers;
+  unsigned ActiveWorkers;
+
+  static void runCompileWorker(void *Arg);
+  void compileQueuedModules(CompileWorker *W);
+  void runCompileJob(CompileJob *Job);
+  ObjectBufferStream *takeCompileJobResult(Module *M);
+  void joinExitedCompileWorkers();
 
 public:
   ~MCJIT();
@@ -44,8 +134,27 @@ public:
   /// @name ExecutionEngine interface implementation
   /// @{
 
+  virtual void addModule(Module *M);
+
+  /// removeModule - Remove M from the engine and unload the code generated
+  /// for it, releasing its sections back to the memory manager.  Code in other
+  /// modules must no longer refer to M's symbols.
+  virtual bool removeModule(Module *M);
+
+  /// finalizeObject - Generate code for every module that has not been looked
+  /// up yet, resolve the relocations of everything loaded since the previous
+  /// call and apply page permissions.  Objects that were already finalized are
+  /// not touched again.
   virtual void finalizeObject();
 
+  /// compileModuleAsync - Queue M for code generation by a pool of worker
+  /// threads, each using a TargetMachine of its own. The object is linked and
+  /// finalized on the calling thread by the usual entry points; finalizeObject
+  /// leaves modules that are still being compiled alone.
+  virtual AsyncCompileHandle compileModuleAsync(Module *M);
+  virtual bool isAsyncCompileDone(Module *M);
+  virtual void waitForAsyncCompile(Module *M);
+
   virtual void *getPointerToBasicBlock(BasicBlock *BB);
 
   virtual void *getPointerToFunction(Function *F);
@@ -80,6 +189,15 @@ public:
   virtual void RegisterJITEventListener(JITEventListener *L);
   virtual void UnregisterJITEventListener(JITEventListener *L);
 
+  /// @}
+  /// @name Cross-module linking
+  /// @{
+
+  /// getSymbolAddress - Return the target address of the mangled symbol Name
+  /// if one of our modules defines it, generating code for that module if
+  /// needed. Returns 0 for symbols that are not defined by the JIT.
+  uint64_t getSymbolAddress(const std::string &Name);
+
   /// @}
   /// @name (Private) Registration Interfaces
   /// @{
@@ -98,12 +216,26 @@ public:
 
 protected:
   /// emitObject -- Generate a JITed object in memory from the specified module
-  /// Currently, MCJIT only supports a single module and the module passed to
-  /// this function call is expected to be the contained module.  The module
-  /// is passed as a parameter here to prepare for multiple module support in 
-  /// the future.
+  /// and load it into the dynamic linker, unless that has already been done.
+  /// Relocations are not resolved here: doing so can generate code for other
+  /// modules, so callers resolve them once the objects they need are loaded.
   void emitObject(Module *M);
 
+  /// emitObjectBuffer -- Generate an object for M in memory using TM.
+  static ObjectBufferStream *emitObjectBuffer(Module &M, TargetMachine &TM,
+                                              MCContext *&Ctx);
+
+  /// findUnemittedModule -- Return the module that defines the mangled symbol
+  /// Name but has not been loaded yet, or null if there is none.
+  Module *findUnemittedModule(StringRef Name);
+
+  /// indexModule / unindexModule -- Add the exported definitions of M to
+  /// UnemittedSymbols, or remove them.
+  void indexModule(Module *M);
+  void unindexModule(Module *M);
+
+  std::string getMangledName(StringRef Name);
+
   void NotifyObjectEmitted(const ObjectImage& Obj);
   void NotifyFreeingObject(const ObjectImage& Obj);
 };
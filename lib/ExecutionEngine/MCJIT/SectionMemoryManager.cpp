@@ -67,6 +67,14 @@ uint8_t *SectionMemoryManager::allocateSection(MemoryGroup &MemGroup,
       // Store cutted free memory block.
       MemGroup.FreeMem[i] = sys::MemoryBlock((void*)(Addr + Size),
                                              EndOfBlock - Addr - Size);
+      // Account for the section in the block it was carved out of.
+      for (unsigned j = 0, je = MemGroup.AllocatedMem.size(); j != je; ++j) {
+        uintptr_t Base = (uintptr_t)MemGroup.AllocatedMem[j].base();
+        if (Addr >= Base && Addr < Base + MemGroup.AllocatedMem[j].size()) {
+          ++MemGroup.SectionCount[j];
+          break;
+        }
+      }
       return (uint8_t*)Addr;
     }
   }
@@ -95,6 +103,7 @@ uint8_t *SectionMemoryManager::allocateSection(MemoryGroup &MemGroup,
   MemGroup.Near = MB;
 
   MemGroup.AllocatedMem.push_back(MB);
+  MemGroup.SectionCount.push_back(1);
   Addr = (uintptr_t)MB.base();
   uintptr_t EndOfBlock = Addr + MB.size();
 
@@ -138,6 +147,51 @@ bool SectionMemoryManager::applyPermissions(std::string *ErrMsg)
 
   // Read-write data memory already has the correct permissions
 
+  // Don't allow free memory blocks to be used after setting protection flags.
+  // Sections of objects loaded later go into freshly mapped blocks.
+  CodeMem.FreeMem.clear();
+  RODataMem.FreeMem.clear();
+
+  return false;
+}
+
+void SectionMemoryManager::deallocateSection(uint8_t *Addr,
+                                             unsigned SectionID) {
+  if (deallocateSection(CodeMem, Addr) ||
+      deallocateSection(RWDataMem, Addr) ||
+      deallocateSection(RODataMem, Addr))
+    return;
+  llvm_unreachable("Attempting to release an unknown section!");
+}
+
+bool SectionMemoryManager::deallocateSection(MemoryGroup &MemGroup,
+                                             uint8_t *Addr) {
+  for (unsigned i = 0, e = MemGroup.AllocatedMem.size(); i != e; ++i) {
+    sys::MemoryBlock MB = MemGroup.AllocatedMem[i];
+    uint8_t *Base = (uint8_t*)MB.base();
+    if (Addr < Base || Addr >= Base + MB.size())
+      continue;
+
+    assert(MemGroup.SectionCount[i] && "Section released twice!");
+    if (--MemGroup.SectionCount[i] != 0)
+      return true;
+
+    // That was the last section in the block; unmap it, along with any free
+    // space that was left in it.
+    for (unsigned j = 0; j != MemGroup.FreeMem.size(); ) {
+      uint8_t *FreeBase = (uint8_t*)MemGroup.FreeMem[j].base();
+      if (FreeBase >= Base && FreeBase < Base + MB.size())
+        MemGroup.FreeMem.erase(MemGroup.FreeMem.begin() + j);
+      else
+        ++j;
+    }
+    if (MemGroup.Near.base() == MB.base())
+      MemGroup.Near = sys::MemoryBlock();
+    MemGroup.AllocatedMem.erase(MemGroup.AllocatedMem.begin() + i);
+    MemGroup.SectionCount.erase(MemGroup.SectionCount.begin() + i);
+    sys::Memory::releaseMappedMemory(MB);
+    return true;
+  }
   return false;
 }
 
@@ -17,6 +17,7 @@
 #include "RuntimeDyldELF.h"
 #include "RuntimeDyldImpl.h"
 #include "RuntimeDyldMachO.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/Path.h"
 
@@ -34,17 +35,27 @@ void RuntimeDyldImpl::resolveRelocations() {
   // First, resolve relocations associated with external symbols.
   resolveExternalSymbols();
 
-  // Just iterate over the sections we have and resolve all the relocations
-  // in them. Gross overkill, but it gets the job done.
-  for (int i = 0, e = Sections.size(); i != e; ++i) {
-    uint64_t Addr = Sections[i].LoadAddress;
-    DEBUG(dbgs() << "Resolving relocations Section #" << i
+  // Iterate over the sections that have relocations sourced from them and
+  // resolve all of those. Sections whose relocations were finalized are not
+  // in the map any more, so this only touches objects loaded since.
+  for (DenseMap<unsigned, RelocationList>::iterator i = Relocations.begin(),
+       e = Relocations.end(); i != e; ++i) {
+    uint64_t Addr = Sections[i->first].LoadAddress;
+    DEBUG(dbgs() << "Resolving relocations Section #" << i->first
             << "\t" << format("%p", (uint8_t *)Addr)
             << "\n");
-    resolveRelocationList(Relocations[i], Addr);
+    resolveRelocationList(i->second, Addr);
   }
 }
 
+// Resolve the relocations for all symbols we currently know about and then
+// forget them, so that finalized sections are never written to again.
+void RuntimeDyldImpl::finalizeRelocations() {
+  resolveRelocations();
+  Relocations.clear();
+  ExternalSymbolRelocations.clear();
+}
+
 void RuntimeDyldImpl::mapSectionAddress(const void *LocalAddress,
                                         uint64_t TargetAddress) {
   for (unsigned i = 0, e = Sections.size(); i != e; ++i) {
@@ -69,6 +80,9 @@ ObjectImage *RuntimeDyldImpl::loadObject(ObjectBuffer *InputBuffer) {
 
   Arch = (Triple::ArchType)obj->getArch();
 
+  // Every section emitted from here on belongs to this object.
+  unsigned FirstSectionID = Sections.size();
+
   // Symbols found in this object
   StringMap<SymbolLoc> LocalSymbols;
   // Used sections from the object file
@@ -169,9 +183,63 @@ ObjectImage *RuntimeDyldImpl::loadObject(ObjectBuffer *InputBuffer) {
     }
   }
 
+  ObjectSections[obj.get()] = SectionIDRange(FirstSectionID, Sections.size());
   return obj.take();
 }
 
+void RuntimeDyldImpl::unloadObject(ObjectImage *Obj) {
+  DenseMap<const ObjectImage*, SectionIDRange>::iterator I =
+    ObjectSections.find(Obj);
+  if (I == ObjectSections.end())
+    return;
+  unsigned First = I->second.first, Last = I->second.second;
+  ObjectSections.erase(I);
+
+  // Forget the symbols the object defined.
+  for (SymbolTableMap::iterator i = GlobalSymbolTable.begin(),
+       e = GlobalSymbolTable.end(); i != e; ) {
+    SymbolTableMap::iterator Cur = i;
+    ++i;
+    if (Cur->second.first >= First && Cur->second.first < Last)
+      GlobalSymbolTable.erase(Cur);
+  }
+
+  // Drop the pending relocations sourced from the object's sections, and
+  // those that would patch them.
+  for (unsigned SectionID = First; SectionID != Last; ++SectionID)
+    Relocations.erase(SectionID);
+  for (DenseMap<unsigned, RelocationList>::iterator i = Relocations.begin(),
+       e = Relocations.end(); i != e; ++i)
+    removeRelocationsInto(i->second, First, Last);
+  for (StringMap<RelocationList>::iterator
+       i = ExternalSymbolRelocations.begin(),
+       e = ExternalSymbolRelocations.end(); i != e; ++i)
+    removeRelocationsInto(i->second, First, Last);
+
+  // Hand the section memory back to the memory manager. The entries stay in
+  // Sections so that the SectionIDs of other objects remain valid.
+  for (unsigned SectionID = First; SectionID != Last; ++SectionID) {
+    SectionEntry &Section = Sections[SectionID];
+    DEBUG(dbgs() << "unloadSection SectionID: " << SectionID
+                 << " addr: " << format("%p", Section.Address)
+                 << "\n");
+    if (Section.Address)
+      MemMgr->deallocateSection(Section.Address, SectionID);
+    Section.Address = 0;
+    Section.Size = 0;
+    Section.LoadAddress = 0;
+  }
+}
+
+void RuntimeDyldImpl::removeRelocationsInto(RelocationList &Relocs,
+                                            unsigned First, unsigned Last) {
+  unsigned Kept = 0;
+  for (unsigned i = 0, e = Relocs.size(); i != e; ++i)
+    if (Relocs[i].SectionID < First || Relocs[i].SectionID >= Last)
+      Relocs[Kept++] = Relocs[i];
+  Relocs.erase(Relocs.begin() + Kept, Relocs.end());
+}
+
 void RuntimeDyldImpl::emitCommonSymbols(ObjectImage &Obj,
                                         const CommonSymbolMap &CommonSymbols,
                                         uint64_t TotalSize,
@@ -425,29 +493,44 @@ void RuntimeDyldImpl::resolveRelocationList(const RelocationList &Relocs,
 }
 
 void RuntimeDyldImpl::resolveExternalSymbols() {
-  StringMap<RelocationList>::iterator i = ExternalSymbolRelocations.begin(),
-                                      e = ExternalSymbolRelocations.end();
-  for (; i != e; i++) {
-    StringRef Name = i->first();
-    RelocationList &Relocs = i->second;
-    SymbolTableMap::const_iterator Loc = GlobalSymbolTable.find(Name);
-    if (Loc == GlobalSymbolTable.end()) {
-      if (Name.size() == 0) {
+  // Asking the memory manager for a symbol may load further objects (MCJIT
+  // generates code for its modules on demand), which adds entries to
+  // ExternalSymbolRelocations and invalidates iterators into it. Work from a
+  // snapshot of the names and take another one until nothing new shows up.
+  StringSet<> Resolved;
+  for (;;) {
+    SmallVector<std::string, 16> Names;
+    for (StringMap<RelocationList>::iterator
+         i = ExternalSymbolRelocations.begin(),
+         e = ExternalSymbolRelocations.end(); i != e; ++i)
+      if (!Resolved.count(i->first()))
+        Names.push_back(i->first());
+    if (Names.empty())
+      break;
+
+    for (unsigned i = 0, e = Names.size(); i != e; ++i) {
+      const std::string &Name = Names[i];
+      Resolved.insert(Name);
+      uint64_t Addr = 0;
+      if (Name.empty()) {
         // This is an absolute symbol, use an address of zero.
         DEBUG(dbgs() << "Resolving absolute relocations." << "\n");
-        resolveRelocationList(Relocs, 0);
       } else {
-        // This is an external symbol, try to get its address from
-        // MemoryManager.
-        uint8_t *Addr = (uint8_t*) MemMgr->getPointerToNamedFunction(Name.data(),
-                                                                   true);
+        SymbolTableMap::const_iterator Loc = GlobalSymbolTable.find(Name);
+        if (Loc != GlobalSymbolTable.end()) {
+          // The symbol is defined by an object that was loaded after the
+          // relocation was recorded.
+          Addr = getSectionLoadAddress(Loc->second.first) + Loc->second.second;
+        } else {
+          // This is an external symbol, try to get its address from
+          // MemoryManager.
+          Addr = (uintptr_t)MemMgr->getPointerToNamedFunction(Name, true);
+        }
         DEBUG(dbgs() << "Resolving relocations Name: " << Name
-                << "\t" << format("%p", Addr)
+                << "\t" << format("%p", (uint8_t *)Addr)
                 << "\n");
-        resolveRelocationList(Relocs, (uintptr_t)Addr);
       }
-    } else {
-      report_fatal_error("Expected external symbol");
+      resolveRelocationList(ExternalSymbolRelocations[Name], Addr);
     }
   }
 }
@@ -509,15 +592,30 @@ ObjectImage *RuntimeDyld::loadObject(ObjectBuffer *InputBuffer) {
 }
 
 void *RuntimeDyld::getSymbolAddress(StringRef Name) {
+  if (!Dyld)
+    return 0;
   return Dyld->getSymbolAddress(Name);
 }
 
+void RuntimeDyld::unloadObject(ObjectImage *Obj) {
+  if (Dyld)
+    Dyld->unloadObject(Obj);
+}
+
 uint64_t RuntimeDyld::getSymbolLoadAddress(StringRef Name) {
+  if (!Dyld)
+    return 0;
   return Dyld->getSymbolLoadAddress(Name);
 }
 
 void RuntimeDyld::resolveRelocations() {
-  Dyld->resolveRelocations();
+  if (Dyld)
+    Dyld->resolveRelocations();
+}
+
+void RuntimeDyld::finalizeRelocations() {
+  if (Dyld)
+    Dyld->finalizeRelocations();
 }
 
 void RuntimeDyld::reassignSectionAddress(unsigned SectionID,
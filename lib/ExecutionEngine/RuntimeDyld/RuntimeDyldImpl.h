@@ -161,6 +161,11 @@ protected:
   // modules.  This map is indexed by symbol name.
   StringMap<RelocationList> ExternalSymbolRelocations;
 
+  // The SectionIDs emitted while loading each object.  Loading an object only
+  // ever appends to Sections, so this is a half-open [first, last) range.
+  typedef std::pair<unsigned, unsigned> SectionIDRange;
+  DenseMap<const ObjectImage*, SectionIDRange> ObjectSections;
+
   typedef std::map<RelocationValueRef, uintptr_t> StubMap;
 
   Triple::ArchType Arch;
@@ -294,6 +299,10 @@ protected:
 
   /// \brief Resolve relocations to external symbols.
   void resolveExternalSymbols();
+
+  /// \brief Drop the relocations that patch sections in [First, Last).
+  void removeRelocationsInto(RelocationList &Relocs, unsigned First,
+                             unsigned Last);
   virtual ObjectImage *createObjectImage(ObjectBuffer *InputBuffer);
 public:
   RuntimeDyldImpl(RTDyldMemoryManager *mm) : MemMgr(mm), HasError(false) {}
@@ -302,6 +311,8 @@ public:
 
   ObjectImage *loadObject(ObjectBuffer *InputBuffer);
 
+  void unloadObject(ObjectImage *Obj);
+
   void *getSymbolAddress(StringRef Name) {
     // FIXME: Just look up as a function for now. Overly simple of course.
     // Work in progress.
@@ -322,6 +333,8 @@ public:
 
   void resolveRelocations();
 
+  void finalizeRelocations();
+
   void reassignSectionAddress(unsigned SectionID, uint64_t Addr);
 
   void mapSectionAddress(const void *LocalAddress, uint64_t TargetAddress);
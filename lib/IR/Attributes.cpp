@@ -38,6 +38,7 @@ Attribute Attribute::get(LLVMContext &Context, Attribute::AttrKind Kind,
   if (Val) ID.AddInteger(Val);
 
   void *InsertPoint;
+  ContextLock Lock(pImpl, pImpl->AttrsLock);
   AttributeImpl *PA = pImpl->AttrsSet.FindNodeOrInsertPos(ID, InsertPoint);
 
   if (!PA) {
@@ -60,6 +61,7 @@ Attribute Attribute::get(LLVMContext &Context, StringRef Kind, StringRef Val) {
   if (!Val.empty()) ID.AddString(Val);
 
   void *InsertPoint;
+  ContextLock Lock(pImpl, pImpl->AttrsLock);
   AttributeImpl *PA = pImpl->AttrsSet.FindNodeOrInsertPos(ID, InsertPoint);
 
   if (!PA) {
@@ -421,6 +423,7 @@ AttributeSetNode *AttributeSetNode::get(LLVMContext &C,
     I->Profile(ID);
 
   void *InsertPoint;
+  ContextLock Lock(pImpl, pImpl->AttrsLock);
   AttributeSetNode *PA =
     pImpl->AttrsSetNodes.FindNodeOrInsertPos(ID, InsertPoint);
 
@@ -538,6 +541,7 @@ AttributeSet::getImpl(LLVMContext &C,
   AttributeSetImpl::Profile(ID, Attrs);
 
   void *InsertPoint;
+  ContextLock Lock(pImpl, pImpl->AttrsLock);
   AttributeSetImpl *PA = pImpl->AttrsLists.FindNodeOrInsertPos(ID, InsertPoint);
 
   // If we didn't find any existing attributes of the same shape then
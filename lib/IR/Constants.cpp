@@ -430,6 +430,7 @@ ConstantInt::ConstantInt(IntegerType *Ty, const APInt& V)
 
 ConstantInt *ConstantInt::getTrue(LLVMContext &Context) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  ContextLock Lock(pImpl, pImpl->ScalarConstantsLock);
   if (!pImpl->TheTrueVal)
     pImpl->TheTrueVal = ConstantInt::get(Type::getInt1Ty(Context), 1);
   return pImpl->TheTrueVal;
@@ -437,6 +438,7 @@ ConstantInt *ConstantInt::getTrue(LLVMContext &Context) {
 
 ConstantInt *ConstantInt::getFalse(LLVMContext &Context) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  ContextLock Lock(pImpl, pImpl->ScalarConstantsLock);
   if (!pImpl->TheFalseVal)
     pImpl->TheFalseVal = ConstantInt::get(Type::getInt1Ty(Context), 0);
   return pImpl->TheFalseVal;
@@ -477,6 +479,7 @@ ConstantInt *ConstantInt::get(LLVMContext &Context, const APInt &V) {
   IntegerType *ITy = IntegerType::get(Context, V.getBitWidth());
   // get an existing value or the insertion position
   DenseMapAPIntKeyInfo::KeyTy Key(V, ITy);
+  ContextLock Lock(Context.pImpl, Context.pImpl->ScalarConstantsLock);
   ConstantInt *&Slot = Context.pImpl->IntConstants[Key]; 
   if (!Slot) Slot = new ConstantInt(ITy, V);
   return Slot;
@@ -605,6 +608,7 @@ ConstantFP* ConstantFP::get(LLVMContext &Context, const APFloat& V) {
 
   LLVMContextImpl* pImpl = Context.pImpl;
 
+  ContextLock Lock(pImpl, pImpl->ScalarConstantsLock);
   ConstantFP *&Slot = pImpl->FPConstants[Key];
 
   if (!Slot) {
@@ -828,6 +832,7 @@ Constant *ConstantArray::get(ArrayType *Ty, ArrayRef<Constant*> V) {
   }
 
   // Otherwise, we really do want to create a ConstantArray.
+  ContextLock Lock(pImpl, pImpl->ValuesLock);
   return pImpl->ArrayConstants.getOrCreate(Ty, V);
 }
 
@@ -891,7 +896,9 @@ Constant *ConstantStruct::get(StructType *ST, ArrayRef<Constant*> V) {
   if (isUndef)
     return UndefValue::get(ST);
 
-  return ST->getContext().pImpl->StructConstants.getOrCreate(ST, V);
+  LLVMContextImpl *pImpl = ST->getContext().pImpl;
+  ContextLock Lock(pImpl, pImpl->ValuesLock);
+  return pImpl->StructConstants.getOrCreate(ST, V);
 }
 
 Constant *ConstantStruct::get(StructType *T, ...) {
@@ -1010,6 +1017,7 @@ Constant *ConstantVector::get(ArrayRef<Constant*> V) {
 
   // Otherwise, the element type isn't compatible with ConstantDataVector, or
   // the operand list constants a ConstantExpr or something else strange.
+  ContextLock Lock(pImpl, pImpl->ValuesLock);
   return pImpl->VectorConstants.getOrCreate(T, V);
 }
 
@@ -1226,6 +1234,7 @@ ConstantAggregateZero *ConstantAggregateZero::get(Type *Ty) {
   assert((Ty->isStructTy() || Ty->isArrayTy() || Ty->isVectorTy()) &&
          "Cannot create an aggregate zero of non-aggregate type!");
   
+  ContextLock Lock(Ty->getContext().pImpl, Ty->getContext().pImpl->ValuesLock);
   ConstantAggregateZero *&Entry = Ty->getContext().pImpl->CAZConstants[Ty];
   if (Entry == 0)
     Entry = new ConstantAggregateZero(Ty);
@@ -1236,14 +1245,18 @@ ConstantAggregateZero *ConstantAggregateZero::get(Type *Ty) {
 /// destroyConstant - Remove the constant from the constant table.
 ///
 void ConstantAggregateZero::destroyConstant() {
+  ContextLock Lock(getContext().pImpl, getContext().pImpl->ValuesLock);
   getContext().pImpl->CAZConstants.erase(getType());
+  Lock.unlock();
   destroyConstantImpl();
 }
 
 /// destroyConstant - Remove the constant from the constant table...
 ///
 void ConstantArray::destroyConstant() {
+  ContextLock Lock(getContext().pImpl, getContext().pImpl->ValuesLock);
   getType()->getContext().pImpl->ArrayConstants.remove(this);
+  Lock.unlock();
   destroyConstantImpl();
 }
 
@@ -1254,14 +1267,18 @@ void ConstantArray::destroyConstant() {
 // destroyConstant - Remove the constant from the constant table...
 //
 void ConstantStruct::destroyConstant() {
+  ContextLock Lock(getContext().pImpl, getContext().pImpl->ValuesLock);
   getType()->getContext().pImpl->StructConstants.remove(this);
+  Lock.unlock();
   destroyConstantImpl();
 }
 
 // destroyConstant - Remove the constant from the constant table...
 //
 void ConstantVector::destroyConstant() {
+  ContextLock Lock(getContext().pImpl, getContext().pImpl->ValuesLock);
   getType()->getContext().pImpl->VectorConstants.remove(this);
+  Lock.unlock();
   destroyConstantImpl();
 }
 
@@ -1306,6 +1323,7 @@ const APInt &Constant::getUniqueInteger() const {
 //
 
 ConstantPointerNull *ConstantPointerNull::get(PointerType *Ty) {
+  ContextLock Lock(Ty->getContext().pImpl, Ty->getContext().pImpl->ValuesLock);
   ConstantPointerNull *&Entry = Ty->getContext().pImpl->CPNConstants[Ty];
   if (Entry == 0)
     Entry = new ConstantPointerNull(Ty);
@@ -1316,8 +1334,10 @@ ConstantPointerNull *ConstantPointerNull::get(PointerType *Ty) {
 // destroyConstant - Remove the constant from the constant table...
 //
 void ConstantPointerNull::destroyConstant() {
+  ContextLock Lock(getContext().pImpl, getContext().pImpl->ValuesLock);
   getContext().pImpl->CPNConstants.erase(getType());
   // Free the constant and any dangling references to it.
+  Lock.unlock();
   destroyConstantImpl();
 }
 
@@ -1326,6 +1346,7 @@ void ConstantPointerNull::destroyConstant() {
 //
 
 UndefValue *UndefValue::get(Type *Ty) {
+  ContextLock Lock(Ty->getContext().pImpl, Ty->getContext().pImpl->ValuesLock);
   UndefValue *&Entry = Ty->getContext().pImpl->UVConstants[Ty];
   if (Entry == 0)
     Entry = new UndefValue(Ty);
@@ -1336,8 +1357,10 @@ UndefValue *UndefValue::get(Type *Ty) {
 // destroyConstant - Remove the constant from the constant table.
 //
 void UndefValue::destroyConstant() {
+  ContextLock Lock(getContext().pImpl, getContext().pImpl->ValuesLock);
   // Free the constant and any dangling references to it.
   getContext().pImpl->UVConstants.erase(getType());
+  Lock.unlock();
   destroyConstantImpl();
 }
 
@@ -1350,6 +1373,7 @@ BlockAddress *BlockAddress::get(BasicBlock *BB) {
 }
 
 BlockAddress *BlockAddress::get(Function *F, BasicBlock *BB) {
+  ContextLock Lock(F->getContext().pImpl, F->getContext().pImpl->ValuesLock);
   BlockAddress *&BA =
     F->getContext().pImpl->BlockAddresses[std::make_pair(F, BB)];
   if (BA == 0)
@@ -1371,13 +1395,16 @@ BlockAddress::BlockAddress(Function *F, BasicBlock *BB)
 // destroyConstant - Remove the constant from the constant table.
 //
 void BlockAddress::destroyConstant() {
+  ContextLock Lock(getContext().pImpl, getContext().pImpl->ValuesLock);
   getFunction()->getType()->getContext().pImpl
     ->BlockAddresses.erase(std::make_pair(getFunction(), getBasicBlock()));
   getBasicBlock()->AdjustBlockAddressRefCount(-1);
+  Lock.unlock();
   destroyConstantImpl();
 }
 
 void BlockAddress::replaceUsesOfWithOnConstant(Value *From, Value *To, Use *U) {
+  ContextLock Lock(getContext().pImpl, getContext().pImpl->ValuesLock);
   // This could be replacing either the Basic Block or the Function.  In either
   // case, we have to remove the map entry.
   Function *NewF = getFunction();
@@ -1432,6 +1459,7 @@ static inline Constant *getFoldedCast(
   // Look up the constant in the table first to ensure uniqueness.
   ExprMapKeyType Key(opc, C);
 
+  ContextLock Lock(pImpl, pImpl->ValuesLock);
   return pImpl->ExprConstants.getOrCreate(Ty, Key);
 }
 
@@ -1731,6 +1759,7 @@ Constant *ConstantExpr::get(unsigned Opcode, Constant *C1, Constant *C2,
   ExprMapKeyType Key(Opcode, ArgVec, 0, Flags);
 
   LLVMContextImpl *pImpl = C1->getContext().pImpl;
+  ContextLock Lock(pImpl, pImpl->ValuesLock);
   return pImpl->ExprConstants.getOrCreate(C1->getType(), Key);
 }
 
@@ -1808,6 +1837,7 @@ Constant *ConstantExpr::getSelect(Constant *C, Constant *V1, Constant *V2) {
   ExprMapKeyType Key(Instruction::Select, ArgVec);
 
   LLVMContextImpl *pImpl = C->getContext().pImpl;
+  ContextLock Lock(pImpl, pImpl->ValuesLock);
   return pImpl->ExprConstants.getOrCreate(V1->getType(), Key);
 }
 
@@ -1844,6 +1874,7 @@ Constant *ConstantExpr::getGetElementPtr(Constant *C, ArrayRef<Value *> Idxs,
                            InBounds ? GEPOperator::IsInBounds : 0);
 
   LLVMContextImpl *pImpl = C->getContext().pImpl;
+  ContextLock Lock(pImpl, pImpl->ValuesLock);
   return pImpl->ExprConstants.getOrCreate(ReqTy, Key);
 }
 
@@ -1866,6 +1897,7 @@ ConstantExpr::getICmp(unsigned short pred, Constant *LHS, Constant *RHS) {
     ResultTy = VectorType::get(ResultTy, VT->getNumElements());
 
   LLVMContextImpl *pImpl = LHS->getType()->getContext().pImpl;
+  ContextLock Lock(pImpl, pImpl->ValuesLock);
   return pImpl->ExprConstants.getOrCreate(ResultTy, Key);
 }
 
@@ -1887,6 +1919,7 @@ ConstantExpr::getFCmp(unsigned short pred, Constant *LHS, Constant *RHS) {
     ResultTy = VectorType::get(ResultTy, VT->getNumElements());
 
   LLVMContextImpl *pImpl = LHS->getType()->getContext().pImpl;
+  ContextLock Lock(pImpl, pImpl->ValuesLock);
   return pImpl->ExprConstants.getOrCreate(ResultTy, Key);
 }
 
@@ -1905,6 +1938,7 @@ Constant *ConstantExpr::getExtractElement(Constant *Val, Constant *Idx) {
 
   LLVMContextImpl *pImpl = Val->getContext().pImpl;
   Type *ReqTy = Val->getType()->getVectorElementType();
+  ContextLock Lock(pImpl, pImpl->ValuesLock);
   return pImpl->ExprConstants.getOrCreate(ReqTy, Key);
 }
 
@@ -1924,6 +1958,7 @@ Constant *ConstantExpr::getInsertElement(Constant *Val, Constant *Elt,
   const ExprMapKeyType Key(Instruction::InsertElement, ArgVec);
 
   LLVMContextImpl *pImpl = Val->getContext().pImpl;
+  ContextLock Lock(pImpl, pImpl->ValuesLock);
   return pImpl->ExprConstants.getOrCreate(Val->getType(), Key);
 }
 
@@ -1944,6 +1979,7 @@ Constant *ConstantExpr::getShuffleVector(Constant *V1, Constant *V2,
   const ExprMapKeyType Key(Instruction::ShuffleVector, ArgVec);
 
   LLVMContextImpl *pImpl = ShufTy->getContext().pImpl;
+  ContextLock Lock(pImpl, pImpl->ValuesLock);
   return pImpl->ExprConstants.getOrCreate(ShufTy, Key);
 }
 
@@ -2126,7 +2162,9 @@ Constant *ConstantExpr::getBinOpAbsorber(unsigned Opcode, Type *Ty) {
 // destroyConstant - Remove the constant from the constant table...
 //
 void ConstantExpr::destroyConstant() {
+  ContextLock Lock(getContext().pImpl, getContext().pImpl->ValuesLock);
   getType()->getContext().pImpl->ExprConstants.remove(this);
+  Lock.unlock();
   destroyConstantImpl();
 }
 
@@ -2221,6 +2259,7 @@ Constant *ConstantDataSequential::getImpl(StringRef Elements, Type *Ty) {
     return ConstantAggregateZero::get(Ty);
 
   // Do a lookup to see if we have already formed one of these.
+  ContextLock Lock(Ty->getContext().pImpl, Ty->getContext().pImpl->ValuesLock);
   StringMap<ConstantDataSequential*>::MapEntryTy &Slot =
     Ty->getContext().pImpl->CDSConstants.GetOrCreateValue(Elements);
 
@@ -2244,6 +2283,7 @@ Constant *ConstantDataSequential::getImpl(StringRef Elements, Type *Ty) {
 }
 
 void ConstantDataSequential::destroyConstant() {
+  ContextLock Lock(getContext().pImpl, getContext().pImpl->ValuesLock);
   // Remove the constant from the StringMap.
   StringMap<ConstantDataSequential*> &CDSConstants = 
     getType()->getContext().pImpl->CDSConstants;
@@ -2280,6 +2320,7 @@ void ConstantDataSequential::destroyConstant() {
   Next = 0;
 
   // Finally, actually delete it.
+  Lock.unlock();
   destroyConstantImpl();
 }
 
@@ -2527,6 +2568,7 @@ Constant *ConstantDataVector::getSplatValue() const {
 ///
 void ConstantArray::replaceUsesOfWithOnConstant(Value *From, Value *To,
                                                 Use *U) {
+  ContextLock Lock(getContext().pImpl, getContext().pImpl->ValuesLock);
   assert(isa<Constant>(To) && "Cannot make Constant refer to non-constant!");
   Constant *ToC = cast<Constant>(To);
 
@@ -2602,6 +2644,7 @@ void ConstantArray::replaceUsesOfWithOnConstant(Value *From, Value *To,
 
 void ConstantStruct::replaceUsesOfWithOnConstant(Value *From, Value *To,
                                                  Use *U) {
+  ContextLock Lock(getContext().pImpl, getContext().pImpl->ValuesLock);
   assert(isa<Constant>(To) && "Cannot make Constant refer to non-constant!");
   Constant *ToC = cast<Constant>(To);
 
@@ -2677,6 +2720,7 @@ void ConstantStruct::replaceUsesOfWithOnConstant(Value *From, Value *To,
 
 void ConstantVector::replaceUsesOfWithOnConstant(Value *From, Value *To,
                                                  Use *U) {
+  ContextLock Lock(getContext().pImpl, getContext().pImpl->ValuesLock);
   assert(isa<Constant>(To) && "Cannot make Constant refer to non-constant!");
 
   SmallVector<Constant*, 8> Values;
@@ -2699,6 +2743,7 @@ void ConstantVector::replaceUsesOfWithOnConstant(Value *From, Value *To,
 
 void ConstantExpr::replaceUsesOfWithOnConstant(Value *From, Value *ToV,
                                                Use *U) {
+  ContextLock Lock(getContext().pImpl, getContext().pImpl->ValuesLock);
   assert(isa<Constant>(ToV) && "Cannot make Constant refer to non-constant!");
   Constant *To = cast<Constant>(ToV);
 
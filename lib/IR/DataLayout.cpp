@@ -439,12 +439,16 @@ DataLayout::~DataLayout() {
 }
 
 bool DataLayout::doFinalization(Module &M) {
+  sys::SmartScopedLock<true> Lock(LayoutMapLock);
   delete static_cast<StructLayoutMap*>(LayoutMap);
   LayoutMap = 0;
   return false;
 }
 
 const StructLayout *DataLayout::getStructLayout(StructType *Ty) const {
+  // The DataLayout of a target machine is shared by every thread that
+  // compiles with it, e.g. with -function-pass-threads.
+  sys::SmartScopedLock<true> Lock(LayoutMapLock);
   if (!LayoutMap)
     LayoutMap = new StructLayoutMap();
 
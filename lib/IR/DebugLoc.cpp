@@ -20,6 +20,7 @@ using namespace llvm;
 MDNode *DebugLoc::getScope(const LLVMContext &Ctx) const {
   if (ScopeIdx == 0) return 0;
   
+  ContextLock Lock(Ctx.pImpl, Ctx.pImpl->ValuesLock);
   if (ScopeIdx > 0) {
     // Positive ScopeIdx is an index into ScopeRecords, which has no inlined-at
     // position specified.
@@ -39,6 +40,7 @@ MDNode *DebugLoc::getInlinedAt(const LLVMContext &Ctx) const {
   // position specified.  Zero is invalid.
   if (ScopeIdx >= 0) return 0;
   
+  ContextLock Lock(Ctx.pImpl, Ctx.pImpl->ValuesLock);
   // Otherwise, the index is in the ScopeInlinedAtRecords array.
   assert(unsigned(-ScopeIdx) <= Ctx.pImpl->ScopeInlinedAtRecords.size() &&
          "Invalid ScopeIdx");
@@ -53,6 +55,7 @@ void DebugLoc::getScopeAndInlinedAt(MDNode *&Scope, MDNode *&IA,
     return;
   }
   
+  ContextLock Lock(Ctx.pImpl, Ctx.pImpl->ValuesLock);
   if (ScopeIdx > 0) {
     // Positive ScopeIdx is an index into ScopeRecords, which has no inlined-at
     // position specified.
@@ -160,6 +163,8 @@ unsigned DenseMapInfo<DebugLoc>::getHashValue(const DebugLoc &Key) {
 
 int LLVMContextImpl::getOrAddScopeRecordIdxEntry(MDNode *Scope,
                                                  int ExistingIdx) {
+  ContextLock Lock(this, ValuesLock);
+
   // If we already have an entry for this scope, return it.
   int &Idx = ScopeRecordIdx[Scope];
   if (Idx) return Idx;
@@ -183,6 +188,8 @@ int LLVMContextImpl::getOrAddScopeRecordIdxEntry(MDNode *Scope,
 
 int LLVMContextImpl::getOrAddScopeInlinedAtIdxEntry(MDNode *Scope, MDNode *IA,
                                                     int ExistingIdx) {
+  ContextLock Lock(this, ValuesLock);
+
   // If we already have an entry, return it.
   int &Idx = ScopeInlinedAtIdx[std::make_pair(Scope, IA)];
   if (Idx) return Idx;
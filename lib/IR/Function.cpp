@@ -211,8 +211,10 @@ Function::~Function() {
   clearGC();
 
   // Remove the intrinsicID from the Cache.
-  if(getValueName() && isIntrinsic())
+  if(getValueName() && isIntrinsic()) {
+    ContextLock Lock(getContext().pImpl, getContext().pImpl->ValuesLock);
     getContext().pImpl->IntrinsicIDCache.erase(this);
+  }
 }
 
 void Function::BuildLazyArguments() const {
@@ -350,6 +352,7 @@ unsigned Function::getIntrinsicID() const {
   if (!ValName || !isIntrinsic())
     return 0;
 
+  ContextLock Lock(getContext().pImpl, getContext().pImpl->ValuesLock);
   LLVMContextImpl::IntrinsicIDCacheTy &IntrinsicIDCache =
     getContext().pImpl->IntrinsicIDCache;
   if(!IntrinsicIDCache.count(this)) {
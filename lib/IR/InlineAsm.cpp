@@ -31,6 +31,7 @@ InlineAsm *InlineAsm::get(FunctionType *Ty, StringRef AsmString,
   InlineAsmKeyType Key(AsmString, Constraints, hasSideEffects, isAlignStack,
                        asmDialect);
   LLVMContextImpl *pImpl = Ty->getContext().pImpl;
+  ContextLock Lock(pImpl, pImpl->ValuesLock);
   return pImpl->InlineAsms.getOrCreate(PointerType::getUnqual(Ty), Key);
 }
 
@@ -48,7 +49,9 @@ InlineAsm::InlineAsm(PointerType *Ty, const std::string &asmString,
 }
 
 void InlineAsm::destroyConstant() {
+  ContextLock Lock(getContext().pImpl, getContext().pImpl->ValuesLock);
   getType()->getContext().pImpl->InlineAsms.remove(this);
+  Lock.unlock();
   delete this;
 }
 
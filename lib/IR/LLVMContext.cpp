@@ -67,13 +67,24 @@ LLVMContext::LLVMContext() : pImpl(new LLVMContextImpl(*this)) {
 LLVMContext::~LLVMContext() { delete pImpl; }
 
 void LLVMContext::addModule(Module *M) {
+  ContextLock Lock(pImpl, pImpl->ValuesLock);
   pImpl->OwnedModules.insert(M);
 }
 
 void LLVMContext::removeModule(Module *M) {
+  ContextLock Lock(pImpl, pImpl->ValuesLock);
   pImpl->OwnedModules.erase(M);
 }
 
+void LLVMContext::enableConcurrentUniquing() {
+  pImpl->ConcurrentUniquing = true;
+  Use::LockSharedLists = true;
+}
+
+bool LLVMContext::isConcurrentUniquingEnabled() const {
+  return pImpl->ConcurrentUniquing;
+}
+
 //===----------------------------------------------------------------------===//
 // Recoverable Backend Errors
 //===----------------------------------------------------------------------===//
@@ -153,6 +164,7 @@ unsigned LLVMContext::getMDKindID(StringRef Name) const {
   assert(isValidName(Name) && "Invalid MDNode name");
 
   // If this is new, assign it its ID.
+  ContextLock Lock(pImpl, pImpl->ValuesLock);
   return
     pImpl->CustomMDKindNames.GetOrCreateValue(
       Name, pImpl->CustomMDKindNames.size()).second;
@@ -161,6 +173,7 @@ unsigned LLVMContext::getMDKindID(StringRef Name) const {
 /// getHandlerNames - Populate client supplied smallvector using custome
 /// metadata name and ID.
 void LLVMContext::getMDKindNames(SmallVectorImpl<StringRef> &Names) const {
+  ContextLock Lock(pImpl, pImpl->ValuesLock);
   Names.resize(pImpl->CustomMDKindNames.size());
   for (StringMap<unsigned>::const_iterator I = pImpl->CustomMDKindNames.begin(),
        E = pImpl->CustomMDKindNames.end(); I != E; ++I)
@@ -30,6 +30,7 @@
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Metadata.h"
+#include "llvm/Support/Mutex.h"
 #include "llvm/Support/ValueHandle.h"
 #include <vector>
 
@@ -238,7 +239,36 @@ public:
   
   LLVMContext::InlineAsmDiagHandlerTy InlineAsmDiagHandler;
   void *InlineAsmDiagContext;
-  
+
+  /// ConcurrentUniquing - True if the tables below may be used by several
+  /// threads at once.  See LLVMContext::enableConcurrentUniquing.
+  bool ConcurrentUniquing;
+
+  /// The tables are split into groups, each guarded by its own lock, so that
+  /// e.g. threads creating types don't wait for threads creating metadata.
+  /// The locks are only taken in concurrent mode (see ContextLock below).
+  /// Code holding one of them may acquire the ones declared after it, but
+  /// never the ones declared before it.
+  ///
+  /// AttrsLock guards AttrsSet, AttrsLists and AttrsSetNodes.
+  sys::Mutex AttrsLock;
+  /// ValuesLock guards the aggregate and expression constant tables, the
+  /// metadata tables, the value handle and instruction metadata maps, the
+  /// debug location scope records, OwnedModules and IntrinsicIDCache.  It is
+  /// not held while value handle callbacks run.
+  sys::Mutex ValuesLock;
+  /// ScalarConstantsLock guards IntConstants and FPConstants.
+  sys::Mutex ScalarConstantsLock;
+  /// TypesLock guards the derived type tables and TypeAllocator.
+  sys::Mutex TypesLock;
+  /// LLVMObjectsLock guards LLVMObjects.
+  sys::Mutex LLVMObjectsLock;
+  /// UseListLocks guard the use lists of the values that are shared between
+  /// functions (see Use::LockSharedLists), hashed by value.  They are taken
+  /// last and one at a time.
+  enum { NumUseListLocks = 16 };
+  sys::Mutex UseListLocks[NumUseListLocks];
+
   typedef DenseMap<DenseMapAPIntKeyInfo::KeyTy, ConstantInt*, 
                          DenseMapAPIntKeyInfo> IntMapTy;
   IntMapTy IntConstants;
@@ -362,6 +392,34 @@ public:
   ~LLVMContextImpl();
 };
 
+/// ContextLock - Hold one of the LLVMContextImpl table locks for the lifetime
+/// of this object if the context is in concurrent mode, and do nothing
+/// otherwise.
+class ContextLock {
+  sys::Mutex *M;
+
+  ContextLock(const ContextLock &) LLVM_DELETED_FUNCTION;
+  void operator=(const ContextLock &) LLVM_DELETED_FUNCTION;
+public:
+  ContextLock(const LLVMContextImpl *pImpl, sys::Mutex &Lock)
+    : M(pImpl->ConcurrentUniquing ? &Lock : 0) {
+    if (M)
+      M->acquire();
+  }
+  ~ContextLock() {
+    unlock();
+  }
+
+  /// unlock - Release the lock before the end of the scope, e.g. so that a
+  /// constant is removed from its table under the lock but destroyed, and its
+  /// value handles notified, without it.
+  void unlock() {
+    if (M)
+      M->release();
+    M = 0;
+  }
+};
+
 }
 
 #endif
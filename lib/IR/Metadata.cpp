@@ -37,6 +37,7 @@ MDString::MDString(LLVMContext &C)
 
 MDString *MDString::get(LLVMContext &Context, StringRef Str) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  ContextLock Lock(pImpl, pImpl->ValuesLock);
   StringMapEntry<Value*> &Entry =
     pImpl->MDStringCache.GetOrCreateValue(Str);
   Value *&S = Entry.getValue();
@@ -132,6 +133,7 @@ MDNode::~MDNode() {
   assert((getSubclassDataFromValue() & DestroyFlag) != 0 &&
          "Not being destroyed through destroy()?");
   LLVMContextImpl *pImpl = getType()->getContext().pImpl;
+  ContextLock Lock(pImpl, pImpl->ValuesLock);
   if (isNotUniqued()) {
     pImpl->NonUniquedMDNodes.erase(this);
   } else {
@@ -215,6 +217,7 @@ static bool isFunctionLocalValue(Value *V) {
 MDNode *MDNode::getMDNode(LLVMContext &Context, ArrayRef<Value*> Vals,
                           FunctionLocalness FL, bool Insert) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  ContextLock Lock(pImpl, pImpl->ValuesLock);
 
   // Add all the operand pointers. Note that we don't have to add the
   // isFunctionLocal bit because that's implied by the operands.
@@ -319,11 +322,13 @@ void MDNode::Profile(FoldingSetNodeID &ID) const {
 void MDNode::setIsNotUniqued() {
   setValueSubclassData(getSubclassDataFromValue() | NotUniquedBit);
   LLVMContextImpl *pImpl = getType()->getContext().pImpl;
+  ContextLock Lock(pImpl, pImpl->ValuesLock);
   pImpl->NonUniquedMDNodes.insert(this);
 }
 
 // Replace value from this node's operand list.
 void MDNode::replaceOperand(MDNodeOperand *Op, Value *To) {
+  ContextLock Lock(getContext().pImpl, getContext().pImpl->ValuesLock);
   Value *From = *Op;
 
   // If is possible that someone did GV->RAUW(inst), replacing a global variable
@@ -628,7 +633,9 @@ void Instruction::setMetadata(unsigned KindID, MDNode *Node) {
     DbgLoc = DebugLoc::getFromDILocation(Node);
     return;
   }
-  
+
+  ContextLock Lock(getContext().pImpl, getContext().pImpl->ValuesLock);
+
   // Handle the case when we're adding/updating metadata on an instruction.
   if (Node) {
     LLVMContextImpl::MDMapTy &Info = getContext().pImpl->MetadataStore[this];
@@ -683,6 +690,7 @@ MDNode *Instruction::getMetadataImpl(unsigned KindID) const {
   
   if (!hasMetadataHashEntry()) return 0;
   
+  ContextLock Lock(getContext().pImpl, getContext().pImpl->ValuesLock);
   LLVMContextImpl::MDMapTy &Info = getContext().pImpl->MetadataStore[this];
   assert(!Info.empty() && "bit out of sync with hash table");
 
@@ -704,6 +712,7 @@ void Instruction::getAllMetadataImpl(SmallVectorImpl<std::pair<unsigned,
     if (!hasMetadataHashEntry()) return;
   }
   
+  ContextLock Lock(getContext().pImpl, getContext().pImpl->ValuesLock);
   assert(hasMetadataHashEntry() &&
          getContext().pImpl->MetadataStore.count(this) &&
          "Shouldn't have called this");
@@ -722,6 +731,7 @@ void Instruction::
 getAllMetadataOtherThanDebugLocImpl(SmallVectorImpl<std::pair<unsigned,
                                     MDNode*> > &Result) const {
   Result.clear();
+  ContextLock Lock(getContext().pImpl, getContext().pImpl->ValuesLock);
   assert(hasMetadataHashEntry() &&
          getContext().pImpl->MetadataStore.count(this) &&
          "Shouldn't have called this");
@@ -739,6 +749,7 @@ getAllMetadataOtherThanDebugLocImpl(SmallVectorImpl<std::pair<unsigned,
 /// this instruction.
 void Instruction::clearMetadataHashEntries() {
   assert(hasMetadataHashEntry() && "Caller should check");
+  ContextLock Lock(getContext().pImpl, getContext().pImpl->ValuesLock);
   getContext().pImpl->MetadataStore.erase(this);
   setHasMetadataHashEntry(false);
 }
@@ -92,6 +92,10 @@ ImmutablePass *Pass::getAsImmutablePass() {
   return 0;
 }
 
+Pass *Pass::createClone() const {
+  return 0;
+}
+
 PMDataManager *Pass::getAsPMDataManager() {
   return 0;
 }
@@ -13,6 +13,8 @@
 
 
 #include "llvm/PassManagers.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Assembly/PrintModulePass.h"
 #include "llvm/Assembly/Writer.h"
 #include "llvm/IR/Module.h"
@@ -23,6 +25,9 @@
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Mutex.h"
 #include "llvm/Support/PassNameParser.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/ThreadLocal.h"
+#include "llvm/Support/TimeValue.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
@@ -484,9 +489,63 @@ public:
   }
 };
 
+//===----------------------------------------------------------------------===//
+/// PassTraceInfo Class - This class collects the pass runs recorded by
+/// PassTraceRegion and writes them out as a Chrome trace (JSON) when it is
+/// destroyed.  This only happens when -pass-trace is enabled on the command
+/// line.
+///
+
+static ManagedStatic<sys::SmartMutex<true> > PassTraceMutex;
+
+class PassTraceInfo {
+public:
+  struct Event {
+    std::string Name;
+    std::string Unit;
+    uint64_t Start, Duration;
+    unsigned Thread;
+    unsigned InstsBefore, InstsAfter;
+    size_t PeakRSSGrowth;
+    bool HasInstCounts;
+  };
+
+private:
+  std::vector<Event> Events;
+  uint64_t StartTime;
+  unsigned NumThreads;
+  sys::ThreadLocal<const void> ThreadIDs;
+
+public:
+  // Use 'create' member to get this.
+  PassTraceInfo() : StartTime(sys::TimeValue::now().usec()), NumThreads(0) {}
+
+  ~PassTraceInfo() { writeTrace(); }
+
+  // createTheTraceInfo - This method either initializes the TheTraceInfo
+  // pointer to a non null value (if the -pass-trace option is given) or it
+  // leaves it null.  It may be called multiple times.
+  static void createTheTraceInfo();
+
+  /// now - Return the number of microseconds since the trace was started.
+  uint64_t now() const { return sys::TimeValue::now().usec() - StartTime; }
+
+  /// getThreadID - Return a small number identifying the calling thread.
+  unsigned getThreadID();
+
+  void addEvent(const Event &E) {
+    sys::SmartScopedLock<true> Lock(*PassTraceMutex);
+    Events.push_back(E);
+  }
+
+private:
+  void writeTrace();
+};
+
 } // End of anon namespace
 
 static TimingInfo *TheTimeInfo;
+static PassTraceInfo *TheTraceInfo;
 
 //===----------------------------------------------------------------------===//
 // PMTopLevelManager implementation
@@ -1299,6 +1358,7 @@ bool BBPassManager::runOnFunction(Function &F) {
         // If the pass crashes, remember this.
         PassManagerPrettyStackEntry X(BP, *I);
         TimeRegion PassTimer(getPassTimer(BP));
+        PassTraceRegion PassTrace(BP, *I);
 
         LocalChanged |= BP->runOnBasicBlock(*I);
       }
@@ -1475,6 +1535,7 @@ void FunctionPassManagerImpl::releaseMemoryOnTheFly() {
 bool FunctionPassManagerImpl::run(Function &F) {
   bool Changed = false;
   TimingInfo::createTheTimeInfo();
+  PassTraceInfo::createTheTraceInfo();
 
   initializeAllAnalysisInfo();
   for (unsigned Index = 0; Index < getNumContainedManagers(); ++Index)
@@ -1502,19 +1563,156 @@ void FPPassManager::dumpPassStructure(unsigned Offset) {
 }
 
 
+FunctionShards::~FunctionShards() {}
+
+FunctionShards *(*FPPassManager::ShardFunctions)(FPPassManager &, Module &) = 0;
+
+/// collectPasses - Add P and, if it is a pass manager, the passes it manages.
+static void collectPasses(Pass *P, SmallVectorImpl<Pass *> &Passes) {
+  Passes.push_back(P);
+  if (PMDataManager *PMD = P->getAsPMDataManager())
+    for (unsigned i = 0, e = PMD->getNumContainedPasses(); i != e; ++i)
+      collectPasses(PMD->getContainedPassAt(i), Passes);
+}
+
+/// canRunOnWorker - Return true if P, and every pass in it if it is a pass
+/// manager, can be recreated on a worker thread, and only requires analyses
+/// that the worker can provide.
+static bool canRunOnWorker(PMTopLevelManager *TPM, Pass *P) {
+  if (PMDataManager *PMD = P->getAsPMDataManager()) {
+    for (unsigned i = 0, e = PMD->getNumContainedPasses(); i != e; ++i)
+      if (!canRunOnWorker(TPM, PMD->getContainedPassAt(i)))
+        return false;
+  } else {
+    const PassInfo *PI = Pass::lookupPassInfo(P->getPassID());
+    if (!PI || !PI->isAnalysis() || !PI->getNormalCtor()) {
+      OwningPtr<Pass> Clone(P->createClone());
+      if (!Clone)
+        return false;
+    }
+  }
+
+  // Analyses that are not available yet are computed by the passes of the
+  // manager, so only the available ones have to be looked at.
+  const AnalysisUsage::VectorType &RequiredSet =
+    TPM->findAnalysisUsage(P)->getRequiredSet();
+  for (AnalysisUsage::VectorType::const_iterator I = RequiredSet.begin(),
+         E = RequiredSet.end(); I != E; ++I) {
+    Pass *Impl = TPM->findAnalysisPass(*I);
+    if (!Impl)
+      continue;
+    ImmutablePass *IP = Impl->getAsImmutablePass();
+    if (!IP)
+      return false;
+    OwningPtr<Pass> Clone(IP->createClone());
+    if (!Clone)
+      return false;
+  }
+  return true;
+}
+
+/// canRecompute - Return true if P is an analysis that can be run again on
+/// the calling thread after the workers are done, because all it uses are
+/// immutable passes.
+static bool canRecompute(PMTopLevelManager *TPM, Pass *P) {
+  if (P->getAsPMDataManager())
+    return false;
+  const PassInfo *PI = Pass::lookupPassInfo(P->getPassID());
+  if (!PI || !PI->isAnalysis())
+    return false;
+  const AnalysisUsage::VectorType &RequiredSet =
+    TPM->findAnalysisUsage(P)->getRequiredSet();
+  for (AnalysisUsage::VectorType::const_iterator I = RequiredSet.begin(),
+         E = RequiredSet.end(); I != E; ++I) {
+    Pass *Impl = TPM->findAnalysisPass(*I);
+    if (!Impl || !Impl->getAsImmutablePass())
+      return false;
+  }
+  return true;
+}
+
+unsigned
+FPPassManager::getNumShardablePasses(SmallVectorImpl<unsigned> &Recomputed) {
+  // The workers cannot take part in the debugging output or the timers.
+  if (PassDebugging >= Executions || TimePassesIsEnabled)
+    return 0;
+#ifndef NDEBUG
+  if (DebugFlag)
+    return 0;
+#endif
+
+  unsigned NumPasses = 0;
+  DenseMap<Pass *, unsigned> Slots;
+  while (NumPasses != getNumContainedPasses() &&
+         canRunOnWorker(TPM, getContainedPass(NumPasses))) {
+    SmallVector<Pass *, 8> Passes;
+    collectPasses(getContainedPass(NumPasses), Passes);
+    for (unsigned i = 0, e = Passes.size(); i != e; ++i)
+      Slots[Passes[i]] = NumPasses;
+    ++NumPasses;
+  }
+
+  // Whatever the workers compute only exists on the workers, so stop before
+  // any pass whose result is still used after the workers are done, unless
+  // it is an analysis that is cheap to compute again here.
+  bool Cut = true;
+  while (NumPasses && Cut) {
+    Cut = false;
+    Recomputed.clear();
+    SmallVector<Pass *, 32> Users(1, this);
+    for (unsigned Index = NumPasses; Index < getNumContainedPasses(); ++Index)
+      collectPasses(getContainedPass(Index), Users);
+    for (unsigned i = 0, e = Users.size(); i != e; ++i) {
+      SmallVector<Pass *, 12> LastUses;
+      TPM->collectLastUses(LastUses, Users[i]);
+      for (unsigned u = 0, ue = LastUses.size(); u != ue; ++u) {
+        DenseMap<Pass *, unsigned>::iterator Slot = Slots.find(LastUses[u]);
+        if (Slot == Slots.end() || Slot->second >= NumPasses)
+          continue;
+        if (LastUses[u] == getContainedPass(Slot->second) &&
+            canRecompute(TPM, LastUses[u])) {
+          Recomputed.push_back(Slot->second);
+        } else {
+          NumPasses = Slot->second;
+          Cut = true;
+        }
+      }
+    }
+  }
+  std::sort(Recomputed.begin(), Recomputed.end());
+  Recomputed.erase(std::unique(Recomputed.begin(), Recomputed.end()),
+                   Recomputed.end());
+  return NumPasses;
+}
+
+void FPPassManager::recomputeAnalysis(Function &F, unsigned Index) {
+  FunctionPass *FP = getContainedPass(Index);
+  initializeAnalysisImpl(FP);
+  {
+    PassManagerPrettyStackEntry X(FP, F);
+    PassTraceRegion PassTrace(FP, F);
+    FP->runOnFunction(F);
+  }
+  recordAvailableAnalysis(FP);
+}
+
 /// Execute all of the passes scheduled for execution by invoking
-/// runOnFunction method.  Keep track of whether any of the passes modifies
-/// the function, and if so, return true.
-bool FPPassManager::runOnFunction(Function &F) {
+/// runOnFunction method, starting at FirstPass.  Keep track of whether any of
+/// the passes modifies the function, and if so, return true.
+bool FPPassManager::runOnFunction(Function &F, unsigned FirstPass) {
   if (F.isDeclaration())
     return false;
 
   bool Changed = false;
 
+  // Record the whole pipeline's run over F, so the slowest functions stand
+  // out in the trace.
+  PassTraceRegion FunctionTrace(this, F);
+
   // Collect inherited analysis from Module level pass manager.
   populateInheritedAnalysis(TPM->activeStack);
 
-  for (unsigned Index = 0; Index < getNumContainedPasses(); ++Index) {
+  for (unsigned Index = FirstPass; Index < getNumContainedPasses(); ++Index) {
     FunctionPass *FP = getContainedPass(Index);
     bool LocalChanged = false;
 
@@ -1526,6 +1724,7 @@ bool FPPassManager::runOnFunction(Function &F) {
     {
       PassManagerPrettyStackEntry X(FP, F);
       TimeRegion PassTimer(getPassTimer(FP));
+      PassTraceRegion PassTrace(FP, F);
 
       LocalChanged |= FP->runOnFunction(F);
     }
@@ -1546,8 +1745,32 @@ bool FPPassManager::runOnFunction(Function &F) {
 bool FPPassManager::runOnModule(Module &M) {
   bool Changed = false;
 
-  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
-    Changed |= runOnFunction(*I);
+  OwningPtr<FunctionShards> Shards;
+  if (ShardFunctions)
+    Shards.reset(ShardFunctions(*this, M));
+  if (Shards) {
+    // The passes that run on the workers invalidate the analyses of the
+    // parent managers just as they would when run here.
+    populateInheritedAnalysis(TPM->activeStack);
+    for (unsigned Index = 0; Index != Shards->getNumPasses(); ++Index) {
+      SmallVector<Pass *, 8> Passes;
+      collectPasses(getContainedPass(Index), Passes);
+      for (unsigned i = 0, e = Passes.size(); i != e; ++i)
+        removeNotPreservedAnalysis(Passes[i]);
+    }
+  }
+
+  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I) {
+    bool LocalChanged;
+    if (Shards && Shards->takeFunction(*I, LocalChanged)) {
+      populateInheritedAnalysis(TPM->activeStack);
+      ArrayRef<unsigned> Recomputed = Shards->getRecomputedPasses();
+      for (unsigned i = 0, e = Recomputed.size(); i != e; ++i)
+        recomputeAnalysis(*I, Recomputed[i]);
+      Changed |= runOnFunction(*I, Shards->getNumPasses()) | LocalChanged;
+    } else
+      Changed |= runOnFunction(*I);
+  }
 
   return Changed;
 }
@@ -1604,6 +1827,7 @@ MPPassManager::runOnModule(Module &M) {
     {
       PassManagerPrettyStackEntry X(MP, M);
       TimeRegion PassTimer(getPassTimer(MP));
+      PassTraceRegion PassTrace(MP, M);
 
       LocalChanged |= MP->runOnModule(M);
     }
@@ -1688,6 +1912,7 @@ Pass* MPPassManager::getOnTheFlyPass(Pass *MP, AnalysisID PI, Function &F){
 bool PassManagerImpl::run(Module &M) {
   bool Changed = false;
   TimingInfo::createTheTimeInfo();
+  PassTraceInfo::createTheTraceInfo();
 
   dumpArguments();
   dumpPasses();
@@ -1768,6 +1993,165 @@ Timer *llvm::getPassTimer(Pass *P) {
   return 0;
 }
 
+//===----------------------------------------------------------------------===//
+// PassTraceInfo Class - This class collects the events of the -pass-trace
+// report.  Each event is one run of a pass (or pass manager) over a module,
+// function, basic block or call graph SCC.
+//
+static cl::opt<std::string>
+PassTraceFile("pass-trace", cl::value_desc("filename"),
+  cl::desc("Write a Chrome trace of every pass run over every function, "
+           "with instruction counts and peak RSS growth, to <filename>"));
+
+void PassTraceInfo::createTheTraceInfo() {
+  if (PassTraceFile.empty() || TheTraceInfo) return;
+
+  // As with TimingInfo, constructing this on first use guarantees that it is
+  // destroyed, and the trace written, before the static globals are.
+  static ManagedStatic<PassTraceInfo> PTI;
+  TheTraceInfo = &*PTI;
+}
+
+unsigned PassTraceInfo::getThreadID() {
+  // Thread IDs are stored off by one so that an unset slot reads as null.
+  const void *ID = ThreadIDs.get();
+  if (!ID) {
+    sys::SmartScopedLock<true> Lock(*PassTraceMutex);
+    ID = reinterpret_cast<const void*>(static_cast<intptr_t>(++NumThreads));
+    ThreadIDs.set(ID);
+  }
+  return static_cast<unsigned>(reinterpret_cast<intptr_t>(ID)) - 1;
+}
+
+/// writeJSONString - Print S as a quoted JSON string.
+static void writeJSONString(raw_ostream &OS, StringRef S) {
+  OS << '"';
+  for (StringRef::iterator I = S.begin(), E = S.end(); I != E; ++I) {
+    unsigned char C = *I;
+    if (C == '"' || C == '\\')
+      OS << '\\' << C;
+    else if (C < 0x20)
+      OS << "\\u00" << hexdigit(C >> 4) << hexdigit(C & 0xF);
+    else
+      OS << C;
+  }
+  OS << '"';
+}
+
+void PassTraceInfo::writeTrace() {
+  std::string ErrorInfo;
+  raw_fd_ostream OS(PassTraceFile.c_str(), ErrorInfo);
+  if (!ErrorInfo.empty()) {
+    errs() << "Error opening pass trace file '" << PassTraceFile << "': "
+           << ErrorInfo << '\n';
+    return;
+  }
+
+  unsigned PID = sys::process::get_self()->get_id();
+  OS << "{\"traceEvents\":[";
+  for (unsigned i = 0, e = Events.size(); i != e; ++i) {
+    const Event &E = Events[i];
+    OS << (i ? ",\n" : "\n") << "{\"name\":";
+    writeJSONString(OS, E.Name);
+    OS << ",\"cat\":\"pass\",\"ph\":\"X\",\"ts\":" << E.Start
+       << ",\"dur\":" << E.Duration << ",\"pid\":" << PID
+       << ",\"tid\":" << E.Thread << ",\"args\":{\"unit\":";
+    writeJSONString(OS, E.Unit);
+    if (E.HasInstCounts)
+      OS << ",\"insts_before\":" << E.InstsBefore
+         << ",\"insts_after\":" << E.InstsAfter;
+    OS << ",\"peak_rss_growth\":" << (uint64_t)E.PeakRSSGrowth << "}}";
+  }
+  OS << "\n]}\n";
+}
+
+//===----------------------------------------------------------------------===//
+// PassTraceRegion implementation
+//
+
+static unsigned countInstructions(const BasicBlock &BB) {
+  return BB.size();
+}
+
+static unsigned countInstructions(const Function &F) {
+  unsigned Count = 0;
+  for (Function::const_iterator I = F.begin(), E = F.end(); I != E; ++I)
+    Count += countInstructions(*I);
+  return Count;
+}
+
+static unsigned countInstructions(const Module &M) {
+  unsigned Count = 0;
+  for (Module::const_iterator I = M.begin(), E = M.end(); I != E; ++I)
+    Count += countInstructions(*I);
+  return Count;
+}
+
+PassTraceRegion::PassTraceRegion(Pass *P, Module &M)
+  : P(TheTraceInfo ? P : 0), M(&M), F(0), BB(0) {
+  start();
+}
+
+PassTraceRegion::PassTraceRegion(Pass *P, Function &F)
+  : P(TheTraceInfo ? P : 0), M(0), F(&F), BB(0) {
+  start();
+}
+
+PassTraceRegion::PassTraceRegion(Pass *P, BasicBlock &BB)
+  : P(TheTraceInfo ? P : 0), M(0), F(0), BB(&BB) {
+  start();
+}
+
+PassTraceRegion::PassTraceRegion(Pass *P, StringRef Unit)
+  : P(TheTraceInfo ? P : 0), M(0), F(0), BB(0) {
+  if (this->P)
+    this->Unit = Unit;
+  start();
+}
+
+void PassTraceRegion::start() {
+  if (!P)
+    return;
+
+  InstsBefore = 0;
+  if (M) {
+    Unit = M->getModuleIdentifier();
+    InstsBefore = countInstructions(*M);
+  } else if (F) {
+    Unit = F->getName();
+    InstsBefore = countInstructions(*F);
+  } else if (BB) {
+    Unit = (BB->getParent()->getName() + ":" + BB->getName()).str();
+    InstsBefore = countInstructions(*BB);
+  }
+  PeakRSSBefore = sys::Process::GetPeakResidentSetSize();
+  StartTime = TheTraceInfo->now();
+}
+
+PassTraceRegion::~PassTraceRegion() {
+  if (!P)
+    return;
+
+  PassTraceInfo::Event E;
+  E.Start = StartTime;
+  E.Duration = TheTraceInfo->now() - StartTime;
+  E.PeakRSSGrowth = sys::Process::GetPeakResidentSetSize() - PeakRSSBefore;
+  E.Name = P->getPassName();
+  E.Unit = Unit;
+  E.Thread = TheTraceInfo->getThreadID();
+  E.InstsBefore = InstsBefore;
+  E.HasInstCounts = M || F || BB;
+  if (M)
+    E.InstsAfter = countInstructions(*M);
+  else if (F)
+    E.InstsAfter = countInstructions(*F);
+  else if (BB)
+    E.InstsAfter = countInstructions(*BB);
+  else
+    E.InstsAfter = 0;
+  TheTraceInfo->addEvent(E);
+}
+
 //===----------------------------------------------------------------------===//
 // PMStack implementation
 //
@@ -12,6 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/IR/Value.h"
+#include "LLVMContextImpl.h"
 #include <new>
 
 namespace llvm {
@@ -21,6 +22,13 @@ namespace llvm {
 //===----------------------------------------------------------------------===//
 
 void Use::swap(Use &RHS) {
+  if (LLVM_UNLIKELY(LockSharedLists)) {
+    Value *V1(Val);
+    setLocked(RHS.Val);
+    RHS.setLocked(V1);
+    return;
+  }
+
   Value *V1(Val);
   Value *V2(RHS.Val);
   if (V1 != V2) {
@@ -45,6 +53,62 @@ void Use::swap(Use &RHS) {
   }
 }
 
+//===----------------------------------------------------------------------===//
+//                         Use list locking Implementation
+//===----------------------------------------------------------------------===//
+
+bool Use::LockSharedLists = false;
+
+/// getUseListLock - Return the lock guarding the use list of V, or null if
+/// its use list can only be changed by the thread that owns its function.
+static sys::Mutex *getUseListLock(const Value *V) {
+  // Constants, globals, metadata and inline asm may be used by any function
+  // in the context, so those are the use lists that threads share.
+  unsigned ID = V->getValueID();
+  if (ID < Value::ConstantFirstVal || ID > Value::InlineAsmVal)
+    return 0;
+  LLVMContextImpl *pImpl = V->getContext().pImpl;
+  if (!pImpl->ConcurrentUniquing)
+    return 0;
+  unsigned Bucket = DenseMapInfo<const Value*>::getHashValue(V);
+  return &pImpl->UseListLocks[Bucket % LLVMContextImpl::NumUseListLocks];
+}
+
+namespace {
+/// UseListGuard - Hold the use list lock of a value, if it has one.
+class UseListGuard {
+  sys::Mutex *M;
+public:
+  explicit UseListGuard(const Value *V) : M(getUseListLock(V)) {
+    if (M)
+      M->acquire();
+  }
+  ~UseListGuard() {
+    if (M)
+      M->release();
+  }
+};
+}
+
+// Each of these takes at most one use list lock at a time, so the locks can
+// be acquired with any of the context table locks held.
+
+void Use::setLocked(Value *V) {
+  if (Val) removeFromListLocked();
+  Val = V;
+  if (V) addToListLocked();
+}
+
+void Use::addToListLocked() {
+  UseListGuard Guard(Val);
+  Val->addUse(*this);
+}
+
+void Use::removeFromListLocked() {
+  UseListGuard Guard(Val);
+  removeFromList();
+}
+
 //===----------------------------------------------------------------------===//
 //                         Use getImpliedUser Implementation
 //===----------------------------------------------------------------------===//
@@ -195,8 +195,10 @@ void Value::setName(const Twine &NewName) {
   if (getSymTab(this, ST))
     return;  // Cannot set a name on this value (e.g. constant).
 
-  if (Function *F = dyn_cast<Function>(this))
+  if (Function *F = dyn_cast<Function>(this)) {
+    ContextLock Lock(getContext().pImpl, getContext().pImpl->ValuesLock);
     getContext().pImpl->IntrinsicIDCache.erase(F);
+  }
 
   if (!ST) { // No symbol table to update?  Just do the change.
     if (NameRef.empty()) {
@@ -508,6 +510,7 @@ void ValueHandleBase::AddToUseList() {
   assert(VP.getPointer() && "Null pointer doesn't have a use list!");
 
   LLVMContextImpl *pImpl = VP.getPointer()->getContext().pImpl;
+  ContextLock Lock(pImpl, pImpl->ValuesLock);
 
   if (VP.getPointer()->HasValueHandle) {
     // If this value already has a ValueHandle, then it must be in the
@@ -547,11 +550,22 @@ void ValueHandleBase::AddToUseList() {
   }
 }
 
+/// AddToUseListOf - Add this ValueHandle to the use list of RHS, which
+/// watches the same value, just before RHS.
+void ValueHandleBase::AddToUseListOf(const ValueHandleBase &RHS) {
+  LLVMContextImpl *pImpl = VP.getPointer()->getContext().pImpl;
+  ContextLock Lock(pImpl, pImpl->ValuesLock);
+  AddToExistingUseList(RHS.getPrevPtr());
+}
+
 /// RemoveFromUseList - Remove this ValueHandle from its current use list.
 void ValueHandleBase::RemoveFromUseList() {
   assert(VP.getPointer() && VP.getPointer()->HasValueHandle &&
          "Pointer doesn't have a use list!");
 
+  LLVMContextImpl *pImpl = VP.getPointer()->getContext().pImpl;
+  ContextLock Lock(pImpl, pImpl->ValuesLock);
+
   // Unlink this from its use list.
   ValueHandleBase **PrevPtr = getPrevPtr();
   assert(*PrevPtr == this && "List invariant broken");
@@ -566,7 +580,6 @@ void ValueHandleBase::RemoveFromUseList() {
   // If the Next pointer was null, then it is possible that this was the last
   // ValueHandle watching VP.  If so, delete its entry from the ValueHandles
   // map.
-  LLVMContextImpl *pImpl = VP.getPointer()->getContext().pImpl;
   DenseMap<Value*, ValueHandleBase*> &Handles = pImpl->ValueHandles;
   if (Handles.isPointerIntoBucketsArray(PrevPtr)) {
     Handles.erase(VP.getPointer());
@@ -581,7 +594,11 @@ void ValueHandleBase::ValueIsDeleted(Value *V) {
   // Get the linked list base, which is guaranteed to exist since the
   // HasValueHandle flag is set.
   LLVMContextImpl *pImpl = V->getContext().pImpl;
-  ValueHandleBase *Entry = pImpl->ValueHandles[V];
+  ValueHandleBase *Entry;
+  {
+    ContextLock Lock(pImpl, pImpl->ValuesLock);
+    Entry = pImpl->ValueHandles[V];
+  }
   assert(Entry && "Value bit set but no entries exist");
 
   // We use a local ValueHandleBase as an iterator so that ValueHandles can add
@@ -593,10 +610,16 @@ void ValueHandleBase::ValueIsDeleted(Value *V) {
   // be processed and the checking code will mete out righteous punishment if
   // the handle is still present once we have finished processing all the other
   // value handles (it is fine to momentarily add then remove a value handle).
-  for (ValueHandleBase Iterator(Assert, *Entry); Entry; Entry = Iterator.Next) {
-    Iterator.RemoveFromUseList();
-    Iterator.AddToExistingUseListAfter(Entry);
-    assert(Entry->Next == &Iterator && "Loop invariant broken.");
+  // The context lock is only held while walking the list; the handles take it
+  // themselves as they update, so callbacks are free to create or delete
+  // values.
+  for (ValueHandleBase Iterator(Assert, *Entry); Entry; ) {
+    {
+      ContextLock Lock(pImpl, pImpl->ValuesLock);
+      Iterator.RemoveFromUseList();
+      Iterator.AddToExistingUseListAfter(Entry);
+      assert(Entry->Next == &Iterator && "Loop invariant broken.");
+    }
 
     switch (Entry->getKind()) {
     case Assert:
@@ -615,11 +638,15 @@ void ValueHandleBase::ValueIsDeleted(Value *V) {
       static_cast<CallbackVH*>(Entry)->deleted();
       break;
     }
+
+    ContextLock Lock(pImpl, pImpl->ValuesLock);
+    Entry = Iterator.Next;
   }
 
   // All callbacks, weak references, and assertingVHs should be dropped by now.
   if (V->HasValueHandle) {
 #ifndef NDEBUG      // Only in +Asserts mode...
+    ContextLock Lock(pImpl, pImpl->ValuesLock);
     dbgs() << "While deleting: " << *V->getType() << " %" << V->getName()
            << "\n";
     if (pImpl->ValueHandles[V]->getKind() == Assert)
@@ -639,18 +666,26 @@ void ValueHandleBase::ValueIsRAUWd(Value *Old, Value *New) {
   // Get the linked list base, which is guaranteed to exist since the
   // HasValueHandle flag is set.
   LLVMContextImpl *pImpl = Old->getContext().pImpl;
-  ValueHandleBase *Entry = pImpl->ValueHandles[Old];
+  ValueHandleBase *Entry;
+  {
+    ContextLock Lock(pImpl, pImpl->ValuesLock);
+    Entry = pImpl->ValueHandles[Old];
+  }
 
   assert(Entry && "Value bit set but no entries exist");
 
   // We use a local ValueHandleBase as an iterator so that
   // ValueHandles can add and remove themselves from the list without
   // breaking our iteration.  This is not really an AssertingVH; we
-  // just have to give ValueHandleBase some kind.
-  for (ValueHandleBase Iterator(Assert, *Entry); Entry; Entry = Iterator.Next) {
-    Iterator.RemoveFromUseList();
-    Iterator.AddToExistingUseListAfter(Entry);
-    assert(Entry->Next == &Iterator && "Loop invariant broken.");
+  // just have to give ValueHandleBase some kind.  As in ValueIsDeleted, the
+  // context lock is not held while the handles are updated.
+  for (ValueHandleBase Iterator(Assert, *Entry); Entry; ) {
+    {
+      ContextLock Lock(pImpl, pImpl->ValuesLock);
+      Iterator.RemoveFromUseList();
+      Iterator.AddToExistingUseListAfter(Entry);
+      assert(Entry->Next == &Iterator && "Loop invariant broken.");
+    }
 
     switch (Entry->getKind()) {
     case Assert:
@@ -672,11 +707,15 @@ void ValueHandleBase::ValueIsRAUWd(Value *Old, Value *New) {
       static_cast<CallbackVH*>(Entry)->allUsesReplacedWith(New);
       break;
     }
+
+    ContextLock Lock(pImpl, pImpl->ValuesLock);
+    Entry = Iterator.Next;
   }
 
 #ifndef NDEBUG
   // If any new tracking or weak value handles were added while processing the
   // list, then complain about it now.
+  ContextLock Lock(pImpl, pImpl->ValuesLock);
   if (Old->HasValueHandle)
     for (Entry = pImpl->ValueHandles[Old]; Entry; Entry = Entry->Next)
       switch (Entry->getKind()) {
@@ -82,6 +82,8 @@ namespace {  // Anonymous namespace for class
       initializePreVerifierPass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *createClone() const { return new PreVerifier(); }
+
     virtual void getAnalysisUsage(AnalysisUsage &AU) const {
       AU.setPreservesAll();
     }
@@ -154,6 +156,8 @@ namespace {
       initializeVerifierPass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *createClone() const { return new Verifier(action); }
+
     bool doInitialization(Module &M) {
       Mod = &M;
       Context = &M.getContext();
@@ -815,8 +815,12 @@ bool ModuleLinker::linkFunctionProto(Function *SF) {
     DGV->eraseFromParent();
   } else {
     // Internal, LO_ODR, or LO linkage - stick in set to ignore and lazily link.
+    // When only linking what is needed, do the same for anything else the
+    // destination does not already refer to.
     if (SF->hasLocalLinkage() || SF->hasLinkOnceLinkage() ||
-        SF->hasAvailableExternallyLinkage()) {
+        SF->hasAvailableExternallyLinkage() ||
+        ((Mode & Linker::LinkOnlyNeeded) &&
+         (!SF->isDeclaration() || SF->isMaterializable()))) {
       DoNotLinkFromSource.insert(SF);
       LazilyLinkFunctions.push_back(SF);
     }
@@ -927,7 +931,7 @@ void ModuleLinker::linkFunctionBody(Function *Dst, Function *Src) {
     ValueMap[I] = DI;
   }
 
-  if (Mode == Linker::DestroySource) {
+  if (!(Mode & Linker::PreserveSource)) {
     // Splice the body of the source function into the dest function.
     Dst->getBasicBlockList().splice(Dst->end(), Src->getBasicBlockList());
     
@@ -28,16 +28,78 @@
 #include "llvm/MC/MCObjectWriter.h"
 #include "llvm/MC/MCSectionELF.h"
 #include "llvm/MC/MCValue.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ELF.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileOutputBuffer.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/system_error.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
 #include <vector>
 using namespace llvm;
 
 #undef  DEBUG_TYPE
 #define DEBUG_TYPE "reloc-info"
 
+static cl::opt<unsigned>
+WriteThreads("elf-write-threads", cl::Hidden, cl::init(0),
+             cl::desc("Write the sections of ELF object files on this many "
+                      "threads, straight into the output file if possible "
+                      "(0 writes them one after the other to the stream)"));
+
 namespace {
+/// raw_region_ostream - A raw_ostream writing to a region of memory of known
+/// size, which is at \p Offset in the file being written.
+class raw_region_ostream : public raw_ostream {
+  char *Start;
+  uint64_t Size;
+  uint64_t Offset;
+  uint64_t Pos;
+
+  virtual void write_impl(const char *Ptr, size_t Len) {
+    assert(Pos + Len <= Size && "Writing past the end of the region!");
+    memcpy(Start + Pos, Ptr, Len);
+    Pos += Len;
+  }
+
+  virtual uint64_t current_pos() const { return Offset + Pos; }
+
+public:
+  raw_region_ostream(char *Start, uint64_t Size, uint64_t Offset)
+    : Start(Start), Size(Size), Offset(Offset), Pos(0) {}
+
+  ~raw_region_ostream() {
+    flush();
+    assert(Pos == Size && "Region not completely written!");
+  }
+};
+
+/// ELFRegionWriter - The object writer through which the data of one part of
+/// the file is written when ELFObjectWriter writes the parts concurrently.
+class ELFRegionWriter : public MCObjectWriter {
+public:
+  ELFRegionWriter(raw_ostream &OS, bool IsLittleEndian)
+    : MCObjectWriter(OS, IsLittleEndian) {}
+
+  virtual void ExecutePostLayoutBinding(MCAssembler &Asm,
+                                        const MCAsmLayout &Layout) {
+    llvm_unreachable("Only used to write data!");
+  }
+  virtual void RecordRelocation(const MCAssembler &Asm,
+                                const MCAsmLayout &Layout,
+                                const MCFragment *Fragment,
+                                const MCFixup &Fixup, MCValue Target,
+                                uint64_t &FixedValue) {
+    llvm_unreachable("Only used to write data!");
+  }
+  virtual void WriteObject(MCAssembler &Asm, const MCAsmLayout &Layout) {
+    llvm_unreachable("Only used to write data!");
+  }
+};
+
 class ELFObjectWriter : public MCObjectWriter {
   protected:
 
@@ -55,9 +117,9 @@ class ELFObjectWriter : public MCObjectWriter {
     static uint64_t GetSectionAddressSize(const MCAsmLayout &Layout,
                                           const MCSectionData &SD);
 
-    void WriteDataSectionData(MCAssembler &Asm,
+    void WriteDataSectionData(MCObjectWriter &W, const MCAssembler &Asm,
                               const MCAsmLayout &Layout,
-                              const MCSectionELF &Section);
+                              const MCSectionData &SD);
 
     /*static bool isFixupKindX86RIPRel(unsigned Kind) {
       return Kind == X86::reloc_riprel_4byte ||
@@ -160,11 +222,11 @@ class ELFObjectWriter : public MCObjectWriter {
 
     virtual ~ELFObjectWriter();
 
-    void WriteWord(uint64_t W) {
+    void WriteWord(MCObjectWriter &W, uint64_t Value) {
       if (is64Bit())
-        Write64(W);
+        W.Write64(Value);
       else
-        Write32(W);
+        W.Write32(Value);
     }
 
     void StringLE16(char *buf, uint16_t Value) {
@@ -230,7 +292,7 @@ class ELFObjectWriter : public MCObjectWriter {
       F.getContents().append(&buf[0], &buf[8]);
     }
 
-    void WriteHeader(const MCAssembler &Asm,
+    void WriteHeader(MCObjectWriter &W, const MCAssembler &Asm,
                      uint64_t SectionDataSize,
                      unsigned NumberOfSections);
 
@@ -306,7 +368,8 @@ class ELFObjectWriter : public MCObjectWriter {
     virtual void ExecutePostLayoutBinding(MCAssembler &Asm,
                                           const MCAsmLayout &Layout);
 
-    void WriteSectionHeader(MCAssembler &Asm, const GroupMapTy &GroupMap,
+    void WriteSectionHeader(MCObjectWriter &W, MCAssembler &Asm,
+                            const GroupMapTy &GroupMap,
                             const MCAsmLayout &Layout,
                             const SectionIndexMapTy &SectionIndexMap,
                             const SectionOffsetMapTy &SectionOffsetMap);
@@ -314,7 +377,8 @@ class ELFObjectWriter : public MCObjectWriter {
     void ComputeSectionOrder(MCAssembler &Asm,
                              std::vector<const MCSectionELF*> &Sections);
 
-    void WriteSecHdrEntry(uint32_t Name, uint32_t Type, uint64_t Flags,
+    void WriteSecHdrEntry(MCObjectWriter &W,
+                          uint32_t Name, uint32_t Type, uint64_t Flags,
                           uint64_t Address, uint64_t Offset,
                           uint64_t Size, uint32_t Link, uint32_t Info,
                           uint64_t Alignment, uint64_t EntrySize);
@@ -331,7 +395,20 @@ class ELFObjectWriter : public MCObjectWriter {
                                            bool IsPCRel) const;
 
     virtual void WriteObject(MCAssembler &Asm, const MCAsmLayout &Layout);
-    void WriteSection(MCAssembler &Asm,
+
+    /// WriteObjectConcurrently - Write the object file whose layout has been
+    /// computed by WriteObject() into a buffer of its final size, the sections
+    /// on WriteThreads threads.
+    void WriteObjectConcurrently(MCAssembler &Asm, const MCAsmLayout &Layout,
+                             const std::vector<const MCSectionELF*> &Sections,
+                                 const GroupMapTy &GroupMap,
+                                 const SectionIndexMapTy &SectionIndexMap,
+                                 const SectionOffsetMapTy &SectionOffsetMap,
+                                 uint64_t SectionHeaderOffset,
+                                 unsigned NumSections, uint64_t FileSize);
+    static void WriteSectionsThread(void *Job);
+
+    void WriteSection(MCObjectWriter &W, MCAssembler &Asm,
                       const SectionIndexMapTy &SectionIndexMap,
                       uint32_t GroupSymbolIndex,
                       uint64_t Offset, uint64_t Size, uint64_t Alignment,
@@ -371,7 +448,7 @@ ELFObjectWriter::~ELFObjectWriter()
 {}
 
 // Emit the ELF header.
-void ELFObjectWriter::WriteHeader(const MCAssembler &Asm,
+void ELFObjectWriter::WriteHeader(MCObjectWriter &W, const MCAssembler &Asm,
                                   uint64_t SectionDataSize,
                                   unsigned NumberOfSections) {
   // ELF Header
@@ -382,56 +459,56 @@ void ELFObjectWriter::WriteHeader(const MCAssembler &Asm,
   // emitWord method behaves differently for ELF32 and ELF64, writing
   // 4 bytes in the former and 8 in the latter.
 
-  Write8(0x7f); // e_ident[EI_MAG0]
-  Write8('E');  // e_ident[EI_MAG1]
-  Write8('L');  // e_ident[EI_MAG2]
-  Write8('F');  // e_ident[EI_MAG3]
+  W.Write8(0x7f); // e_ident[EI_MAG0]
+  W.Write8('E');  // e_ident[EI_MAG1]
+  W.Write8('L');  // e_ident[EI_MAG2]
+  W.Write8('F');  // e_ident[EI_MAG3]
 
-  Write8(is64Bit() ? ELF::ELFCLASS64 : ELF::ELFCLASS32); // e_ident[EI_CLASS]
+  W.Write8(is64Bit() ? ELF::ELFCLASS64 : ELF::ELFCLASS32); // e_ident[EI_CLASS]
 
   // e_ident[EI_DATA]
-  Write8(isLittleEndian() ? ELF::ELFDATA2LSB : ELF::ELFDATA2MSB);
+  W.Write8(isLittleEndian() ? ELF::ELFDATA2LSB : ELF::ELFDATA2MSB);
 
-  Write8(ELF::EV_CURRENT);        // e_ident[EI_VERSION]
+  W.Write8(ELF::EV_CURRENT);        // e_ident[EI_VERSION]
   // e_ident[EI_OSABI]
-  Write8(TargetObjectWriter->getOSABI());
-  Write8(0);                  // e_ident[EI_ABIVERSION]
+  W.Write8(TargetObjectWriter->getOSABI());
+  W.Write8(0);                  // e_ident[EI_ABIVERSION]
 
-  WriteZeros(ELF::EI_NIDENT - ELF::EI_PAD);
+  W.WriteZeros(ELF::EI_NIDENT - ELF::EI_PAD);
 
-  Write16(ELF::ET_REL);             // e_type
+  W.Write16(ELF::ET_REL);             // e_type
 
-  Write16(TargetObjectWriter->getEMachine()); // e_machine = target
+  W.Write16(TargetObjectWriter->getEMachine()); // e_machine = target
 
-  Write32(ELF::EV_CURRENT);         // e_version
-  WriteWord(0);                    // e_entry, no entry point in .o file
-  WriteWord(0);                    // e_phoff, no program header for .o
-  WriteWord(SectionDataSize + (is64Bit() ? sizeof(ELF::Elf64_Ehdr) :
+  W.Write32(ELF::EV_CURRENT);         // e_version
+  WriteWord(W, 0);                    // e_entry, no entry point in .o file
+  WriteWord(W, 0);                    // e_phoff, no program header for .o
+  WriteWord(W, SectionDataSize + (is64Bit() ? sizeof(ELF::Elf64_Ehdr) :
             sizeof(ELF::Elf32_Ehdr)));  // e_shoff = sec hdr table off in bytes
 
   // e_flags = whatever the target wants
-  Write32(Asm.getELFHeaderEFlags());
+  W.Write32(Asm.getELFHeaderEFlags());
 
   // e_ehsize = ELF header size
-  Write16(is64Bit() ? sizeof(ELF::Elf64_Ehdr) : sizeof(ELF::Elf32_Ehdr));
+  W.Write16(is64Bit() ? sizeof(ELF::Elf64_Ehdr) : sizeof(ELF::Elf32_Ehdr));
 
-  Write16(0);                  // e_phentsize = prog header entry size
-  Write16(0);                  // e_phnum = # prog header entries = 0
+  W.Write16(0);                  // e_phentsize = prog header entry size
+  W.Write16(0);                  // e_phnum = # prog header entries = 0
 
   // e_shentsize = Section header entry size
-  Write16(is64Bit() ? sizeof(ELF::Elf64_Shdr) : sizeof(ELF::Elf32_Shdr));
+  W.Write16(is64Bit() ? sizeof(ELF::Elf64_Shdr) : sizeof(ELF::Elf32_Shdr));
 
   // e_shnum     = # of section header ents
   if (NumberOfSections >= ELF::SHN_LORESERVE)
-    Write16(ELF::SHN_UNDEF);
+    W.Write16(ELF::SHN_UNDEF);
   else
-    Write16(NumberOfSections);
+    W.Write16(NumberOfSections);
 
   // e_shstrndx  = Section # of '.shstrtab'
   if (ShstrtabIndex >= ELF::SHN_LORESERVE)
-    Write16(ELF::SHN_XINDEX);
+    W.Write16(ELF::SHN_XINDEX);
   else
-    Write16(ShstrtabIndex);
+    W.Write16(ShstrtabIndex);
 }
 
 void ELFObjectWriter::WriteSymbolEntry(MCDataFragment *SymtabF,
@@ -1034,22 +1111,23 @@ void ELFObjectWriter::WriteRelocations(MCAssembler &Asm, MCAsmLayout &Layout,
   }
 }
 
-void ELFObjectWriter::WriteSecHdrEntry(uint32_t Name, uint32_t Type,
+void ELFObjectWriter::WriteSecHdrEntry(MCObjectWriter &W,
+                                       uint32_t Name, uint32_t Type,
                                        uint64_t Flags, uint64_t Address,
                                        uint64_t Offset, uint64_t Size,
                                        uint32_t Link, uint32_t Info,
                                        uint64_t Alignment,
                                        uint64_t EntrySize) {
-  Write32(Name);        // sh_name: index into string table
-  Write32(Type);        // sh_type
-  WriteWord(Flags);     // sh_flags
-  WriteWord(Address);   // sh_addr
-  WriteWord(Offset);    // sh_offset
-  WriteWord(Size);      // sh_size
-  Write32(Link);        // sh_link
-  Write32(Info);        // sh_info
-  WriteWord(Alignment); // sh_addralign
-  WriteWord(EntrySize); // sh_entsize
+  W.Write32(Name);          // sh_name: index into string table
+  W.Write32(Type);          // sh_type
+  WriteWord(W, Flags);      // sh_flags
+  WriteWord(W, Address);    // sh_addr
+  WriteWord(W, Offset);     // sh_offset
+  WriteWord(W, Size);       // sh_size
+  W.Write32(Link);          // sh_link
+  W.Write32(Info);          // sh_info
+  WriteWord(W, Alignment);  // sh_addralign
+  WriteWord(W, EntrySize);  // sh_entsize
 }
 
 void ELFObjectWriter::WriteRelocationsFragment(const MCAssembler &Asm,
@@ -1267,7 +1345,7 @@ void ELFObjectWriter::CreateIndexedSections(MCAssembler &Asm,
   }
 }
 
-void ELFObjectWriter::WriteSection(MCAssembler &Asm,
+void ELFObjectWriter::WriteSection(MCObjectWriter &W, MCAssembler &Asm,
                                    const SectionIndexMapTy &SectionIndexMap,
                                    uint32_t GroupSymbolIndex,
                                    uint64_t Offset, uint64_t Size,
@@ -1356,7 +1434,7 @@ void ELFObjectWriter::WriteSection(MCAssembler &Asm,
     }
   }
 
-  WriteSecHdrEntry(SectionStringTableIndex[&Section], Section.getType(),
+  WriteSecHdrEntry(W, SectionStringTableIndex[&Section], Section.getType(),
                    Section.getFlags(), 0, Offset, Size, sh_link, sh_info,
                    Alignment, Section.getEntrySize());
 }
@@ -1391,27 +1469,27 @@ uint64_t ELFObjectWriter::GetSectionAddressSize(const MCAsmLayout &Layout,
   return Layout.getSectionAddressSize(&SD);
 }
 
-void ELFObjectWriter::WriteDataSectionData(MCAssembler &Asm,
+void ELFObjectWriter::WriteDataSectionData(MCObjectWriter &W,
+                                           const MCAssembler &Asm,
                                            const MCAsmLayout &Layout,
-                                           const MCSectionELF &Section) {
-  const MCSectionData &SD = Asm.getOrCreateSectionData(Section);
-
-  uint64_t Padding = OffsetToAlignment(OS.tell(), SD.getAlignment());
-  WriteZeros(Padding);
+                                           const MCSectionData &SD) {
+  uint64_t Padding = OffsetToAlignment(W.getStream().tell(),
+                                       SD.getAlignment());
+  W.WriteZeros(Padding);
 
   if (IsELFMetaDataSection(SD)) {
     for (MCSectionData::const_iterator i = SD.begin(), e = SD.end(); i != e;
          ++i) {
       const MCFragment &F = *i;
       assert(F.getKind() == MCFragment::FT_Data);
-      WriteBytes(cast<MCDataFragment>(F).getContents());
+      W.WriteBytes(cast<MCDataFragment>(F).getContents());
     }
   } else {
-    Asm.writeSectionData(&SD, Layout);
+    Asm.writeSectionData(&SD, Layout, W);
   }
 }
 
-void ELFObjectWriter::WriteSectionHeader(MCAssembler &Asm,
+void ELFObjectWriter::WriteSectionHeader(MCObjectWriter &W, MCAssembler &Asm,
                                          const GroupMapTy &GroupMap,
                                          const MCAsmLayout &Layout,
                                       const SectionIndexMapTy &SectionIndexMap,
@@ -1432,7 +1510,8 @@ void ELFObjectWriter::WriteSectionHeader(MCAssembler &Asm,
     NumSections >= ELF::SHN_LORESERVE ? NumSections : 0;
   uint32_t FirstSectionLink =
     ShstrtabIndex >= ELF::SHN_LORESERVE ? ShstrtabIndex : 0;
-  WriteSecHdrEntry(0, 0, 0, 0, 0, FirstSectionSize, FirstSectionLink, 0, 0, 0);
+  WriteSecHdrEntry(W, 0, 0, 0, 0, 0, FirstSectionSize, FirstSectionLink,
+                   0, 0, 0);
 
   for (unsigned i = 0; i < NumSections - 1; ++i) {
     const MCSectionELF &Section = *Sections[i];
@@ -1446,7 +1525,7 @@ void ELFObjectWriter::WriteSectionHeader(MCAssembler &Asm,
 
     uint64_t Size = GetSectionAddressSize(Layout, SD);
 
-    WriteSection(Asm, SectionIndexMap, GroupSymbolIndex,
+    WriteSection(W, Asm, SectionIndexMap, GroupSymbolIndex,
                  SectionOffsetMap.lookup(&Section), Size,
                  SD.getAlignment(), Section);
   }
@@ -1555,24 +1634,163 @@ void ELFObjectWriter::WriteObject(MCAssembler &Asm,
     FileOff += GetSectionFileSize(Layout, SD);
   }
 
+  if (WriteThreads) {
+    WriteObjectConcurrently(Asm, Layout, Sections, GroupMap, SectionIndexMap,
+                            SectionOffsetMap, SectionHeaderOffset,
+                            NumSections, FileOff);
+    return;
+  }
+
   // Write out the ELF header ...
-  WriteHeader(Asm, SectionHeaderOffset, NumSections + 1);
+  WriteHeader(*this, Asm, SectionHeaderOffset, NumSections + 1);
 
   // ... then the regular sections ...
   // + because of .shstrtab
   for (unsigned i = 0; i < NumRegularSections + 1; ++i)
-    WriteDataSectionData(Asm, Layout, *Sections[i]);
+    WriteDataSectionData(*this, Asm, Layout,
+                         Asm.getOrCreateSectionData(*Sections[i]));
 
   uint64_t Padding = OffsetToAlignment(OS.tell(), NaturalAlignment);
   WriteZeros(Padding);
 
   // ... then the section header table ...
-  WriteSectionHeader(Asm, GroupMap, Layout, SectionIndexMap,
+  WriteSectionHeader(*this, Asm, GroupMap, Layout, SectionIndexMap,
                      SectionOffsetMap);
 
   // ... and then the remaining sections ...
   for (unsigned i = NumRegularSections + 1; i < NumSections; ++i)
-    WriteDataSectionData(Asm, Layout, *Sections[i]);
+    WriteDataSectionData(*this, Asm, Layout,
+                         Asm.getOrCreateSectionData(*Sections[i]));
+}
+
+namespace {
+/// The sections written by one thread of WriteObjectConcurrently().
+struct SectionWriteJob {
+  ELFObjectWriter *Writer;
+  const MCAssembler *Asm;
+  const MCAsmLayout *Layout;
+  char *Buffer;
+  std::vector<std::pair<const MCSectionData*, uint64_t> > Sections;
+  uint64_t Size;
+};
+
+/// Orders the jobs of WriteObjectConcurrently() by the amount of data they
+/// write, most first.
+struct JobSizeGreater {
+  bool operator()(const SectionWriteJob *A, const SectionWriteJob *B) const {
+    return A->Size > B->Size;
+  }
+};
+}
+
+void ELFObjectWriter::WriteSectionsThread(void *Arg) {
+  SectionWriteJob &Job = *static_cast<SectionWriteJob*>(Arg);
+  for (unsigned i = 0, e = Job.Sections.size(); i != e; ++i) {
+    const MCSectionData &SD = *Job.Sections[i].first;
+    uint64_t Offset = Job.Sections[i].second;
+    raw_region_ostream Region(Job.Buffer + Offset,
+                              Job.Writer->GetSectionFileSize(*Job.Layout, SD),
+                              Offset);
+    ELFRegionWriter W(Region, Job.Writer->isLittleEndian());
+    Job.Writer->WriteDataSectionData(W, *Job.Asm, *Job.Layout, SD);
+  }
+}
+
+void ELFObjectWriter::WriteObjectConcurrently(MCAssembler &Asm,
+                                              const MCAsmLayout &Layout,
+                          const std::vector<const MCSectionELF*> &Sections,
+                                              const GroupMapTy &GroupMap,
+                                      const SectionIndexMapTy &SectionIndexMap,
+                                    const SectionOffsetMapTy &SectionOffsetMap,
+                                              uint64_t SectionHeaderOffset,
+                                              unsigned NumSections,
+                                              uint64_t FileSize) {
+  // The whole file is written into a buffer, which is a mapping of the file
+  // itself if we know which one it is and it can be mapped.  Anything not
+  // written, which is the padding between the sections, stays zero.
+  OwningPtr<FileOutputBuffer> FileBuffer;
+  std::vector<char> MemBuffer;
+  char *Buffer;
+  if (!getOutputFile().empty() &&
+      !FileOutputBuffer::create(getOutputFile(), FileSize, FileBuffer)) {
+    Buffer = reinterpret_cast<char*>(FileBuffer->getBufferStart());
+  } else {
+    FileBuffer.reset();
+    MemBuffer.resize(FileSize);
+    Buffer = &MemBuffer[0];
+  }
+
+  uint64_t HeaderSize = is64Bit() ? sizeof(ELF::Elf64_Ehdr) :
+                                    sizeof(ELF::Elf32_Ehdr);
+  uint64_t SectionHeaderEntrySize = is64Bit() ?
+    sizeof(ELF::Elf64_Shdr) : sizeof(ELF::Elf32_Shdr);
+
+  // The headers are written up front: the section header table updates the
+  // writer's maps, which the section writers don't touch.
+  {
+    raw_region_ostream Region(Buffer, HeaderSize, 0);
+    ELFRegionWriter W(Region, isLittleEndian());
+    WriteHeader(W, Asm, SectionHeaderOffset, NumSections + 1);
+  }
+  {
+    uint64_t Offset = HeaderSize + SectionHeaderOffset;
+    raw_region_ostream Region(Buffer + Offset,
+                              (NumSections + 1) * SectionHeaderEntrySize,
+                              Offset);
+    ELFRegionWriter W(Region, isLittleEndian());
+    WriteSectionHeader(W, Asm, GroupMap, Layout, SectionIndexMap,
+                       SectionOffsetMap);
+  }
+
+  // Spread the sections over the threads, the largest ones first, each going
+  // to the thread with the least to write so far.
+  std::vector<std::pair<uint64_t, const MCSectionData*> > BySize;
+  for (unsigned i = 0, e = Sections.size(); i != e; ++i) {
+    const MCSectionData &SD = Asm.getOrCreateSectionData(*Sections[i]);
+    if (uint64_t Size = GetSectionFileSize(Layout, SD))
+      BySize.push_back(std::make_pair(Size, &SD));
+  }
+  std::stable_sort(BySize.begin(), BySize.end(),
+                   std::greater<std::pair<uint64_t, const MCSectionData*> >());
+
+  unsigned NumJobs = std::min<size_t>(WriteThreads, BySize.size());
+  std::vector<SectionWriteJob> Jobs(NumJobs);
+  std::vector<SectionWriteJob*> Queue;
+  for (unsigned i = 0; i != NumJobs; ++i) {
+    SectionWriteJob &Job = Jobs[i];
+    Job.Writer = this;
+    Job.Asm = &Asm;
+    Job.Layout = &Layout;
+    Job.Buffer = Buffer;
+    Job.Size = 0;
+    Queue.push_back(&Job);
+  }
+  for (unsigned i = 0, e = BySize.size(); i != e; ++i) {
+    // The least loaded job is at the back of the queue.
+    SectionWriteJob *Job = Queue.back();
+    Queue.pop_back();
+    const MCSectionData *SD = BySize[i].second;
+    const MCSectionELF &Section =
+      static_cast<const MCSectionELF &>(SD->getSection());
+    Job->Sections.push_back(std::make_pair(SD,
+                                           SectionOffsetMap.lookup(&Section)));
+    Job->Size += BySize[i].first;
+    Queue.insert(std::upper_bound(Queue.begin(), Queue.end(), Job,
+                                  JobSizeGreater()), Job);
+  }
+
+  std::vector<void*> Args;
+  for (unsigned i = 0; i != NumJobs; ++i)
+    Args.push_back(&Jobs[i]);
+  llvm_execute_on_threads(WriteSectionsThread, Args);
+
+  if (FileBuffer) {
+    if (error_code EC = FileBuffer->commit())
+      report_fatal_error("can't write '" + getOutputFile() + "': " +
+                         EC.message());
+  } else {
+    OS.write(Buffer, FileSize);
+  }
 }
 
 bool
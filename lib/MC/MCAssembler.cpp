@@ -28,6 +28,7 @@
 #include "llvm/Support/LEB128.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 
 using namespace llvm;
 
@@ -113,7 +114,7 @@ void MCAsmLayout::ensureValid(const MCFragment *F) const {
 uint64_t MCAsmLayout::getFragmentOffset(const MCFragment *F) const {
   ensureValid(F);
   assert(F->Offset != ~UINT64_C(0) && "Address not set!");
-  return F->Offset;
+  return F->Offset + getPendingShift(F);
 }
 
 uint64_t MCAsmLayout::getSymbolOffset(const MCSymbolData *SD) const {
@@ -453,6 +454,8 @@ void MCAsmLayout::layoutFragment(MCFragment *F) {
   // isn't valid.
   assert((!Prev || isFragmentValid(Prev)) &&
          "Attempt to compute fragment before its predecessor!");
+  assert(!PendingShifts.count(F->getParent()) &&
+         "Attempt to compute fragment with pending offset changes!");
 
   ++stats::FragmentLayouts;
 
@@ -479,20 +482,128 @@ void MCAsmLayout::layoutFragment(MCFragment *F) {
   // The fragment's offset will point to after the padding, and its computed
   // size won't include the padding.
   //
-  if (Assembler.isBundlingEnabled() && F->hasInstructions()) {
-    assert(isa<MCEncodedFragment>(F) &&
-           "Only MCEncodedFragment implementations have instructions");
-    uint64_t FSize = Assembler.computeFragmentSize(*this, *F);
-
-    if (FSize > Assembler.getBundleAlignSize())
-      report_fatal_error("Fragment can't be larger than a bundle size");
-
-    uint64_t RequiredBundlePadding = computeBundlePadding(F, F->Offset, FSize);
-    if (RequiredBundlePadding > UINT8_MAX)
-      report_fatal_error("Padding cannot exceed 255 bytes");
-    F->setBundlePadding(static_cast<uint8_t>(RequiredBundlePadding));
-    F->Offset += RequiredBundlePadding;
+  if (Assembler.isBundlingEnabled() && F->hasInstructions())
+    F->Offset += computeFragmentBundlePadding(F, F->Offset);
+}
+
+uint64_t MCAsmLayout::computeFragmentBundlePadding(MCFragment *F,
+                                                   uint64_t FOffset) {
+  assert(isa<MCEncodedFragment>(F) &&
+         "Only MCEncodedFragment implementations have instructions");
+  uint64_t FSize = Assembler.computeFragmentSize(*this, *F);
+
+  if (FSize > Assembler.getBundleAlignSize())
+    report_fatal_error("Fragment can't be larger than a bundle size");
+
+  uint64_t RequiredBundlePadding = computeBundlePadding(F, FOffset, FSize);
+  if (RequiredBundlePadding > UINT8_MAX)
+    report_fatal_error("Padding cannot exceed 255 bytes");
+  F->setBundlePadding(static_cast<uint8_t>(RequiredBundlePadding));
+  return RequiredBundlePadding;
+}
+
+namespace {
+/// LayoutOrder - Compare fragments by layout order.
+struct LayoutOrder {
+  bool operator()(unsigned LHS, const MCFragment *RHS) const {
+    return LHS < RHS->getLayoutOrder();
+  }
+};
+}
+
+int64_t MCAsmLayout::getPendingShift(const MCFragment *F) const {
+  if (PendingShifts.empty())
+    return 0;
+  DenseMap<const MCSectionData*, std::vector<int64_t> >::const_iterator it =
+    PendingShifts.find(F->getParent());
+  if (it == PendingShifts.end())
+    return 0;
+
+  const std::vector<int64_t> &Tree = it->second;
+  int64_t Shift = 0;
+  for (unsigned i = F->getLayoutOrder() + 1; i; i &= i - 1)
+    Shift += Tree[i];
+  return Shift;
+}
+
+void MCAsmLayout::addPendingShift(const MCFragment *F, int64_t Delta) {
+  MCSectionData &SD = *F->getParent();
+  std::vector<int64_t> &Tree = PendingShifts[&SD];
+  if (Tree.empty())
+    Tree.resize(SD.getFragmentList().back().getLayoutOrder() + 2);
+  for (unsigned i = F->getLayoutOrder() + 1, e = Tree.size(); i < e;
+       i += i & (~i + 1))
+    Tree[i] += Delta;
+}
+
+void MCAsmLayout::applyPendingShifts() {
+  for (DenseMap<const MCSectionData*, std::vector<int64_t> >::iterator
+         it = PendingShifts.begin(), ie = PendingShifts.end(); it != ie; ++it) {
+    MCSectionData &SD = const_cast<MCSectionData&>(*it->first);
+    const std::vector<int64_t> &Tree = it->second;
+    for (MCSectionData::iterator F = SD.begin(), FE = SD.end(); F != FE; ++F)
+      for (unsigned i = F->getLayoutOrder() + 1; i; i &= i - 1)
+        F->Offset += Tree[i];
   }
+  PendingShifts.clear();
+}
+
+int64_t MCAsmLayout::relayoutFragment(MCFragment *F,
+                                      SmallVectorImpl<MCFragment*> &Moved) {
+  MCFragment *Prev = F->getPrevNode();
+  uint64_t Offset = 0;
+  if (Prev)
+    Offset = getFragmentOffset(Prev) +
+             getAssembler().computeFragmentSize(*this, *Prev);
+  if (Assembler.isBundlingEnabled() && F->hasInstructions())
+    Offset += computeFragmentBundlePadding(F, Offset);
+
+  int64_t Change = int64_t(Offset - getFragmentOffset(F));
+  if (Change) {
+    addPendingShift(F, Change);
+    Moved.push_back(Prev ? Prev : F);
+  }
+  return Change;
+}
+
+void MCAsmLayout::updateFragmentOffsets(MCFragment *Resized,
+                                        SmallVectorImpl<MCFragment*> &Moved) {
+  MCSectionData &SD = *Resized->getParent();
+  assert(LastValidFragment[&SD] == &SD.getFragmentList().back() &&
+         "Section was not laid out completely");
+
+  DenseMap<const MCSectionData*, std::vector<MCFragment*> >::iterator DI =
+    OffsetDependent.find(&SD);
+  if (DI == OffsetDependent.end()) {
+    DI = OffsetDependent.insert(std::make_pair(&SD,
+                                               std::vector<MCFragment*>())).first;
+    bool Bundling = Assembler.isBundlingEnabled();
+    for (MCSectionData::iterator F = SD.begin(), FE = SD.end(); F != FE; ++F) {
+      MCFragment *Prev = F->getPrevNode();
+      if ((Prev && (isa<MCAlignFragment>(Prev) || isa<MCOrgFragment>(Prev))) ||
+          (Bundling && F->hasInstructions()))
+        DI->second.push_back(F);
+    }
+  }
+  std::vector<MCFragment*> &Dependent = DI->second;
+
+  // Lay out again the resized fragment, whose bundle padding depends on its
+  // size, and the fragment after it.  Delta is how far the fragments after the
+  // last one laid out have moved; once it's zero the fragments that follow
+  // are where they were.
+  int64_t Delta = 0;
+  if (Assembler.isBundlingEnabled() && Resized->hasInstructions())
+    Delta += relayoutFragment(Resized, Moved);
+  MCFragment *Next = Resized->getNextNode();
+  if (!Next)
+    return;
+  Delta += relayoutFragment(Next, Moved);
+
+  for (std::vector<MCFragment*>::iterator
+         D = std::upper_bound(Dependent.begin(), Dependent.end(),
+                              Next->getLayoutOrder(), LayoutOrder()),
+         DE = Dependent.end(); D != DE && Delta; ++D)
+    Delta += relayoutFragment(*D, Moved);
 }
 
 /// \brief Write the contents of a fragment to the given object writer. Expects
@@ -502,10 +613,9 @@ static void writeFragmentContents(const MCFragment &F, MCObjectWriter *OW) {
   OW->WriteBytes(EF.getContents());
 }
 
-/// \brief Write the fragment \p F to the output file.
+/// \brief Write the fragment \p F to the output file through \p OW.
 static void writeFragment(const MCAssembler &Asm, const MCAsmLayout &Layout,
-                          const MCFragment &F) {
-  MCObjectWriter *OW = &Asm.getWriter();
+                          const MCFragment &F, MCObjectWriter *OW) {
 
   // FIXME: Embed in fragments instead?
   uint64_t FragmentSize = Asm.computeFragmentSize(Layout, F);
@@ -654,6 +764,12 @@ static void writeFragment(const MCAssembler &Asm, const MCAsmLayout &Layout,
 
 void MCAssembler::writeSectionData(const MCSectionData *SD,
                                    const MCAsmLayout &Layout) const {
+  writeSectionData(SD, Layout, getWriter());
+}
+
+void MCAssembler::writeSectionData(const MCSectionData *SD,
+                                   const MCAsmLayout &Layout,
+                                   MCObjectWriter &OW) const {
   // Ignore virtual sections.
   if (SD->getSection().isVirtualSection()) {
     assert(Layout.getSectionFileSize(SD) == 0 && "Invalid size for section!");
@@ -692,14 +808,14 @@ void MCAssembler::writeSectionData(const MCSectionData *SD,
     return;
   }
 
-  uint64_t Start = getWriter().getStream().tell();
+  uint64_t Start = OW.getStream().tell();
   (void)Start;
 
   for (MCSectionData::const_iterator it = SD->begin(), ie = SD->end();
        it != ie; ++it)
-    writeFragment(*this, Layout, *it);
+    writeFragment(*this, Layout, *it, &OW);
 
-  assert(getWriter().getStream().tell() - Start ==
+  assert(OW.getStream().tell() - Start ==
          Layout.getSectionAddressSize(SD));
 }
 
@@ -750,8 +866,7 @@ void MCAssembler::Finish() {
   }
 
   // Layout until everything fits.
-  while (layoutOnce(Layout))
-    continue;
+  relaxFragments(Layout);
 
   DEBUG_WITH_TYPE("mc-dump", {
       llvm::errs() << "assembler backend - post-relaxation\n--\n";
@@ -904,59 +1019,300 @@ bool MCAssembler::relaxDwarfCallFrameFragment(MCAsmLayout &Layout,
   return OldSize != Data.size();
 }
 
-bool MCAssembler::layoutSectionOnce(MCAsmLayout &Layout, MCSectionData &SD) {
-  // Holds the first fragment which needed relaxing during this layout. It will
-  // remain NULL if none were relaxed.
-  // When a fragment is relaxed, all the fragments following it should get
-  // invalidated because their offset is going to change.
-  MCFragment *FirstRelaxedFragment = NULL;
-
-  // Attempt to relax all the fragments in the section.
-  for (MCSectionData::iterator I = SD.begin(), IE = SD.end(); I != IE; ++I) {
-    // Check if this is a fragment that needs relaxation.
-    bool RelaxedFrag = false;
-    switch(I->getKind()) {
-    default:
-      break;
-    case MCFragment::FT_Relaxable:
-      assert(!getRelaxAll() &&
-             "Did not expect a MCRelaxableFragment in RelaxAll mode");
-      RelaxedFrag = relaxInstruction(Layout, *cast<MCRelaxableFragment>(I));
-      break;
-    case MCFragment::FT_Dwarf:
-      RelaxedFrag = relaxDwarfLineAddr(Layout,
-                                       *cast<MCDwarfLineAddrFragment>(I));
-      break;
-    case MCFragment::FT_DwarfFrame:
-      RelaxedFrag =
-        relaxDwarfCallFrameFragment(Layout,
-                                    *cast<MCDwarfCallFrameFragment>(I));
-      break;
-    case MCFragment::FT_LEB:
-      RelaxedFrag = relaxLEB(Layout, *cast<MCLEBFragment>(I));
-      break;
+bool MCAssembler::relaxFragment(MCAsmLayout &Layout, MCFragment &F) {
+  switch(F.getKind()) {
+  default:
+    return false;
+  case MCFragment::FT_Relaxable:
+    assert(!getRelaxAll() &&
+           "Did not expect a MCRelaxableFragment in RelaxAll mode");
+    return relaxInstruction(Layout, cast<MCRelaxableFragment>(F));
+  case MCFragment::FT_Dwarf:
+    return relaxDwarfLineAddr(Layout, cast<MCDwarfLineAddrFragment>(F));
+  case MCFragment::FT_DwarfFrame:
+    return relaxDwarfCallFrameFragment(Layout,
+                                       cast<MCDwarfCallFrameFragment>(F));
+  case MCFragment::FT_LEB:
+    return relaxLEB(Layout, cast<MCLEBFragment>(F));
+  }
+}
+
+/// MaxFragmentSpan - The largest number of fragments a relaxable fragment can
+/// depend on and still be tracked by the fragments it depends on.  The others
+/// are visited again after every change of the layout.
+static const unsigned MaxFragmentSpan = 256;
+
+namespace {
+/// FragmentSpan - A fragment whose size depends on the offsets of the
+/// fragments [Lo, Hi] of one section, and has to be relaxed again when the
+/// size of one of the fragments [Lo, Hi) changes.
+struct FragmentSpan {
+  unsigned Lo, Hi;
+  MCFragment *Frag;
+
+  FragmentSpan(unsigned lo, unsigned hi, MCFragment *F)
+    : Lo(lo), Hi(hi), Frag(F) {}
+
+  bool operator<(const FragmentSpan &RHS) const { return Lo < RHS.Lo; }
+};
+
+/// SectionSpans - The spans of the fragments that depend on one section,
+/// sorted by their first fragment.
+struct SectionSpans {
+  std::vector<FragmentSpan> Spans;
+
+  /// MaxLength - The length of the longest span, which bounds how far back
+  /// from a fragment the spans that contain it start.
+  unsigned MaxLength;
+
+  SectionSpans() : MaxLength(0) {}
+};
+
+/// FragmentDeps - The fragments that the value of an expression depends on.
+struct FragmentDeps {
+  const MCSectionData *Section;
+  unsigned Lo, Hi;
+
+  /// Net - The number of symbols added minus the number subtracted, for the
+  /// expression being walked.  If it isn't zero the value depends on where the
+  /// fragments are in the section, not only on how far apart they are.
+  int Net;
+
+  /// Absolute - Whether the value depends on where the fragments are.
+  bool Absolute;
+
+  FragmentDeps() : Section(0), Lo(~0U), Hi(0), Net(0), Absolute(false) {}
+
+  /// add - Add F with the given sign, or 0 if the value isn't linear in its
+  /// offset.  Returns false if F is in another section than the others.
+  bool add(const MCFragment *F, int Sign) {
+    if (Section && Section != F->getParent())
+      return false;
+    Section = F->getParent();
+    Lo = std::min(Lo, F->getLayoutOrder());
+    Hi = std::max(Hi, F->getLayoutOrder());
+    Net += Sign;
+    if (Sign == 0)
+      Absolute = true;
+    return true;
+  }
+};
+}
+
+/// addExprDeps - Add to Deps the fragments of the symbols referenced by E,
+/// with the sign they have in E.  Returns false if the value of E depends on
+/// the layout in some way that can't be tracked.
+static bool addExprDeps(const MCAssembler &Asm, const MCExpr *E, int Sign,
+                        unsigned Depth, FragmentDeps &Deps) {
+  switch (E->getKind()) {
+  case MCExpr::Target:
+    return false;
+
+  case MCExpr::Constant:
+    return true;
+
+  case MCExpr::SymbolRef: {
+    const MCSymbol &Sym = cast<MCSymbolRefExpr>(E)->getSymbol();
+    if (Sym.isVariable())
+      return Depth < 8 && addExprDeps(Asm, Sym.getVariableValue(), Sign,
+                                      Depth + 1, Deps);
+    // Undefined and absolute symbols don't move.
+    if (!Sym.isInSection())
+      return true;
+    const MCFragment *F = Asm.getSymbolData(Sym).getFragment();
+    return F && Deps.add(F, Sign);
+  }
+
+  case MCExpr::Unary: {
+    const MCUnaryExpr *UE = cast<MCUnaryExpr>(E);
+    int SubSign = 0;
+    if (UE->getOpcode() == MCUnaryExpr::Plus)
+      SubSign = Sign;
+    else if (UE->getOpcode() == MCUnaryExpr::Minus)
+      SubSign = -Sign;
+    return addExprDeps(Asm, UE->getSubExpr(), SubSign, Depth, Deps);
+  }
+
+  case MCExpr::Binary: {
+    const MCBinaryExpr *BE = cast<MCBinaryExpr>(E);
+    int LHSSign = 0, RHSSign = 0;
+    if (BE->getOpcode() == MCBinaryExpr::Add) {
+      LHSSign = RHSSign = Sign;
+    } else if (BE->getOpcode() == MCBinaryExpr::Sub) {
+      LHSSign = Sign;
+      RHSSign = -Sign;
     }
-    if (RelaxedFrag && !FirstRelaxedFragment)
-      FirstRelaxedFragment = I;
+    return addExprDeps(Asm, BE->getLHS(), LHSSign, Depth, Deps) &&
+           addExprDeps(Asm, BE->getRHS(), RHSSign, Depth, Deps);
+  }
   }
-  if (FirstRelaxedFragment) {
-    Layout.invalidateFragmentsFrom(FirstRelaxedFragment);
+  llvm_unreachable("Invalid assembly expression kind!");
+}
+
+/// addValueDeps - Add to Deps the fragments the value of E depends on.  If
+/// PCFrag is set, the value is relative to the start of that fragment.
+static bool addValueDeps(const MCAssembler &Asm, const MCExpr *E,
+                         const MCFragment *PCFrag, FragmentDeps &Deps) {
+  Deps.Net = 0;
+  if (!addExprDeps(Asm, E, 1, 0, Deps))
+    return false;
+  if (PCFrag && !Deps.add(PCFrag, -1))
+    return false;
+  if (Deps.Net != 0)
+    Deps.Absolute = true;
+  return true;
+}
+
+/// getFragmentDeps - Compute the fragments the size of the relaxable fragment
+/// F depends on.  Returns false if they can't be tracked.
+static bool getFragmentDeps(const MCAssembler &Asm, MCFragment &F,
+                            FragmentDeps &Deps) {
+  switch (F.getKind()) {
+  default:
+    llvm_unreachable("Not a relaxable fragment!");
+  case MCFragment::FT_Relaxable: {
+    MCRelaxableFragment &RF = cast<MCRelaxableFragment>(F);
+    for (MCRelaxableFragment::fixup_iterator it = RF.fixup_begin(),
+         ie = RF.fixup_end(); it != ie; ++it) {
+      const MCFixupKindInfo &Info =
+        Asm.getBackend().getFixupKindInfo(it->getKind());
+      const MCFragment *PCFrag =
+        (Info.Flags & MCFixupKindInfo::FKF_IsPCRel) ? &F : 0;
+      if (!addValueDeps(Asm, it->getValue(), PCFrag, Deps))
+        return false;
+      // An aligned down PC depends on where this fragment is.
+      if (Info.Flags & MCFixupKindInfo::FKF_IsAlignedDownTo32Bits)
+        Deps.Absolute = true;
+    }
     return true;
   }
-  return false;
+  case MCFragment::FT_Dwarf:
+    return addValueDeps(Asm, &cast<MCDwarfLineAddrFragment>(F).getAddrDelta(),
+                        0, Deps);
+  case MCFragment::FT_DwarfFrame:
+    return addValueDeps(Asm, &cast<MCDwarfCallFrameFragment>(F).getAddrDelta(),
+                        0, Deps);
+  case MCFragment::FT_LEB:
+    return addValueDeps(Asm, &cast<MCLEBFragment>(F).getValue(), 0, Deps);
+  }
 }
 
-bool MCAssembler::layoutOnce(MCAsmLayout &Layout) {
-  ++stats::RelaxationSteps;
+/// mayRelax - Return true if F may change size when it is relaxed again.
+static bool mayRelax(const MCAssembler &Asm, const MCFragment &F) {
+  switch (F.getKind()) {
+  default:
+    return false;
+  case MCFragment::FT_Relaxable:
+    return Asm.getBackend().mayNeedRelaxation(
+      cast<MCRelaxableFragment>(F).getInst());
+  case MCFragment::FT_Dwarf:
+  case MCFragment::FT_DwarfFrame:
+  case MCFragment::FT_LEB:
+    return true;
+  }
+}
 
-  bool WasRelaxed = false;
-  for (iterator it = begin(), ie = end(); it != ie; ++it) {
-    MCSectionData &SD = *it;
-    while (layoutSectionOnce(Layout, SD))
-      WasRelaxed = true;
+/// getLayoutKey - Return a key that orders fragments by section and then by
+/// offset.
+static uint64_t getLayoutKey(const MCFragment *F) {
+  return (uint64_t(F->getParent()->getLayoutOrder()) << 32) |
+         F->getLayoutOrder();
+}
+
+void MCAssembler::relaxFragments(MCAsmLayout &Layout) {
+  // Lay out every section, the offsets are then kept up to date as the
+  // fragments are resized.
+  for (unsigned i = 0, e = Layout.getSectionOrder().size(); i != e; ++i)
+    Layout.getFragmentOffset(&*Layout.getSectionOrder()[i]->rbegin());
+
+  // The relaxable fragments that depend on each section, and the ones whose
+  // dependencies aren't tracked.
+  DenseMap<const MCSectionData*, SectionSpans> Spans;
+  std::vector<MCFragment*> Untracked;
+
+  // Visit every relaxable fragment once, and find out what it depends on if it
+  // may still change.
+  // The offsets are updated as soon as a fragment is resized, so that the
+  // fragments after it are relaxed with their final offsets.
+  ++stats::RelaxationSteps;
+  std::vector<MCFragment*> Resized;
+  SmallVector<MCFragment*, 32> Moved;
+  for (unsigned i = 0, e = Layout.getSectionOrder().size(); i != e; ++i) {
+    MCSectionData &SD = *Layout.getSectionOrder()[i];
+    for (MCSectionData::iterator I = SD.begin(), IE = SD.end(); I != IE; ++I) {
+      if (!mayRelax(*this, *I))
+        continue;
+      if (relaxFragment(Layout, *I)) {
+        Layout.updateFragmentOffsets(I, Moved);
+        Resized.push_back(I);
+      }
+      if (!mayRelax(*this, *I))
+        continue;
+
+      FragmentDeps Deps;
+      if (!getFragmentDeps(*this, *I, Deps))
+        Untracked.push_back(I);
+      else if (Deps.Section) {
+        unsigned Lo = Deps.Absolute ? 0 : Deps.Lo;
+        if (Deps.Hi - Lo > MaxFragmentSpan) {
+          Untracked.push_back(I);
+          continue;
+        }
+        SectionSpans &SS = Spans[Deps.Section];
+        SS.Spans.push_back(FragmentSpan(Lo, Deps.Hi, I));
+        SS.MaxLength = std::max(SS.MaxLength, Deps.Hi - Lo);
+      }
+    }
+  }
+  for (DenseMap<const MCSectionData*, SectionSpans>::iterator
+         it = Spans.begin(), ie = Spans.end(); it != ie; ++it)
+    std::sort(it->second.Spans.begin(), it->second.Spans.end());
+
+  // The fragments to relax again, with their layout keys.
+  typedef std::pair<uint64_t, MCFragment*> WorkItem;
+  std::vector<WorkItem> Worklist;
+  while (!Moved.empty() || !Resized.empty()) {
+    // Revisit the fragments that depend on a fragment that moved, and the
+    // resized ones that may change again.
+    for (unsigned i = 0, e = Moved.size(); i != e; ++i) {
+      DenseMap<const MCSectionData*, SectionSpans>::iterator SI =
+        Spans.find(Moved[i]->getParent());
+      if (SI == Spans.end())
+        continue;
+      std::vector<FragmentSpan> &FS = SI->second.Spans;
+      unsigned Order = Moved[i]->getLayoutOrder();
+      unsigned MaxLength = SI->second.MaxLength;
+      unsigned First = Order >= MaxLength ? Order - MaxLength : 0;
+      for (std::vector<FragmentSpan>::iterator
+             it = std::lower_bound(FS.begin(), FS.end(),
+                                   FragmentSpan(First, First, 0)),
+             ie = FS.end(); it != ie && it->Lo <= Order; ++it)
+        if (Order < it->Hi)
+          Worklist.push_back(WorkItem(getLayoutKey(it->Frag), it->Frag));
+    }
+    for (unsigned i = 0, e = Resized.size(); i != e; ++i)
+      if (mayRelax(*this, *Resized[i]))
+        Worklist.push_back(WorkItem(getLayoutKey(Resized[i]), Resized[i]));
+    for (unsigned i = 0, e = Untracked.size(); i != e; ++i)
+      Worklist.push_back(WorkItem(getLayoutKey(Untracked[i]), Untracked[i]));
+
+    ++stats::RelaxationSteps;
+    std::sort(Worklist.begin(), Worklist.end());
+    Worklist.erase(std::unique(Worklist.begin(), Worklist.end()),
+                   Worklist.end());
+    Moved.clear();
+    Resized.clear();
+    for (unsigned i = 0, e = Worklist.size(); i != e; ++i) {
+      MCFragment *F = Worklist[i].second;
+      if (relaxFragment(Layout, *F)) {
+        Layout.updateFragmentOffsets(F, Moved);
+        Resized.push_back(F);
+      }
+    }
+    Worklist.clear();
   }
 
-  return WasRelaxed;
+  Layout.applyPendingShifts();
 }
 
 void MCAssembler::finishLayout(MCAsmLayout &Layout) {
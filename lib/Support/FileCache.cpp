@@ -0,0 +1,155 @@
+//===-- FileCache.cpp - Content addressed file cache ----------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the FileCache class.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/FileCache.h"
+#include "llvm/Support/FileOutputBuffer.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/LockFileManager.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/TimeValue.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+using namespace llvm;
+
+/// The prefix of the names of all cache entries.  Anything else in the cache
+/// directory, such as temporary files, is left alone by prune().
+static const char EntryPrefix[] = "llvmcache-";
+
+FileCache::Key &FileCache::Key::add(StringRef Data) {
+  add(uint64_t(Data.size()));
+  Hash.update(Data);
+  return *this;
+}
+
+FileCache::Key &FileCache::Key::add(uint64_t Value) {
+  uint8_t Bytes[8];
+  for (unsigned i = 0; i != 8; ++i)
+    Bytes[i] = uint8_t(Value >> (8 * i));
+  Hash.update(Bytes);
+  return *this;
+}
+
+std::string FileCache::Key::str() {
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Str;
+  MD5::stringifyResult(Result, Str);
+  return Str.str();
+}
+
+FileCache::FileCache(StringRef Dir, uint64_t MaxSize)
+  : Directory(Dir), MaxSize(MaxSize) {
+  bool Existed;
+  sys::fs::create_directories(Directory.str(), Existed);
+}
+
+void FileCache::getEntryPath(StringRef K, SmallVectorImpl<char> &Path) const {
+  Path.clear();
+  Path.append(Directory.begin(), Directory.end());
+  sys::path::append(Path, Twine(EntryPrefix) + K);
+}
+
+bool FileCache::lookup(StringRef K, OwningPtr<MemoryBuffer> &Result) {
+  SmallString<128> EntryPath;
+  getEntryPath(K, EntryPath);
+  if (MemoryBuffer::getFile(EntryPath.c_str(), Result, -1, false))
+    return false;
+
+  // Bump the modification time, which prune() uses to find the least
+  // recently used entries.  Failing to do so is harmless.
+  sys::PathWithStatus Entry(EntryPath.str());
+  if (const sys::FileStatus *Status = Entry.getFileStatus()) {
+    sys::FileStatus NewStatus = *Status;
+    NewStatus.modTime = sys::TimeValue::now();
+    Entry.setStatusInfoOnDisk(NewStatus);
+  }
+  return true;
+}
+
+error_code FileCache::store(StringRef K, StringRef Data) {
+  // A zero sized file cannot be mapped, and there is nothing to gain from
+  // caching empty results anyway.
+  if (Data.empty())
+    return error_code::success();
+
+  SmallString<128> EntryPath;
+  getEntryPath(K, EntryPath);
+
+  // FileOutputBuffer writes to a uniquely named file in the same directory
+  // and renames it over the entry on commit, so concurrent readers see either
+  // the old or the new contents.
+  OwningPtr<FileOutputBuffer> Buffer;
+  if (error_code EC = FileOutputBuffer::create(EntryPath.str(), Data.size(),
+                                               Buffer))
+    return EC;
+  memcpy(Buffer->getBufferStart(), Data.data(), Data.size());
+  return Buffer->commit();
+}
+
+namespace {
+struct CacheEntry {
+  sys::TimeValue Time;
+  uint64_t Size;
+  std::string Path;
+
+  bool operator<(const CacheEntry &RHS) const {
+    if (Time != RHS.Time)
+      return Time < RHS.Time;
+    return Path < RHS.Path;
+  }
+};
+}
+
+void FileCache::prune() {
+  if (MaxSize == 0)
+    return;
+
+  // Only one process needs to prune at a time.
+  SmallString<128> LockPath(Directory);
+  sys::path::append(LockPath, "llvmcache.prune");
+  LockFileManager Lock(LockPath.str());
+  if (Lock.getState() != LockFileManager::LFS_Owned)
+    return;
+
+  std::vector<CacheEntry> Entries;
+  uint64_t TotalSize = 0;
+  error_code EC;
+  for (sys::fs::directory_iterator I(Directory.str(), EC), E; I != E && !EC;
+       I.increment(EC)) {
+    StringRef Name = sys::path::filename(I->path());
+    if (!Name.startswith(EntryPrefix))
+      continue;
+    sys::PathWithStatus EntryPath(I->path());
+    const sys::FileStatus *Status = EntryPath.getFileStatus();
+    if (!Status || Status->isDir)
+      continue;
+    CacheEntry Entry;
+    Entry.Time = Status->getTimestamp();
+    Entry.Size = Status->getSize();
+    Entry.Path = I->path();
+    Entries.push_back(Entry);
+    TotalSize += Entry.Size;
+  }
+
+  // Evict the least recently used entries first.
+  std::sort(Entries.begin(), Entries.end());
+  for (unsigned i = 0, e = Entries.size(); i != e && TotalSize > MaxSize;
+       ++i) {
+    bool Existed;
+    if (!sys::fs::remove(Entries[i].Path, Existed))
+      TotalSize -= Entries[i].Size;
+  }
+}
@@ -0,0 +1,207 @@
+//===-- MD5.cpp - MD5 message digest algorithm ----------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the MD5 message digest algorithm as described in
+// RFC 1321.  The block function follows the structure of the well known
+// public domain implementation by Alexander Peslyak.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cstring>
+
+// The basic MD5 functions.  F and G are optimized compared to their RFC 1321
+// definitions.
+#define F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define G(x, y, z) ((y) ^ ((z) & ((x) ^ (y))))
+#define H(x, y, z) ((x) ^ (y) ^ (z))
+#define I(x, y, z) ((y) ^ ((x) | ~(z)))
+
+// The MD5 transformation for all four rounds.
+#define STEP(f, a, b, c, d, x, t, s)                                           \
+  (a) += f((b), (c), (d)) + (x) + (t);                                         \
+  (a) = (((a) << (s)) | (((a) & 0xffffffff) >> (32 - (s))));                   \
+  (a) += (b);
+
+// Read the I-th little endian 32-bit word of the current block.
+#define GET(i)                                                                 \
+  (Block[(i)] = (uint32_t)Ptr[(i) * 4] | ((uint32_t)Ptr[(i) * 4 + 1] << 8) |   \
+                ((uint32_t)Ptr[(i) * 4 + 2] << 16) |                           \
+                ((uint32_t)Ptr[(i) * 4 + 3] << 24))
+#define SET(i) (Block[(i)])
+
+using namespace llvm;
+
+MD5::MD5()
+  : A(0x67452301), B(0xefcdab89), C(0x98badcfe), D(0x10325476), Length(0) {
+}
+
+/// body - Process all complete 64 byte blocks in \p Data, which must be a
+/// multiple of 64 bytes long.  Returns a pointer past the last byte processed.
+const uint8_t *MD5::body(const uint8_t *Data, size_t Size) {
+  const uint8_t *Ptr = Data;
+  uint32_t Block[16];
+  uint32_t a = A, b = B, c = C, d = D;
+
+  do {
+    uint32_t SavedA = a, SavedB = b, SavedC = c, SavedD = d;
+
+    // Round 1
+    STEP(F, a, b, c, d, GET(0), 0xd76aa478, 7)
+    STEP(F, d, a, b, c, GET(1), 0xe8c7b756, 12)
+    STEP(F, c, d, a, b, GET(2), 0x242070db, 17)
+    STEP(F, b, c, d, a, GET(3), 0xc1bdceee, 22)
+    STEP(F, a, b, c, d, GET(4), 0xf57c0faf, 7)
+    STEP(F, d, a, b, c, GET(5), 0x4787c62a, 12)
+    STEP(F, c, d, a, b, GET(6), 0xa8304613, 17)
+    STEP(F, b, c, d, a, GET(7), 0xfd469501, 22)
+    STEP(F, a, b, c, d, GET(8), 0x698098d8, 7)
+    STEP(F, d, a, b, c, GET(9), 0x8b44f7af, 12)
+    STEP(F, c, d, a, b, GET(10), 0xffff5bb1, 17)
+    STEP(F, b, c, d, a, GET(11), 0x895cd7be, 22)
+    STEP(F, a, b, c, d, GET(12), 0x6b901122, 7)
+    STEP(F, d, a, b, c, GET(13), 0xfd987193, 12)
+    STEP(F, c, d, a, b, GET(14), 0xa679438e, 17)
+    STEP(F, b, c, d, a, GET(15), 0x49b40821, 22)
+
+    // Round 2
+    STEP(G, a, b, c, d, SET(1), 0xf61e2562, 5)
+    STEP(G, d, a, b, c, SET(6), 0xc040b340, 9)
+    STEP(G, c, d, a, b, SET(11), 0x265e5a51, 14)
+    STEP(G, b, c, d, a, SET(0), 0xe9b6c7aa, 20)
+    STEP(G, a, b, c, d, SET(5), 0xd62f105d, 5)
+    STEP(G, d, a, b, c, SET(10), 0x02441453, 9)
+    STEP(G, c, d, a, b, SET(15), 0xd8a1e681, 14)
+    STEP(G, b, c, d, a, SET(4), 0xe7d3fbc8, 20)
+    STEP(G, a, b, c, d, SET(9), 0x21e1cde6, 5)
+    STEP(G, d, a, b, c, SET(14), 0xc33707d6, 9)
+    STEP(G, c, d, a, b, SET(3), 0xf4d50d87, 14)
+    STEP(G, b, c, d, a, SET(8), 0x455a14ed, 20)
+    STEP(G, a, b, c, d, SET(13), 0xa9e3e905, 5)
+    STEP(G, d, a, b, c, SET(2), 0xfcefa3f8, 9)
+    STEP(G, c, d, a, b, SET(7), 0x676f02d9, 14)
+    STEP(G, b, c, d, a, SET(12), 0x8d2a4c8a, 20)
+
+    // Round 3
+    STEP(H, a, b, c, d, SET(5), 0xfffa3942, 4)
+    STEP(H, d, a, b, c, SET(8), 0x8771f681, 11)
+    STEP(H, c, d, a, b, SET(11), 0x6d9d6122, 16)
+    STEP(H, b, c, d, a, SET(14), 0xfde5380c, 23)
+    STEP(H, a, b, c, d, SET(1), 0xa4beea44, 4)
+    STEP(H, d, a, b, c, SET(4), 0x4bdecfa9, 11)
+    STEP(H, c, d, a, b, SET(7), 0xf6bb4b60, 16)
+    STEP(H, b, c, d, a, SET(10), 0xbebfbc70, 23)
+    STEP(H, a, b, c, d, SET(13), 0x289b7ec6, 4)
+    STEP(H, d, a, b, c, SET(0), 0xeaa127fa, 11)
+    STEP(H, c, d, a, b, SET(3), 0xd4ef3085, 16)
+    STEP(H, b, c, d, a, SET(6), 0x04881d05, 23)
+    STEP(H, a, b, c, d, SET(9), 0xd9d4d039, 4)
+    STEP(H, d, a, b, c, SET(12), 0xe6db99e5, 11)
+    STEP(H, c, d, a, b, SET(15), 0x1fa27cf8, 16)
+    STEP(H, b, c, d, a, SET(2), 0xc4ac5665, 23)
+
+    // Round 4
+    STEP(I, a, b, c, d, SET(0), 0xf4292244, 6)
+    STEP(I, d, a, b, c, SET(7), 0x432aff97, 10)
+    STEP(I, c, d, a, b, SET(14), 0xab9423a7, 15)
+    STEP(I, b, c, d, a, SET(5), 0xfc93a039, 21)
+    STEP(I, a, b, c, d, SET(12), 0x655b59c3, 6)
+    STEP(I, d, a, b, c, SET(3), 0x8f0ccc92, 10)
+    STEP(I, c, d, a, b, SET(10), 0xffeff47d, 15)
+    STEP(I, b, c, d, a, SET(1), 0x85845dd1, 21)
+    STEP(I, a, b, c, d, SET(8), 0x6fa87e4f, 6)
+    STEP(I, d, a, b, c, SET(15), 0xfe2ce6e0, 10)
+    STEP(I, c, d, a, b, SET(6), 0xa3014314, 15)
+    STEP(I, b, c, d, a, SET(13), 0x4e0811a1, 21)
+    STEP(I, a, b, c, d, SET(4), 0xf7537e82, 6)
+    STEP(I, d, a, b, c, SET(11), 0xbd3af235, 10)
+    STEP(I, c, d, a, b, SET(2), 0x2ad7d2bb, 15)
+    STEP(I, b, c, d, a, SET(9), 0xeb86d391, 21)
+
+    a += SavedA;
+    b += SavedB;
+    c += SavedC;
+    d += SavedD;
+
+    Ptr += 64;
+  } while (Size -= 64);
+
+  A = a;
+  B = b;
+  C = c;
+  D = d;
+
+  return Ptr;
+}
+
+void MD5::update(ArrayRef<uint8_t> Data) {
+  const uint8_t *Ptr = Data.data();
+  size_t Size = Data.size();
+
+  size_t Used = Length & 0x3f;
+  Length += Size;
+
+  // Complete a partially filled block first.
+  if (Used) {
+    size_t Free = 64 - Used;
+    if (Size < Free) {
+      memcpy(&Buffer[Used], Ptr, Size);
+      return;
+    }
+    memcpy(&Buffer[Used], Ptr, Free);
+    Ptr += Free;
+    Size -= Free;
+    body(Buffer, 64);
+  }
+
+  if (Size >= 64) {
+    Ptr = body(Ptr, Size & ~(size_t)0x3f);
+    Size &= 0x3f;
+  }
+
+  memcpy(Buffer, Ptr, Size);
+}
+
+void MD5::update(StringRef Str) {
+  update(ArrayRef<uint8_t>(reinterpret_cast<const uint8_t *>(Str.data()),
+                           Str.size()));
+}
+
+void MD5::final(MD5Result &Result) {
+  size_t Used = Length & 0x3f;
+  Buffer[Used++] = 0x80;
+
+  size_t Free = 64 - Used;
+  if (Free < 8) {
+    memset(&Buffer[Used], 0, Free);
+    body(Buffer, 64);
+    Used = 0;
+    Free = 64;
+  }
+  memset(&Buffer[Used], 0, Free - 8);
+
+  // Append the message length in bits, little endian.
+  uint64_t Bits = Length << 3;
+  for (unsigned i = 0; i != 8; ++i)
+    Buffer[56 + i] = uint8_t(Bits >> (8 * i));
+
+  body(Buffer, 64);
+
+  uint32_t Words[4] = { A, B, C, D };
+  for (unsigned i = 0; i != 16; ++i)
+    Result[i] = uint8_t(Words[i / 4] >> (8 * (i % 4)));
+}
+
+void MD5::stringifyResult(const MD5Result &Result, SmallString<32> &Str) {
+  raw_svector_ostream Res(Str);
+  for (unsigned i = 0; i != 16; ++i)
+    Res << format("%.2x", Result[i]);
+}
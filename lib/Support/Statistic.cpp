@@ -28,6 +28,7 @@
 #include "llvm/Support/Format.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Mutex.h"
+#include "llvm/Support/ThreadLocal.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cstring>
@@ -46,34 +47,141 @@ Enabled(
 
 
 namespace {
+/// StatisticShard - The counts one thread has added to the statistics, indexed
+/// by statistic ID.  Only the owning thread writes to a shard, without atomic
+/// operations; readers sum the shards up while holding StatLock.  Counts live
+/// in chunks that never move once allocated, so readers can look at a shard
+/// while its thread keeps bumping it.
+class StatisticShard {
+  enum { ChunkSize = 256, MaxChunks = 256 };
+  volatile sys::cas_flag *volatile Chunks[MaxChunks];
+
+public:
+  enum { MaxStatistics = ChunkSize * MaxChunks };
+
+  StatisticShard() {
+    for (unsigned i = 0; i != MaxChunks; ++i)
+      Chunks[i] = 0;
+  }
+
+  ~StatisticShard() {
+    for (unsigned i = 0; i != MaxChunks; ++i)
+      delete[] const_cast<sys::cas_flag*>(Chunks[i]);
+  }
+
+  /// getCount - Return the owning thread's count for statistic ID.
+  volatile sys::cas_flag &getCount(unsigned ID) {
+    unsigned ChunkNo = ID / ChunkSize;
+    if (!Chunks[ChunkNo]) {
+      volatile sys::cas_flag *Chunk = new sys::cas_flag[ChunkSize]();
+      // Make sure the zeroed chunk is visible before the pointer to it is.
+      sys::MemoryFence();
+      Chunks[ChunkNo] = Chunk;
+    }
+    return Chunks[ChunkNo][ID % ChunkSize];
+  }
+
+  /// readCount - Return the count for statistic ID from any thread.
+  sys::cas_flag readCount(unsigned ID) const {
+    const volatile sys::cas_flag *Chunk = Chunks[ID / ChunkSize];
+    return Chunk ? Chunk[ID % ChunkSize] : 0;
+  }
+
+  /// addTo - Add the counts to Other, which only the calling thread writes.
+  void addTo(StatisticShard &Other) const {
+    for (unsigned i = 0; i != MaxChunks; ++i) {
+      const volatile sys::cas_flag *Chunk = Chunks[i];
+      if (!Chunk)
+        continue;
+      for (unsigned j = 0; j != ChunkSize; ++j)
+        if (sys::cas_flag Count = Chunk[j]) {
+          volatile sys::cas_flag &OtherCount = Other.getCount(i*ChunkSize + j);
+          OtherCount = OtherCount + Count;
+        }
+    }
+  }
+};
+
 /// StatisticInfo - This class is used in a ManagedStatic so that it is created
 /// on demand (when the first statistic is bumped) and destroyed only when
 /// llvm_shutdown is called.  We print statistics from the destructor.
 class StatisticInfo {
   std::vector<const Statistic*> Stats;
+  /// Shards - The counts of the live threads.
+  std::vector<StatisticShard*> Shards;
+  /// Retired - The counts of the threads that have exited, which is only
+  /// written with StatLock held.
+  StatisticShard Retired;
+  sys::ThreadLocal<const StatisticShard> ThreadShard;
   friend void llvm::PrintStatistics();
   friend void llvm::PrintStatistics(raw_ostream &OS);
+  friend std::vector<StatisticValue> llvm::GetStatistics(bool);
+  friend void llvm::ResetStatistics(bool);
 public:
+  StatisticInfo();
   ~StatisticInfo();
 
-  void addStatistic(const Statistic *S) {
+  /// addStatistic - Give S its ID.  Called with StatLock held.
+  void addStatistic(Statistic *S) {
+    S->ID = Stats.size();
     Stats.push_back(S);
   }
+
+  /// getThreadShard - Return the calling thread's counts, creating them on
+  /// the thread's first bump.
+  StatisticShard &getThreadShard();
+
+  /// retireShard - Fold the counts of an exited thread into Retired and free
+  /// its shard.  Called with StatLock held.
+  void retireShard(StatisticShard *Shard) {
+    Shard->addTo(Retired);
+    Shards.erase(std::find(Shards.begin(), Shards.end(), Shard));
+    delete Shard;
+  }
+
+  /// sumShards - Return the sum of all threads' counts for statistic ID.
+  /// Called with StatLock held.
+  sys::cas_flag sumShards(unsigned ID) const {
+    if (ID >= StatisticShard::MaxStatistics)
+      return 0;
+    sys::cas_flag Sum = Retired.readCount(ID);
+    for (unsigned i = 0, e = Shards.size(); i != e; ++i)
+      Sum += Shards[i]->readCount(ID);
+    return Sum;
+  }
 };
 }
 
 static ManagedStatic<StatisticInfo> StatInfo;
 static ManagedStatic<sys::SmartMutex<true> > StatLock;
 
+/// retireThreadShard - Called on the exit of a thread that has bumped a
+/// statistic, so that readers only have to go over the live threads' shards.
+static void retireThreadShard(void *Shard) {
+  sys::SmartScopedLock<true> Writer(*StatLock);
+  StatInfo->retireShard(static_cast<StatisticShard*>(Shard));
+}
+
+StatisticInfo::StatisticInfo() : ThreadShard(retireThreadShard) {}
+
+StatisticShard &StatisticInfo::getThreadShard() {
+  StatisticShard *Shard = const_cast<StatisticShard*>(ThreadShard.get());
+  if (!Shard) {
+    Shard = new StatisticShard();
+    ThreadShard.set(Shard);
+    sys::SmartScopedLock<true> Writer(*StatLock);
+    Shards.push_back(Shard);
+  }
+  return *Shard;
+}
+
 /// RegisterStatistic - The first time a statistic is bumped, this method is
 /// called.
 void Statistic::RegisterStatistic() {
-  // If stats are enabled, inform StatInfo that this statistic should be
-  // printed.
+  // Give the statistic its ID, which indexes the per-thread counts.
   sys::SmartScopedLock<true> Writer(*StatLock);
   if (!Initialized) {
-    if (Enabled)
-      StatInfo->addStatistic(this);
+    StatInfo->addStatistic(this);
 
     TsanHappensBefore(this);
     sys::MemoryFence();
@@ -84,6 +192,44 @@ void Statistic::RegisterStatistic() {
   }
 }
 
+sys::cas_flag Statistic::getValue() const {
+  if (!Initialized)
+    return Value;
+  sys::SmartScopedLock<true> Reader(*StatLock);
+  return Value + StatInfo->sumShards(ID);
+}
+
+void Statistic::add(unsigned V) {
+  // Statistics beyond what a shard can hold share a single atomic counter.
+  if (ID >= StatisticShard::MaxStatistics) {
+    sys::AtomicAdd(&Value, V);
+    return;
+  }
+  volatile sys::cas_flag &Count = StatInfo->getThreadShard().getCount(ID);
+  Count = Count + V;
+}
+
+// The operations below work on the value summed over all threads.  Rather than
+// touch other threads' counts, they adjust Value so that the sum comes out
+// right.
+
+void Statistic::set(unsigned V) {
+  sys::SmartScopedLock<true> Writer(*StatLock);
+  Value = V - StatInfo->sumShards(ID);
+}
+
+void Statistic::multiply(unsigned V) {
+  sys::SmartScopedLock<true> Writer(*StatLock);
+  sys::cas_flag Counted = StatInfo->sumShards(ID);
+  Value = (Value + Counted) * V - Counted;
+}
+
+void Statistic::divide(unsigned V) {
+  sys::SmartScopedLock<true> Writer(*StatLock);
+  sys::cas_flag Counted = StatInfo->sumShards(ID);
+  Value = (Value + Counted) / V - Counted;
+}
+
 namespace {
 
 struct NameCompare {
@@ -94,6 +240,11 @@ struct NameCompare {
     // Secondary key is the description.
     return std::strcmp(LHS->getDesc(), RHS->getDesc()) < 0;
   }
+  bool operator()(const StatisticValue &LHS, const StatisticValue &RHS) const {
+    int Cmp = std::strcmp(LHS.Name, RHS.Name);
+    if (Cmp != 0) return Cmp < 0;
+    return std::strcmp(LHS.Desc, RHS.Desc) < 0;
+  }
 };
 
 }
@@ -101,6 +252,8 @@ struct NameCompare {
 // Print information when destroyed, iff command line option is specified.
 StatisticInfo::~StatisticInfo() {
   llvm::PrintStatistics();
+  for (unsigned i = 0, e = Shards.size(); i != e; ++i)
+    delete Shards[i];
 }
 
 void llvm::EnableStatistics() {
@@ -113,6 +266,7 @@ bool llvm::AreStatisticsEnabled() {
 
 void llvm::PrintStatistics(raw_ostream &OS) {
   StatisticInfo &Stats = *StatInfo;
+  sys::SmartScopedLock<true> Reader(*StatLock);
 
   // Figure out how long the biggest Value and Name fields are.
   unsigned MaxNameLen = 0, MaxValLen = 0;
@@ -148,7 +302,7 @@ void llvm::PrintStatistics() {
   StatisticInfo &Stats = *StatInfo;
 
   // Statistics not enabled?
-  if (Stats.Stats.empty()) return;
+  if (!Enabled || Stats.Stats.empty()) return;
 
   // Get the stream to write to.
   raw_ostream &OutStream = *CreateInfoOutputFile();
@@ -168,3 +322,51 @@ void llvm::PrintStatistics() {
   }
 #endif
 }
+
+std::vector<StatisticValue> llvm::GetStatistics(bool ThisThreadOnly) {
+  StatisticInfo &Stats = *StatInfo;
+  const StatisticShard *Shard = ThisThreadOnly ? Stats.ThreadShard.get() : 0;
+  sys::SmartScopedLock<true> Reader(*StatLock);
+
+  std::vector<StatisticValue> Values;
+  Values.reserve(Stats.Stats.size());
+  for (size_t i = 0, e = Stats.Stats.size(); i != e; ++i) {
+    const Statistic *S = Stats.Stats[i];
+    StatisticValue V;
+    V.Name = S->getName();
+    V.Desc = S->getDesc();
+    if (!ThisThreadOnly)
+      V.Value = S->getValue();
+    else if (Shard && S->ID < StatisticShard::MaxStatistics)
+      V.Value = Shard->readCount(S->ID);
+    else
+      V.Value = 0;
+    Values.push_back(V);
+  }
+  std::stable_sort(Values.begin(), Values.end(), NameCompare());
+  return Values;
+}
+
+void llvm::ResetStatistics(bool ThisThreadOnly) {
+  StatisticInfo &Stats = *StatInfo;
+  StatisticShard *Shard = ThisThreadOnly ?
+    const_cast<StatisticShard*>(Stats.ThreadShard.get()) : 0;
+  if (ThisThreadOnly && !Shard)
+    return;
+  sys::SmartScopedLock<true> Writer(*StatLock);
+
+  for (size_t i = 0, e = Stats.Stats.size(); i != e; ++i) {
+    Statistic *S = const_cast<Statistic*>(Stats.Stats[i]);
+    if (!ThisThreadOnly) {
+      // Make the sum over all threads come out as zero.
+      S->Value = -Stats.sumShards(S->ID);
+    } else if (S->ID < StatisticShard::MaxStatistics) {
+      // Move this thread's count into Value so the sum does not change.
+      sys::cas_flag Count = Shard->readCount(S->ID);
+      if (Count) {
+        sys::AtomicAdd(&S->Value, Count);
+        Shard->getCount(S->ID) = 0;
+      }
+    }
+  }
+}
@@ -16,6 +16,7 @@
 #include "llvm/Support/Atomic.h"
 #include "llvm/Support/Mutex.h"
 #include <cassert>
+#include <vector>
 
 using namespace llvm;
 
@@ -102,6 +103,79 @@ void llvm::llvm_execute_on_thread(void (*Fn)(void*), void *UserData,
  error:
   ::pthread_attr_destroy(&Attr);
 }
+
+void llvm::llvm_execute_on_threads(void (*Fn)(void*), ArrayRef<void*> UserData,
+                                   unsigned RequestedStackSize) {
+  std::vector<ThreadInfo> Infos(UserData.size());
+  std::vector<pthread_t> Threads(UserData.size());
+  std::vector<bool> Started(UserData.size(), false);
+  pthread_attr_t Attr;
+
+  // Construct the attributes object.  If that fails, or the requested stack
+  // size cannot be honored, fall back to running everything on this thread.
+  bool HaveAttr = ::pthread_attr_init(&Attr) == 0;
+  if (HaveAttr && RequestedStackSize != 0 &&
+      ::pthread_attr_setstacksize(&Attr, RequestedStackSize) != 0) {
+    ::pthread_attr_destroy(&Attr);
+    HaveAttr = false;
+  }
+
+  for (unsigned i = 0, e = UserData.size(); i != e; ++i) {
+    Infos[i].UserFn = Fn;
+    Infos[i].UserData = UserData[i];
+    if (HaveAttr)
+      Started[i] = ::pthread_create(&Threads[i], &Attr,
+                                    ExecuteOnThread_Dispatch, &Infos[i]) == 0;
+  }
+
+  // Run whatever could not be started on the calling thread, then wait for
+  // the others.
+  for (unsigned i = 0, e = UserData.size(); i != e; ++i)
+    if (!Started[i])
+      Fn(UserData[i]);
+  for (unsigned i = 0, e = UserData.size(); i != e; ++i)
+    if (Started[i])
+      ::pthread_join(Threads[i], 0);
+
+  if (HaveAttr)
+    ::pthread_attr_destroy(&Attr);
+}
+
+namespace {
+struct AsyncThread {
+  ThreadInfo Info;
+  pthread_t Thread;
+};
+}
+
+void *llvm::llvm_start_thread(void (*Fn)(void*), void *UserData,
+                              unsigned RequestedStackSize) {
+  pthread_attr_t Attr;
+  if (::pthread_attr_init(&Attr) != 0)
+    return 0;
+
+  AsyncThread *T = new AsyncThread;
+  T->Info.UserFn = Fn;
+  T->Info.UserData = UserData;
+  bool Started =
+    (RequestedStackSize == 0 ||
+     ::pthread_attr_setstacksize(&Attr, RequestedStackSize) == 0) &&
+    ::pthread_create(&T->Thread, &Attr, ExecuteOnThread_Dispatch,
+                     &T->Info) == 0;
+  ::pthread_attr_destroy(&Attr);
+
+  if (!Started) {
+    delete T;
+    return 0;
+  }
+  return T;
+}
+
+void llvm::llvm_join_thread(void *Thread) {
+  AsyncThread *T = static_cast<AsyncThread*>(Thread);
+  ::pthread_join(T->Thread, 0);
+  delete T;
+}
 #elif LLVM_ENABLE_THREADS!=0 && defined(LLVM_ON_WIN32)
 #include "Windows/Windows.h"
 #include <process.h>
@@ -136,6 +210,59 @@ void llvm::llvm_execute_on_thread(void (*Fn)(void*), void *UserData,
     ::CloseHandle(hThread);
   }
 }
+
+void llvm::llvm_execute_on_threads(void (*Fn)(void*), ArrayRef<void*> UserData,
+                                   unsigned RequestedStackSize) {
+  std::vector<ThreadInfo> Params(UserData.size());
+  std::vector<HANDLE> Threads(UserData.size());
+
+  for (unsigned i = 0, e = UserData.size(); i != e; ++i) {
+    Params[i].func = Fn;
+    Params[i].param = UserData[i];
+    Threads[i] = (HANDLE)::_beginthreadex(NULL, RequestedStackSize,
+                                          ThreadCallback, &Params[i], 0, NULL);
+  }
+
+  // Run whatever could not be started on the calling thread, then wait for
+  // the others.
+  for (unsigned i = 0, e = UserData.size(); i != e; ++i)
+    if (!Threads[i])
+      Fn(UserData[i]);
+  for (unsigned i = 0, e = UserData.size(); i != e; ++i) {
+    if (!Threads[i])
+      continue;
+    (void)::WaitForSingleObject(Threads[i], INFINITE);
+    ::CloseHandle(Threads[i]);
+  }
+}
+
+namespace {
+struct AsyncThread {
+  ThreadInfo Info;
+  HANDLE Thread;
+};
+}
+
+void *llvm::llvm_start_thread(void (*Fn)(void*), void *UserData,
+                              unsigned RequestedStackSize) {
+  AsyncThread *T = new AsyncThread;
+  T->Info.func = Fn;
+  T->Info.param = UserData;
+  T->Thread = (HANDLE)::_beginthreadex(NULL, RequestedStackSize,
+                                       ThreadCallback, &T->Info, 0, NULL);
+  if (!T->Thread) {
+    delete T;
+    return 0;
+  }
+  return T;
+}
+
+void llvm::llvm_join_thread(void *Thread) {
+  AsyncThread *T = static_cast<AsyncThread*>(Thread);
+  (void)::WaitForSingleObject(T->Thread, INFINITE);
+  ::CloseHandle(T->Thread);
+  delete T;
+}
 #else
 // Support for non-Win32, non-pthread implementation.
 void llvm::llvm_execute_on_thread(void (*Fn)(void*), void *UserData,
@@ -144,4 +271,23 @@ void llvm::llvm_execute_on_thread(void (*Fn)(void*), void *UserData,
   Fn(UserData);
 }
 
+void llvm::llvm_execute_on_threads(void (*Fn)(void*), ArrayRef<void*> UserData,
+                                   unsigned RequestedStackSize) {
+  (void) RequestedStackSize;
+  for (unsigned i = 0, e = UserData.size(); i != e; ++i)
+    Fn(UserData[i]);
+}
+
+void *llvm::llvm_start_thread(void (*Fn)(void*), void *UserData,
+                              unsigned RequestedStackSize) {
+  (void) Fn;
+  (void) UserData;
+  (void) RequestedStackSize;
+  return 0;
+}
+
+void llvm::llvm_join_thread(void *Thread) {
+  assert(!Thread && "No threads can have been started!");
+}
+
 #endif
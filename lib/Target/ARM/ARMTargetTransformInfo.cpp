@@ -125,6 +125,12 @@ public:
   unsigned getVectorInstrCost(unsigned Opcode, Type *Val, unsigned Index) const;
 
   unsigned getAddressComputationCost(Type *Val) const;
+
+  unsigned getInterleavedMemoryOpCost(unsigned Opcode, Type *VecTy,
+                                      unsigned Factor,
+                                      ArrayRef<unsigned> Indices,
+                                      unsigned Alignment,
+                                      unsigned AddressSpace) const;
   /// @}
 };
 
@@ -410,3 +416,22 @@ unsigned ARMTTI::getShuffleCost(ShuffleKind Kind, Type *Tp, int Index,
 
   return LT.first * NEONShuffleTbl[Idx].Cost;
 }
+
+unsigned ARMTTI::getInterleavedMemoryOpCost(unsigned Opcode, Type *VecTy,
+                                            unsigned Factor,
+                                            ArrayRef<unsigned> Indices,
+                                            unsigned Alignment,
+                                            unsigned AddressSpace) const {
+  // A group of two members is split (or merged) by a vuzp (or vzip) per pair
+  // of registers, which gives both members at once.
+  unsigned EltSize = VecTy->getScalarSizeInBits();
+  if (!ST->hasNEON() || Factor != 2 ||
+      (EltSize != 8 && EltSize != 16 && EltSize != 32))
+    return TargetTransformInfo::getInterleavedMemoryOpCost(Opcode, VecTy,
+                                                           Factor, Indices,
+                                                           Alignment,
+                                                           AddressSpace);
+
+  std::pair<unsigned, MVT> LT = TLI->getTypeLegalizationCost(VecTy);
+  return getMemoryOpCost(Opcode, VecTy, Alignment, AddressSpace) + LT.first;
+}
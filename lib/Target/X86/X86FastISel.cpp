@@ -82,10 +82,13 @@ public:
 private:
   bool X86FastEmitCompare(const Value *LHS, const Value *RHS, EVT VT);
 
-  bool X86FastEmitLoad(EVT VT, const X86AddressMode &AM, unsigned &RR);
+  bool X86FastEmitLoad(EVT VT, const X86AddressMode &AM, unsigned &RR,
+                       unsigned Alignment = 0);
 
-  bool X86FastEmitStore(EVT VT, const Value *Val, const X86AddressMode &AM);
-  bool X86FastEmitStore(EVT VT, unsigned Val, const X86AddressMode &AM);
+  bool X86FastEmitStore(EVT VT, const Value *Val, const X86AddressMode &AM,
+                        unsigned Alignment = 0);
+  bool X86FastEmitStore(EVT VT, unsigned Val, const X86AddressMode &AM,
+                        unsigned Alignment = 0);
 
   bool X86FastEmitExtend(ISD::NodeType Opc, EVT DstVT, unsigned Src, EVT SrcVT,
                          unsigned &ResultReg);
@@ -109,6 +112,8 @@ private:
 
   bool X86SelectSelect(const Instruction *I);
 
+  bool X86SelectVectorLogic(const Instruction *I);
+
   bool X86SelectTrunc(const Instruction *I);
 
   bool X86SelectFPExt(const Instruction *I);
@@ -145,6 +150,10 @@ private:
 
   bool TryEmitSmallMemcpy(X86AddressMode DestAM,
                           X86AddressMode SrcAM, uint64_t Len);
+
+  bool TryEmitSmallMemset(X86AddressMode DestAM, uint8_t Val, uint64_t Len);
+
+  bool X86EmitRepMovs(X86AddressMode DestAM, unsigned SrcReg, uint64_t Len);
 };
 
 } // end anonymous namespace.
@@ -176,12 +185,15 @@ bool X86FastISel::isTypeLegal(Type *Ty, MVT &VT, bool AllowI1) {
 
 /// X86FastEmitLoad - Emit a machine instruction to load a value of type VT.
 /// The address is either pre-computed, i.e. Ptr, or a GlobalAddress, i.e. GV.
-/// Return true and the result register by reference if it is possible.
+/// A non-zero Alignment below 16 selects the unaligned forms of the vector
+/// loads.  Return true and the result register by reference if it is possible.
 bool X86FastISel::X86FastEmitLoad(EVT VT, const X86AddressMode &AM,
-                                  unsigned &ResultReg) {
+                                  unsigned &ResultReg, unsigned Alignment) {
   // Get opcode and regclass of the output for the given load instruction.
   unsigned Opc = 0;
   const TargetRegisterClass *RC = NULL;
+  bool HasAVX = Subtarget->hasAVX();
+  bool IsAligned = Alignment == 0 || Alignment >= 16;
   switch (VT.getSimpleVT().SimpleTy) {
   default: return false;
   case MVT::i1:
@@ -223,6 +235,30 @@ bool X86FastISel::X86FastEmitLoad(EVT VT, const X86AddressMode &AM,
   case MVT::f80:
     // No f80 support yet.
     return false;
+  case MVT::v4f32:
+    if (IsAligned)
+      Opc = HasAVX ? X86::VMOVAPSrm : X86::MOVAPSrm;
+    else
+      Opc = HasAVX ? X86::VMOVUPSrm : X86::MOVUPSrm;
+    RC  = &X86::VR128RegClass;
+    break;
+  case MVT::v2f64:
+    if (IsAligned)
+      Opc = HasAVX ? X86::VMOVAPDrm : X86::MOVAPDrm;
+    else
+      Opc = HasAVX ? X86::VMOVUPDrm : X86::MOVUPDrm;
+    RC  = &X86::VR128RegClass;
+    break;
+  case MVT::v4i32:
+  case MVT::v2i64:
+  case MVT::v8i16:
+  case MVT::v16i8:
+    if (IsAligned)
+      Opc = HasAVX ? X86::VMOVDQArm : X86::MOVDQArm;
+    else
+      Opc = HasAVX ? X86::VMOVDQUrm : X86::MOVDQUrm;
+    RC  = &X86::VR128RegClass;
+    break;
   }
 
   ResultReg = createResultReg(RC);
@@ -234,11 +270,15 @@ bool X86FastISel::X86FastEmitLoad(EVT VT, const X86AddressMode &AM,
 /// X86FastEmitStore - Emit a machine instruction to store a value Val of
 /// type VT. The address is either pre-computed, consisted of a base ptr, Ptr
 /// and a displacement offset, or a GlobalAddress,
-/// i.e. V. Return true if it is possible.
+/// i.e. V. A non-zero Alignment below 16 selects the unaligned forms of the
+/// vector stores. Return true if it is possible.
 bool
-X86FastISel::X86FastEmitStore(EVT VT, unsigned Val, const X86AddressMode &AM) {
+X86FastISel::X86FastEmitStore(EVT VT, unsigned Val, const X86AddressMode &AM,
+                              unsigned Alignment) {
   // Get opcode and regclass of the output for the given store instruction.
   unsigned Opc = 0;
+  bool HasAVX = Subtarget->hasAVX();
+  bool IsAligned = Alignment == 0 || Alignment >= 16;
   switch (VT.getSimpleVT().SimpleTy) {
   case MVT::f80: // No f80 support yet.
   default: return false;
@@ -263,16 +303,25 @@ X86FastISel::X86FastEmitStore(EVT VT, unsigned Val, const X86AddressMode &AM) {
           (Subtarget->hasAVX() ? X86::VMOVSDmr : X86::MOVSDmr) : X86::ST_Fp64m;
     break;
   case MVT::v4f32:
-    Opc = X86::MOVAPSmr;
+    if (IsAligned)
+      Opc = HasAVX ? X86::VMOVAPSmr : X86::MOVAPSmr;
+    else
+      Opc = HasAVX ? X86::VMOVUPSmr : X86::MOVUPSmr;
     break;
   case MVT::v2f64:
-    Opc = X86::MOVAPDmr;
+    if (IsAligned)
+      Opc = HasAVX ? X86::VMOVAPDmr : X86::MOVAPDmr;
+    else
+      Opc = HasAVX ? X86::VMOVUPDmr : X86::MOVUPDmr;
     break;
   case MVT::v4i32:
   case MVT::v2i64:
   case MVT::v8i16:
   case MVT::v16i8:
-    Opc = X86::MOVDQAmr;
+    if (IsAligned)
+      Opc = HasAVX ? X86::VMOVDQAmr : X86::MOVDQAmr;
+    else
+      Opc = HasAVX ? X86::VMOVDQUmr : X86::MOVDQUmr;
     break;
   }
 
@@ -282,7 +331,8 @@ X86FastISel::X86FastEmitStore(EVT VT, unsigned Val, const X86AddressMode &AM) {
 }
 
 bool X86FastISel::X86FastEmitStore(EVT VT, const Value *Val,
-                                   const X86AddressMode &AM) {
+                                   const X86AddressMode &AM,
+                                   unsigned Alignment) {
   // Handle 'null' like i32/i64 0.
   if (isa<ConstantPointerNull>(Val))
     Val = Constant::getNullValue(TD.getIntPtrType(Val->getContext()));
@@ -317,7 +367,7 @@ bool X86FastISel::X86FastEmitStore(EVT VT, const Value *Val,
   if (ValReg == 0)
     return false;
 
-  return X86FastEmitStore(VT, ValReg, AM);
+  return X86FastEmitStore(VT, ValReg, AM, Alignment);
 }
 
 /// X86FastEmitExtend - Emit a machine instruction to extend a value Src of
@@ -691,20 +741,22 @@ bool X86FastISel::X86SelectStore(const Instruction *I) {
   if (S->isAtomic())
     return false;
 
-  unsigned SABIAlignment =
-    TD.getABITypeAlignment(S->getValueOperand()->getType());
-  if (S->getAlignment() != 0 && S->getAlignment() < SABIAlignment)
-    return false;
-
   MVT VT;
   if (!isTypeLegal(I->getOperand(0)->getType(), VT, /*AllowI1=*/true))
     return false;
 
+  // Under-aligned vector stores use the unaligned moves.
+  unsigned SABIAlignment =
+    TD.getABITypeAlignment(S->getValueOperand()->getType());
+  if (S->getAlignment() != 0 && S->getAlignment() < SABIAlignment &&
+      !VT.isVector())
+    return false;
+
   X86AddressMode AM;
   if (!X86SelectAddress(I->getOperand(1), AM))
     return false;
 
-  return X86FastEmitStore(VT, I->getOperand(0), AM);
+  return X86FastEmitStore(VT, I->getOperand(0), AM, S->getAlignment());
 }
 
 /// X86SelectRet - Select and emit code to implement ret instructions.
@@ -838,7 +890,8 @@ bool X86FastISel::X86SelectRet(const Instruction *I) {
 ///
 bool X86FastISel::X86SelectLoad(const Instruction *I)  {
   // Atomic loads need special handling.
-  if (cast<LoadInst>(I)->isAtomic())
+  const LoadInst *LI = cast<LoadInst>(I);
+  if (LI->isAtomic())
     return false;
 
   MVT VT;
@@ -850,7 +903,7 @@ bool X86FastISel::X86SelectLoad(const Instruction *I)  {
     return false;
 
   unsigned ResultReg = 0;
-  if (X86FastEmitLoad(VT, AM, ResultReg)) {
+  if (X86FastEmitLoad(VT, AM, ResultReg, LI->getAlignment())) {
     UpdateValueMap(I, ResultReg);
     return true;
   }
@@ -1241,9 +1294,21 @@ bool X86FastISel::X86SelectSelect(const Instruction *I) {
   // We only use cmov here, if we don't have a cmov instruction bail.
   if (!Subtarget->hasCMov()) return false;
 
+  // Scalar SSE values are selected in general purpose registers: their bits
+  // are moved over with movd/movq, which need SSE2, selected with a cmov and
+  // moved back.
+  MVT IntVT = MVT::INVALID_SIMPLE_VALUE_TYPE;
+  if (VT == MVT::f32 && Subtarget->hasSSE2())
+    IntVT = MVT::i32;
+  else if (VT == MVT::f64 && Subtarget->hasSSE2() && Subtarget->is64Bit())
+    IntVT = MVT::i64;
+
   unsigned Opc = 0;
   const TargetRegisterClass *RC = NULL;
-  if (VT == MVT::i16) {
+  if (IntVT != MVT::INVALID_SIMPLE_VALUE_TYPE) {
+    Opc = IntVT == MVT::i32 ? X86::CMOVE32rr : X86::CMOVE64rr;
+    RC = TLI.getRegClassFor(IntVT);
+  } else if (VT == MVT::i16) {
     Opc = X86::CMOVE16rr;
     RC = &X86::GR16RegClass;
   } else if (VT == MVT::i32) {
@@ -1263,11 +1328,53 @@ bool X86FastISel::X86SelectSelect(const Instruction *I) {
   unsigned Op2Reg = getRegForValue(I->getOperand(2));
   if (Op2Reg == 0) return false;
 
+  if (IntVT != MVT::INVALID_SIMPLE_VALUE_TYPE) {
+    Op1Reg = FastEmit_r(VT, IntVT, ISD::BITCAST, Op1Reg, /*Kill=*/false);
+    Op2Reg = FastEmit_r(VT, IntVT, ISD::BITCAST, Op2Reg, /*Kill=*/false);
+    if (Op1Reg == 0 || Op2Reg == 0) return false;
+  }
+
   BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL, TII.get(X86::TEST8rr))
     .addReg(Op0Reg).addReg(Op0Reg);
   unsigned ResultReg = createResultReg(RC);
   BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL, TII.get(Opc), ResultReg)
     .addReg(Op1Reg).addReg(Op2Reg);
+
+  if (IntVT != MVT::INVALID_SIMPLE_VALUE_TYPE) {
+    ResultReg = FastEmit_r(IntVT, VT, ISD::BITCAST, ResultReg, /*Kill=*/true);
+    if (ResultReg == 0) return false;
+  }
+  UpdateValueMap(I, ResultReg);
+  return true;
+}
+
+/// X86SelectVectorLogic - Select and, or and xor of 128-bit integer vectors.
+/// SelectionDAG promotes them to v2i64, so the generated FastEmit functions
+/// only handle that type.
+bool X86FastISel::X86SelectVectorLogic(const Instruction *I) {
+  MVT VT;
+  if (!isTypeLegal(I->getType(), VT))
+    return false;
+  if (VT != MVT::v4i32 && VT != MVT::v8i16 && VT != MVT::v16i8)
+    return false;
+
+  bool HasAVX = Subtarget->hasAVX();
+  unsigned Opc;
+  switch (I->getOpcode()) {
+  default: llvm_unreachable("Unexpected vector logic operation!");
+  case Instruction::And: Opc = HasAVX ? X86::VPANDrr : X86::PANDrr; break;
+  case Instruction::Or:  Opc = HasAVX ? X86::VPORrr : X86::PORrr; break;
+  case Instruction::Xor: Opc = HasAVX ? X86::VPXORrr : X86::PXORrr; break;
+  }
+
+  unsigned Op0Reg = getRegForValue(I->getOperand(0));
+  if (Op0Reg == 0) return false;
+  unsigned Op1Reg = getRegForValue(I->getOperand(1));
+  if (Op1Reg == 0) return false;
+
+  unsigned ResultReg = FastEmitInst_rr(Opc, &X86::VR128RegClass,
+                                       Op0Reg, /*Kill=*/false,
+                                       Op1Reg, /*Kill=*/false);
   UpdateValueMap(I, ResultReg);
   return true;
 }
@@ -1396,6 +1503,72 @@ bool X86FastISel::TryEmitSmallMemcpy(X86AddressMode DestAM,
   return true;
 }
 
+bool X86FastISel::TryEmitSmallMemset(X86AddressMode DestAM, uint8_t Val,
+                                     uint64_t Len) {
+  // Small memsets are done with the same stores as small memcpys.
+  if (!IsMemcpySmall(Len))
+    return false;
+
+  bool i64Legal = Subtarget->is64Bit();
+  LLVMContext &Ctx = FuncInfo.Fn->getContext();
+
+  while (Len) {
+    MVT VT;
+    if (Len >= 8 && i64Legal)
+      VT = MVT::i64;
+    else if (Len >= 4)
+      VT = MVT::i32;
+    else if (Len >= 2)
+      VT = MVT::i16;
+    else
+      VT = MVT::i8;
+
+    unsigned Size = VT.getSizeInBits()/8;
+    APInt Splat = APInt::getSplat(VT.getSizeInBits(), APInt(8, Val));
+    const Constant *C = ConstantInt::get(Ctx, Splat);
+    if (!X86FastEmitStore(VT, C, DestAM))
+      return false;
+
+    Len -= Size;
+    DestAM.Disp += Size;
+  }
+
+  return true;
+}
+
+/// X86EmitRepMovs - Copy Len bytes from the address in SrcReg to DestAM with
+/// a rep;movs, and the bytes left over by its element size with plain moves.
+/// This clobbers ECX, EDI and ESI (RCX, RDI and RSI on x86-64).
+bool X86FastISel::X86EmitRepMovs(X86AddressMode DestAM, unsigned SrcReg,
+                                 uint64_t Len) {
+  bool Is64Bit = Subtarget->is64Bit();
+  unsigned EltSize = Is64Bit ? 8 : 4;
+  const TargetRegisterClass *RC = TLI.getRegClassFor(TLI.getPointerTy());
+
+  unsigned DestReg = createResultReg(RC);
+  addFullAddress(BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL,
+                         TII.get(Is64Bit ? X86::LEA64r : X86::LEA32r),
+                         DestReg), DestAM);
+  BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL, TII.get(TargetOpcode::COPY),
+          Is64Bit ? X86::RDI : X86::EDI).addReg(DestReg);
+  BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL, TII.get(TargetOpcode::COPY),
+          Is64Bit ? X86::RSI : X86::ESI).addReg(SrcReg);
+  BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL,
+          TII.get(Is64Bit ? X86::MOV64ri32 : X86::MOV32ri),
+          Is64Bit ? X86::RCX : X86::ECX).addImm(Len / EltSize);
+  BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL,
+          TII.get(Is64Bit ? X86::REP_MOVSQ_64 : X86::REP_MOVSD_32));
+
+  uint64_t Tail = Len % EltSize;
+  if (Tail == 0)
+    return true;
+  X86AddressMode SrcAM;
+  SrcAM.Base.Reg = SrcReg;
+  SrcAM.Disp = Len - Tail;
+  DestAM.Disp += Len - Tail;
+  return TryEmitSmallMemcpy(DestAM, SrcAM, Tail);
+}
+
 bool X86FastISel::X86VisitIntrinsicCall(const IntrinsicInst &I) {
   // FIXME: Handle more intrinsics.
   switch (I.getIntrinsicID()) {
@@ -1429,12 +1602,37 @@ bool X86FastISel::X86VisitIntrinsicCall(const IntrinsicInst &I) {
 
     return DoSelectCall(&I, "memcpy");
   }
+  case Intrinsic::memmove: {
+    const MemMoveInst &MMI = cast<MemMoveInst>(I);
+    if (MMI.isVolatile())
+      return false;
+
+    unsigned SizeWidth = Subtarget->is64Bit() ? 64 : 32;
+    if (!MMI.getLength()->getType()->isIntegerTy(SizeWidth))
+      return false;
+
+    if (MMI.getSourceAddressSpace() > 255 || MMI.getDestAddressSpace() > 255)
+      return false;
+
+    return DoSelectCall(&I, "memmove");
+  }
   case Intrinsic::memset: {
     const MemSetInst &MSI = cast<MemSetInst>(I);
 
     if (MSI.isVolatile())
       return false;
 
+    // Small memsets of a known byte are done with a few stores.
+    const ConstantInt *Len = dyn_cast<ConstantInt>(MSI.getLength());
+    const ConstantInt *Val = dyn_cast<ConstantInt>(MSI.getValue());
+    if (Len && Val && IsMemcpySmall(Len->getZExtValue())) {
+      X86AddressMode DestAM;
+      if (!X86SelectAddress(MSI.getRawDest(), DestAM))
+        return false;
+      return TryEmitSmallMemset(DestAM, Val->getZExtValue(),
+                                Len->getZExtValue());
+    }
+
     unsigned SizeWidth = Subtarget->is64Bit() ? 64 : 32;
     if (!MSI.getLength()->getType()->isIntegerTy(SizeWidth))
       return false;
@@ -1540,21 +1738,25 @@ bool X86FastISel::FastLowerArguments() {
   if (!Subtarget->is64Bit())
     return false;
   
-  // Only handle simple cases. i.e. Up to 6 i32/i64 scalar arguments.
+  // Only handle simple cases. i.e. Up to 6 i32/i64 scalar arguments, the
+  // first of which may be an sret pointer, and up to 8 scalar SSE or 128-bit
+  // vector arguments.
   unsigned Idx = 1;
+  unsigned NumGPRs = 0, NumXMMs = 0;
   for (Function::const_arg_iterator I = F->arg_begin(), E = F->arg_end();
        I != E; ++I, ++Idx) {
-    if (Idx > 6)
-      return false;
-
     if (F->getAttributes().hasAttribute(Idx, Attribute::ByVal) ||
         F->getAttributes().hasAttribute(Idx, Attribute::InReg) ||
-        F->getAttributes().hasAttribute(Idx, Attribute::StructRet) ||
         F->getAttributes().hasAttribute(Idx, Attribute::Nest))
       return false;
 
+    // X86SelectRet returns the sret pointer in %rax.
+    if (F->getAttributes().hasAttribute(Idx, Attribute::StructRet) &&
+        (Idx != 1 || Subtarget->isTarget64BitILP32()))
+      return false;
+
     Type *ArgTy = I->getType();
-    if (ArgTy->isStructTy() || ArgTy->isArrayTy() || ArgTy->isVectorTy())
+    if (ArgTy->isStructTy() || ArgTy->isArrayTy())
       return false;
 
     EVT ArgVT = TLI.getValueType(ArgTy);
@@ -1562,6 +1764,26 @@ bool X86FastISel::FastLowerArguments() {
     switch (ArgVT.getSimpleVT().SimpleTy) {
     case MVT::i32:
     case MVT::i64:
+      if (++NumGPRs > 6)
+        return false;
+      break;
+    case MVT::f32:
+    case MVT::f64:
+      if (!isScalarFPTypeInSSEReg(ArgVT))
+        return false;
+      if (++NumXMMs > 8)
+        return false;
+      break;
+    case MVT::v4f32:
+    case MVT::v2f64:
+    case MVT::v4i32:
+    case MVT::v2i64:
+    case MVT::v8i16:
+    case MVT::v16i8:
+      if (!TLI.isTypeLegal(ArgVT))
+        return false;
+      if (++NumXMMs > 8)
+        return false;
       break;
     default:
       return false;
@@ -1574,17 +1796,28 @@ bool X86FastISel::FastLowerArguments() {
   static const uint16_t GPR64ArgRegs[] = {
     X86::RDI, X86::RSI, X86::RDX, X86::RCX, X86::R8 , X86::R9
   };
+  static const uint16_t XMMArgRegs[] = {
+    X86::XMM0, X86::XMM1, X86::XMM2, X86::XMM3,
+    X86::XMM4, X86::XMM5, X86::XMM6, X86::XMM7
+  };
 
   Idx = 0;
-  const TargetRegisterClass *RC32 = TLI.getRegClassFor(MVT::i32);
-  const TargetRegisterClass *RC64 = TLI.getRegClassFor(MVT::i64);
+  NumGPRs = NumXMMs = 0;
   for (Function::const_arg_iterator I = F->arg_begin(), E = F->arg_end();
        I != E; ++I, ++Idx) {
-    if (I->use_empty())
+    MVT VT = TLI.getSimpleValueType(I->getType());
+    unsigned SrcReg;
+    if (VT == MVT::i32)
+      SrcReg = GPR32ArgRegs[NumGPRs++];
+    else if (VT == MVT::i64)
+      SrcReg = GPR64ArgRegs[NumGPRs++];
+    else
+      SrcReg = XMMArgRegs[NumXMMs++];
+
+    bool IsSRet = Idx == 0 && F->hasStructRetAttr();
+    if (I->use_empty() && !IsSRet)
       continue;
-    bool is32Bit = TLI.getValueType(I->getType()) == MVT::i32;
-    const TargetRegisterClass *RC = is32Bit ? RC32 : RC64;
-    unsigned SrcReg = is32Bit ? GPR32ArgRegs[Idx] : GPR64ArgRegs[Idx];
+    const TargetRegisterClass *RC = TLI.getRegClassFor(VT);
     unsigned DstReg = FuncInfo.MF->addLiveIn(SrcReg, RC);
     // FIXME: Unfortunately it's necessary to emit a copy from the livein copy.
     // Without this, EmitLiveInCopies may eliminate the livein if its only
@@ -1593,6 +1826,9 @@ bool X86FastISel::FastLowerArguments() {
     BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL, TII.get(TargetOpcode::COPY),
             ResultReg).addReg(DstReg, getKillRegState(true));
     UpdateValueMap(I, ResultReg);
+    if (IsSRet)
+      FuncInfo.MF->getInfo<X86MachineFunctionInfo>()
+        ->setSRetReturnReg(ResultReg);
   }
   return true;
 }
@@ -1720,8 +1956,6 @@ bool X86FastISel::DoSelectCall(const Instruction *I, const char *MemIntName) {
       Flags.setByVal();
       Flags.setByValSize(FrameSize);
       Flags.setByValAlign(FrameAlign);
-      if (!IsMemcpySmall(FrameSize))
-        return false;
     }
 
     if (CS.paramHasAttr(AttrInd, Attribute::InReg))
@@ -1799,8 +2033,11 @@ bool X86FastISel::DoSelectCall(const Instruction *I, const char *MemIntName) {
     .addImm(NumBytes);
 
   // Process argument: walk the register/memloc assignments, inserting
-  // copies / loads.
+  // copies / loads.  The copies into argument registers are only made once
+  // all the stack arguments are stored, as copying a large byval argument
+  // clobbers some of them.
   SmallVector<unsigned, 4> RegArgs;
+  SmallVector<unsigned, 4> RegArgVals;
   for (unsigned i = 0, e = ArgLocs.size(); i != e; ++i) {
     CCValAssign &VA = ArgLocs[i];
     unsigned Arg = Args[VA.getValNo()];
@@ -1862,9 +2099,8 @@ bool X86FastISel::DoSelectCall(const Instruction *I, const char *MemIntName) {
     }
 
     if (VA.isRegLoc()) {
-      BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL, TII.get(TargetOpcode::COPY),
-              VA.getLocReg()).addReg(Arg);
       RegArgs.push_back(VA.getLocReg());
+      RegArgVals.push_back(Arg);
     } else {
       unsigned LocMemOffset = VA.getLocMemOffset();
       X86AddressMode AM;
@@ -1876,8 +2112,9 @@ bool X86FastISel::DoSelectCall(const Instruction *I, const char *MemIntName) {
       if (Flags.isByVal()) {
         X86AddressMode SrcAM;
         SrcAM.Base.Reg = Arg;
-        bool Res = TryEmitSmallMemcpy(AM, SrcAM, Flags.getByValSize());
-        assert(Res && "memcpy length already checked!"); (void)Res;
+        if (!TryEmitSmallMemcpy(AM, SrcAM, Flags.getByValSize()) &&
+            !X86EmitRepMovs(AM, Arg, Flags.getByValSize()))
+          return false;
       } else if (isa<ConstantInt>(ArgVal) || isa<ConstantPointerNull>(ArgVal)) {
         // If this is a really simple value, emit this with the Value* version
         // of X86FastEmitStore.  If it isn't simple, we don't want to do this,
@@ -1891,6 +2128,10 @@ bool X86FastISel::DoSelectCall(const Instruction *I, const char *MemIntName) {
     }
   }
 
+  for (unsigned i = 0, e = RegArgs.size(); i != e; ++i)
+    BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL, TII.get(TargetOpcode::COPY),
+            RegArgs[i]).addReg(RegArgVals[i]);
+
   // ELF / PIC requires GOT in the EBX register before function calls via PLT
   // GOT pointer.
   if (Subtarget->isPICStyleGOT()) {
@@ -2084,6 +2325,10 @@ X86FastISel::TargetSelectInstruction(const Instruction *I)  {
     return X86SelectShift(I);
   case Instruction::Select:
     return X86SelectSelect(I);
+  case Instruction::And:
+  case Instruction::Or:
+  case Instruction::Xor:
+    return X86SelectVectorLogic(I);
   case Instruction::Trunc:
     return X86SelectTrunc(I);
   case Instruction::FPExt:
@@ -52,6 +52,8 @@ public:
     initializeX86TTIPass(*PassRegistry::getPassRegistry());
   }
 
+  virtual Pass *createClone() const { return new X86TTI(TM); }
+
   virtual void initializePass() {
     pushTTIStack(this);
   }
@@ -98,6 +100,11 @@ public:
   virtual unsigned getMemoryOpCost(unsigned Opcode, Type *Src,
                                    unsigned Alignment,
                                    unsigned AddressSpace) const;
+  virtual unsigned getInterleavedMemoryOpCost(unsigned Opcode, Type *VecTy,
+                                              unsigned Factor,
+                                              ArrayRef<unsigned> Indices,
+                                              unsigned Alignment,
+                                              unsigned AddressSpace) const;
 
   /// @}
 };
@@ -283,6 +290,15 @@ unsigned X86TTI::getCmpSelInstrCost(unsigned Opcode, Type *ValTy,
   int ISD = TLI->InstructionOpcodeToISD(Opcode);
   assert(ISD && "Invalid opcode");
 
+  // There is no 64-bit integer compare before SSE4.2.
+  static const CostTblEntry<MVT> SSE2CostTbl[] = {
+    { ISD::SETCC,   MVT::v2f64,   1 },
+    { ISD::SETCC,   MVT::v4f32,   1 },
+    { ISD::SETCC,   MVT::v4i32,   1 },
+    { ISD::SETCC,   MVT::v8i16,   1 },
+    { ISD::SETCC,   MVT::v16i8,   1 },
+  };
+
   static const CostTblEntry<MVT> SSE42CostTbl[] = {
     { ISD::SETCC,   MVT::v2f64,   1 },
     { ISD::SETCC,   MVT::v4f32,   1 },
@@ -327,6 +343,12 @@ unsigned X86TTI::getCmpSelInstrCost(unsigned Opcode, Type *ValTy,
       return LT.first * SSE42CostTbl[Idx].Cost;
   }
 
+  if (ST->hasSSE2()) {
+    int Idx = CostTableLookup<MVT>(SSE2CostTbl, array_lengthof(SSE2CostTbl), ISD, MTy);
+    if (Idx != -1)
+      return LT.first * SSE2CostTbl[Idx].Cost;
+  }
+
   return TargetTransformInfo::getCmpSelInstrCost(Opcode, ValTy, CondTy);
 }
 
@@ -371,3 +393,32 @@ unsigned X86TTI::getMemoryOpCost(unsigned Opcode, Type *Src, unsigned Alignment,
 
   return Cost;
 }
+
+unsigned X86TTI::getInterleavedMemoryOpCost(unsigned Opcode, Type *VecTy,
+                                            unsigned Factor,
+                                            ArrayRef<unsigned> Indices,
+                                            unsigned Alignment,
+                                            unsigned AddressSpace) const {
+  // Groups of 32 and 64 bit elements with a stride of 2 or 4 are split and
+  // merged with a few shufps/unpck per register. Other groups are mostly
+  // scalarized by the legalizer.
+  unsigned EltSize = VecTy->getScalarSizeInBits();
+  if (!ST->hasSSE2() || (Factor != 2 && Factor != 4) ||
+      (EltSize != 32 && EltSize != 64))
+    return TargetTransformInfo::getInterleavedMemoryOpCost(Opcode, VecTy,
+                                                           Factor, Indices,
+                                                           Alignment,
+                                                           AddressSpace);
+
+  std::pair<unsigned, MVT> LT = TLI->getTypeLegalizationCost(VecTy);
+  unsigned Cost = getMemoryOpCost(Opcode, VecTy, Alignment, AddressSpace);
+
+  // Each member takes about one shuffle per legal register of the wide
+  // vector. The 256 bit shuffles of AVX can't cross the 128 bit lanes, which
+  // takes a few more.
+  unsigned NumMembers = Opcode == Instruction::Load ? Indices.size() : Factor;
+  unsigned ShuffleCost = NumMembers * LT.first;
+  if (LT.second.getSizeInBits() > 128 && !ST->hasAVX2())
+    ShuffleCost *= 2;
+  return Cost + ShuffleCost;
+}
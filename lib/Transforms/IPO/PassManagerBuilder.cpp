@@ -35,6 +35,10 @@ RunLoopVectorization("vectorize-loops",
 static cl::opt<bool>
 RunBBVectorization("vectorize", cl::desc("Run the BB vectorization passes"));
 
+static cl::opt<bool>
+RunSLPVectorization("vectorize-slp",
+                    cl::desc("Run the SLP vectorization passes"));
+
 static cl::opt<bool>
 UseGVNAfterVectorization("use-gvn-after-vectorization",
   cl::init(false), cl::Hidden,
@@ -54,6 +58,7 @@ PassManagerBuilder::PassManagerBuilder() {
     DisableUnrollLoops = false;
     Vectorize = RunBBVectorization;
     LoopVectorize = RunLoopVectorization;
+    SLPVectorize = RunSLPVectorization;
 }
 
 PassManagerBuilder::~PassManagerBuilder() {
@@ -207,6 +212,11 @@ void PassManagerBuilder::populateModulePassManager(PassManagerBase &MPM) {
 
   addExtensionsToPM(EP_ScalarOptimizerLate, MPM);
 
+  if (SLPVectorize && OptLevel > 2) {
+    MPM.add(createSLPVectorizerPass());   // Vectorize straight-line code.
+    MPM.add(createInstructionCombiningPass());
+  }
+
   if (Vectorize) {
     MPM.add(createBBVectorizePass());
     MPM.add(createInstructionCombiningPass());
@@ -92,6 +92,8 @@ public:
     initializeInstCombinerPass(*PassRegistry::getPassRegistry());
   }
 
+  virtual Pass *createClone() const { return new InstCombiner(); }
+
 public:
   virtual bool runOnFunction(Function &F);
 
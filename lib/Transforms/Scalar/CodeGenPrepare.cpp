@@ -103,6 +103,8 @@ namespace {
       : FunctionPass(ID), TLI(tli) {
         initializeCodeGenPreparePass(*PassRegistry::getPassRegistry());
       }
+
+    virtual Pass *createClone() const { return new CodeGenPrepare(TLI); }
     bool runOnFunction(Function &F);
 
     const char *getPassName() const { return "CodeGen Prepare"; }
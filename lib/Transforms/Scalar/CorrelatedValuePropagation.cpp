@@ -48,6 +48,8 @@ namespace {
      initializeCorrelatedValuePropagationPass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *createClone() const { return new CorrelatedValuePropagation(); }
+
     bool runOnFunction(Function &F);
 
     virtual void getAnalysisUsage(AnalysisUsage &AU) const {
@@ -17,6 +17,7 @@
 
 #define DEBUG_TYPE "dse"
 #include "llvm/Transforms/Scalar.h"
+#include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/Statistic.h"
@@ -25,6 +26,7 @@
 #include "llvm/Analysis/Dominators.h"
 #include "llvm/Analysis/MemoryBuiltins.h"
 #include "llvm/Analysis/MemoryDependenceAnalysis.h"
+#include "llvm/Analysis/MemorySSA.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DataLayout.h"
@@ -33,6 +35,7 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Target/TargetLibraryInfo.h"
 #include "llvm/Transforms/Utils/Local.h"
@@ -41,10 +44,21 @@ using namespace llvm;
 STATISTIC(NumFastStores, "Number of stores deleted");
 STATISTIC(NumFastOther , "Number of other instrs removed");
 
+static cl::opt<bool>
+EnableMemorySSA("enable-dse-memoryssa", cl::init(false), cl::Hidden,
+                cl::desc("Use Memory SSA instead of memory dependence "
+                         "analysis to find the stores overwritten in a block"));
+
+static cl::opt<unsigned>
+MemorySSAScanLimit("dse-memoryssa-scan-limit", cl::init(100), cl::Hidden,
+                   cl::desc("The maximum number of memory definitions looked "
+                            "at before a store with Memory SSA"));
+
 namespace {
   struct DSE : public FunctionPass {
     AliasAnalysis *AA;
     MemoryDependenceAnalysis *MD;
+    OwningPtr<MemorySSA> MSSA;
     DominatorTree *DT;
     const TargetLibraryInfo *TLI;
 
@@ -53,11 +67,16 @@ namespace {
       initializeDSEPass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *createClone() const { return new DSE(); }
+
     virtual bool runOnFunction(Function &F) {
       AA = &getAnalysis<AliasAnalysis>();
       MD = &getAnalysis<MemoryDependenceAnalysis>();
       DT = &getAnalysis<DominatorTree>();
       TLI = AA->getTargetLibraryInfo();
+      AA->beginCacheScope();
+      if (EnableMemorySSA)
+        MSSA.reset(new MemorySSA(F, AA, DT));
 
       bool Changed = false;
       for (Function::iterator I = F.begin(), E = F.end(); I != E; ++I)
@@ -66,11 +85,15 @@ namespace {
         if (DT->isReachableFromEntry(I))
           Changed |= runOnBasicBlock(*I);
 
+      AA->endCacheScope();
       AA = 0; MD = 0; DT = 0;
+      MSSA.reset();
       return Changed;
     }
 
     bool runOnBasicBlock(BasicBlock &BB);
+    bool processWriteWithMemorySSA(Instruction *Inst,
+                                   BasicBlock::iterator &BBI);
     bool HandleFree(CallInst *F);
     bool handleEndBlock(BasicBlock &BB);
     void RemoveAccessedObjects(const AliasAnalysis::Location &LoadedLoc,
@@ -105,11 +128,13 @@ FunctionPass *llvm::createDeadStoreEliminationPass() { return new DSE(); }
 /// and zero out all the operands of this instruction.  If any of them become
 /// dead, delete them and the computation tree that feeds them.
 ///
-/// If ValueSet is non-null, remove any deleted instructions from it as well.
+/// If MSSA is non-null, remove the deleted instructions from Memory SSA.  If
+/// ValueSet is non-null, remove any deleted instructions from it as well.
 ///
 static void DeleteDeadInstruction(Instruction *I,
                                   MemoryDependenceAnalysis &MD,
                                   const TargetLibraryInfo *TLI,
+                                  MemorySSA *MSSA,
                                   SmallSetVector<Value*, 16> *ValueSet = 0) {
   SmallVector<Instruction*, 32> NowDeadInsts;
 
@@ -125,6 +150,8 @@ static void DeleteDeadInstruction(Instruction *I,
     // MemDep, which needs to know the operands and needs it to be in the
     // function.
     MD.removeInstruction(DeadInst);
+    if (MSSA)
+      MSSA->removeMemoryAccess(DeadInst);
 
     for (unsigned op = 0, e = DeadInst->getNumOperands(); op != e; ++op) {
       Value *Op = DeadInst->getOperand(op);
@@ -505,6 +532,11 @@ bool DSE::runOnBasicBlock(BasicBlock &BB) {
     if (!hasMemoryWrite(Inst, TLI))
       continue;
 
+    if (MSSA) {
+      MadeChange |= processWriteWithMemorySSA(Inst, BBI);
+      continue;
+    }
+
     MemDepResult InstDep = MD->getDependency(Inst);
 
     // Ignore any store where we can't find a local dependence.
@@ -525,7 +557,7 @@ bool DSE::runOnBasicBlock(BasicBlock &BB) {
           // in case we need it.
           WeakVH NextInst(BBI);
 
-          DeleteDeadInstruction(SI, *MD, TLI);
+          DeleteDeadInstruction(SI, *MD, TLI, MSSA.get());
 
           if (NextInst == 0)  // Next instruction deleted.
             BBI = BB.begin();
@@ -572,7 +604,7 @@ bool DSE::runOnBasicBlock(BasicBlock &BB) {
                 << *DepWrite << "\n  KILLER: " << *Inst << '\n');
 
           // Delete the store and now-dead instructions that feed it.
-          DeleteDeadInstruction(DepWrite, *MD, TLI);
+          DeleteDeadInstruction(DepWrite, *MD, TLI, MSSA.get());
           ++NumFastStores;
           MadeChange = true;
 
@@ -636,6 +668,142 @@ bool DSE::runOnBasicBlock(BasicBlock &BB) {
   return MadeChange;
 }
 
+/// mayBeReadByUses - Return true if a MemoryUse of the version defined by Def
+/// may read Loc.
+static bool mayBeReadByUses(MemoryDef *Def, const AliasAnalysis::Location &Loc,
+                            AliasAnalysis &AA) {
+  for (MemoryAccess::user_iterator UI = Def->user_begin(),
+       UE = Def->user_end(); UI != UE; ++UI)
+    if (MemoryUse *MU = dyn_cast<MemoryUse>(*UI))
+      if (AA.getModRefInfo(MU->getMemoryInst(), Loc) & AliasAnalysis::Ref)
+        return true;
+  return false;
+}
+
+/// processWriteWithMemorySSA - Remove the stores made dead by Inst, like the
+/// main loop of runOnBasicBlock, but walking the MemoryDefs of the block
+/// before Inst instead of querying memory dependence analysis.  A MemoryDef is
+/// dead if Inst overwrites it before anything reads it: nothing reads its
+/// memory in between if none of the MemoryUses of it and of the MemoryDefs
+/// after it may read the location written by Inst.
+bool DSE::processWriteWithMemorySSA(Instruction *Inst,
+                                    BasicBlock::iterator &BBI) {
+  BasicBlock &BB = *Inst->getParent();
+  MemoryUseOrDef *InstAccess = MSSA->getMemoryAccess(Inst);
+  if (!InstAccess)
+    return false;
+
+  // If we're storing the same value back to a pointer that we loaded from,
+  // and nothing clobbered the pointer in between, the store can be removed.
+  if (StoreInst *SI = dyn_cast<StoreInst>(Inst)) {
+    LoadInst *DepLoad = dyn_cast<LoadInst>(SI->getValueOperand());
+    if (DepLoad && DepLoad->isSimple() &&
+        SI->getPointerOperand() == DepLoad->getPointerOperand() &&
+        isRemovable(SI)) {
+      MemoryAccess *LoadClobber = MSSA->getClobberingMemoryAccess(DepLoad);
+      MemoryAccess *StoreClobber =
+        MSSA->getClobberingMemoryAccess(InstAccess->getDefiningAccess(),
+                                        AA->getLocation(SI));
+      if (LoadClobber && LoadClobber == StoreClobber) {
+        DEBUG(dbgs() << "DSE: Remove Store Of Load from same pointer:\n  "
+                     << "LOAD: " << *DepLoad << "\n  STORE: " << *SI << '\n');
+
+        // DeleteDeadInstruction can delete the current instruction.  Save BBI
+        // in case we need it.
+        WeakVH NextInst(BBI);
+
+        DeleteDeadInstruction(SI, *MD, TLI, MSSA.get());
+
+        if (NextInst == 0)  // Next instruction deleted.
+          BBI = BB.begin();
+        else if (BBI != BB.begin())  // Revisit this instruction if possible.
+          --BBI;
+        ++NumFastStores;
+        return true;
+      }
+    }
+  }
+
+  // Figure out what location is being stored to.
+  AliasAnalysis::Location Loc = getLocForWrite(Inst, *AA);
+
+  // If we didn't get a useful location, fail.
+  if (Loc.Ptr == 0)
+    return false;
+
+  bool MadeChange = false;
+  MemoryAccess *Current = InstAccess->getDefiningAccess();
+  for (unsigned Steps = 0; Steps != MemorySSAScanLimit; ++Steps) {
+    MemoryDef *Def = dyn_cast<MemoryDef>(Current);
+    if (!Def || MSSA->isLiveOnEntryDef(Def) || Def->getBlock() != &BB)
+      break;
+    Instruction *DepWrite = Def->getMemoryInst();
+
+    // A load of Loc after DepWrite keeps it, and everything before it, alive.
+    if (mayBeReadByUses(Def, Loc, *AA))
+      break;
+
+    AliasAnalysis::Location DepLoc = getLocForWrite(DepWrite, *AA);
+    if (DepLoc.Ptr == 0) {
+      // Look past calls and other writes that don't touch Loc, as memory
+      // dependence analysis does.
+      if (AA->getModRefInfo(DepWrite, Loc) != AliasAnalysis::NoModRef)
+        break;
+      Current = Def->getDefiningAccess();
+      continue;
+    }
+
+    if (isRemovable(DepWrite) &&
+        !isPossibleSelfRead(Inst, Loc, DepWrite, *AA)) {
+      int64_t InstWriteOffset, DepWriteOffset;
+      OverwriteResult OR = isOverwrite(Loc, DepLoc, *AA,
+                                       DepWriteOffset, InstWriteOffset);
+      if (OR == OverwriteComplete) {
+        DEBUG(dbgs() << "DSE: Remove Dead Store:\n  DEAD: "
+              << *DepWrite << "\n  KILLER: " << *Inst << '\n');
+
+        // Delete the store and now-dead instructions that feed it.
+        DeleteDeadInstruction(DepWrite, *MD, TLI, MSSA.get());
+        ++NumFastStores;
+
+        // DeleteDeadInstruction can delete the current instruction in loop
+        // cases, reset BBI.
+        BBI = Inst;
+        if (BBI != BB.begin())
+          --BBI;
+        return true;
+      } else if (OR == OverwriteEnd && isShortenable(DepWrite)) {
+        // See runOnBasicBlock for why only some lengths are trimmed.
+        MemIntrinsic* DepIntrinsic = cast<MemIntrinsic>(DepWrite);
+        unsigned DepWriteAlign = DepIntrinsic->getAlignment();
+        if (llvm::isPowerOf2_64(InstWriteOffset) ||
+            ((DepWriteAlign != 0) && InstWriteOffset % DepWriteAlign == 0)) {
+          DEBUG(dbgs() << "DSE: Remove Dead Store:\n  OW END: "
+                << *DepWrite << "\n  KILLER (offset "
+                << InstWriteOffset << ", "
+                << DepLoc.Size << ")"
+                << *Inst << '\n');
+
+          Value* DepWriteLength = DepIntrinsic->getLength();
+          Value* TrimmedLength = ConstantInt::get(DepWriteLength->getType(),
+                                                  InstWriteOffset -
+                                                  DepWriteOffset);
+          DepIntrinsic->setLength(TrimmedLength);
+          MadeChange = true;
+        }
+      }
+    }
+
+    // Can't look past this instruction if it might read 'Loc'.
+    if (AA->getModRefInfo(DepWrite, Loc) & AliasAnalysis::Ref)
+      break;
+
+    Current = Def->getDefiningAccess();
+  }
+
+  return MadeChange;
+}
+
 /// Find all blocks that will unconditionally lead to the block BB and append
 /// them to F.
 static void FindUnconditionalPreds(SmallVectorImpl<BasicBlock *> &Blocks,
@@ -682,7 +850,7 @@ bool DSE::HandleFree(CallInst *F) {
       Instruction *Next = llvm::next(BasicBlock::iterator(Dependency));
 
       // DCE instructions only used to calculate that store
-      DeleteDeadInstruction(Dependency, *MD, TLI);
+      DeleteDeadInstruction(Dependency, *MD, TLI, MSSA.get());
       ++NumFastStores;
       MadeChange = true;
 
@@ -782,7 +950,7 @@ bool DSE::handleEndBlock(BasicBlock &BB) {
               dbgs() << '\n');
 
         // DCE instructions only used to calculate that store.
-        DeleteDeadInstruction(Dead, *MD, TLI, &DeadStackObjects);
+        DeleteDeadInstruction(Dead, *MD, TLI, MSSA.get(), &DeadStackObjects);
         ++NumFastStores;
         MadeChange = true;
         continue;
@@ -792,7 +960,7 @@ bool DSE::handleEndBlock(BasicBlock &BB) {
     // Remove any dead non-memory-mutating instructions.
     if (isInstructionTriviallyDead(BBI, TLI)) {
       Instruction *Inst = BBI++;
-      DeleteDeadInstruction(Inst, *MD, TLI, &DeadStackObjects);
+      DeleteDeadInstruction(Inst, *MD, TLI, MSSA.get(), &DeadStackObjects);
       ++NumFastOther;
       MadeChange = true;
       continue;
@@ -313,6 +313,8 @@ public:
     initializeEarlyCSEPass(*PassRegistry::getPassRegistry());
   }
 
+  virtual Pass *createClone() const { return new EarlyCSE(); }
+
   bool runOnFunction(Function &F);
 
 private:
@@ -20,6 +20,7 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DepthFirstIterator.h"
 #include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AliasAnalysis.h"
@@ -29,6 +30,7 @@
 #include "llvm/Analysis/Loads.h"
 #include "llvm/Analysis/MemoryBuiltins.h"
 #include "llvm/Analysis/MemoryDependenceAnalysis.h"
+#include "llvm/Analysis/MemorySSA.h"
 #include "llvm/Analysis/PHITransAddr.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/Assembly/Writer.h"
@@ -59,6 +61,10 @@ STATISTIC(NumPRELoad,   "Number of loads PRE'd");
 static cl::opt<bool> EnablePRE("enable-pre",
                                cl::init(true), cl::Hidden);
 static cl::opt<bool> EnableLoadPRE("enable-load-pre", cl::init(true));
+static cl::opt<bool>
+EnableMemorySSA("enable-gvn-memoryssa", cl::init(false), cl::Hidden,
+                cl::desc("Use Memory SSA instead of memory dependence "
+                         "analysis to eliminate redundant loads"));
 
 // Maximum allowed recursion depth.
 static cl::opt<uint32_t>
@@ -104,6 +110,7 @@ namespace {
     DenseMap<Expression, uint32_t> expressionNumbering;
     AliasAnalysis *AA;
     MemoryDependenceAnalysis *MD;
+    MemorySSA *MSSA;
     DominatorTree *DT;
 
     uint32_t nextValueNumber;
@@ -114,8 +121,9 @@ namespace {
                                      Value *LHS, Value *RHS);
     Expression create_extractvalue_expression(ExtractValueInst* EI);
     uint32_t lookup_or_add_call(CallInst* C);
+    uint32_t lookup_or_add_load(LoadInst* L);
   public:
-    ValueTable() : nextValueNumber(1) { }
+    ValueTable() : MSSA(0), nextValueNumber(1) { }
     uint32_t lookup_or_add(Value *V);
     uint32_t lookup(Value *V) const;
     uint32_t lookup_or_add_cmp(unsigned Opcode, CmpInst::Predicate Pred,
@@ -126,6 +134,7 @@ namespace {
     void setAliasAnalysis(AliasAnalysis* A) { AA = A; }
     AliasAnalysis *getAliasAnalysis() const { return AA; }
     void setMemDep(MemoryDependenceAnalysis* M) { MD = M; }
+    void setMemorySSA(MemorySSA* M) { MSSA = M; }
     void setDomTree(DominatorTree* D) { DT = D; }
     uint32_t getNextUnusedValueNumber() { return nextValueNumber; }
     void verifyRemoved(const Value *) const;
@@ -380,6 +389,30 @@ uint32_t ValueTable::lookup_or_add_call(CallInst *C) {
   }
 }
 
+/// lookup_or_add_load - Number a load by its address and the access that
+/// clobbers it in Memory SSA, so that the loads of an address that see the
+/// same memory get the same number.
+uint32_t ValueTable::lookup_or_add_load(LoadInst *L) {
+  MemoryAccess *Clobber = 0;
+  if (L->isSimple())
+    Clobber = MSSA->getClobberingMemoryAccess(L);
+  if (!Clobber) {
+    valueNumbering[L] = nextValueNumber;
+    return nextValueNumber++;
+  }
+
+  Expression e;
+  e.type = L->getType();
+  e.opcode = Instruction::Load;
+  e.varargs.push_back(lookup_or_add(L->getPointerOperand()));
+  e.varargs.push_back(Clobber->getID());
+
+  uint32_t& v = expressionNumbering[e];
+  if (!v) v = nextValueNumber++;
+  valueNumbering[L] = v;
+  return v;
+}
+
 /// lookup_or_add - Returns the value number for the specified value, assigning
 /// it a new number if it did not have one before.
 uint32_t ValueTable::lookup_or_add(Value *V) {
@@ -440,6 +473,11 @@ uint32_t ValueTable::lookup_or_add(Value *V) {
     case Instruction::ExtractValue:
       exp = create_extractvalue_expression(cast<ExtractValueInst>(I));
       break;
+    case Instruction::Load:
+      if (MSSA)
+        return lookup_or_add_load(cast<LoadInst>(I));
+      valueNumbering[V] = nextValueNumber;
+      return nextValueNumber++;
     default:
       valueNumbering[V] = nextValueNumber;
       return nextValueNumber++;
@@ -502,6 +540,7 @@ namespace {
   class GVN : public FunctionPass {
     bool NoLoads;
     MemoryDependenceAnalysis *MD;
+    OwningPtr<MemorySSA> MSSA;
     DominatorTree *DT;
     const DataLayout *TD;
     const TargetLibraryInfo *TLI;
@@ -526,6 +565,8 @@ namespace {
       initializeGVNPass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *createClone() const { return new GVN(NoLoads); }
+
     bool runOnFunction(Function &F);
 
     /// markInstructionForDeletion - This removes the specified instruction from
@@ -604,6 +645,8 @@ namespace {
     bool processLoad(LoadInst *L);
     bool processInstruction(Instruction *I);
     bool processNonLocalLoad(LoadInst *L);
+    bool processLoadWithMemorySSA(LoadInst *L);
+    bool processNonLocalLoadWithMemorySSA(LoadInst *L, MemoryPhi *Phi);
     bool processBlock(BasicBlock *BB);
     void dump(DenseMap<uint32_t, Value*> &d);
     bool iterateOnFunction(Function &F);
@@ -1775,6 +1818,9 @@ bool GVN::processLoad(LoadInst *L) {
     return true;
   }
 
+  if (MSSA)
+    return processLoadWithMemorySSA(L);
+
   // ... to a pointer that has been loaded from before...
   MemDepResult Dep = MD->getDependency(L);
 
@@ -1951,6 +1997,138 @@ bool GVN::processLoad(LoadInst *L) {
   return false;
 }
 
+/// AnalyzeLoadFromClobberingDef - Return the offset of the value read by L in
+/// the memory written by DepInst, a store or memory intrinsic that clobbers it
+/// in Memory SSA, or -1 if the value can't be extracted from DepInst.
+static int AnalyzeLoadFromClobberingDef(LoadInst *L, Instruction *DepInst,
+                                        const DataLayout *TD) {
+  if (StoreInst *DepSI = dyn_cast<StoreInst>(DepInst)) {
+    if (!DepSI->isUnordered())
+      return -1;
+    if (DepSI->getPointerOperand() == L->getPointerOperand() &&
+        DepSI->getValueOperand()->getType() == L->getType())
+      return 0;
+    if (!TD)
+      return -1;
+    return AnalyzeLoadFromClobberingStore(L->getType(), L->getPointerOperand(),
+                                          DepSI, *TD);
+  }
+
+  if (MemIntrinsic *DepMI = dyn_cast<MemIntrinsic>(DepInst)) {
+    if (!TD)
+      return -1;
+    return AnalyzeLoadFromClobberingMemInst(L->getType(),
+                                            L->getPointerOperand(), DepMI, *TD);
+  }
+
+  return -1;
+}
+
+/// processLoadWithMemorySSA - Attempt to eliminate a load by forwarding the
+/// value written by its clobber in Memory SSA.  Loads that read the same
+/// memory as a dominating load are eliminated by value numbering instead.
+bool GVN::processLoadWithMemorySSA(LoadInst *L) {
+  MemoryAccess *Clobber = MSSA->getClobberingMemoryAccess(L);
+  if (!Clobber)
+    return false;
+
+  if (MemoryPhi *Phi = dyn_cast<MemoryPhi>(Clobber))
+    return processNonLocalLoadWithMemorySSA(L, Phi);
+
+  Value *AvailVal = 0;
+  if (MSSA->isLiveOnEntryDef(Clobber)) {
+    // Nothing in the function writes the memory read by the load, so a load
+    // from a local allocation reads an undefined value.
+    if (isa<AllocaInst>(GetUnderlyingObject(L->getPointerOperand(), TD)))
+      AvailVal = UndefValue::get(L->getType());
+  } else {
+    Instruction *DepInst = cast<MemoryDef>(Clobber)->getMemoryInst();
+    int Offset = AnalyzeLoadFromClobberingDef(L, DepInst, TD);
+    if (Offset != -1) {
+      if (StoreInst *DepSI = dyn_cast<StoreInst>(DepInst)) {
+        AvailVal = DepSI->getValueOperand();
+        if (AvailVal->getType() != L->getType())
+          AvailVal = GetStoreValueForLoad(AvailVal, Offset, L->getType(), L,
+                                          *TD);
+      } else {
+        AvailVal = GetMemInstValueForLoad(cast<MemIntrinsic>(DepInst), Offset,
+                                          L->getType(), L, *TD);
+      }
+    }
+  }
+
+  if (!AvailVal) {
+    DEBUG(
+      // fast print dep, using operator<< on instruction is too slow.
+      dbgs() << "GVN: load ";
+      WriteAsOperand(dbgs(), L);
+      dbgs() << " is clobbered by " << *Clobber << '\n';
+    );
+    return false;
+  }
+
+  DEBUG(dbgs() << "GVN FORWARDED: " << *AvailVal << '\n' << *L << "\n\n\n");
+  L->replaceAllUsesWith(AvailVal);
+  if (AvailVal->getType()->getScalarType()->isPointerTy())
+    MD->invalidateCachedPointerInfo(AvailVal);
+  markInstructionForDeletion(L);
+  ++NumGVNLoad;
+  return true;
+}
+
+/// processNonLocalLoadWithMemorySSA - Attempt to eliminate a load clobbered by
+/// a MemoryPhi by forwarding the values written by the clobbers of all its
+/// incoming versions, and constructing SSA form for them.
+bool GVN::processNonLocalLoadWithMemorySSA(LoadInst *L, MemoryPhi *Phi) {
+  BasicBlock *Join = Phi->getBlock();
+  if (!DT->dominates(Join, L->getParent()))
+    return false;
+
+  // The incoming versions are only walked for the same address if it is
+  // computed before the join.
+  if (Instruction *Ptr = dyn_cast<Instruction>(L->getPointerOperand()))
+    if (!DT->properlyDominates(Ptr->getParent(), Join))
+      return false;
+
+  AliasAnalysis::Location Loc = VN.getAliasAnalysis()->getLocation(L);
+  SmallVector<AvailableValueInBlock, 8> ValuesPerBlock;
+  for (unsigned i = 0, e = Phi->getNumIncomingValues(); i != e; ++i) {
+    BasicBlock *Pred = Phi->getIncomingBlock(i);
+    MemoryAccess *Clobber =
+      MSSA->getClobberingMemoryAccess(Phi->getIncomingValue(i), Loc);
+    MemoryDef *Def = dyn_cast<MemoryDef>(Clobber);
+    if (!Def || MSSA->isLiveOnEntryDef(Def))
+      return false;
+
+    // The forwarded value has to be available at the end of the predecessor.
+    Instruction *DepInst = Def->getMemoryInst();
+    if (!DT->dominates(DepInst->getParent(), Pred))
+      return false;
+
+    int Offset = AnalyzeLoadFromClobberingDef(L, DepInst, TD);
+    if (Offset == -1)
+      return false;
+    if (StoreInst *DepSI = dyn_cast<StoreInst>(DepInst))
+      ValuesPerBlock.push_back(
+        AvailableValueInBlock::get(Pred, DepSI->getValueOperand(), Offset));
+    else
+      ValuesPerBlock.push_back(
+        AvailableValueInBlock::getMI(Pred, cast<MemIntrinsic>(DepInst),
+                                     Offset));
+  }
+
+  DEBUG(dbgs() << "GVN REMOVING NONLOCAL LOAD: " << *L << '\n');
+  Value *V = ConstructSSAForLoadSet(L, ValuesPerBlock, *this);
+  L->replaceAllUsesWith(V);
+  if (isa<PHINode>(V))
+    V->takeName(L);
+  if (V->getType()->getScalarType()->isPointerTy())
+    MD->invalidateCachedPointerInfo(V);
+  markInstructionForDeletion(L);
+  ++NumGVNLoad;
+  return true;
+}
+
 // findLeader - In order to find a leader for a given value number at a
 // specific basic block, we first obtain the list of all Values for that number,
 // and then scan the list to find one whose block dominates the block in
@@ -2173,6 +2351,20 @@ bool GVN::processInstruction(Instruction *I) {
       return true;
 
     unsigned Num = VN.lookup_or_add(LI);
+
+    // With Memory SSA, loads are numbered by the memory they read, so a
+    // dominating load with the same number reads the same value.
+    if (MSSA) {
+      if (Value *Repl = findLeader(LI->getParent(), Num)) {
+        patchAndReplaceAllUsesWith(LI, Repl);
+        if (Repl->getType()->getScalarType()->isPointerTy())
+          MD->invalidateCachedPointerInfo(Repl);
+        markInstructionForDeletion(LI);
+        ++NumGVNLoad;
+        return true;
+      }
+    }
+
     addToLeaderTable(Num, LI, LI->getParent());
     return false;
   }
@@ -2278,6 +2470,10 @@ bool GVN::runOnFunction(Function& F) {
   VN.setMemDep(MD);
   VN.setDomTree(DT);
 
+  // GVN only adds instructions and deletes or replaces values with equivalent
+  // ones, so alias analysis may keep the results of its queries.
+  VN.getAliasAnalysis()->beginCacheScope();
+
   bool Changed = false;
   bool ShouldContinue = true;
 
@@ -2292,6 +2488,11 @@ bool GVN::runOnFunction(Function& F) {
     Changed |= removedBlock;
   }
 
+  if (EnableMemorySSA && !NoLoads) {
+    MSSA.reset(new MemorySSA(F, VN.getAliasAnalysis(), DT));
+    VN.setMemorySSA(MSSA.get());
+  }
+
   unsigned Iteration = 0;
   while (ShouldContinue) {
     DEBUG(dbgs() << "GVN iteration: " << Iteration << "\n");
@@ -2315,6 +2516,9 @@ bool GVN::runOnFunction(Function& F) {
   // Actually, when this happens, we should just fully integrate PRE into GVN.
 
   cleanupGlobalSets();
+  MSSA.reset();
+  VN.setMemorySSA(0);
+  VN.getAliasAnalysis()->endCacheScope();
 
   return Changed;
 }
@@ -2347,6 +2551,7 @@ bool GVN::processBlock(BasicBlock *BB) {
          E = InstrsToErase.end(); I != E; ++I) {
       DEBUG(dbgs() << "GVN removed: " << **I << '\n');
       if (MD) MD->removeInstruction(*I);
+      if (MSSA) MSSA->removeMemoryAccess(*I);
       DEBUG(verifyRemoved(*I));
       (*I)->eraseFromParent();
     }
@@ -2530,6 +2735,7 @@ bool GVN::performPRE(Function &F) {
 
       DEBUG(dbgs() << "GVN PRE removed: " << *CurInst << '\n');
       if (MD) MD->removeInstruction(CurInst);
+      if (MSSA) MSSA->removeMemoryAccess(CurInst);
       DEBUG(verifyRemoved(CurInst));
       CurInst->eraseFromParent();
       Changed = true;
@@ -2547,11 +2753,17 @@ bool GVN::performPRE(Function &F) {
 bool GVN::splitCriticalEdges() {
   if (toSplit.empty())
     return false;
+  Function &F = *toSplit.back().first->getParent()->getParent();
   do {
     std::pair<TerminatorInst*, unsigned> Edge = toSplit.pop_back_val();
     SplitCriticalEdge(Edge.first, Edge.second, this);
   } while (!toSplit.empty());
   if (MD) MD->invalidateCachedPredecessors();
+  // Memory SSA isn't updated for new blocks, build it again.
+  if (MSSA) {
+    MSSA.reset(new MemorySSA(F, VN.getAliasAnalysis(), DT));
+    VN.setMemorySSA(MSSA.get());
+  }
   return true;
 }
 
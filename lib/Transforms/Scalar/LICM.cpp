@@ -74,6 +74,8 @@ namespace {
       initializeLICMPass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *createClone() const { return new LICM(); }
+
     virtual bool runOnLoop(Loop *L, LPPassManager &LPM);
 
     /// This transformation requires natural loop information & requires that
@@ -212,6 +214,7 @@ bool LICM::runOnLoop(Loop *L, LPPassManager &LPM) {
 
   TD = getAnalysisIfAvailable<DataLayout>();
   TLI = &getAnalysis<TargetLibraryInfo>();
+  AA->beginCacheScope();
 
   CurAST = new AliasSetTracker(*AA);
   // Collect Alias info from subloops.
@@ -292,6 +295,7 @@ bool LICM::runOnLoop(Loop *L, LPPassManager &LPM) {
     LoopToAliasSetMap[L] = CurAST;
   else
     delete CurAST;
+  AA->endCacheScope();
   return Changed;
 }
 
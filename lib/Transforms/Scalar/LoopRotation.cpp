@@ -42,6 +42,8 @@ namespace {
       initializeLoopRotatePass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *createClone() const { return new LoopRotate(); }
+
     // LCSSA form makes instruction renaming easier.
     virtual void getAnalysisUsage(AnalysisUsage &AU) const {
       AU.addPreserved<DominatorTree>();
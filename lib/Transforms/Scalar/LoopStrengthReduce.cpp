@@ -4760,6 +4760,8 @@ public:
   static char ID; // Pass ID, replacement for typeid
   LoopStrengthReduce();
 
+  virtual Pass *createClone() const { return new LoopStrengthReduce(); }
+
 private:
   bool runOnLoop(Loop *L, LPPassManager &LPM);
   void getAnalysisUsage(AnalysisUsage &AU) const;
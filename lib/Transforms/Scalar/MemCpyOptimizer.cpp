@@ -312,6 +312,8 @@ namespace {
       TD = 0;
     }
 
+    virtual Pass *createClone() const { return new MemCpyOpt(); }
+
     bool runOnFunction(Function &F);
 
   private:
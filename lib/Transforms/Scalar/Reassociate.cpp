@@ -124,6 +124,8 @@ namespace {
       initializeReassociatePass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *createClone() const { return new Reassociate(); }
+
     bool runOnFunction(Function &F);
 
     virtual void getAnalysisUsage(AnalysisUsage &AU) const {
@@ -1507,6 +1507,8 @@ namespace {
       initializeSCCPPass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *createClone() const { return new SCCP(); }
+
     // runOnFunction - Run the Sparse Conditional Constant Propagation
     // algorithm, and return true if the function was modified.
     //
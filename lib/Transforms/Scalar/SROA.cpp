@@ -1343,6 +1343,8 @@ public:
         C(0), TD(0), DT(0) {
     initializeSROAPass(*PassRegistry::getPassRegistry());
   }
+
+  virtual Pass *createClone() const { return new SROA(RequiresDomTree); }
   bool runOnFunction(Function &F);
   void getAnalysisUsage(AnalysisUsage &AU) const;
 
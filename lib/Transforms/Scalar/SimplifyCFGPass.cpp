@@ -47,6 +47,8 @@ namespace {
       initializeCFGSimplifyPassPass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *createClone() const { return new CFGSimplifyPass(); }
+
     virtual bool runOnFunction(Function &F);
 
     virtual void getAnalysisUsage(AnalysisUsage &AU) const {
@@ -87,6 +87,8 @@ namespace {
       initializeTailCallElimPass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *createClone() const { return new TailCallElim(); }
+
     virtual void getAnalysisUsage(AnalysisUsage &AU) const;
 
     virtual bool runOnFunction(Function &F);
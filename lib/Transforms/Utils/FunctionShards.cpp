@@ -0,0 +1,802 @@
+//===-- FunctionShards.cpp - Run function passes on worker threads --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements -function-pass-threads.  The module is written to
+// bitcode once, and each worker reads its own copy of it into a private
+// LLVMContext, so that nothing the workers create or unique is shared with
+// the module or with each other.  A worker runs clones of the first passes of
+// the function pass manager (up to instruction selection in llc, the first
+// pass that cannot be cloned) on the functions of its shard, in module order,
+// and checks after each function that the passes only changed its body and
+// added declarations or local globals.  It then writes its copy back to
+// bitcode, which the main thread reads into the context of the module when
+// it gets to the first function of the shard, and the bodies are moved over
+// one function at a time as the function pass manager reaches them.
+//
+// Names are what keeps the result identical to a serial run.  The bodies
+// keep the names the workers gave them, and each function's symbol table
+// counter is carried to the worker and back.  New globals are created in the
+// module in the order the serial run would have created them, so if their
+// names conflict, they get the same unique names.  A worker stops at the
+// first function whose passes had a global renamed in its copy of the module,
+// which it sees from the counter of the module's symbol table, since the
+// serial run may have renamed it differently.
+//
+// So does the order of use lists, which bitcode does not keep and which
+// passes that walk the users of a value may depend on.  The order of the uses
+// of the arguments, blocks and instructions of each function is carried to
+// the worker and back along with the body.
+//
+// The output is read back with the identified struct types of the module
+// rather than new ones, so it cannot add types to the module's context.  A
+// shard whose passes created a struct type is not taken.
+//
+// Metadata is read back into the context of the module, where most of it is
+// uniqued to the metadata it was written from, but nodes in cycles, such as
+// debug info, are not.  The module level metadata is therefore listed in a
+// named node of the module's bitcode, which the workers write back out, and
+// the nodes of the output are mapped to the module's by their position in it.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "function-shards"
+#include "llvm/Transforms/Utils/FunctionShards.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/TypeFinder.h"
+#include "llvm/IR/ValueSymbolTable.h"
+#include "llvm/PassManager.h"
+#include "llvm/PassManagers.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/InstIterator.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/ValueHandle.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+#include <algorithm>
+using namespace llvm;
+
+STATISTIC(NumShardedFunctions, "Number of functions run on worker threads");
+STATISTIC(NumShardedPasses, "Number of passes run on worker threads");
+
+/// The named metadata that lists the module level metadata in the bitcode
+/// that is handed to the workers.
+static const char *const MetadataListName = "llvm.function.shards";
+
+static cl::opt<unsigned>
+FunctionPassThreads("function-pass-threads", cl::Hidden, cl::init(0),
+  cl::desc("Run the function passes that support it on this many threads"));
+
+namespace {
+
+/// GlobalState - The properties of a global value that passes running on
+/// other functions must leave alone.
+struct GlobalState {
+  std::string Name, Section;
+  const Value *Operand;
+  AttributeSet Attributes;
+  unsigned Linkage, Visibility, Alignment, CallingConv, ThreadLocalMode;
+  bool UnnamedAddr, Constant;
+
+  explicit GlobalState(const GlobalValue *GV);
+
+  /// describes - Return true if GV is in this state.  If GV is the function
+  /// the passes ran on, only the properties that moving the body back into
+  /// the module does not copy are compared.
+  bool describes(const GlobalValue *GV, bool Own) const;
+};
+
+/// KnownGlobals - The globals at the start of one of the lists of a module
+/// that have been accounted for, with their state and the index of the shard
+/// function that added them (~0U for the ones that were there before).
+struct KnownGlobals {
+  std::vector<GlobalValue*> Values;
+  std::vector<GlobalState> States;
+  std::vector<unsigned> Creators;
+
+  void add(GlobalValue *GV, unsigned Creator) {
+    Values.push_back(GV);
+    States.push_back(GlobalState(GV));
+    Creators.push_back(Creator);
+  }
+
+  /// check - Return the index of the first known global that is not where
+  /// it was or has changed, or the number of known globals if there is none,
+  /// in which case the globals after them are added to Added if it is given.
+  template <typename ListTy>
+  unsigned check(ListTy &List, const GlobalValue *Own,
+                 std::vector<GlobalValue*> *Added) const {
+    typename ListTy::iterator I = List.begin(), E = List.end();
+    for (unsigned i = 0, e = Values.size(); i != e; ++i, ++I)
+      if (I == E || &*I != Values[i] ||
+          !States[i].describes(Values[i], Values[i] == Own))
+        return i;
+    if (Added)
+      for (; I != E; ++I)
+        Added->push_back(&*I);
+    return Values.size();
+  }
+
+  /// getFirstCreator - Return the earliest shard function that added one of
+  /// the globals from index Start on, or ~0U if there is none.
+  unsigned getFirstCreator(unsigned Start) const {
+    for (unsigned i = Start, e = Values.size(); i != e; ++i)
+      if (Creators[i] != ~0U)
+        return Creators[i];
+    return ~0U;
+  }
+};
+
+/// Shard - A run of functions of the module that is handed to one worker.
+struct Shard {
+  // Set up by the main thread before the worker starts.
+  StringRef Input;
+  unsigned NumFunctions, NumVariables, NumAliases;
+  std::vector<unsigned> Functions;
+  std::vector<unsigned> FirstLastUnique;
+  std::vector<std::vector<unsigned> > FirstUseLists;
+  std::vector<Pass*> Passes;
+  void *Thread;
+
+  // Filled in by the worker: the number of functions at the start of the
+  // shard that can be taken, and for each of them whether it was changed,
+  // the symbol table counter and use list order of its body, and where the
+  // globals it added end in the function and variable lists of the output.
+  std::string Output;
+  unsigned NumDone;
+  std::vector<bool> Changed;
+  std::vector<unsigned> LastUnique, FunctionsEnd, VariablesEnd;
+  std::vector<std::vector<unsigned> > UseLists;
+
+  // Used by the main thread to take the results.
+  Module *Result;
+  std::vector<Function*> ResultFunctions;
+  std::vector<GlobalVariable*> ResultVariables;
+  ValueToValueMapTy VMap;
+  unsigned NumTaken;
+
+  Shard() : NumFunctions(0), NumVariables(0), NumAliases(0), Thread(0),
+            NumDone(0), Result(0), NumTaken(0) {}
+  ~Shard() {
+    DeleteContainerPointers(Passes);
+    delete Result;
+  }
+};
+
+/// ModuleShards - The shards of a module, and the results of the workers.
+class ModuleShards : public FunctionShards {
+  Module &M;
+  std::string Input;
+  KnownGlobals Functions, Variables, Aliases;
+  std::vector<StructType*> StructTypes;
+  std::vector<TrackingVH<MDNode> > MetadataNodes;
+  DenseMap<const Function*, std::pair<unsigned, unsigned> > Owners;
+  std::vector<Shard*> Shards;
+  bool Diverged;
+
+  bool readResult(Shard &S);
+  bool mapNewGlobals(Shard &S, unsigned Index);
+  void discard(Shard &S);
+
+public:
+  ModuleShards(Module &M, unsigned NumPasses, ArrayRef<unsigned> Recomputed)
+    : FunctionShards(NumPasses, Recomputed), M(M), Diverged(false) {}
+  ~ModuleShards();
+
+  bool start(FPPassManager &FPPM, unsigned NumThreads);
+  virtual bool takeFunction(Function &F, bool &Changed);
+};
+
+} // end anonymous namespace
+
+GlobalState::GlobalState(const GlobalValue *GV)
+  : Name(GV->getName()), Section(GV->getSection()), Operand(0),
+    Linkage(GV->getLinkage()), Visibility(GV->getVisibility()),
+    Alignment(GV->getAlignment()), CallingConv(0), ThreadLocalMode(0),
+    UnnamedAddr(GV->hasUnnamedAddr()), Constant(false) {
+  if (const Function *F = dyn_cast<Function>(GV)) {
+    Attributes = F->getAttributes();
+    CallingConv = F->getCallingConv();
+  } else if (const GlobalVariable *V = dyn_cast<GlobalVariable>(GV)) {
+    Operand = V->hasInitializer() ? V->getInitializer() : 0;
+    ThreadLocalMode = V->getThreadLocalMode();
+    Constant = V->isConstant();
+  } else {
+    Operand = cast<GlobalAlias>(GV)->getAliasee();
+  }
+}
+
+bool GlobalState::describes(const GlobalValue *GV, bool Own) const {
+  if (GV->getName() != Name || GV->getLinkage() != Linkage)
+    return false;
+  if (Own)
+    return true;
+  if (GV->getSection() != Section || GV->getVisibility() != Visibility ||
+      GV->getAlignment() != Alignment || GV->hasUnnamedAddr() != UnnamedAddr)
+    return false;
+  if (const Function *F = dyn_cast<Function>(GV))
+    return F->getAttributes() == Attributes &&
+           F->getCallingConv() == CallingConv;
+  if (const GlobalVariable *V = dyn_cast<GlobalVariable>(GV))
+    return (V->hasInitializer() ? V->getInitializer() : 0) == Operand &&
+           V->getThreadLocalMode() == ThreadLocalMode &&
+           V->isConstant() == Constant;
+  return cast<GlobalAlias>(GV)->getAliasee() == Operand;
+}
+
+/// collectList - Append the globals in List to Globals.
+template <typename ListTy, typename GlobalTy>
+static void collectList(ListTy &List, std::vector<GlobalTy*> &Globals) {
+  for (typename ListTy::iterator I = List.begin(), E = List.end(); I != E; ++I)
+    Globals.push_back(&*I);
+}
+
+/// collectMetadata - Collect the module level metadata that M refers to, in
+/// a fixed order.
+static void collectMetadata(Module &M,
+                            std::vector<TrackingVH<MDNode> > &Nodes) {
+  SmallVector<MDNode*, 32> Worklist;
+  for (Module::named_metadata_iterator I = M.named_metadata_begin(),
+         E = M.named_metadata_end(); I != E; ++I)
+    for (unsigned i = 0, e = I->getNumOperands(); i != e; ++i)
+      Worklist.push_back(I->getOperand(i));
+  SmallVector<std::pair<unsigned, MDNode*>, 4> Attachments;
+  for (Module::iterator F = M.begin(), FE = M.end(); F != FE; ++F)
+    for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+      I->getAllMetadata(Attachments);
+      for (unsigned i = 0, e = Attachments.size(); i != e; ++i)
+        Worklist.push_back(Attachments[i].second);
+      for (unsigned i = 0, e = I->getNumOperands(); i != e; ++i)
+        if (MDNode *N = dyn_cast<MDNode>(I->getOperand(i)))
+          Worklist.push_back(N);
+    }
+
+  SmallPtrSet<MDNode*, 32> Visited;
+  while (!Worklist.empty()) {
+    MDNode *N = Worklist.pop_back_val();
+    if (!Visited.insert(N))
+      continue;
+    if (!N->isFunctionLocal())
+      Nodes.push_back(N);
+    for (unsigned i = 0, e = N->getNumOperands(); i != e; ++i)
+      if (MDNode *Op = dyn_cast_or_null<MDNode>(N->getOperand(i)))
+        Worklist.push_back(Op);
+  }
+}
+
+/// hasUnwritableOperand - Return true if an instruction of F has an operand
+/// that does not read back from bitcode as it was, like undef metadata.
+static bool hasUnwritableOperand(Function &F) {
+  for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I)
+    for (User::op_iterator OI = I->op_begin(), OE = I->op_end(); OI != OE;
+         ++OI)
+      if ((*OI)->getType()->isMetadataTy() && !isa<MDNode>(*OI) &&
+          !isa<MDString>(*OI))
+        return true;
+  return false;
+}
+
+/// isSafeNewGlobal - Return true if a global that a function pass added to
+/// a worker's copy of the module can be added to the module in its place.
+static bool isSafeNewGlobal(const GlobalValue *GV) {
+  if (isa<GlobalAlias>(GV))
+    return false;
+  return GV->isDeclaration() || (!isa<Function>(GV) && GV->hasLocalLinkage());
+}
+
+/// isLocalValue - Return true if V belongs to the body of a function.
+static bool isLocalValue(const Value *V) {
+  return isa<Argument>(V) || isa<BasicBlock>(V) || isa<Instruction>(V);
+}
+
+/// collectLocalUses - Collect the uses of the values local to F by the
+/// instructions of F, in the order of the instructions and their operands.
+static void collectLocalUses(Function &F,
+                             DenseMap<Value*, SmallVector<Use*, 4> > &Uses) {
+  for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I)
+    for (User::op_iterator OI = I->op_begin(), OE = I->op_end(); OI != OE;
+         ++OI)
+      if (isLocalValue(*OI))
+        Uses[*OI].push_back(OI);
+}
+
+/// collectLocalValues - Collect the values local to F in a fixed order.
+static void collectLocalValues(Function &F, std::vector<Value*> &Values) {
+  for (Function::arg_iterator A = F.arg_begin(), E = F.arg_end(); A != E; ++A)
+    Values.push_back(A);
+  for (Function::iterator BB = F.begin(), BE = F.end(); BB != BE; ++BB) {
+    Values.push_back(BB);
+    for (BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E; ++I)
+      Values.push_back(I);
+  }
+}
+
+/// recordUseLists - Append to Order, for each value local to F with more
+/// than one use, the index of each of its uses among those collected by
+/// collectLocalUses, in the order of its use list.
+static void recordUseLists(Function &F, std::vector<unsigned> &Order) {
+  DenseMap<Value*, SmallVector<Use*, 4> > Uses;
+  collectLocalUses(F, Uses);
+  DenseMap<const Use*, unsigned> Indices;
+  for (DenseMap<Value*, SmallVector<Use*, 4> >::iterator I = Uses.begin(),
+         E = Uses.end(); I != E; ++I)
+    for (unsigned i = 0, e = I->second.size(); i != e; ++i)
+      Indices[I->second[i]] = i;
+
+  std::vector<Value*> Values;
+  collectLocalValues(F, Values);
+  for (unsigned v = 0, ve = Values.size(); v != ve; ++v) {
+    Value *V = Values[v];
+    DenseMap<Value*, SmallVector<Use*, 4> >::iterator U = Uses.find(V);
+    if (U == Uses.end() || U->second.size() < 2)
+      continue;
+    for (Value::use_iterator UI = V->use_begin(), UE = V->use_end(); UI != UE;
+         ++UI) {
+      DenseMap<const Use*, unsigned>::iterator I = Indices.find(&UI.getUse());
+      if (I != Indices.end())
+        Order.push_back(I->second);
+    }
+  }
+}
+
+/// restoreUseLists - Put the use lists of the values local to F, which must
+/// have the same instructions and operands as when Order was recorded, back
+/// in the order recordUseLists recorded.
+static void restoreUseLists(Function &F, const std::vector<unsigned> &Order) {
+  DenseMap<Value*, SmallVector<Use*, 4> > Uses;
+  collectLocalUses(F, Uses);
+  std::vector<Value*> Values;
+  collectLocalValues(F, Values);
+  unsigned Start = 0;
+  for (unsigned v = 0, ve = Values.size(); v != ve; ++v) {
+    Value *V = Values[v];
+    DenseMap<Value*, SmallVector<Use*, 4> >::iterator U = Uses.find(V);
+    if (U == Uses.end() || U->second.size() < 2)
+      continue;
+    unsigned N = U->second.size();
+    assert(Start + N <= Order.size() && "Use lists of a different function!");
+    // Setting a use adds it to the front of the use list.
+    for (unsigned i = N; i-- != 0; )
+      U->second[Order[Start + i]]->set(V);
+    Start += N;
+  }
+}
+
+/// runShard - Run the passes of a shard on its functions in a copy of the
+/// module of its own.
+static void runShard(void *Arg) {
+  Shard &S = *static_cast<Shard*>(Arg);
+  LLVMContext Context;
+  std::string ErrMsg;
+  MemoryBuffer *Buffer = MemoryBuffer::getMemBuffer(S.Input, "", false);
+  OwningPtr<Module> M(getLazyBitcodeModule(Buffer, Context, &ErrMsg));
+  if (!M) {
+    delete Buffer;
+    return;
+  }
+
+  std::vector<Function*> Functions;
+  collectList(M->getFunctionList(), Functions);
+  if (Functions.size() != S.NumFunctions)
+    return;
+
+  // The functions of the other shards stay definitions, like in the module,
+  // but their bodies are never read.
+  for (unsigned i = 0; i != S.NumFunctions; ++i)
+    if (Functions[i]->isMaterializable() &&
+        !std::binary_search(S.Functions.begin(), S.Functions.end(), i))
+      new UnreachableInst(Context,
+                          BasicBlock::Create(Context, "", Functions[i]));
+
+  FunctionPassManager FPM(M.get());
+  for (unsigned i = 0, e = S.Passes.size(); i != e; ++i)
+    FPM.add(S.Passes[i]);
+  S.Passes.clear();
+  FPM.doInitialization();
+
+  KnownGlobals Known[3];
+  for (Module::iterator I = M->begin(), E = M->end(); I != E; ++I)
+    Known[0].add(I, ~0U);
+  for (Module::global_iterator I = M->global_begin(), E = M->global_end();
+       I != E; ++I)
+    Known[1].add(I, ~0U);
+  for (Module::alias_iterator I = M->alias_begin(), E = M->alias_end();
+       I != E; ++I)
+    Known[2].add(I, ~0U);
+  if (Known[0].Values.size() != S.NumFunctions ||
+      Known[1].Values.size() != S.NumVariables ||
+      Known[2].Values.size() != S.NumAliases)
+    return;
+
+  SmallVector<StringRef, 8> MDKinds;
+  Context.getMDKindNames(MDKinds);
+  unsigned NumMDKinds = MDKinds.size();
+
+  for (unsigned i = 0, e = S.Functions.size(); i != e; ++i) {
+    Function *F = Functions[S.Functions[i]];
+    if (F->Materialize(&ErrMsg))
+      break;
+    restoreUseLists(*F, S.FirstUseLists[i]);
+    F->getValueSymbolTable().setLastUnique(S.FirstLastUnique[i]);
+    unsigned ModuleLastUnique = M->getValueSymbolTable().getLastUnique();
+    bool Changed = FPM.run(*F);
+
+    std::vector<GlobalValue*> Added[3];
+    unsigned Unchanged[3] = {
+      Known[0].check(M->getFunctionList(), F, &Added[0]),
+      Known[1].check(M->getGlobalList(), F, &Added[1]),
+      Known[2].check(M->getAliasList(), F, &Added[2])
+    };
+    // A global that got a unique name here may get a different one in the
+    // module, which has the globals the other shards added.
+    bool Safe = M->getValueSymbolTable().getLastUnique() == ModuleLastUnique;
+    for (unsigned k = 0; k != 3; ++k) {
+      Safe &= Unchanged[k] == Known[k].Values.size();
+      for (unsigned a = 0, ae = Added[k].size(); a != ae; ++a)
+        Safe &= isSafeNewGlobal(Added[k][a]);
+    }
+    Context.getMDKindNames(MDKinds);
+    Safe &= MDKinds.size() == NumMDKinds && !hasUnwritableOperand(*F);
+
+    if (!Safe) {
+      // The main thread adds the new globals of the functions it takes as
+      // they are at the end, so none of them may have been changed since.
+      for (unsigned k = 0; k != 3; ++k)
+        S.NumDone = std::min(S.NumDone,
+                             Known[k].getFirstCreator(Unchanged[k]));
+      break;
+    }
+
+    for (unsigned k = 0; k != 3; ++k)
+      for (unsigned a = 0, ae = Added[k].size(); a != ae; ++a)
+        Known[k].add(Added[k][a], i);
+    Known[0].States[S.Functions[i]] = GlobalState(F);
+
+    S.Changed.push_back(Changed);
+    S.LastUnique.push_back(F->getValueSymbolTable().getLastUnique());
+    S.UseLists.push_back(std::vector<unsigned>());
+    recordUseLists(*F, S.UseLists.back());
+    S.FunctionsEnd.push_back(Known[0].Values.size());
+    S.VariablesEnd.push_back(Known[1].Values.size());
+    ++S.NumDone;
+  }
+
+  if (S.NumDone) {
+    raw_string_ostream OS(S.Output);
+    WriteBitcodeToFile(M.get(), OS);
+  }
+}
+
+bool ModuleShards::start(FPPassManager &FPPM, unsigned NumThreads) {
+  // Blockaddresses and garbage collection metadata cannot be moved between
+  // modules function by function, unnamed structs cannot be found again by
+  // name, and some operands do not survive the trip through bitcode.
+  std::vector<Function*> Definitions;
+  std::vector<uint64_t> Sizes;
+  uint64_t TotalSize = 0;
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F) {
+    if (F->hasGC())
+      return false;
+    if (F->isDeclaration())
+      continue;
+    if (hasUnwritableOperand(*F))
+      return false;
+    uint64_t Size = 1;
+    for (Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB) {
+      if (BB->hasAddressTaken())
+        return false;
+      Size += BB->size();
+    }
+    Definitions.push_back(F);
+    Sizes.push_back(Size);
+    TotalSize += Size;
+  }
+  if (Definitions.size() < 2)
+    return false;
+
+  TypeFinder Types;
+  Types.run(M, false);
+  for (TypeFinder::iterator I = Types.begin(), E = Types.end(); I != E; ++I) {
+    if ((*I)->isLiteral())
+      continue;
+    if (!(*I)->hasName())
+      return false;
+    StructTypes.push_back(*I);
+  }
+
+  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
+    Functions.add(I, ~0U);
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E; ++I)
+    Variables.add(I, ~0U);
+  for (Module::alias_iterator I = M.alias_begin(), E = M.alias_end();
+       I != E; ++I)
+    Aliases.add(I, ~0U);
+
+  collectMetadata(M, MetadataNodes);
+  NamedMDNode *MetadataList = M.getOrInsertNamedMetadata(MetadataListName);
+  for (unsigned i = 0, e = MetadataNodes.size(); i != e; ++i)
+    MetadataList->addOperand(MetadataNodes[i]);
+  raw_string_ostream OS(Input);
+  WriteBitcodeToFile(&M, OS);
+  OS.flush();
+  M.eraseNamedMetadata(MetadataList);
+
+  // Divide the definitions into runs of about the same number of
+  // instructions.
+  unsigned NumShards = std::min<size_t>(NumThreads, Definitions.size());
+  DenseMap<const Function*, unsigned> Indices;
+  for (unsigned i = 0, e = Functions.Values.size(); i != e; ++i)
+    Indices[cast<Function>(Functions.Values[i])] = i;
+  uint64_t Assigned = 0;
+  for (unsigned i = 0, e = Definitions.size(); i != e; ++i) {
+    if (Shards.empty() ||
+        (Shards.size() < NumShards &&
+         Assigned * NumShards >= Shards.size() * TotalSize)) {
+      Shard *S = new Shard();
+      S->Input = Input;
+      S->NumFunctions = Functions.Values.size();
+      S->NumVariables = Variables.Values.size();
+      S->NumAliases = Aliases.Values.size();
+      Shards.push_back(S);
+    }
+    Shard &S = *Shards.back();
+    Function *F = Definitions[i];
+    Owners[F] = std::make_pair(Shards.size() - 1, S.Functions.size());
+    S.Functions.push_back(Indices[F]);
+    S.FirstLastUnique.push_back(F->getValueSymbolTable().getLastUnique());
+    S.FirstUseLists.push_back(std::vector<unsigned>());
+    recordUseLists(*F, S.FirstUseLists.back());
+    Assigned += Sizes[i];
+  }
+
+  // Clone the passes here, so the workers never look at the originals.
+  // Analyses that are not cloneable are configured by their constructors.
+  PMTopLevelManager *TPM = FPPM.getTopLevelManager();
+  for (unsigned s = 0, se = Shards.size(); s != se; ++s) {
+    Shard &S = *Shards[s];
+    SmallVectorImpl<ImmutablePass*> &ImmutablePasses =
+      TPM->getImmutablePasses();
+    for (unsigned i = 0, e = ImmutablePasses.size(); i != e; ++i)
+      if (Pass *Clone = ImmutablePasses[i]->createClone())
+        S.Passes.push_back(Clone);
+
+    SmallVector<Pass*, 16> Worklist;
+    for (unsigned Index = getNumPasses(); Index-- != 0; )
+      Worklist.push_back(FPPM.getContainedPass(Index));
+    while (!Worklist.empty()) {
+      Pass *P = Worklist.pop_back_val();
+      if (PMDataManager *PMD = P->getAsPMDataManager()) {
+        // The worker's pass manager schedules its own managers.
+        for (unsigned i = PMD->getNumContainedPasses(); i-- != 0; )
+          Worklist.push_back(PMD->getContainedPassAt(i));
+        continue;
+      }
+      Pass *Clone = P->createClone();
+      S.Passes.push_back(Clone ? Clone : Pass::createPass(P->getPassID()));
+    }
+  }
+
+  if (!llvm_is_multithreaded())
+    llvm_start_multithreaded();
+  for (unsigned s = 0, se = Shards.size(); s != se; ++s) {
+    Shards[s]->Thread = llvm_start_thread(runShard, Shards[s]);
+    if (!Shards[s]->Thread)
+      runShard(Shards[s]);
+  }
+  return true;
+}
+
+ModuleShards::~ModuleShards() {
+  for (unsigned s = 0, se = Shards.size(); s != se; ++s)
+    if (Shards[s]->Thread)
+      llvm_join_thread(Shards[s]->Thread);
+  DeleteContainerPointers(Shards);
+}
+
+void ModuleShards::discard(Shard &S) {
+  S.NumDone = 0;
+  delete S.Result;
+  S.Result = 0;
+  S.ResultFunctions.clear();
+  S.ResultVariables.clear();
+  S.VMap.clear();
+}
+
+/// readResult - Wait for the worker of S, and read its output into the
+/// context of the module.  Return false if there is nothing to take.
+bool ModuleShards::readResult(Shard &S) {
+  if (S.Thread) {
+    llvm_join_thread(S.Thread);
+    S.Thread = 0;
+  }
+  if (S.Result || !S.NumDone)
+    return S.Result != 0;
+
+  // The output's structs are the module's, which fails to read if the
+  // passes added one.
+  OwningPtr<MemoryBuffer> Buffer(MemoryBuffer::getMemBuffer(S.Output, "",
+                                                            false));
+  std::string ErrMsg;
+  S.Result = ParseBitcodeFile(Buffer.get(), M.getContext(), StructTypes,
+                              &ErrMsg);
+  std::string().swap(S.Output);
+
+  bool Mapped = S.Result != 0;
+  if (Mapped) {
+    collectList(S.Result->getFunctionList(), S.ResultFunctions);
+    collectList(S.Result->getGlobalList(), S.ResultVariables);
+    std::vector<GlobalAlias*> ResultAliases;
+    collectList(S.Result->getAliasList(), ResultAliases);
+    Mapped = S.ResultFunctions.size() >= S.FunctionsEnd[S.NumDone - 1] &&
+             S.ResultVariables.size() >= S.VariablesEnd[S.NumDone - 1] &&
+             ResultAliases.size() == S.NumAliases;
+    for (unsigned i = 0; Mapped && i != S.NumFunctions; ++i) {
+      Mapped = S.ResultFunctions[i]->getName() ==
+               Functions.Values[i]->getName();
+      S.VMap[S.ResultFunctions[i]] = Functions.Values[i];
+    }
+    for (unsigned i = 0; Mapped && i != S.NumVariables; ++i) {
+      Mapped = S.ResultVariables[i]->getName() ==
+               Variables.Values[i]->getName();
+      S.VMap[S.ResultVariables[i]] = Variables.Values[i];
+    }
+    for (unsigned i = 0; Mapped && i != S.NumAliases; ++i) {
+      Mapped = ResultAliases[i]->getName() == Aliases.Values[i]->getName();
+      S.VMap[ResultAliases[i]] = Aliases.Values[i];
+    }
+    NamedMDNode *MetadataList = S.Result->getNamedMetadata(MetadataListName);
+    Mapped = Mapped && MetadataList &&
+             MetadataList->getNumOperands() == MetadataNodes.size();
+    for (unsigned i = 0; Mapped && i != MetadataNodes.size(); ++i) {
+      Mapped = MetadataNodes[i] != 0;
+      S.VMap[MetadataList->getOperand(i)] = MetadataNodes[i];
+    }
+  }
+  if (!Mapped)
+    discard(S);
+  return Mapped;
+}
+
+/// mapNewGlobals - Add the globals that the passes added while running on
+/// function Index of S to the module, the way the passes would have added
+/// them there.  Return false, without changing anything, if they cannot be.
+bool ModuleShards::mapNewGlobals(Shard &S, unsigned Index) {
+  std::vector<GlobalValue*> New;
+  for (unsigned i = Index ? S.FunctionsEnd[Index - 1] : S.NumFunctions,
+         e = S.FunctionsEnd[Index]; i != e; ++i)
+    New.push_back(S.ResultFunctions[i]);
+  for (unsigned i = Index ? S.VariablesEnd[Index - 1] : S.NumVariables,
+         e = S.VariablesEnd[Index]; i != e; ++i)
+    New.push_back(S.ResultVariables[i]);
+
+  // Module::getOrInsertFunction renames a local function of the name that
+  // is asked for, which cannot be replayed from the result.
+  for (unsigned i = 0, e = New.size(); i != e; ++i)
+    if (New[i]->isDeclaration() && New[i]->hasName())
+      if (GlobalValue *Existing = M.getNamedValue(New[i]->getName()))
+        if (Existing->hasLocalLinkage())
+          return false;
+
+  for (unsigned i = 0, e = New.size(); i != e; ++i) {
+    GlobalValue *From = New[i];
+    Type *Ty = From->getType();
+
+    // Declarations are asked for by name and reuse what is already there.
+    if (From->isDeclaration() && From->hasName())
+      if (GlobalValue *Existing = M.getNamedValue(From->getName())) {
+        S.VMap[From] = Existing->getType() == Ty ? (Constant*)Existing :
+                       ConstantExpr::getBitCast(Existing, Ty);
+        continue;
+      }
+
+    GlobalValue *To;
+    if (Function *F = dyn_cast<Function>(From)) {
+      To = Function::Create(F->getFunctionType(), F->getLinkage(),
+                            F->getName(), &M);
+    } else {
+      GlobalVariable *V = cast<GlobalVariable>(From);
+      To = new GlobalVariable(M, cast<PointerType>(Ty)->getElementType(),
+                              V->isConstant(), V->getLinkage(), 0,
+                              V->getName(), 0, V->getThreadLocalMode(),
+                              Ty->getPointerAddressSpace());
+    }
+    To->copyAttributesFrom(From);
+    S.VMap[From] = To;
+  }
+
+  for (unsigned i = 0, e = New.size(); i != e; ++i)
+    if (GlobalVariable *V = dyn_cast<GlobalVariable>(New[i]))
+      if (V->hasInitializer())
+        cast<GlobalVariable>(S.VMap[V])->setInitializer(
+          MapValue(V->getInitializer(), S.VMap));
+  return true;
+}
+
+bool ModuleShards::takeFunction(Function &F, bool &Changed) {
+  DenseMap<const Function*, std::pair<unsigned, unsigned> >::iterator
+    Owner = Owners.find(&F);
+  if (Owner == Owners.end() || Diverged)
+    return false;
+  Shard &S = *Shards[Owner->second.first];
+  unsigned Index = Owner->second.second;
+  if (!readResult(S))
+    return false;
+  if (Index != S.NumTaken || Index >= S.NumDone) {
+    discard(S);
+    return false;
+  }
+
+  // The workers ran on the module as it was when it was written out.  If
+  // anything besides the bodies has changed since, they may have gone a
+  // different way.
+  if (Functions.check(M.getFunctionList(), 0, 0) != Functions.Values.size() ||
+      Variables.check(M.getGlobalList(), 0, 0) != Variables.Values.size() ||
+      Aliases.check(M.getAliasList(), 0, 0) != Aliases.Values.size()) {
+    Diverged = true;
+    return false;
+  }
+
+  if (!mapNewGlobals(S, Index)) {
+    discard(S);
+    return false;
+  }
+
+  Function *From = S.ResultFunctions[S.Functions[Index]];
+  F.dropAllReferences();
+  for (Function::arg_iterator A = F.arg_begin(), E = F.arg_end(); A != E; ++A)
+    A->setName("");
+  Function::arg_iterator A = F.arg_begin();
+  for (Function::arg_iterator FromA = From->arg_begin(),
+         E = From->arg_end(); FromA != E; ++FromA, ++A) {
+    A->setName(FromA->getName());
+    S.VMap[FromA] = A;
+  }
+
+  SmallVector<ReturnInst*, 8> Returns;
+  CloneFunctionInto(&F, From, S.VMap, true, Returns);
+  restoreUseLists(F, S.UseLists[Index]);
+  F.getValueSymbolTable().setLastUnique(S.LastUnique[Index]);
+  Functions.States[S.Functions[Index]] = GlobalState(&F);
+  Changed = S.Changed[Index];
+  ++NumShardedFunctions;
+
+  if (++S.NumTaken == S.NumDone)
+    discard(S);
+  return true;
+}
+
+static FunctionShards *shardFunctions(FPPassManager &FPPM, Module &M) {
+  if (FunctionPassThreads < 2)
+    return 0;
+  SmallVector<unsigned, 4> Recomputed;
+  unsigned NumPasses = FPPM.getNumShardablePasses(Recomputed);
+  if (!NumPasses)
+    return 0;
+  OwningPtr<ModuleShards> Shards(new ModuleShards(M, NumPasses, Recomputed));
+  if (!Shards->start(FPPM, FunctionPassThreads))
+    return 0;
+  NumShardedPasses += NumPasses;
+  return Shards.take();
+}
+
+void llvm::enableFunctionPassThreads() {
+  FPPassManager::ShardFunctions = shardFunctions;
+}
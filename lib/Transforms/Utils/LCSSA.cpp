@@ -51,6 +51,8 @@ namespace {
       initializeLCSSAPass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *createClone() const { return new LCSSA(); }
+
     // Cached analysis information for the current function.
     DominatorTree *DT;
     LoopInfo *LI;
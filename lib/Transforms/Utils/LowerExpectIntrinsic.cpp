@@ -52,6 +52,8 @@ namespace {
       initializeLowerExpectIntrinsicPass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *createClone() const { return new LowerExpectIntrinsic(); }
+
     bool runOnFunction(Function &F);
   };
 }
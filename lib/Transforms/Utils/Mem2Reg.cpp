@@ -31,6 +31,8 @@ namespace {
       initializePromotePassPass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *createClone() const { return new PromotePass(); }
+
     // runOnFunction - To run this pass, first we calculate the alloca
     // instructions that are safe for promotion, then we promote each one.
     //
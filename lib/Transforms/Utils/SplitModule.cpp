@@ -0,0 +1,293 @@
+//===-- SplitModule.cpp - Split a module into partitions ------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This family of functions divides the definitions of a module into
+// partitions that can be code generated independently, and restricts copies
+// of the module to one partition each.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Utils/SplitModule.h"
+#include "llvm/ADT/EquivalenceClasses.h"
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/InstIterator.h"
+#include <algorithm>
+using namespace llvm;
+
+namespace {
+/// CallNode - A function in the direct call graph of the module.  The graph
+/// is only used to find SCCs, which are never split across partitions.
+struct CallNode {
+  const Function *F;
+  std::vector<CallNode*> Callees;
+};
+}
+
+namespace llvm {
+template <> struct GraphTraits<CallNode*> {
+  typedef CallNode NodeType;
+  typedef std::vector<CallNode*>::iterator ChildIteratorType;
+
+  static NodeType *getEntryNode(CallNode *N) { return N; }
+  static ChildIteratorType child_begin(NodeType *N) {
+    return N->Callees.begin();
+  }
+  static ChildIteratorType child_end(NodeType *N) { return N->Callees.end(); }
+};
+}
+
+typedef SetVector<const GlobalValue*> GlobalSetVector;
+
+/// findUsingGlobals - Collect the functions and global variables whose body
+/// or initializer refers to \p V, looking through constant expressions.
+static void findUsingGlobals(const Value *V, GlobalSetVector &Users) {
+  for (Value::const_use_iterator UI = V->use_begin(), UE = V->use_end();
+       UI != UE; ++UI) {
+    if (const Instruction *I = dyn_cast<Instruction>(*UI))
+      Users.insert(I->getParent()->getParent());
+    else if (const GlobalValue *GV = dyn_cast<GlobalValue>(*UI))
+      Users.insert(GV);
+    else if (const Constant *C = dyn_cast<Constant>(*UI))
+      findUsingGlobals(C, Users);
+  }
+}
+
+/// getInstructionCount - Return the number of instructions in \p F, which
+/// is used as an estimate of its code generation cost.
+static unsigned getInstructionCount(const Function &F) {
+  unsigned Count = 0;
+  for (Function::const_iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+    Count += BB->size();
+  return Count;
+}
+
+static bool isLargerUnit(const std::pair<unsigned, const GlobalValue*> &A,
+                         const std::pair<unsigned, const GlobalValue*> &B) {
+  return A.first > B.first;
+}
+
+void llvm::partitionModule(Module &M, unsigned NumPartitions,
+                           ModulePartitionMap &Partitions) {
+  EquivalenceClasses<const GlobalValue*> Units;
+
+  // Build the direct call graph, rooted at a node that calls every function.
+  std::vector<CallNode> Nodes(M.size());
+  DenseMap<const Function*, CallNode*> NodeMap;
+  CallNode Root;
+  Root.F = 0;
+  unsigned Idx = 0;
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F, ++Idx) {
+    Nodes[Idx].F = F;
+    NodeMap[F] = &Nodes[Idx];
+  }
+  for (unsigned i = 0, e = Nodes.size(); i != e; ++i) {
+    const Function *F = Nodes[i].F;
+    if (F->isDeclaration())
+      continue;
+    Root.Callees.push_back(&Nodes[i]);
+    SmallPtrSet<const Function*, 16> Seen;
+    for (const_inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I)
+      for (unsigned op = 0, ope = I->getNumOperands(); op != ope; ++op) {
+        const Function *Callee =
+          dyn_cast<Function>(I->getOperand(op)->stripPointerCasts());
+        if (Callee && !Callee->isDeclaration() && Seen.insert(Callee))
+          Nodes[i].Callees.push_back(NodeMap[Callee]);
+      }
+  }
+
+  for (scc_iterator<CallNode*> I = scc_begin(&Root), E = scc_end(&Root);
+       I != E; ++I) {
+    std::vector<CallNode*> &SCC = *I;
+    if (!SCC[0]->F)
+      continue;
+    for (unsigned i = 0, e = SCC.size(); i != e; ++i)
+      Units.unionSets(SCC[0]->F, SCC[i]->F);
+  }
+
+  // An alias must be emitted together with the object it aliases.
+  for (Module::alias_iterator A = M.alias_begin(), E = M.alias_end();
+       A != E; ++A)
+    if (const GlobalValue *Aliasee = A->resolveAliasedGlobal(false))
+      Units.unionSets(A, Aliasee);
+
+  // A blockaddress can only be resolved in the partition that defines its
+  // function.
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F)
+    for (Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB) {
+      if (!BB->hasAddressTaken())
+        continue;
+      GlobalSetVector Users;
+      findUsingGlobals(BlockAddress::get(BB), Users);
+      for (unsigned i = 0, e = Users.size(); i != e; ++i)
+        Units.unionSets(F, Users[i]);
+    }
+
+  // Collect the units that contain code, in module order, along with their
+  // sizes.
+  std::vector<std::pair<unsigned, const GlobalValue*> > CodeUnits;
+  DenseMap<const GlobalValue*, unsigned> UnitSize;
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F) {
+    if (F->isDeclaration())
+      continue;
+    const GlobalValue *Leader = Units.getOrInsertLeaderValue(F);
+    if (!UnitSize.count(Leader))
+      CodeUnits.push_back(std::make_pair(0U, Leader));
+    UnitSize[Leader] += getInstructionCount(*F) + 1;
+  }
+  for (unsigned i = 0, e = CodeUnits.size(); i != e; ++i)
+    CodeUnits[i].first = UnitSize[CodeUnits[i].second];
+
+  // Hand out the largest units first, each to the least loaded partition.
+  std::stable_sort(CodeUnits.begin(), CodeUnits.end(), isLargerUnit);
+  DenseMap<const GlobalValue*, unsigned> UnitPartition;
+  std::vector<unsigned> Load(NumPartitions, 0);
+  for (unsigned i = 0, e = CodeUnits.size(); i != e; ++i) {
+    unsigned Best = std::min_element(Load.begin(), Load.end()) - Load.begin();
+    Load[Best] += CodeUnits[i].first;
+    UnitPartition[CodeUnits[i].second] = Best;
+  }
+
+  // Everything else lands in the partition of the first function that uses
+  // it, or in the first partition if there is no such function.
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F)
+    if (!F->isDeclaration())
+      Partitions[F] = UnitPartition[Units.getLeaderValue(F)];
+  for (Module::global_iterator GV = M.global_begin(), E = M.global_end();
+       GV != E; ++GV) {
+    if (GV->isDeclaration())
+      continue;
+    const GlobalValue *Leader = Units.getOrInsertLeaderValue(GV);
+    if (UnitPartition.count(Leader)) {
+      Partitions[GV] = UnitPartition[Leader];
+      continue;
+    }
+    unsigned Part = 0;
+    GlobalSetVector Users;
+    if (!GV->hasAppendingLinkage())
+      findUsingGlobals(GV, Users);
+    for (unsigned i = 0, e = Users.size(); i != e; ++i)
+      if (isa<Function>(Users[i])) {
+        Part = Partitions[Users[i]];
+        break;
+      }
+    Partitions[GV] = Part;
+    UnitPartition[Leader] = Part;
+  }
+  for (Module::alias_iterator A = M.alias_begin(), E = M.alias_end();
+       A != E; ++A) {
+    const GlobalValue *Leader = Units.getOrInsertLeaderValue(A);
+    Partitions[A] = UnitPartition.count(Leader) ? UnitPartition[Leader] : 0;
+  }
+}
+
+void llvm::promoteCrossPartitionReferences(Module &M,
+                                        const ModulePartitionMap &Partitions) {
+  std::vector<GlobalValue*> Globals;
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F)
+    Globals.push_back(F);
+  for (Module::global_iterator GV = M.global_begin(), E = M.global_end();
+       GV != E; ++GV)
+    Globals.push_back(GV);
+  for (Module::alias_iterator A = M.alias_begin(), E = M.alias_end();
+       A != E; ++A)
+    Globals.push_back(A);
+
+  for (unsigned i = 0, e = Globals.size(); i != e; ++i) {
+    GlobalValue *GV = Globals[i];
+    if (GV->isDeclaration())
+      continue;
+    if (!GV->hasName())
+      GV->setName("__llvm_lto_anon");
+    if (!GV->hasLocalLinkage())
+      continue;
+
+    unsigned Part = Partitions.lookup(GV);
+    GlobalSetVector Users;
+    findUsingGlobals(GV, Users);
+    bool UsedElsewhere = false;
+    for (unsigned u = 0, ue = Users.size(); u != ue && !UsedElsewhere; ++u)
+      UsedElsewhere = Partitions.lookup(Users[u]) != Part;
+    if (!UsedElsewhere)
+      continue;
+
+    GV->setName(GV->getName() + ".lto_priv");
+    GV->setLinkage(GlobalValue::ExternalLinkage);
+    GV->setVisibility(GlobalValue::HiddenVisibility);
+  }
+}
+
+void llvm::restrictToPartition(Module &M, const StringSet<> &Defined,
+                               bool KeepAppending) {
+  std::vector<GlobalValue*> Dropped;
+
+  // Aliases cannot be declarations, so replace them with a declaration of
+  // the right kind.
+  for (Module::alias_iterator I = M.alias_begin(), E = M.alias_end();
+       I != E; ) {
+    GlobalAlias *GA = I++;
+    if (Defined.count(GA->getName()))
+      continue;
+    Type *Ty = GA->getType()->getElementType();
+    GlobalValue *Decl;
+    if (FunctionType *FTy = dyn_cast<FunctionType>(Ty)) {
+      Decl = Function::Create(FTy, GlobalValue::ExternalLinkage, "", &M);
+    } else {
+      // Accesses through the declaration must use the TLS model of the
+      // variable the alias stands for.
+      GlobalVariable::ThreadLocalMode TLM = GlobalVariable::NotThreadLocal;
+      if (const GlobalVariable *Aliasee =
+            dyn_cast_or_null<GlobalVariable>(GA->resolveAliasedGlobal(false)))
+        TLM = Aliasee->getThreadLocalMode();
+      Decl = new GlobalVariable(M, Ty, false, GlobalValue::ExternalLinkage,
+                                0, "", 0, TLM,
+                                GA->getType()->getAddressSpace());
+    }
+    Decl->takeName(GA);
+    Decl->setVisibility(GA->getVisibility());
+    GA->replaceAllUsesWith(Decl);
+    GA->eraseFromParent();
+    Dropped.push_back(Decl);
+  }
+
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F) {
+    if (F->isDeclaration() || Defined.count(F->getName()))
+      continue;
+    F->deleteBody();
+    Dropped.push_back(F);
+  }
+
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E; ) {
+    GlobalVariable *GV = I++;
+    if (GV->hasAppendingLinkage()) {
+      if (!KeepAppending)
+        GV->eraseFromParent();
+      continue;
+    }
+    if (GV->isDeclaration() || Defined.count(GV->getName()))
+      continue;
+    GV->setInitializer(0);
+    GV->setLinkage(GlobalValue::ExternalLinkage);
+    Dropped.push_back(GV);
+  }
+
+  // Declarations that are no longer referenced would only leave behind stale
+  // references from debug info, so delete them.
+  for (unsigned i = 0, e = Dropped.size(); i != e; ++i) {
+    GlobalValue *GV = Dropped[i];
+    GV->removeDeadConstantUsers();
+    if (GV->use_empty())
+      GV->eraseFromParent();
+  }
+}
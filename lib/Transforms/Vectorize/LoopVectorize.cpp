@@ -101,6 +101,14 @@ static cl::opt<bool>
 EnableIfConversion("enable-if-conversion", cl::init(true), cl::Hidden,
                    cl::desc("Enable if-conversion during vectorization."));
 
+static cl::opt<bool>
+EnableInterleavedMemAccesses("enable-interleaved-mem-accesses", cl::init(true),
+                             cl::Hidden,
+                             cl::desc("Vectorize strided loads and stores, "
+                                      "such as the fields of an array of "
+                                      "structs, with wide accesses and "
+                                      "shuffles."));
+
 /// We don't vectorize loops with a known constant trip count below this number.
 static cl::opt<unsigned>
 TinyTripCountVectorThreshold("vectorizer-min-trip-count", cl::init(16),
@@ -116,6 +124,10 @@ static const unsigned TinyTripCountUnrollThreshold = 128;
 /// number of pointers. Notice that the check is quadratic!
 static const unsigned RuntimeMemoryCheckThreshold = 4;
 
+/// The largest stride, in elements, of the strided accesses that we combine
+/// into an interleave group.
+static const unsigned MaxInterleaveFactor = 8;
+
 /// We use a metadata with this name  to indicate that a scalar loop was
 /// vectorized and that we don't need to re-vectorize it if we run into it
 /// again.
@@ -204,6 +216,12 @@ private:
   void vectorizeMemoryInstruction(Instruction *Instr,
                                   LoopVectorizationLegality *Legal);
 
+  /// Vectorize the interleave group of the Load or Store Instr. The whole
+  /// group is emitted as one wide access per unroll part when we reach its
+  /// insert position.
+  void vectorizeInterleaveGroup(Instruction *Instr,
+                                LoopVectorizationLegality *Legal);
+
   /// Create a broadcast instruction. This method generates a broadcast
   /// instruction (shuffle) for loop invariant values and for the induction
   /// value. If this is the induction variable then we extend it to N, N+1, ...
@@ -333,7 +351,7 @@ public:
                             DominatorTree *DT, TargetTransformInfo* TTI,
                             AliasAnalysis *AA, TargetLibraryInfo *TLI)
       : TheLoop(L), SE(SE), DL(DL), DT(DT), TTI(TTI), AA(AA), TLI(TLI),
-        Induction(0) {}
+        Induction(0), NeedsScalarEpilogue(false) {}
 
   /// This enum represents the kinds of reductions that we support.
   enum ReductionKind {
@@ -344,7 +362,20 @@ public:
     RK_IntegerAnd,  ///< Bitwise or logical AND of numbers.
     RK_IntegerXor,  ///< Bitwise or logical XOR of numbers.
     RK_FloatAdd,    ///< Sum of floats.
-    RK_FloatMult    ///< Product of floats.
+    RK_FloatMult,   ///< Product of floats.
+    RK_IntegerMinMax, ///< Min/max of integers, in terms of select(cmp()).
+    RK_FloatMinMax    ///< Min/max of floats, in terms of select(cmp()).
+  };
+
+  /// This enum represents the kinds of min/max reductions.
+  enum MinMaxReductionKind {
+    MRK_Invalid,  ///< Not a min/max pattern.
+    MRK_UIntMin,  ///< Unsigned integer minimum.
+    MRK_UIntMax,  ///< Unsigned integer maximum.
+    MRK_SIntMin,  ///< Signed integer minimum.
+    MRK_SIntMax,  ///< Signed integer maximum.
+    MRK_FloatMin, ///< Floating point minimum.
+    MRK_FloatMax  ///< Floating point maximum.
   };
 
   /// This enum represents the kinds of inductions that we support.
@@ -359,10 +390,11 @@ public:
   /// This POD struct holds information about reduction variables.
   struct ReductionDescriptor {
     ReductionDescriptor() : StartValue(0), LoopExitInstr(0),
-      Kind(RK_NoReduction) {}
+      Kind(RK_NoReduction), MinMaxKind(MRK_Invalid) {}
 
-    ReductionDescriptor(Value *Start, Instruction *Exit, ReductionKind K)
-        : StartValue(Start), LoopExitInstr(Exit), Kind(K) {}
+    ReductionDescriptor(Value *Start, Instruction *Exit, ReductionKind K,
+                        MinMaxReductionKind MK)
+        : StartValue(Start), LoopExitInstr(Exit), Kind(K), MinMaxKind(MK) {}
 
     // The starting value of the reduction.
     // It does not have to be zero!
@@ -371,6 +403,8 @@ public:
     Instruction *LoopExitInstr;
     // The kind of the reduction.
     ReductionKind Kind;
+    // The kind of min/max, if this is a min/max reduction.
+    MinMaxReductionKind MinMaxKind;
   };
 
   // This POD struct holds information about the memory runtime legality
@@ -384,10 +418,14 @@ public:
       Pointers.clear();
       Starts.clear();
       Ends.clear();
+      InterleavedObjects.clear();
     }
 
-    /// Insert a pointer and calculate the start and end SCEVs.
-    void insert(ScalarEvolution *SE, Loop *Lp, Value *Ptr);
+    /// Insert a pointer and calculate the start and end SCEVs.  If Ptr is
+    /// accessed by an interleave group, InterleavedObject is the object it
+    /// points into.
+    void insert(ScalarEvolution *SE, Loop *Lp, Value *Ptr,
+                Value *InterleavedObject);
 
     /// This flag indicates if we need to add the runtime check.
     bool Need;
@@ -397,6 +435,43 @@ public:
     SmallVector<const SCEV*, 2> Starts;
     /// Holds the pointer value at the end of the loop.
     SmallVector<const SCEV*, 2> Ends;
+    /// Holds the object that the pointer points into if it is accessed by an
+    /// interleave group, or null.  The accesses of interleave groups to the
+    /// same object have been checked against each other already, and their
+    /// ranges always overlap, so they are not compared at runtime.
+    SmallVector<Value*, 2> InterleavedObjects;
+  };
+
+  /// An interleave group is a set of loads, or of stores, in the same block
+  /// whose addresses advance by the same constant stride and which access
+  /// different elements within that stride, such as the fields of an array of
+  /// structs. The group is vectorized with one wide access and shuffles.
+  struct InterleaveGroup {
+    InterleaveGroup() : Factor(0), Alignment(0), InsertPos(0), InsertIdx(0) {}
+
+    /// Returns the position of the member I within the stride.
+    unsigned getIndex(Instruction *I) const {
+      for (unsigned i = 0; i < Factor; ++i)
+        if (Members[i] == I)
+          return i;
+      llvm_unreachable("Not a member of the group");
+    }
+
+    /// The stride in elements, which is the number of members of a full
+    /// group.
+    unsigned Factor;
+    /// The alignment of the access to member zero.
+    unsigned Alignment;
+    /// The members by their position within the stride. Member zero is
+    /// always present. Load groups may have gaps, which are null.
+    SmallVector<Instruction*, 8> Members;
+    /// The positions of the members within their block, in the same order.
+    SmallVector<unsigned, 8> Positions;
+    /// The member at which the wide access is emitted: the first load or the
+    /// last store of the group.
+    Instruction *InsertPos;
+    /// The position of InsertPos within its block.
+    unsigned InsertIdx;
   };
 
   /// A POD for saving information about induction variables.
@@ -461,6 +536,18 @@ public:
 
   /// Returns the information that we collected about runtime memory check.
   RuntimePointerCheck *getRuntimePointerCheck() { return &PtrRtCheck; }
+
+  /// Returns the interleave group of the Load or Store I, or null if I is
+  /// not part of one.
+  const InterleaveGroup *getInterleaveGroup(Instruction *I) {
+    DenseMap<Instruction*, unsigned>::iterator It = InterleaveGroupMap.find(I);
+    return It == InterleaveGroupMap.end() ? 0 : &InterleaveGroups[It->second];
+  }
+
+  /// Returns true if the vector loop must leave at least one iteration to
+  /// the scalar loop. The wide loads of groups with gaps at their end read
+  /// past the elements that the last iteration uses.
+  bool requiresScalarEpilogue() { return NeedsScalarEpilogue; }
 private:
   /// Check if a single basic block loop is vectorizable.
   /// At this point we know that this is a loop with a constant trip count
@@ -480,6 +567,21 @@ private:
   /// Collect the variables that need to stay uniform after vectorization.
   void collectLoopUniforms();
 
+  /// Find the loads and stores with a constant stride that can be combined
+  /// into interleave groups.
+  void collectInterleaveGroups();
+
+  /// Returns true if the memory access I and the stores in Writes are all
+  /// members of interleave groups that never access the same element in
+  /// different iterations, and that keep the order of the accesses within an
+  /// iteration.
+  bool isSafeInterleavedAccess(Instruction *I,
+                               const std::vector<Instruction*> &Writes);
+
+  /// Returns the object that the load or store I points into if I is a
+  /// member of an interleave group, or null.
+  Value *getInterleavedObject(Instruction *I);
+
   /// Return true if all of the instructions in the block can be speculatively
   /// executed.
   bool blockCanBePredicated(BasicBlock *BB);
@@ -490,6 +592,15 @@ private:
   /// Returns true if the instruction I can be a reduction variable of type
   /// 'Kind'.
   bool isReductionInstr(Instruction *I, ReductionKind Kind);
+  /// Returns the kind of min/max that the select I computes, if it selects
+  /// one of the two operands of its compare.
+  static MinMaxReductionKind isMinMaxSelectCmpPattern(Instruction *I);
+  /// Returns true if the user U of Iter can be skipped while following the
+  /// reduction chain of kind 'Kind', because the chain reaches it through
+  /// another user of Iter. This is the compare of a min/max or the select of
+  /// a conditional accumulation.
+  bool isSkippedReductionUser(Instruction *U, Instruction *Iter,
+                              ReductionKind Kind);
   /// Returns the induction kind of Phi. This function may return NoInduction
   /// if the PHI is not an induction variable.
   InductionKind isInductionVariable(PHINode *Phi);
@@ -540,6 +651,12 @@ private:
   /// We need to check that all of the pointers in this list are disjoint
   /// at runtime.
   RuntimePointerCheck PtrRtCheck;
+  /// The interleave groups of the loop.
+  SmallVector<InterleaveGroup, 4> InterleaveGroups;
+  /// Maps the members of the interleave groups to their group.
+  DenseMap<Instruction*, unsigned> InterleaveGroupMap;
+  /// True if a load group has gaps at its end.
+  bool NeedsScalarEpilogue;
 };
 
 /// LoopVectorizationCostModel - estimates the expected speedups due to
@@ -737,7 +854,8 @@ struct LoopVectorize : public LoopPass {
 
 void
 LoopVectorizationLegality::RuntimePointerCheck::insert(ScalarEvolution *SE,
-                                                       Loop *Lp, Value *Ptr) {
+                                                       Loop *Lp, Value *Ptr,
+                                                     Value *InterleavedObject) {
   const SCEV *Sc = SE->getSCEV(Ptr);
   const SCEVAddRecExpr *AR = dyn_cast<SCEVAddRecExpr>(Sc);
   assert(AR && "Invalid addrec expression");
@@ -746,6 +864,7 @@ LoopVectorizationLegality::RuntimePointerCheck::insert(ScalarEvolution *SE,
   Pointers.push_back(Ptr);
   Starts.push_back(AR->getStart());
   Ends.push_back(ScEnd);
+  InterleavedObjects.push_back(InterleavedObject);
 }
 
 Value *InnerLoopVectorizer::getBroadcastInstrs(Value *V) {
@@ -893,8 +1012,141 @@ Value *InnerLoopVectorizer::reverseVector(Value *Vec) {
 }
 
 
+/// \brief Return a shuffle mask that selects every \p Stride'th element,
+/// starting at \p Start: <Start, Start + Stride, ..., Start + (VF-1)*Stride>.
+static Constant *getStridedMask(IRBuilder<> &Builder, unsigned Start,
+                                unsigned Stride, unsigned VF) {
+  SmallVector<Constant*, 16> Mask;
+  for (unsigned i = 0; i < VF; ++i)
+    Mask.push_back(Builder.getInt32(Start + i * Stride));
+  return ConstantVector::get(Mask);
+}
+
+/// \brief Return a shuffle mask that interleaves the elements of the
+/// concatenation of \p NumVecs vectors of \p VF elements:
+/// <0, VF, ..., (NumVecs-1)*VF, 1, VF+1, ...>.
+static Constant *getInterleavedMask(IRBuilder<> &Builder, unsigned VF,
+                                    unsigned NumVecs) {
+  SmallVector<Constant*, 16> Mask;
+  for (unsigned i = 0; i < VF; ++i)
+    for (unsigned j = 0; j < NumVecs; ++j)
+      Mask.push_back(Builder.getInt32(j * VF + i));
+  return ConstantVector::get(Mask);
+}
+
+/// \brief Concatenate two vectors. \p V2 may be shorter than \p V1, in which
+/// case it is first widened with undef elements.
+static Value *concatenateTwoVectors(IRBuilder<> &Builder, Value *V1,
+                                    Value *V2) {
+  unsigned NumElts1 = cast<VectorType>(V1->getType())->getNumElements();
+  unsigned NumElts2 = cast<VectorType>(V2->getType())->getNumElements();
+  assert(NumElts1 >= NumElts2 && "Unexpected vector sizes");
+
+  if (NumElts1 > NumElts2) {
+    SmallVector<Constant*, 16> Mask;
+    for (unsigned i = 0; i < NumElts1; ++i)
+      Mask.push_back(i < NumElts2 ? (Constant*)Builder.getInt32(i) :
+                     UndefValue::get(Builder.getInt32Ty()));
+    V2 = Builder.CreateShuffleVector(V2, UndefValue::get(V2->getType()),
+                                     ConstantVector::get(Mask));
+  }
+
+  SmallVector<Constant*, 16> Mask;
+  for (unsigned i = 0; i < NumElts1 + NumElts2; ++i)
+    Mask.push_back(Builder.getInt32(i));
+  return Builder.CreateShuffleVector(V1, V2, ConstantVector::get(Mask));
+}
+
+/// \brief Concatenate the vectors in \p Vecs, which all have the same type.
+static Value *concatenateVectors(IRBuilder<> &Builder,
+                                 SmallVectorImpl<Value*> &Vecs) {
+  while (Vecs.size() > 1) {
+    SmallVector<Value*, 8> Concat;
+    for (unsigned i = 0, e = Vecs.size(); i + 1 < e; i += 2)
+      Concat.push_back(concatenateTwoVectors(Builder, Vecs[i], Vecs[i + 1]));
+    if (Vecs.size() % 2)
+      Concat.push_back(Vecs.back());
+    Vecs.swap(Concat);
+  }
+  return Vecs[0];
+}
+
+void InnerLoopVectorizer::vectorizeInterleaveGroup(Instruction *Instr,
+                                             LoopVectorizationLegality *Legal) {
+  const LoopVectorizationLegality::InterleaveGroup *Group =
+    Legal->getInterleaveGroup(Instr);
+  assert(Group && "Instruction is not in an interleave group");
+
+  // The whole group is vectorized at its insert position, the first load or
+  // the last store. The other members have nothing left to do.
+  if (Instr != Group->InsertPos)
+    return;
+
+  LoadInst *LI = dyn_cast<LoadInst>(Instr);
+  StoreInst *SI = dyn_cast<StoreInst>(Instr);
+  Type *ScalarTy = LI ? LI->getType() : SI->getValueOperand()->getType();
+  Value *Ptr = LI ? LI->getPointerOperand() : SI->getPointerOperand();
+  unsigned AS = LI ? LI->getPointerAddressSpace() :
+    SI->getPointerAddressSpace();
+  unsigned Factor = Group->Factor;
+  unsigned Index = Group->getIndex(Instr);
+  Type *WideTy = VectorType::get(ScalarTy, VF * Factor);
+
+  // Find the address of member zero in the first lane of each part.
+  Constant *Zero = Builder.getInt32(0);
+  VectorParts &PtrParts = getVectorValue(Ptr);
+  SmallVector<Value*, 2> WidePtrs;
+  for (unsigned Part = 0; Part < UF; ++Part) {
+    Value *PartPtr = PtrParts[Part];
+    if (PartPtr->getType()->isVectorTy())
+      PartPtr = Builder.CreateExtractElement(PartPtr, Zero);
+    if (Index)
+      PartPtr = Builder.CreateGEP(PartPtr, Builder.getInt32(-(int)Index));
+    WidePtrs.push_back(Builder.CreateBitCast(PartPtr,
+                                             WideTy->getPointerTo(AS)));
+  }
+
+  if (LI) {
+    for (unsigned Part = 0; Part < UF; ++Part) {
+      LoadInst *WideLoad = Builder.CreateLoad(WidePtrs[Part], "wide.vec");
+      WideLoad->setAlignment(Group->Alignment);
+
+      // Extract the elements of each member.
+      for (unsigned i = 0; i < Factor; ++i) {
+        Instruction *Member = Group->Members[i];
+        if (!Member)
+          continue;
+        Value *Strided = Builder.CreateShuffleVector(
+          WideLoad, UndefValue::get(WideTy),
+          getStridedMask(Builder, i, Factor, VF), "strided.vec");
+        WidenMap.get(Member)[Part] = Strided;
+      }
+    }
+    return;
+  }
+
+  for (unsigned Part = 0; Part < UF; ++Part) {
+    // Interleave the stored values of all of the members.
+    SmallVector<Value*, 8> StoredVecs;
+    for (unsigned i = 0; i < Factor; ++i) {
+      StoreInst *Member = cast<StoreInst>(Group->Members[i]);
+      StoredVecs.push_back(getVectorValue(Member->getValueOperand())[Part]);
+    }
+    Value *WideVec = concatenateVectors(Builder, StoredVecs);
+    Value *Interleaved = Builder.CreateShuffleVector(
+      WideVec, UndefValue::get(WideTy), getInterleavedMask(Builder, VF, Factor),
+      "interleaved.vec");
+    Builder.CreateStore(Interleaved, WidePtrs[Part])
+      ->setAlignment(Group->Alignment);
+  }
+}
+
 void InnerLoopVectorizer::vectorizeMemoryInstruction(Instruction *Instr,
                                              LoopVectorizationLegality *Legal) {
+  // Accesses in interleave groups are vectorized together.
+  if (Legal->getInterleaveGroup(Instr))
+    return vectorizeInterleaveGroup(Instr, Legal);
+
   // Attempt to issue a wide load.
   LoadInst *LI = dyn_cast<LoadInst>(Instr);
   StoreInst *SI = dyn_cast<StoreInst>(Instr);
@@ -1110,6 +1362,11 @@ InnerLoopVectorizer::addRuntimeCheck(LoopVectorizationLegality *Legal,
 
   for (unsigned i = 0; i < NumPointers; ++i) {
     for (unsigned j = i+1; j < NumPointers; ++j) {
+      if (PtrRtCheck->InterleavedObjects[i] &&
+          PtrRtCheck->InterleavedObjects[i] ==
+            PtrRtCheck->InterleavedObjects[j])
+        continue;
+
       Value *Start0 = ChkBuilder.CreateBitCast(Starts[i], PtrArithTy, "bc");
       Value *Start1 = ChkBuilder.CreateBitCast(Starts[j], PtrArithTy, "bc");
       Value *End0 =   ChkBuilder.CreateBitCast(Ends[i],   PtrArithTy, "bc");
@@ -1245,6 +1502,13 @@ InnerLoopVectorizer::createEmptyLoop(LoopVectorizationLegality *Legal) {
   // Now we need to generate the expression for N - (N % VF), which is
   // the part that the vectorized body will execute.
   Value *R = BypassBuilder.CreateURem(Count, Step, "n.mod.vf");
+  // The wide loads of an interleave group with gaps at its end read past the
+  // last element of the last iteration, so leave at least one iteration to
+  // the scalar loop.
+  if (Legal->requiresScalarEpilogue()) {
+    Value *IsZero = BypassBuilder.CreateICmpEQ(R, ConstantInt::get(IdxTy, 0));
+    R = BypassBuilder.CreateSelect(IsZero, Step, R);
+  }
   Value *CountRoundDown = BypassBuilder.CreateSub(Count, R, "n.vec");
   Value *IdxEndRoundDown = BypassBuilder.CreateAdd(CountRoundDown, StartIdx,
                                                      "end.idx.rnd.down");
@@ -1588,6 +1852,44 @@ getReductionBinOp(LoopVectorizationLegality::ReductionKind Kind) {
   }
 }
 
+/// This function creates the compare and select that compute the min/max of
+/// Left and Right for the min/max kind RK.
+static Value *
+createMinMaxOp(IRBuilder<> &Builder,
+               LoopVectorizationLegality::MinMaxReductionKind RK,
+               Value *Left, Value *Right) {
+  CmpInst::Predicate P = CmpInst::ICMP_NE;
+  switch (RK) {
+  default:
+    llvm_unreachable("Unknown min/max reduction kind");
+  case LoopVectorizationLegality::MRK_UIntMin:
+    P = CmpInst::ICMP_ULT;
+    break;
+  case LoopVectorizationLegality::MRK_UIntMax:
+    P = CmpInst::ICMP_UGT;
+    break;
+  case LoopVectorizationLegality::MRK_SIntMin:
+    P = CmpInst::ICMP_SLT;
+    break;
+  case LoopVectorizationLegality::MRK_SIntMax:
+    P = CmpInst::ICMP_SGT;
+    break;
+  case LoopVectorizationLegality::MRK_FloatMin:
+    P = CmpInst::FCMP_OLT;
+    break;
+  case LoopVectorizationLegality::MRK_FloatMax:
+    P = CmpInst::FCMP_OGT;
+  }
+
+  Value *Cmp;
+  if (RK == LoopVectorizationLegality::MRK_FloatMin ||
+      RK == LoopVectorizationLegality::MRK_FloatMax)
+    Cmp = Builder.CreateFCmp(P, Left, Right, "rdx.minmax.cmp");
+  else
+    Cmp = Builder.CreateICmp(P, Left, Right, "rdx.minmax.cmp");
+  return Builder.CreateSelect(Cmp, Left, Right, "rdx.minmax.select");
+}
+
 void
 InnerLoopVectorizer::vectorizeLoop(LoopVectorizationLegality *Legal) {
   //===------------------------------------------------===//
@@ -1649,15 +1951,30 @@ InnerLoopVectorizer::vectorizeLoop(LoopVectorizationLegality *Legal) {
     VectorParts &VectorExit = getVectorValue(RdxDesc.LoopExitInstr);
     Type *VecTy = VectorExit[0]->getType();
 
-    // Find the reduction identity variable. Zero for addition, or, xor,
-    // one for multiplication, -1 for And.
-    Constant *Iden = getReductionIdentity(RdxDesc.Kind, VecTy->getScalarType());
-    Constant *Identity = ConstantVector::getSplat(VF, Iden);
-
-    // This vector is the Identity vector where the first element is the
-    // incoming scalar reduction.
-    Value *VectorStart = Builder.CreateInsertElement(Identity,
-                                                     RdxDesc.StartValue, Zero);
+    bool IsMinMax =
+      RdxDesc.Kind == LoopVectorizationLegality::RK_IntegerMinMax ||
+      RdxDesc.Kind == LoopVectorizationLegality::RK_FloatMinMax;
+
+    Value *Identity;
+    Value *VectorStart;
+    if (IsMinMax) {
+      // Min/max don't have an identity that we could use, but the min/max
+      // of the start value with itself is the start value, so we start
+      // every lane with it.
+      VectorStart = Identity = Builder.CreateVectorSplat(VF, RdxDesc.StartValue,
+                                                         "minmax.ident");
+    } else {
+      // Find the reduction identity variable. Zero for addition, or, xor,
+      // one for multiplication, -1 for And.
+      Constant *Iden = getReductionIdentity(RdxDesc.Kind,
+                                            VecTy->getScalarType());
+      Identity = ConstantVector::getSplat(VF, Iden);
+
+      // This vector is the Identity vector where the first element is the
+      // incoming scalar reduction.
+      VectorStart = Builder.CreateInsertElement(Identity,
+                                                RdxDesc.StartValue, Zero);
+    }
 
     // Fix the vector-loop phi.
     // We created the induction variable so we know that the
@@ -1700,6 +2017,11 @@ InnerLoopVectorizer::vectorizeLoop(LoopVectorizationLegality *Legal) {
     // Reduce all of the unrolled parts into a single vector.
     Value *ReducedPartRdx = RdxParts[0];
     for (unsigned part = 1; part < UF; ++part) {
+      if (IsMinMax) {
+        ReducedPartRdx = createMinMaxOp(Builder, RdxDesc.MinMaxKind,
+                                        RdxParts[part], ReducedPartRdx);
+        continue;
+      }
       Instruction::BinaryOps Op = getReductionBinOp(RdxDesc.Kind);
       ReducedPartRdx = Builder.CreateBinOp(Op, RdxParts[part], ReducedPartRdx,
                                            "bin.rdx");
@@ -1727,6 +2049,10 @@ InnerLoopVectorizer::vectorizeLoop(LoopVectorizationLegality *Legal) {
                                     ConstantVector::get(ShuffleMask),
                                     "rdx.shuf");
 
+      if (IsMinMax) {
+        TmpVec = createMinMaxOp(Builder, RdxDesc.MinMaxKind, TmpVec, Shuf);
+        continue;
+      }
       Instruction::BinaryOps Op = getReductionBinOp(RdxDesc.Kind);
       TmpVec = Builder.CreateBinOp(Op, TmpVec, Shuf, "bin.rdx");
     }
@@ -2216,6 +2542,10 @@ bool LoopVectorizationLegality::canVectorize() {
     return false;
   }
 
+  // Find the strided accesses that we can vectorize as groups. The memory
+  // checks below rely on the groups.
+  collectInterleaveGroups();
+
   // Go over each instruction and look at memory deps.
   if (!canVectorizeMemory()) {
     DEBUG(dbgs() << "LV: Can't vectorize due to memory conflicts\n");
@@ -2323,6 +2653,15 @@ bool LoopVectorizationLegality::canVectorizeInstrs() {
           DEBUG(dbgs() << "LV: Found an FAdd reduction PHI."<< *Phi <<"\n");
           continue;
         }
+        if (AddReductionVar(Phi, RK_IntegerMinMax)) {
+          DEBUG(dbgs() << "LV: Found a MINMAX reduction PHI."<< *Phi <<"\n");
+          continue;
+        }
+        if (AddReductionVar(Phi, RK_FloatMinMax)) {
+          DEBUG(dbgs() << "LV: Found an float MINMAX reduction PHI."<< *Phi <<
+                "\n");
+          continue;
+        }
 
         DEBUG(dbgs() << "LV: Found an unidentified PHI."<< *Phi <<"\n");
         return false;
@@ -2404,6 +2743,220 @@ void LoopVectorizationLegality::collectLoopUniforms() {
   }
 }
 
+void LoopVectorizationLegality::collectInterleaveGroups() {
+  if (!EnableInterleavedMemAccesses || !DL)
+    return;
+
+  // The memory checks only look at one access per pointer, so we only group
+  // accesses whose pointer no other access of the same kind uses.
+  DenseMap<Value*, unsigned> LoadPtrUses, StorePtrUses;
+  for (Loop::block_iterator bb = TheLoop->block_begin(),
+       be = TheLoop->block_end(); bb != be; ++bb)
+    for (BasicBlock::iterator it = (*bb)->begin(), e = (*bb)->end(); it != e;
+         ++it) {
+      if (LoadInst *LI = dyn_cast<LoadInst>(it))
+        ++LoadPtrUses[LI->getPointerOperand()];
+      else if (StoreInst *SI = dyn_cast<StoreInst>(it))
+        ++StorePtrUses[SI->getPointerOperand()];
+    }
+
+  for (Loop::block_iterator bb = TheLoop->block_begin(),
+       be = TheLoop->block_end(); bb != be; ++bb) {
+    // The groups of this block, with the index of each member relative to
+    // the first member that we found.
+    SmallVector<SmallVector<std::pair<int, Instruction*>, 8>, 4> Candidates;
+    SmallVector<unsigned, 4> CandidateFactors;
+    DenseMap<Instruction*, unsigned> Positions;
+
+    unsigned Pos = 0;
+    for (BasicBlock::iterator it = (*bb)->begin(), e = (*bb)->end(); it != e;
+         ++it, ++Pos) {
+      Positions[it] = Pos;
+      LoadInst *LI = dyn_cast<LoadInst>(it);
+      StoreInst *SI = dyn_cast<StoreInst>(it);
+      if ((!LI || !LI->isSimple()) && (!SI || !SI->isSimple()))
+        continue;
+
+      Value *Ptr = LI ? LI->getPointerOperand() : SI->getPointerOperand();
+      if ((LI ? LoadPtrUses[Ptr] : StorePtrUses[Ptr]) != 1)
+        continue;
+
+      Type *EltTy = LI ? LI->getType() : SI->getValueOperand()->getType();
+      if (!EltTy->isIntegerTy() && !EltTy->isFloatingPointTy())
+        continue;
+      uint64_t EltSize = DL->getTypeAllocSize(EltTy);
+      if (DL->getTypeSizeInBits(EltTy) != EltSize * 8)
+        continue;
+
+      // Look for a constant stride that is a small multiple of the element
+      // size. Consecutive accesses are vectorized on their own.
+      if (isConsecutivePtr(Ptr) || isUniform(Ptr))
+        continue;
+      const SCEVAddRecExpr *AR = dyn_cast<SCEVAddRecExpr>(SE->getSCEV(Ptr));
+      if (!AR || AR->getLoop() != TheLoop || !AR->isAffine())
+        continue;
+      const SCEVConstant *Step =
+        dyn_cast<SCEVConstant>(AR->getStepRecurrence(*SE));
+      if (!Step || Step->getValue()->getBitWidth() > 64)
+        continue;
+      int64_t Stride = Step->getValue()->getSExtValue();
+      if (Stride <= 0 || Stride % EltSize)
+        continue;
+      unsigned Factor = Stride / EltSize;
+      if (Factor < 2 || Factor > MaxInterleaveFactor)
+        continue;
+
+      // Add the access to a group of the same kind whose members are at a
+      // constant distance from it, within the stride.
+      bool Added = false;
+      for (unsigned g = 0, ge = Candidates.size(); g != ge && !Added; ++g) {
+        SmallVector<std::pair<int, Instruction*>, 8> &C = Candidates[g];
+        Instruction *Leader = C[0].second;
+        if (isa<LoadInst>(Leader) != (LI != 0) || CandidateFactors[g] != Factor)
+          continue;
+        Value *LeaderPtr = LI ? cast<LoadInst>(Leader)->getPointerOperand() :
+          cast<StoreInst>(Leader)->getPointerOperand();
+        Type *LeaderTy = LI ? Leader->getType() :
+          cast<StoreInst>(Leader)->getValueOperand()->getType();
+        if (LeaderTy != EltTy)
+          continue;
+        const SCEVConstant *Dist = dyn_cast<SCEVConstant>(
+          SE->getMinusSCEV(AR, SE->getSCEV(LeaderPtr)));
+        if (!Dist || Dist->getValue()->getBitWidth() > 64)
+          continue;
+        int64_t D = Dist->getValue()->getSExtValue();
+        if (D % (int64_t)EltSize)
+          continue;
+        int Index = D / (int64_t)EltSize;
+        int Min = Index, Max = Index;
+        bool Taken = false;
+        for (unsigned i = 0, ie = C.size(); i != ie; ++i) {
+          Taken |= C[i].first == Index;
+          Min = std::min(Min, C[i].first);
+          Max = std::max(Max, C[i].first);
+        }
+        if (Taken || Max - Min >= (int)Factor)
+          continue;
+        C.push_back(std::make_pair(Index, (Instruction*)it));
+        Added = true;
+      }
+      if (Added)
+        continue;
+
+      Candidates.resize(Candidates.size() + 1);
+      Candidates.back().push_back(std::make_pair(0, (Instruction*)it));
+      CandidateFactors.push_back(Factor);
+    }
+
+    for (unsigned g = 0, ge = Candidates.size(); g != ge; ++g) {
+      SmallVector<std::pair<int, Instruction*>, 8> &C = Candidates[g];
+      unsigned Factor = CandidateFactors[g];
+      bool IsLoad = isa<LoadInst>(C[0].second);
+      // A single access gains nothing from a wide access, and we can't store
+      // to the gaps of a group.
+      if (C.size() < 2 || (!IsLoad && C.size() != Factor))
+        continue;
+
+      InterleaveGroup G;
+      G.Factor = Factor;
+      G.Members.resize(Factor);
+      G.Positions.resize(Factor);
+      G.InsertPos = IsLoad ? C.front().second : C.back().second;
+      G.InsertIdx = Positions[G.InsertPos];
+      int Min = C[0].first;
+      for (unsigned i = 1, ie = C.size(); i != ie; ++i)
+        Min = std::min(Min, C[i].first);
+      for (unsigned i = 0, ie = C.size(); i != ie; ++i) {
+        G.Members[C[i].first - Min] = C[i].second;
+        G.Positions[C[i].first - Min] = Positions[C[i].second];
+      }
+
+      Instruction *First = G.Members[0];
+      LoadInst *FirstLI = dyn_cast<LoadInst>(First);
+      Type *EltTy = FirstLI ? FirstLI->getType() :
+        cast<StoreInst>(First)->getValueOperand()->getType();
+      G.Alignment = FirstLI ? FirstLI->getAlignment() :
+        cast<StoreInst>(First)->getAlignment();
+      if (!G.Alignment)
+        G.Alignment = DL->getABITypeAlignment(EltTy);
+
+      // The wide load of the last iteration reads the gaps at the end of the
+      // group, past the last element that the loop uses.
+      if (IsLoad && !G.Members[Factor - 1])
+        NeedsScalarEpilogue = true;
+
+      DEBUG(dbgs() << "LV: Found an interleave group of " << C.size() <<
+            (IsLoad ? " loads" : " stores") << " with stride " << Factor <<
+            " at:" << *G.InsertPos << "\n");
+      for (unsigned i = 0, ie = C.size(); i != ie; ++i)
+        InterleaveGroupMap[C[i].second] = InterleaveGroups.size();
+      InterleaveGroups.push_back(G);
+    }
+  }
+}
+
+Value *LoopVectorizationLegality::getInterleavedObject(Instruction *I) {
+  if (!getInterleaveGroup(I))
+    return 0;
+  Value *Ptr = isa<LoadInst>(I) ? cast<LoadInst>(I)->getPointerOperand() :
+                                  cast<StoreInst>(I)->getPointerOperand();
+  return GetUnderlyingObject(Ptr, DL);
+}
+
+bool LoopVectorizationLegality::isSafeInterleavedAccess(
+    Instruction *I, const std::vector<Instruction*> &Writes) {
+  const InterleaveGroup *GI = getInterleaveGroup(I);
+  if (!GI)
+    return false;
+  Instruction *BaseI = GI->Members[0];
+  Value *PtrI = isa<LoadInst>(BaseI) ?
+    cast<LoadInst>(BaseI)->getPointerOperand() :
+    cast<StoreInst>(BaseI)->getPointerOperand();
+  Type *EltTy = cast<PointerType>(PtrI->getType())->getElementType();
+  int64_t EltSize = DL->getTypeAllocSize(EltTy);
+  int64_t Stride = GI->Factor * EltSize;
+
+  for (unsigned w = 0, we = Writes.size(); w != we; ++w) {
+    const InterleaveGroup *GW = getInterleaveGroup(Writes[w]);
+    if (!GW)
+      return false;
+    if (GW == GI)
+      continue;
+    Instruction *BaseW = GW->Members[0];
+    Value *PtrW = cast<StoreInst>(BaseW)->getPointerOperand();
+    if (BaseW->getParent() != BaseI->getParent() || GW->Factor != GI->Factor ||
+        cast<PointerType>(PtrW->getType())->getElementType() != EltTy)
+      return false;
+
+    // The distance between member zero of the two groups.
+    const SCEVConstant *Dist = dyn_cast<SCEVConstant>(
+      SE->getMinusSCEV(SE->getSCEV(PtrI), SE->getSCEV(PtrW)));
+    if (!Dist || Dist->getValue()->getBitWidth() > 64)
+      return false;
+    int64_t D = Dist->getValue()->getSExtValue();
+    if (D % EltSize)
+      return false;
+
+    // Compare every pair of members. An element that both groups access in
+    // different iterations is a dependence between vector lanes. One that
+    // they access in the same iteration must still be accessed in the same
+    // order once the groups are moved to their insert positions.
+    bool IFirst = GI->InsertIdx < GW->InsertIdx;
+    for (unsigned i = 0; i < GI->Factor; ++i) {
+      if (!GI->Members[i])
+        continue;
+      for (unsigned j = 0; j < GW->Factor; ++j) {
+        int64_t Delta = D + ((int64_t)i - (int64_t)j) * EltSize;
+        if (Delta % Stride)
+          continue;
+        if (Delta || (GI->Positions[i] < GW->Positions[j]) != IFirst)
+          return false;
+      }
+    }
+  }
+  return true;
+}
+
 AliasAnalysis::Location
 LoopVectorizationLegality::getLoadStoreLocation(Instruction *Inst) {
   if (StoreInst *Store = dyn_cast<StoreInst>(Inst))
@@ -2559,7 +3112,7 @@ bool LoopVectorizationLegality::canVectorizeMemory() {
   for (MI = ReadWrites.begin(), ME = ReadWrites.end(); MI != ME; ++MI) {
     Value *V = (*MI).first;
     if (hasComputableBounds(V)) {
-      PtrRtCheck.insert(SE, TheLoop, V);
+      PtrRtCheck.insert(SE, TheLoop, V, getInterleavedObject((*MI).second));
       DEBUG(dbgs() << "LV: Found a runtime check ptr:" << *V <<"\n");
     } else {
       CanDoRT = false;
@@ -2568,8 +3121,11 @@ bool LoopVectorizationLegality::canVectorizeMemory() {
   }
   for (MI = Reads.begin(), ME = Reads.end(); MI != ME; ++MI) {
     Value *V = (*MI).first;
+    // Strided pointers that are also written already have their range.
+    if (ReadWrites.count(V))
+      continue;
     if (hasComputableBounds(V)) {
-      PtrRtCheck.insert(SE, TheLoop, V);
+      PtrRtCheck.insert(SE, TheLoop, V, getInterleavedObject((*MI).second));
       DEBUG(dbgs() << "LV: Found a runtime check ptr:" << *V <<"\n");
     } else {
       CanDoRT = false;
@@ -2626,6 +3182,11 @@ bool LoopVectorizationLegality::canVectorizeMemory() {
         WriteObjects[*UI].push_back(Inst);
         continue;
       }
+      // Interleave groups that write different elements in each iteration.
+      if (isSafeInterleavedAccess(Inst, WriteObjects[*UI])) {
+        WriteObjects[*UI].push_back(Inst);
+        continue;
+      }
       // Direct alias found.
       if (!AA || dyn_cast<GlobalValue>(*UI) == NULL) {
         DEBUG(dbgs() << "LV: Found a possible write-write reorder:"
@@ -2669,6 +3230,10 @@ bool LoopVectorizationLegality::canVectorizeMemory() {
       // Never seen it before, can't alias.
       if (WriteObjects[*UI].empty())
         continue;
+      // Interleave groups that read and write different elements in each
+      // iteration.
+      if (isSafeInterleavedAccess((*MI).second, WriteObjects[*UI]))
+        continue;
       // Direct alias found.
       if (!AA || dyn_cast<GlobalValue>(*UI) == NULL) {
         DEBUG(dbgs() << "LV: Found a possible write-write reorder:"
@@ -2727,6 +3292,10 @@ bool LoopVectorizationLegality::AddReductionVar(PHINode *Phi,
   Instruction *ExitInstruction = 0;
   // Indicates that we found a binary operation in our scan.
   bool FoundBinOp = false;
+  // The kind of the min/max selects that we found, for min/max reductions.
+  MinMaxReductionKind MinMaxKind = MRK_Invalid;
+  // The instructions of the reduction chain that we visited so far.
+  SmallPtrSet<Instruction *, 8> Chain;
 
   // Iter is our iterator. We start with the PHI node and scan for all of the
   // users of this instruction. All users must be instructions that can be
@@ -2749,6 +3318,7 @@ bool LoopVectorizationLegality::AddReductionVar(PHINode *Phi,
 
     // Remember the current instruction.
     Instruction *OldIter = Iter;
+    Chain.insert(Iter);
 
     // For each of the *users* of iter.
     for (Value::use_iterator it = Iter->use_begin(), e = Iter->use_end();
@@ -2778,6 +3348,11 @@ bool LoopVectorizationLegality::AddReductionVar(PHINode *Phi,
           Iter->hasNUsesOrMore(2))
         continue;
 
+      // The compare of a min/max and the select of a conditional
+      // accumulation are reached through another user of Iter.
+      if (TheLoop->contains(Parent) && isSkippedReductionUser(U, OldIter, Kind))
+        continue;
+
       // We can't have multiple inside users.
       if (FoundInBlockUser)
         return false;
@@ -2787,9 +3362,31 @@ bool LoopVectorizationLegality::AddReductionVar(PHINode *Phi,
       if (!isReductionInstr(U, Kind))
         return false;
 
+      if (SelectInst *Sel = dyn_cast<SelectInst>(U)) {
+        if (Sel->getCondition() == OldIter)
+          return false;
+        if (Kind == RK_IntegerMinMax || Kind == RK_FloatMinMax) {
+          // All the selects of the chain must compute the same min/max.
+          MinMaxReductionKind MK = isMinMaxSelectCmpPattern(Sel);
+          if (MK == MRK_Invalid || (MinMaxKind != MRK_Invalid &&
+                                    MinMaxKind != MK))
+            return false;
+          MinMaxKind = MK;
+        } else {
+          // A conditional accumulation selects either the new value of the
+          // reduction or one that we already visited.
+          Value *Other = Sel->getTrueValue() == OldIter ?
+            Sel->getFalseValue() : Sel->getTrueValue();
+          Instruction *OtherInst = dyn_cast<Instruction>(Other);
+          if (!OtherInst || !Chain.count(OtherInst))
+            return false;
+        }
+      }
+
       // Reductions of instructions such as Div, and Sub is only
       // possible if the LHS is the reduction variable.
-      if (!U->isCommutative() && !isa<PHINode>(U) && U->getOperand(0) != Iter)
+      if (!U->isCommutative() && !isa<PHINode>(U) && !isa<SelectInst>(U) &&
+          U->getOperand(0) != Iter)
         return false;
 
       Iter = U;
@@ -2806,8 +3403,13 @@ bool LoopVectorizationLegality::AddReductionVar(PHINode *Phi,
       // This instruction is allowed to have out-of-loop users.
       AllowedExit.insert(ExitInstruction);
 
+      // A min/max reduction needs at least one min/max select.
+      if ((Kind == RK_IntegerMinMax || Kind == RK_FloatMinMax) &&
+          MinMaxKind == MRK_Invalid)
+        return false;
+
       // Save the description of this reduction variable.
-      ReductionDescriptor RD(RdxStart, ExitInstruction, Kind);
+      ReductionDescriptor RD(RdxStart, ExitInstruction, Kind, MinMaxKind);
       Reductions[Phi] = RD;
       // We've ended the cycle. This is a reduction variable if we have an
       // outside user and it has a binary op.
@@ -2826,10 +3428,26 @@ LoopVectorizationLegality::isReductionInstr(Instruction *I,
   default:
     return false;
   case Instruction::PHI:
-      if (FP && (Kind != RK_FloatMult && Kind != RK_FloatAdd))
+      if (FP && (Kind != RK_FloatMult && Kind != RK_FloatAdd &&
+                 Kind != RK_FloatMinMax))
         return false;
     // possibly.
     return true;
+  case Instruction::Select: {
+    if (Kind == RK_IntegerMinMax)
+      return !FP;
+    if (Kind == RK_FloatMinMax) {
+      // Reordering the comparisons changes the result if there are NaNs.
+      Function *F = TheLoop->getHeader()->getParent();
+      if (!FP || !F->hasFnAttribute("no-nans-fp-math"))
+        return false;
+      Attribute A = F->getAttributes().getAttribute(AttributeSet::FunctionIndex,
+                                                     "no-nans-fp-math");
+      return A.getValueAsString() == "true";
+    }
+    // Conditional accumulations select the new value of the other kinds.
+    return FP == (Kind == RK_FloatMult || Kind == RK_FloatAdd);
+  }
   case Instruction::Sub:
   case Instruction::Add:
     return Kind == RK_IntegerAdd;
@@ -2850,6 +3468,83 @@ LoopVectorizationLegality::isReductionInstr(Instruction *I,
    }
 }
 
+LoopVectorizationLegality::MinMaxReductionKind
+LoopVectorizationLegality::isMinMaxSelectCmpPattern(Instruction *I) {
+  SelectInst *Sel = dyn_cast<SelectInst>(I);
+  if (!Sel)
+    return MRK_Invalid;
+  CmpInst *Cmp = dyn_cast<CmpInst>(Sel->getCondition());
+  if (!Cmp || !Cmp->hasOneUse())
+    return MRK_Invalid;
+
+  // Look for select(cmp(a, b), a, b). If the operands of the select are
+  // swapped, the select picks the opposite of what the compare tests.
+  CmpInst::Predicate Pred = Cmp->getPredicate();
+  Value *A = Cmp->getOperand(0), *B = Cmp->getOperand(1);
+  if (Sel->getTrueValue() == B && Sel->getFalseValue() == A)
+    Pred = CmpInst::getInversePredicate(Pred);
+  else if (Sel->getTrueValue() != A || Sel->getFalseValue() != B)
+    return MRK_Invalid;
+
+  switch (Pred) {
+  case CmpInst::ICMP_ULT:
+  case CmpInst::ICMP_ULE:
+    return MRK_UIntMin;
+  case CmpInst::ICMP_UGT:
+  case CmpInst::ICMP_UGE:
+    return MRK_UIntMax;
+  case CmpInst::ICMP_SLT:
+  case CmpInst::ICMP_SLE:
+    return MRK_SIntMin;
+  case CmpInst::ICMP_SGT:
+  case CmpInst::ICMP_SGE:
+    return MRK_SIntMax;
+  case CmpInst::FCMP_OLT:
+  case CmpInst::FCMP_OLE:
+  case CmpInst::FCMP_ULT:
+  case CmpInst::FCMP_ULE:
+    return MRK_FloatMin;
+  case CmpInst::FCMP_OGT:
+  case CmpInst::FCMP_OGE:
+  case CmpInst::FCMP_UGT:
+  case CmpInst::FCMP_UGE:
+    return MRK_FloatMax;
+  default:
+    return MRK_Invalid;
+  }
+}
+
+bool LoopVectorizationLegality::isSkippedReductionUser(Instruction *U,
+                                                       Instruction *Iter,
+                                                       ReductionKind Kind) {
+  if (Kind == RK_IntegerMinMax || Kind == RK_FloatMinMax) {
+    // The compare of select(cmp(Iter, x), Iter, x).
+    if (!isa<CmpInst>(U) || !U->hasOneUse())
+      return false;
+    SelectInst *Sel = dyn_cast<SelectInst>(*U->use_begin());
+    return Sel && Sel->getCondition() == U &&
+      (Sel->getTrueValue() == Iter || Sel->getFalseValue() == Iter) &&
+      isMinMaxSelectCmpPattern(Sel) != MRK_Invalid;
+  }
+
+  // The select of select(c, Iter op x, Iter), which we reach through the
+  // operation.
+  SelectInst *Sel = dyn_cast<SelectInst>(U);
+  if (!Sel || Sel->getCondition() == Iter)
+    return false;
+  Value *Other;
+  if (Sel->getTrueValue() == Iter)
+    Other = Sel->getFalseValue();
+  else if (Sel->getFalseValue() == Iter)
+    Other = Sel->getTrueValue();
+  else
+    return false;
+  Instruction *Op = dyn_cast<Instruction>(Other);
+  return Op && Op != Iter && TheLoop->contains(Op) && !isa<PHINode>(Op) &&
+    Op->hasOneUse() && isReductionInstr(Op, Kind) &&
+    std::find(Op->op_begin(), Op->op_end(), Iter) != Op->op_end();
+}
+
 LoopVectorizationLegality::InductionKind
 LoopVectorizationLegality::isInductionVariable(PHINode *Phi) {
   Type *PhiTy = Phi->getType();
@@ -3368,6 +4063,22 @@ LoopVectorizationCostModel::getInstructionCost(Instruction *I, unsigned VF) {
       return TTI.getAddressComputationCost(VectorTy) +
         TTI.getMemoryOpCost(I->getOpcode(), VectorTy, Alignment, AS);
 
+    // Interleaved loads/stores. The whole group is charged to the member that
+    // emits the wide access.
+    if (const LoopVectorizationLegality::InterleaveGroup *Group =
+          Legal->getInterleaveGroup(I)) {
+      if (I != Group->InsertPos)
+        return 0;
+      Type *WideTy = VectorType::get(ValTy, VF * Group->Factor);
+      SmallVector<unsigned, 8> Indices;
+      for (unsigned i = 0; i < Group->Factor; ++i)
+        if (Group->Members[i])
+          Indices.push_back(i);
+      return TTI.getAddressComputationCost(WideTy) +
+        TTI.getInterleavedMemoryOpCost(I->getOpcode(), WideTy, Group->Factor,
+                                       Indices, Group->Alignment, AS);
+    }
+
     // Scalarized loads/stores.
     int Stride = Legal->isConsecutivePtr(Ptr);
     bool Reverse = Stride < 0;
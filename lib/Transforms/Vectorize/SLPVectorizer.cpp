@@ -0,0 +1,1334 @@
+//===- SLPVectorizer.cpp - A bottom up SLP Vectorizer ---------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass implements the Bottom Up SLP vectorizer. It detects consecutive
+// stores that can be put together into vector-stores, and horizontal
+// reductions whose leaves can be put together into a vector. Next, it attempts
+// to construct a vectorizable tree using the use-def chains. If a profitable
+// tree was found, the SLP vectorizer performs vectorization on the tree.
+//
+// Unlike BBVectorize, which considers all pairs of instructions in the basic
+// block, the search starts from a small number of seeds and only follows the
+// operands of the seeds, so the compile time is bounded by the depth of the
+// trees and by the number of seeds that are tried together.
+//
+// The pass is inspired by the work described in the paper:
+//  "Loop-Aware SLP in GCC" by Ira Rosen, Dorit Nuzman, Ayal Zaks.
+//
+//===----------------------------------------------------------------------===//
+
+#define SV_NAME "slp-vectorizer"
+#define DEBUG_TYPE SV_NAME
+
+#include "llvm/Transforms/Vectorize.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Type.h"
+#include "llvm/IR/Value.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/ValueHandle.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <climits>
+
+using namespace llvm;
+
+STATISTIC(NumVectorizedTrees, "Number of vectorized trees");
+STATISTIC(NumVectorInstructions, "Number of vector instructions generated");
+STATISTIC(NumReductions, "Number of vectorized horizontal reductions");
+STATISTIC(NumGatheredAtLimit,
+          "Number of bundles gathered because of the compile time limits");
+
+static cl::opt<int>
+SLPCostThreshold("slp-threshold", cl::init(0), cl::Hidden,
+                 cl::desc("Only vectorize trees whose cost is less than "
+                          "minus this number (a positive number requires "
+                          "a bigger gain)"));
+
+static cl::opt<bool>
+ShouldVectorizeHor("slp-vectorize-hor", cl::init(true), cl::Hidden,
+                   cl::desc("Attempt to vectorize horizontal reductions"));
+
+/// Limits the depth of the use-def chains that are followed from the seeds.
+static const unsigned RecursionMaxDepth = 12;
+
+/// The number of stores that are checked against each other when looking for
+/// chains of consecutive stores. Notice that the check is quadratic!
+static const unsigned MaxStoreLookup = 16;
+
+/// Vectorizing a bundle of memory operations moves them to the position of
+/// the last one. We don't check for memory dependencies over more than this
+/// number of instructions.
+static const unsigned MaxMemDepDistance = 160;
+
+namespace {
+
+/// \returns the opcode shared by all the values in \p VL, or zero if they are
+/// not all instructions with the same opcode.
+static unsigned getSameOpcode(ArrayRef<Value *> VL) {
+  Instruction *I0 = dyn_cast<Instruction>(VL[0]);
+  if (!I0)
+    return 0;
+  unsigned Opcode = I0->getOpcode();
+  for (unsigned i = 1, e = VL.size(); i < e; ++i) {
+    Instruction *I = dyn_cast<Instruction>(VL[i]);
+    if (!I || I->getOpcode() != Opcode)
+      return 0;
+  }
+  return Opcode;
+}
+
+/// \returns true if all the values in \p VL are constants.
+static bool allConstant(ArrayRef<Value *> VL) {
+  for (unsigned i = 0, e = VL.size(); i < e; ++i)
+    if (!isa<Constant>(VL[i]))
+      return false;
+  return true;
+}
+
+/// \returns true if all the values in \p VL are the same value.
+static bool isSplat(ArrayRef<Value *> VL) {
+  for (unsigned i = 1, e = VL.size(); i < e; ++i)
+    if (VL[i] != VL[0])
+      return false;
+  return true;
+}
+
+/// \returns true if \p VL contains the same value more than once.
+static bool hasDuplicates(ArrayRef<Value *> VL) {
+  SmallPtrSet<Value *, 8> Seen;
+  for (unsigned i = 0, e = VL.size(); i < e; ++i)
+    if (!Seen.insert(VL[i]))
+      return true;
+  return false;
+}
+
+/// \returns true if all the values in \p VL are instructions in \p BB.
+static bool allInBlock(ArrayRef<Value *> VL, BasicBlock *BB) {
+  for (unsigned i = 0, e = VL.size(); i < e; ++i) {
+    Instruction *I = dyn_cast<Instruction>(VL[i]);
+    if (!I || I->getParent() != BB)
+      return false;
+  }
+  return true;
+}
+
+/// \returns the type of the scalars that make up the vector of \p V. This is
+/// the type of the stored value for stores.
+static Type *getScalarType(Value *V) {
+  if (StoreInst *SI = dyn_cast<StoreInst>(V))
+    return SI->getValueOperand()->getType();
+  return V->getType();
+}
+
+/// \returns true if \p Ty can be the element type of the vectors we create.
+static bool isVectorizableType(Type *Ty) {
+  return (Ty->isIntegerTy() || Ty->isFloatingPointTy()) &&
+    VectorType::isValidElementType(Ty);
+}
+
+/// \returns true if \p A and \p B are the same value, both constants, or both
+/// instructions with the same opcode.
+static bool isSameKind(Value *A, Value *B) {
+  if (A == B)
+    return true;
+  if (isa<Constant>(A))
+    return isa<Constant>(B);
+  Instruction *IA = dyn_cast<Instruction>(A);
+  Instruction *IB = dyn_cast<Instruction>(B);
+  return IA && IB && IA->getOpcode() == IB->getOpcode();
+}
+
+/// Split the operands of the binary operators in \p VL into \p Left and
+/// \p Right. The operands of commutative operators are swapped when this
+/// makes the lanes agree with the first one.
+static void reorderInputs(ArrayRef<Value *> VL, SmallVectorImpl<Value *> &Left,
+                          SmallVectorImpl<Value *> &Right) {
+  for (unsigned i = 0, e = VL.size(); i < e; ++i) {
+    Instruction *I = cast<Instruction>(VL[i]);
+    Value *L = I->getOperand(0);
+    Value *R = I->getOperand(1);
+    if (i && I->isCommutative() &&
+        (!isSameKind(L, Left[0]) || !isSameKind(R, Right[0])) &&
+        isSameKind(R, Left[0]) && isSameKind(L, Right[0]))
+      std::swap(L, R);
+    Left.push_back(L);
+    Right.push_back(R);
+  }
+}
+
+/// \returns the alignment of the load or store \p I.
+static unsigned getAlignment(Instruction *I, DataLayout *DL) {
+  unsigned Align;
+  if (LoadInst *LI = dyn_cast<LoadInst>(I))
+    Align = LI->getAlignment();
+  else
+    Align = cast<StoreInst>(I)->getAlignment();
+  return Align ? Align : DL->getABITypeAlignment(getScalarType(I));
+}
+
+/// Bottom Up SLP Vectorizer. The tree is built from a bundle of seed scalars
+/// in a single basic block by following their operands. Each node of the
+/// tree is either a bundle of scalars that are replaced by one vector
+/// instruction, or a list of values that are gathered into a vector with
+/// insertelement instructions.
+class BoUpSLP {
+public:
+  typedef SmallVector<Value *, 8> ValueList;
+
+  BoUpSLP(BasicBlock *BB, ScalarEvolution *SE, DataLayout *DL,
+          TargetTransformInfo *TTI, AliasAnalysis *AA)
+    : BB(BB), SE(SE), DL(DL), TTI(TTI), AA(AA) {}
+
+  /// Construct a vectorizable tree that starts at \p Roots. The users in
+  /// \p UserIgnoreLst of the roots are going to be removed by the caller and
+  /// don't need to be extracted.
+  void buildTree(ArrayRef<Value *> Roots,
+                 ArrayRef<Value *> UserIgnoreLst = ArrayRef<Value *>());
+
+  /// \returns the vectorization cost of the tree, which is negative if the
+  /// vector code is cheaper than the scalar code, or INT_MAX if the tree can't
+  /// be vectorized.
+  int getTreeCost();
+
+  /// Vectorize the tree, replace the external uses of the scalars by
+  /// extracts and erase the scalars.
+  /// \returns the vectorized root of the tree.
+  Value *vectorizeTree();
+
+  /// \returns the position of \p I in the basic block.
+  unsigned getPosition(Instruction *I);
+
+  /// Forget the positions of the instructions after the block was changed
+  /// outside of 'vectorizeTree'.
+  void invalidatePositions() { InstrIdx.clear(); }
+
+  /// Clear the internal data structures that are created by 'buildTree'.
+  void deleteTree() {
+    VectorizableTree.clear();
+    ScalarToTreeEntry.clear();
+    UserIgnoreList.clear();
+  }
+
+  /// \returns true if the memory accesses \p A and \p B are consecutive,
+  /// with \p B accessing the element after \p A.
+  bool isConsecutiveAccess(Value *A, Value *B);
+
+private:
+  struct TreeEntry {
+    TreeEntry() : VectorizedValue(0), InsertBefore(0), NeedToGather(false),
+                  UserIdx(-1) {}
+
+    /// The scalars of the node, one per lane.
+    ValueList Scalars;
+    /// The vector value created for the node.
+    Value *VectorizedValue;
+    /// The vector code of the node is inserted before this instruction, which
+    /// follows the last scalar of the bundle (or of the user, for gathers).
+    Instruction *InsertBefore;
+    /// Do we need to gather this node ?
+    bool NeedToGather;
+    /// The index of the node that uses this one, or -1 for the root.
+    int UserIdx;
+  };
+
+  /// Create a new node for \p VL and \returns its index.
+  int newTreeEntry(ArrayRef<Value *> VL, bool Vectorized, int UserIdx);
+
+  /// Add a node for \p VL to the tree, and the nodes of its operands.
+  void buildTree_rec(ArrayRef<Value *> VL, unsigned Depth, int UserIdx);
+
+  /// \returns the last scalar of the bundle \p VL, in the block order.
+  Instruction *getLastInstruction(ArrayRef<Value *> VL);
+
+  /// \returns true if the memory operations in \p VL can all be moved to the
+  /// position of the last one.
+  bool canSinkMemoryBundle(ArrayRef<Value *> VL);
+
+  /// \returns true if the vector code of every node is placed after the
+  /// vector code of the nodes it uses, and before the external users of its
+  /// scalars.
+  bool isTreeSchedulable();
+
+  /// \returns true if \p U is an external user of the scalar \p V, which
+  /// belongs to the node \p Idx.
+  bool isExternalUser(User *U, int Idx);
+
+  /// \returns the cost of the node \p E.
+  int getEntryCost(TreeEntry &E);
+
+  /// \returns the cost of building a vector of type \p Ty out of \p VL.
+  int getGatherCost(ArrayRef<Value *> VL, VectorType *Ty);
+
+  /// \returns a vector made of the values in \p VL, built before
+  /// \p InsertBefore.
+  Value *Gather(ArrayRef<Value *> VL, VectorType *Ty,
+                Instruction *InsertBefore);
+
+  /// \returns the vectorized value of the operands \p VL of the node
+  /// \p UserIdx.
+  Value *vectorizeOperand(ArrayRef<Value *> VL, int UserIdx);
+
+  /// Emit the vector code of the node \p Idx.
+  Value *vectorizeEntry(int Idx);
+
+  std::vector<TreeEntry> VectorizableTree;
+
+  /// Maps the scalars of the vectorized nodes to their node.
+  DenseMap<Value *, int> ScalarToTreeEntry;
+
+  /// Users of the roots that are removed by the caller.
+  SmallPtrSet<Value *, 16> UserIgnoreList;
+
+  /// The position of the instructions of the block. It is computed lazily
+  /// and cleared whenever the block changes.
+  DenseMap<Instruction *, unsigned> InstrIdx;
+
+  BasicBlock *BB;
+  ScalarEvolution *SE;
+  DataLayout *DL;
+  TargetTransformInfo *TTI;
+  AliasAnalysis *AA;
+};
+
+int BoUpSLP::newTreeEntry(ArrayRef<Value *> VL, bool Vectorized,
+                          int UserIdx) {
+  VectorizableTree.push_back(TreeEntry());
+  int Idx = VectorizableTree.size() - 1;
+  TreeEntry &E = VectorizableTree.back();
+  E.Scalars.append(VL.begin(), VL.end());
+  E.NeedToGather = !Vectorized;
+  E.UserIdx = UserIdx;
+  if (Vectorized) {
+    BasicBlock::iterator Next = getLastInstruction(VL);
+    E.InsertBefore = ++Next;
+    for (unsigned i = 0, e = VL.size(); i < e; ++i)
+      ScalarToTreeEntry[VL[i]] = Idx;
+  } else if (UserIdx >= 0) {
+    E.InsertBefore = VectorizableTree[UserIdx].InsertBefore;
+  }
+  return Idx;
+}
+
+unsigned BoUpSLP::getPosition(Instruction *I) {
+  assert(I->getParent() == BB && "Instruction is not in the block");
+  if (InstrIdx.empty()) {
+    unsigned Pos = 0;
+    for (BasicBlock::iterator it = BB->begin(), e = BB->end(); it != e; ++it)
+      InstrIdx[it] = Pos++;
+  }
+  return InstrIdx[I];
+}
+
+Instruction *BoUpSLP::getLastInstruction(ArrayRef<Value *> VL) {
+  Instruction *Last = cast<Instruction>(VL[0]);
+  unsigned LastPos = getPosition(Last);
+  for (unsigned i = 1, e = VL.size(); i < e; ++i) {
+    Instruction *I = cast<Instruction>(VL[i]);
+    unsigned Pos = getPosition(I);
+    if (Pos > LastPos) {
+      Last = I;
+      LastPos = Pos;
+    }
+  }
+  return Last;
+}
+
+bool BoUpSLP::isConsecutiveAccess(Value *A, Value *B) {
+  Value *PtrA, *PtrB;
+  if (LoadInst *LA = dyn_cast<LoadInst>(A)) {
+    LoadInst *LB = dyn_cast<LoadInst>(B);
+    if (!LB)
+      return false;
+    PtrA = LA->getPointerOperand();
+    PtrB = LB->getPointerOperand();
+  } else {
+    StoreInst *SA = dyn_cast<StoreInst>(A);
+    StoreInst *SB = dyn_cast<StoreInst>(B);
+    if (!SA || !SB)
+      return false;
+    PtrA = SA->getPointerOperand();
+    PtrB = SB->getPointerOperand();
+  }
+
+  // Make sure that A and B are different pointers of the same type.
+  if (PtrA == PtrB || PtrA->getType() != PtrB->getType())
+    return false;
+
+  unsigned AS = cast<PointerType>(PtrA->getType())->getAddressSpace();
+  Type *Ty = cast<PointerType>(PtrA->getType())->getElementType();
+  uint64_t Size = DL->getTypeStoreSize(Ty);
+
+  // B is consecutive to A if its address is the address of A plus the size
+  // of the accessed type.
+  const SCEV *PtrSCEVA = SE->getSCEV(PtrA);
+  const SCEV *PtrSCEVB = SE->getSCEV(PtrB);
+  const SCEV *Offset = SE->getConstant(DL->getIntPtrType(A->getContext(), AS),
+                                       Size);
+  return SE->getAddExpr(PtrSCEVA, Offset) == PtrSCEVB;
+}
+
+bool BoUpSLP::canSinkMemoryBundle(ArrayRef<Value *> VL) {
+  bool IsStore = isa<StoreInst>(VL[0]);
+  unsigned First = getPosition(cast<Instruction>(VL[0]));
+  unsigned Last = First;
+  SmallVector<AliasAnalysis::Location, 8> Locs;
+  SmallPtrSet<Value *, 8> Bundle;
+  for (unsigned i = 0, e = VL.size(); i < e; ++i) {
+    unsigned Pos = getPosition(cast<Instruction>(VL[i]));
+    First = std::min(First, Pos);
+    Last = std::max(Last, Pos);
+    Bundle.insert(VL[i]);
+    if (IsStore)
+      Locs.push_back(AA->getLocation(cast<StoreInst>(VL[i])));
+    else
+      Locs.push_back(AA->getLocation(cast<LoadInst>(VL[i])));
+  }
+
+  if (Last - First > MaxMemDepDistance) {
+    DEBUG(dbgs() << "SLP: Memory bundle is spread over too many "
+          "instructions.\n");
+    ++NumGatheredAtLimit;
+    return false;
+  }
+
+  // Stores can't move across any access of the same memory, and loads can't
+  // move across writes to it.
+  BasicBlock::iterator it = cast<Instruction>(VL[0]);
+  while (getPosition(it) != First)
+    --it;
+  for (++it; getPosition(it) < Last; ++it) {
+    if (Bundle.count(it))
+      continue;
+    if (IsStore ? !it->mayReadOrWriteMemory() : !it->mayWriteToMemory())
+      continue;
+    for (unsigned i = 0, e = Locs.size(); i < e; ++i) {
+      AliasAnalysis::ModRefResult MR = AA->getModRefInfo(it, Locs[i]);
+      if (IsStore ? MR != AliasAnalysis::NoModRef : (MR & AliasAnalysis::Mod)) {
+        DEBUG(dbgs() << "SLP: Can't sink the bundle across " << *it << "\n");
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void BoUpSLP::buildTree(ArrayRef<Value *> Roots,
+                        ArrayRef<Value *> UserIgnoreLst) {
+  deleteTree();
+  UserIgnoreList.insert(UserIgnoreLst.begin(), UserIgnoreLst.end());
+  buildTree_rec(Roots, 0, -1);
+}
+
+void BoUpSLP::buildTree_rec(ArrayRef<Value *> VL, unsigned Depth,
+                            int UserIdx) {
+  if (Depth == RecursionMaxDepth) {
+    DEBUG(dbgs() << "SLP: Gathering due to max recursion depth.\n");
+    ++NumGatheredAtLimit;
+    newTreeEntry(VL, false, UserIdx);
+    return;
+  }
+
+  unsigned Opcode = getSameOpcode(VL);
+  if (!Opcode || allConstant(VL) || isSplat(VL) || hasDuplicates(VL) ||
+      !allInBlock(VL, BB) || !isVectorizableType(getScalarType(VL[0]))) {
+    newTreeEntry(VL, false, UserIdx);
+    return;
+  }
+
+  // Reuse the node if we have already seen this bundle. Scalars that are part
+  // of another bundle are gathered.
+  if (ScalarToTreeEntry.count(VL[0])) {
+    int Idx = ScalarToTreeEntry[VL[0]];
+    if (VectorizableTree[Idx].Scalars.size() == VL.size() &&
+        std::equal(VL.begin(), VL.end(),
+                   VectorizableTree[Idx].Scalars.begin())) {
+      DEBUG(dbgs() << "SLP: Reusing the bundle of " << *VL[0] << "\n");
+      return;
+    }
+  }
+  for (unsigned i = 0, e = VL.size(); i < e; ++i) {
+    if (ScalarToTreeEntry.count(VL[i])) {
+      DEBUG(dbgs() << "SLP: Gathering due to partial overlap.\n");
+      newTreeEntry(VL, false, UserIdx);
+      return;
+    }
+  }
+
+  Instruction *VL0 = cast<Instruction>(VL[0]);
+  switch (Opcode) {
+  case Instruction::Load:
+  case Instruction::Store: {
+    for (unsigned i = 0, e = VL.size(); i < e; ++i) {
+      bool Simple = isa<LoadInst>(VL[i]) ? cast<LoadInst>(VL[i])->isSimple() :
+        cast<StoreInst>(VL[i])->isSimple();
+      if (!Simple || (i && !isConsecutiveAccess(VL[i - 1], VL[i]))) {
+        DEBUG(dbgs() << "SLP: Gathering non-consecutive memory accesses.\n");
+        newTreeEntry(VL, false, UserIdx);
+        return;
+      }
+    }
+    if (!canSinkMemoryBundle(VL)) {
+      newTreeEntry(VL, false, UserIdx);
+      return;
+    }
+    int Idx = newTreeEntry(VL, true, UserIdx);
+    DEBUG(dbgs() << "SLP: Added a vector of " <<
+          (Opcode == Instruction::Load ? "loads" : "stores") << ".\n");
+    if (Opcode == Instruction::Store) {
+      ValueList Operands;
+      for (unsigned i = 0, e = VL.size(); i < e; ++i)
+        Operands.push_back(cast<StoreInst>(VL[i])->getValueOperand());
+      buildTree_rec(Operands, Depth + 1, Idx);
+    }
+    return;
+  }
+  case Instruction::Trunc:
+  case Instruction::ZExt:
+  case Instruction::SExt:
+  case Instruction::FPToUI:
+  case Instruction::FPToSI:
+  case Instruction::UIToFP:
+  case Instruction::SIToFP:
+  case Instruction::FPTrunc:
+  case Instruction::FPExt: {
+    Type *SrcTy = VL0->getOperand(0)->getType();
+    for (unsigned i = 1, e = VL.size(); i < e; ++i) {
+      if (cast<Instruction>(VL[i])->getOperand(0)->getType() != SrcTy) {
+        newTreeEntry(VL, false, UserIdx);
+        return;
+      }
+    }
+    if (!isVectorizableType(SrcTy)) {
+      newTreeEntry(VL, false, UserIdx);
+      return;
+    }
+    int Idx = newTreeEntry(VL, true, UserIdx);
+    DEBUG(dbgs() << "SLP: Added a vector of casts.\n");
+    ValueList Operands;
+    for (unsigned i = 0, e = VL.size(); i < e; ++i)
+      Operands.push_back(cast<Instruction>(VL[i])->getOperand(0));
+    buildTree_rec(Operands, Depth + 1, Idx);
+    return;
+  }
+  case Instruction::ICmp:
+  case Instruction::FCmp: {
+    CmpInst::Predicate P0 = cast<CmpInst>(VL0)->getPredicate();
+    Type *OpTy = VL0->getOperand(0)->getType();
+    for (unsigned i = 1, e = VL.size(); i < e; ++i) {
+      CmpInst *Cmp = cast<CmpInst>(VL[i]);
+      if (Cmp->getPredicate() != P0 || Cmp->getOperand(0)->getType() != OpTy) {
+        newTreeEntry(VL, false, UserIdx);
+        return;
+      }
+    }
+    if (!isVectorizableType(OpTy)) {
+      newTreeEntry(VL, false, UserIdx);
+      return;
+    }
+    int Idx = newTreeEntry(VL, true, UserIdx);
+    DEBUG(dbgs() << "SLP: Added a vector of compares.\n");
+    for (unsigned OpIdx = 0; OpIdx < 2; ++OpIdx) {
+      ValueList Operands;
+      for (unsigned i = 0, e = VL.size(); i < e; ++i)
+        Operands.push_back(cast<Instruction>(VL[i])->getOperand(OpIdx));
+      buildTree_rec(Operands, Depth + 1, Idx);
+    }
+    return;
+  }
+  case Instruction::Select: {
+    int Idx = newTreeEntry(VL, true, UserIdx);
+    DEBUG(dbgs() << "SLP: Added a vector of selects.\n");
+    for (unsigned OpIdx = 0; OpIdx < 3; ++OpIdx) {
+      ValueList Operands;
+      for (unsigned i = 0, e = VL.size(); i < e; ++i)
+        Operands.push_back(cast<Instruction>(VL[i])->getOperand(OpIdx));
+      buildTree_rec(Operands, Depth + 1, Idx);
+    }
+    return;
+  }
+  case Instruction::Add:
+  case Instruction::FAdd:
+  case Instruction::Sub:
+  case Instruction::FSub:
+  case Instruction::Mul:
+  case Instruction::FMul:
+  case Instruction::UDiv:
+  case Instruction::SDiv:
+  case Instruction::FDiv:
+  case Instruction::URem:
+  case Instruction::SRem:
+  case Instruction::FRem:
+  case Instruction::Shl:
+  case Instruction::LShr:
+  case Instruction::AShr:
+  case Instruction::And:
+  case Instruction::Or:
+  case Instruction::Xor: {
+    int Idx = newTreeEntry(VL, true, UserIdx);
+    DEBUG(dbgs() << "SLP: Added a vector of binary operators.\n");
+    ValueList Left, Right;
+    reorderInputs(VL, Left, Right);
+    buildTree_rec(Left, Depth + 1, Idx);
+    buildTree_rec(Right, Depth + 1, Idx);
+    return;
+  }
+  default:
+    DEBUG(dbgs() << "SLP: Gathering unknown instruction " << *VL0 << "\n");
+    newTreeEntry(VL, false, UserIdx);
+    return;
+  }
+}
+
+bool BoUpSLP::isExternalUser(User *U, int Idx) {
+  // The users of the roots that are ignored are removed by the caller.
+  if (Idx == 0 && UserIgnoreList.count(U))
+    return false;
+  return !ScalarToTreeEntry.count(U);
+}
+
+bool BoUpSLP::isTreeSchedulable() {
+  for (unsigned Idx = 0, e = VectorizableTree.size(); Idx < e; ++Idx) {
+    TreeEntry &E = VectorizableTree[Idx];
+    if (E.NeedToGather) {
+      // A gather that uses a vectorized scalar needs the extract of that
+      // scalar, so the vector code of its node must come first.
+      for (unsigned i = 0, ie = E.Scalars.size(); i < ie; ++i) {
+        if (!ScalarToTreeEntry.count(E.Scalars[i]))
+          continue;
+        TreeEntry &Def = VectorizableTree[ScalarToTreeEntry[E.Scalars[i]]];
+        TreeEntry &User = VectorizableTree[E.UserIdx];
+        if (getPosition(getLastInstruction(Def.Scalars)) >=
+            getPosition(getLastInstruction(User.Scalars)))
+          return false;
+      }
+      continue;
+    }
+
+    // The external users in the block must come after the vector code that
+    // defines the extracts.
+    unsigned LastPos = getPosition(getLastInstruction(E.Scalars));
+    for (unsigned i = 0, ie = E.Scalars.size(); i < ie; ++i) {
+      Value *Scalar = E.Scalars[i];
+      for (Value::use_iterator UI = Scalar->use_begin(),
+           UE = Scalar->use_end(); UI != UE; ++UI) {
+        Instruction *U = dyn_cast<Instruction>(*UI);
+        if (!U || !isExternalUser(U, Idx) || isa<PHINode>(U) ||
+            U->getParent() != BB)
+          continue;
+        if (getPosition(U) < LastPos) {
+          DEBUG(dbgs() << "SLP: Scalar " << *Scalar << " is used by " << *U
+                << " before the vector code.\n");
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+int BoUpSLP::getGatherCost(ArrayRef<Value *> VL, VectorType *Ty) {
+  if (allConstant(VL))
+    return 0;
+  if (isSplat(VL))
+    return TTI->getShuffleCost(TargetTransformInfo::SK_Broadcast, Ty) +
+      TTI->getVectorInstrCost(Instruction::InsertElement, Ty, 0);
+  int Cost = 0;
+  for (unsigned i = 0, e = VL.size(); i < e; ++i) {
+    if (isa<Constant>(VL[i]))
+      continue;
+    Cost += TTI->getVectorInstrCost(Instruction::InsertElement, Ty, i);
+    // Scalars that are vectorized in another node are extracted first.
+    if (ScalarToTreeEntry.count(VL[i]))
+      Cost += TTI->getVectorInstrCost(Instruction::ExtractElement, Ty, i);
+  }
+  return Cost;
+}
+
+int BoUpSLP::getEntryCost(TreeEntry &E) {
+  ArrayRef<Value *> VL = E.Scalars;
+  Type *ScalarTy = getScalarType(VL[0]);
+  unsigned VF = VL.size();
+  VectorType *VecTy = VectorType::get(ScalarTy, VF);
+
+  if (E.NeedToGather)
+    return getGatherCost(VL, VecTy);
+
+  Instruction *VL0 = cast<Instruction>(VL[0]);
+  unsigned Opcode = VL0->getOpcode();
+  int ScalarCost, VecCost;
+  switch (Opcode) {
+  case Instruction::Load:
+  case Instruction::Store: {
+    unsigned Align = getAlignment(VL0, DL);
+    ScalarCost = VF * TTI->getMemoryOpCost(Opcode, ScalarTy, Align, 0);
+    VecCost = TTI->getMemoryOpCost(Opcode, VecTy, Align, 0);
+    break;
+  }
+  case Instruction::Trunc:
+  case Instruction::ZExt:
+  case Instruction::SExt:
+  case Instruction::FPToUI:
+  case Instruction::FPToSI:
+  case Instruction::UIToFP:
+  case Instruction::SIToFP:
+  case Instruction::FPTrunc:
+  case Instruction::FPExt: {
+    Type *SrcTy = VL0->getOperand(0)->getType();
+    ScalarCost = VF * TTI->getCastInstrCost(Opcode, ScalarTy, SrcTy);
+    VecCost = TTI->getCastInstrCost(Opcode, VecTy,
+                                    VectorType::get(SrcTy, VF));
+    break;
+  }
+  case Instruction::ICmp:
+  case Instruction::FCmp:
+  case Instruction::Select: {
+    Type *ValTy = Opcode == Instruction::Select ? ScalarTy :
+      VL0->getOperand(0)->getType();
+    Type *CondTy = Type::getInt1Ty(ScalarTy->getContext());
+    ScalarCost = VF * TTI->getCmpSelInstrCost(Opcode, ValTy, CondTy);
+    VecCost = TTI->getCmpSelInstrCost(Opcode, VectorType::get(ValTy, VF),
+                                      VectorType::get(CondTy, VF));
+    break;
+  }
+  default:
+    ScalarCost = VF * TTI->getArithmeticInstrCost(Opcode, ScalarTy);
+    VecCost = TTI->getArithmeticInstrCost(Opcode, VecTy);
+    break;
+  }
+  return VecCost - ScalarCost;
+}
+
+int BoUpSLP::getTreeCost() {
+  if (VectorizableTree.empty() || VectorizableTree[0].NeedToGather ||
+      !isTreeSchedulable())
+    return INT_MAX;
+
+  int Cost = 0;
+  for (unsigned Idx = 0, e = VectorizableTree.size(); Idx < e; ++Idx) {
+    TreeEntry &E = VectorizableTree[Idx];
+    int C = getEntryCost(E);
+    DEBUG(dbgs() << "SLP: Cost " << C << " for the bundle of " <<
+          *E.Scalars[0] << ".\n");
+    Cost += C;
+    if (E.NeedToGather)
+      continue;
+
+    // Add the cost of the extracts for the external users.
+    VectorType *VecTy = VectorType::get(getScalarType(E.Scalars[0]),
+                                        E.Scalars.size());
+    for (unsigned i = 0, ie = E.Scalars.size(); i < ie; ++i) {
+      Value *Scalar = E.Scalars[i];
+      for (Value::use_iterator UI = Scalar->use_begin(),
+           UE = Scalar->use_end(); UI != UE; ++UI) {
+        if (isExternalUser(*UI, Idx)) {
+          Cost += TTI->getVectorInstrCost(Instruction::ExtractElement, VecTy,
+                                          i);
+          break;
+        }
+      }
+    }
+  }
+  DEBUG(dbgs() << "SLP: Total cost " << Cost << " for a tree of " <<
+        VectorizableTree.size() << " nodes.\n");
+  return Cost;
+}
+
+Value *BoUpSLP::Gather(ArrayRef<Value *> VL, VectorType *Ty,
+                       Instruction *InsertBefore) {
+  IRBuilder<> Builder(InsertBefore);
+  Value *Vec = UndefValue::get(Ty);
+  for (unsigned i = 0, e = VL.size(); i < e; ++i)
+    Vec = Builder.CreateInsertElement(Vec, VL[i], Builder.getInt32(i));
+  return Vec;
+}
+
+Value *BoUpSLP::vectorizeOperand(ArrayRef<Value *> VL, int UserIdx) {
+  if (ScalarToTreeEntry.count(VL[0])) {
+    int Idx = ScalarToTreeEntry[VL[0]];
+    TreeEntry &E = VectorizableTree[Idx];
+    if (E.Scalars.size() == VL.size() &&
+        std::equal(VL.begin(), VL.end(), E.Scalars.begin()))
+      return vectorizeEntry(Idx);
+  }
+  VectorType *VecTy = VectorType::get(getScalarType(VL[0]), VL.size());
+  return Gather(VL, VecTy, VectorizableTree[UserIdx].InsertBefore);
+}
+
+Value *BoUpSLP::vectorizeEntry(int Idx) {
+  if (Value *V = VectorizableTree[Idx].VectorizedValue)
+    return V;
+
+  // Copy the scalars; the nodes don't move while we vectorize, but the
+  // operands are vectorized first.
+  ValueList VL(VectorizableTree[Idx].Scalars);
+  Instruction *InsertBefore = VectorizableTree[Idx].InsertBefore;
+  Instruction *VL0 = cast<Instruction>(VL[0]);
+  unsigned Opcode = VL0->getOpcode();
+  Type *ScalarTy = getScalarType(VL0);
+  VectorType *VecTy = VectorType::get(ScalarTy, VL.size());
+
+  Value *V;
+  switch (Opcode) {
+  case Instruction::Load: {
+    LoadInst *LI = cast<LoadInst>(VL0);
+    IRBuilder<> Builder(InsertBefore);
+    Value *Ptr = Builder.CreateBitCast(LI->getPointerOperand(),
+                                       VecTy->getPointerTo(
+                                         LI->getPointerAddressSpace()));
+    LoadInst *Load = Builder.CreateLoad(Ptr);
+    Load->setAlignment(getAlignment(LI, DL));
+    V = Load;
+    break;
+  }
+  case Instruction::Store: {
+    StoreInst *SI = cast<StoreInst>(VL0);
+    ValueList Operands;
+    for (unsigned i = 0, e = VL.size(); i < e; ++i)
+      Operands.push_back(cast<StoreInst>(VL[i])->getValueOperand());
+    Value *Val = vectorizeOperand(Operands, Idx);
+    IRBuilder<> Builder(InsertBefore);
+    Value *Ptr = Builder.CreateBitCast(SI->getPointerOperand(),
+                                       VecTy->getPointerTo(
+                                         SI->getPointerAddressSpace()));
+    StoreInst *Store = Builder.CreateStore(Val, Ptr);
+    Store->setAlignment(getAlignment(SI, DL));
+    V = Store;
+    break;
+  }
+  case Instruction::Trunc:
+  case Instruction::ZExt:
+  case Instruction::SExt:
+  case Instruction::FPToUI:
+  case Instruction::FPToSI:
+  case Instruction::UIToFP:
+  case Instruction::SIToFP:
+  case Instruction::FPTrunc:
+  case Instruction::FPExt: {
+    ValueList Operands;
+    for (unsigned i = 0, e = VL.size(); i < e; ++i)
+      Operands.push_back(cast<Instruction>(VL[i])->getOperand(0));
+    Value *In = vectorizeOperand(Operands, Idx);
+    IRBuilder<> Builder(InsertBefore);
+    V = Builder.CreateCast(static_cast<Instruction::CastOps>(Opcode), In,
+                           VecTy);
+    break;
+  }
+  case Instruction::ICmp:
+  case Instruction::FCmp: {
+    ValueList LHSs, RHSs;
+    for (unsigned i = 0, e = VL.size(); i < e; ++i) {
+      LHSs.push_back(cast<Instruction>(VL[i])->getOperand(0));
+      RHSs.push_back(cast<Instruction>(VL[i])->getOperand(1));
+    }
+    Value *L = vectorizeOperand(LHSs, Idx);
+    Value *R = vectorizeOperand(RHSs, Idx);
+    IRBuilder<> Builder(InsertBefore);
+    CmpInst::Predicate P = cast<CmpInst>(VL0)->getPredicate();
+    if (Opcode == Instruction::FCmp)
+      V = Builder.CreateFCmp(P, L, R);
+    else
+      V = Builder.CreateICmp(P, L, R);
+    break;
+  }
+  case Instruction::Select: {
+    ValueList Conds, Trues, Falses;
+    for (unsigned i = 0, e = VL.size(); i < e; ++i) {
+      SelectInst *SI = cast<SelectInst>(VL[i]);
+      Conds.push_back(SI->getCondition());
+      Trues.push_back(SI->getTrueValue());
+      Falses.push_back(SI->getFalseValue());
+    }
+    Value *C = vectorizeOperand(Conds, Idx);
+    Value *T = vectorizeOperand(Trues, Idx);
+    Value *F = vectorizeOperand(Falses, Idx);
+    IRBuilder<> Builder(InsertBefore);
+    V = Builder.CreateSelect(C, T, F);
+    break;
+  }
+  default: {
+    ValueList Left, Right;
+    reorderInputs(VL, Left, Right);
+    Value *L = vectorizeOperand(Left, Idx);
+    Value *R = vectorizeOperand(Right, Idx);
+    IRBuilder<> Builder(InsertBefore);
+    V = Builder.CreateBinOp(static_cast<Instruction::BinaryOps>(Opcode), L, R);
+    break;
+  }
+  }
+
+  ++NumVectorInstructions;
+  VectorizableTree[Idx].VectorizedValue = V;
+  return V;
+}
+
+Value *BoUpSLP::vectorizeTree() {
+  Value *VectorRoot = vectorizeEntry(0);
+
+  // Extract the scalars that are still used outside of the tree. The extracts
+  // are placed right after the vector code of their node.
+  for (unsigned Idx = 0, e = VectorizableTree.size(); Idx < e; ++Idx) {
+    TreeEntry &E = VectorizableTree[Idx];
+    if (E.NeedToGather)
+      continue;
+    for (unsigned i = 0, ie = E.Scalars.size(); i < ie; ++i) {
+      Value *Scalar = E.Scalars[i];
+      SmallVector<User *, 8> Users;
+      for (Value::use_iterator UI = Scalar->use_begin(),
+           UE = Scalar->use_end(); UI != UE; ++UI)
+        if (isExternalUser(*UI, Idx))
+          Users.push_back(*UI);
+      if (Users.empty())
+        continue;
+      IRBuilder<> Builder(E.InsertBefore);
+      Value *Ex = Builder.CreateExtractElement(E.VectorizedValue,
+                                               Builder.getInt32(i));
+      for (unsigned u = 0, ue = Users.size(); u < ue; ++u)
+        Users[u]->replaceUsesOfWith(Scalar, Ex);
+    }
+  }
+
+  // The remaining users of the scalars are other scalars of the tree, or
+  // ignored users that the caller removes.
+  for (unsigned Idx = 0, e = VectorizableTree.size(); Idx < e; ++Idx) {
+    TreeEntry &E = VectorizableTree[Idx];
+    if (E.NeedToGather)
+      continue;
+    for (unsigned i = 0, ie = E.Scalars.size(); i < ie; ++i) {
+      Value *Scalar = E.Scalars[i];
+      Scalar->replaceAllUsesWith(UndefValue::get(Scalar->getType()));
+      cast<Instruction>(Scalar)->eraseFromParent();
+    }
+  }
+
+  deleteTree();
+  InstrIdx.clear();
+  return VectorRoot;
+}
+
+/// The SLPVectorizer Pass.
+struct SLPVectorizer : public FunctionPass {
+  /// Pass identification, replacement for typeid
+  static char ID;
+
+  explicit SLPVectorizer() : FunctionPass(ID) {
+    initializeSLPVectorizerPass(*PassRegistry::getPassRegistry());
+  }
+
+  ScalarEvolution *SE;
+  DataLayout *DL;
+  TargetTransformInfo *TTI;
+  AliasAnalysis *AA;
+
+  virtual bool runOnFunction(Function &F) {
+    SE = &getAnalysis<ScalarEvolution>();
+    DL = getAnalysisIfAvailable<DataLayout>();
+    TTI = &getAnalysis<TargetTransformInfo>();
+    AA = &getAnalysis<AliasAnalysis>();
+
+    // We need the size of the types to find consecutive accesses.
+    if (!DL)
+      return false;
+
+    // Don't vectorize when the target has no vector registers, or when the
+    // attribute NoImplicitFloat is used.
+    if (!TTI->getNumberOfRegisters(true))
+      return false;
+    if (F.getAttributes().hasAttribute(AttributeSet::FunctionIndex,
+                                       Attribute::NoImplicitFloat))
+      return false;
+
+    DEBUG(dbgs() << "SLP: Analyzing blocks in " << F.getName() << ".\n");
+
+    bool Changed = false;
+    for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB) {
+      BoUpSLP R(BB, SE, DL, TTI, AA);
+      Changed |= vectorizeStoreChains(BB, R);
+      if (ShouldVectorizeHor)
+        Changed |= vectorizeReductions(BB, R);
+    }
+    return Changed;
+  }
+
+  virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+    FunctionPass::getAnalysisUsage(AU);
+    AU.addRequired<ScalarEvolution>();
+    AU.addRequired<AliasAnalysis>();
+    AU.addRequired<TargetTransformInfo>();
+    AU.setPreservesCFG();
+  }
+
+private:
+  /// \returns the widest vectorization factor for values of type \p Ty, or
+  /// zero if they can't be put in a vector.
+  unsigned getMaxVF(Type *Ty) {
+    uint64_t Sz = DL->getTypeSizeInBits(Ty);
+    if (!Sz || Sz != DL->getTypeStoreSizeInBits(Ty))
+      return 0;
+    return TTI->getRegisterBitWidth(true) / Sz;
+  }
+
+  /// Try to vectorize the tree that starts at \p VL.
+  /// \returns true if the tree was vectorized.
+  bool tryToVectorizeTree(ArrayRef<Value *> VL, BoUpSLP &R) {
+    R.buildTree(VL);
+    int Cost = R.getTreeCost();
+    DEBUG(dbgs() << "SLP: Found a tree of cost " << Cost << " at " << *VL[0]
+          << "\n");
+    if (Cost >= -SLPCostThreshold) {
+      R.deleteTree();
+      return false;
+    }
+    R.vectorizeTree();
+    ++NumVectorizedTrees;
+    return true;
+  }
+
+  /// Vectorize the chains of consecutive stores in \p BB.
+  bool vectorizeStoreChains(BasicBlock *BB, BoUpSLP &R);
+
+  /// Find the chains of consecutive stores among \p Stores, and vectorize
+  /// them.
+  bool vectorizeStores(ArrayRef<StoreInst *> Stores, BoUpSLP &R);
+
+  /// Vectorize the consecutive stores in \p Chain, using the widest vectors
+  /// that are profitable.
+  bool vectorizeStoreChain(ArrayRef<Value *> Chain, BoUpSLP &R);
+
+  /// Vectorize the horizontal reductions in \p BB.
+  bool vectorizeReductions(BasicBlock *BB, BoUpSLP &R);
+
+  /// Vectorize the reduction whose last operation is \p Root.
+  bool vectorizeReduction(BinaryOperator *Root, BoUpSLP &R);
+};
+
+bool SLPVectorizer::vectorizeStoreChains(BasicBlock *BB, BoUpSLP &R) {
+  // Group the stores by the object that they access.
+  MapVector<Value *, SmallVector<StoreInst *, 8> > StoreRefs;
+  for (BasicBlock::iterator it = BB->begin(), e = BB->end(); it != e; ++it) {
+    StoreInst *SI = dyn_cast<StoreInst>(it);
+    if (!SI || !SI->isSimple())
+      continue;
+    if (!isVectorizableType(SI->getValueOperand()->getType()))
+      continue;
+    Value *Ptr = SI->getPointerOperand();
+    StoreRefs[GetUnderlyingObject(Ptr, DL)].push_back(SI);
+  }
+
+  bool Changed = false;
+  for (MapVector<Value *, SmallVector<StoreInst *, 8> >::iterator
+       it = StoreRefs.begin(), e = StoreRefs.end(); it != e; ++it) {
+    ArrayRef<StoreInst *> Stores = it->second;
+    if (Stores.size() < 2)
+      continue;
+    DEBUG(dbgs() << "SLP: Analyzing " << Stores.size() << " stores to " <<
+          *it->first << ".\n");
+    // Only look for chains among a limited number of stores at a time.
+    for (unsigned CI = 0, CE = Stores.size(); CI < CE; CI += MaxStoreLookup) {
+      unsigned Len = std::min<unsigned>(CE - CI, MaxStoreLookup);
+      Changed |= vectorizeStores(Stores.slice(CI, Len), R);
+    }
+  }
+  return Changed;
+}
+
+bool SLPVectorizer::vectorizeStores(ArrayRef<StoreInst *> Stores,
+                                    BoUpSLP &R) {
+  unsigned N = Stores.size();
+  SmallVector<int, 16> Next(N, -1);
+  SmallVector<bool, 16> HasPrev(N, false);
+  for (unsigned i = 0; i < N; ++i) {
+    for (unsigned j = 0; j < N; ++j) {
+      if (i == j || HasPrev[j] || !R.isConsecutiveAccess(Stores[i], Stores[j]))
+        continue;
+      Next[i] = j;
+      HasPrev[j] = true;
+      break;
+    }
+  }
+
+  bool Changed = false;
+  for (unsigned i = 0; i < N; ++i) {
+    if (HasPrev[i] || Next[i] == -1)
+      continue;
+    // Stores that are not consecutive to any other store don't start a chain.
+    SmallVector<Value *, 16> Chain;
+    for (int I = i; I != -1 && Chain.size() < N; I = Next[I])
+      Chain.push_back(Stores[I]);
+    Changed |= vectorizeStoreChain(Chain, R);
+  }
+  return Changed;
+}
+
+bool SLPVectorizer::vectorizeStoreChain(ArrayRef<Value *> Chain, BoUpSLP &R) {
+  Type *StoreTy = getScalarType(Chain[0]);
+  unsigned MaxVF = getMaxVF(StoreTy);
+  if (MaxVF < 2)
+    return false;
+
+  DEBUG(dbgs() << "SLP: Analyzing a store chain of length " << Chain.size()
+        << ".\n");
+
+  // The stores are erased when they are vectorized, so remember which ones
+  // are gone.
+  SmallPtrSet<Value *, 16> VectorizedStores;
+  bool Changed = false;
+  for (unsigned VF = MaxVF; VF >= 2; VF /= 2) {
+    for (unsigned i = 0; i + VF <= Chain.size();) {
+      ArrayRef<Value *> Operands = Chain.slice(i, VF);
+      bool Done = false;
+      for (unsigned j = 0; j < VF; ++j)
+        Done |= VectorizedStores.count(Operands[j]);
+      if (Done || !tryToVectorizeTree(Operands, R)) {
+        ++i;
+        continue;
+      }
+      VectorizedStores.insert(Operands.begin(), Operands.end());
+      Changed = true;
+      i += VF;
+    }
+  }
+  return Changed;
+}
+
+/// \returns true if \p I is an operation that a horizontal reduction can
+/// reassociate.
+static bool isReductionOp(Instruction *I, unsigned Opcode) {
+  if (I->getOpcode() != Opcode)
+    return false;
+  switch (Opcode) {
+  case Instruction::Add:
+  case Instruction::Mul:
+  case Instruction::And:
+  case Instruction::Or:
+  case Instruction::Xor:
+    return true;
+  case Instruction::FAdd:
+  case Instruction::FMul:
+    return I->hasUnsafeAlgebra();
+  default:
+    return false;
+  }
+}
+
+/// \returns true if \p V is an operation of a reduction that only feeds the
+/// next operation of the same reduction.
+static bool isInnerReductionOp(Value *V, unsigned Opcode, BasicBlock *BB) {
+  Instruction *I = dyn_cast<Instruction>(V);
+  if (!I || I->getParent() != BB || !isReductionOp(I, Opcode) ||
+      !I->hasOneUse())
+    return false;
+  Instruction *U = cast<Instruction>(*I->use_begin());
+  return U->getParent() == BB && isReductionOp(U, Opcode);
+}
+
+bool SLPVectorizer::vectorizeReductions(BasicBlock *BB, BoUpSLP &R) {
+  // Vectorizing a reduction erases instructions, including other roots.
+  SmallVector<WeakVH, 8> Roots;
+  for (BasicBlock::iterator it = BB->begin(), e = BB->end(); it != e; ++it) {
+    BinaryOperator *BO = dyn_cast<BinaryOperator>(it);
+    if (!BO || !isReductionOp(BO, BO->getOpcode()) ||
+        isInnerReductionOp(BO, BO->getOpcode(), BB))
+      continue;
+    if (isInnerReductionOp(BO->getOperand(0), BO->getOpcode(), BB) ||
+        isInnerReductionOp(BO->getOperand(1), BO->getOpcode(), BB))
+      Roots.push_back(BO);
+  }
+
+  bool Changed = false;
+  for (unsigned i = 0, e = Roots.size(); i < e; ++i)
+    if (BinaryOperator *Root =
+          dyn_cast_or_null<BinaryOperator>(static_cast<Value *>(Roots[i])))
+      Changed |= vectorizeReduction(Root, R);
+  return Changed;
+}
+
+bool SLPVectorizer::vectorizeReduction(BinaryOperator *Root, BoUpSLP &R) {
+  unsigned Opcode = Root->getOpcode();
+  BasicBlock *BB = Root->getParent();
+  Type *Ty = Root->getType();
+  unsigned MaxVF = getMaxVF(Ty);
+  if (MaxVF < 2)
+    return false;
+
+  // Collect the operations of the reduction, and the operands that are
+  // reduced in the order of the expression. Leaves are kept as the operand
+  // slots of the reduction, as vectorizing a part of them may replace others
+  // by extracts.
+  SmallVector<Value *, 16> ReductionOps;
+  SmallVector<std::pair<Instruction *, unsigned>, 16> Leaves;
+  SmallVector<std::pair<Instruction *, unsigned>, 16> Stack;
+  ReductionOps.push_back(Root);
+  Stack.push_back(std::make_pair(Root, 0U));
+  while (!Stack.empty()) {
+    Instruction *I = Stack.back().first;
+    unsigned OpIdx = Stack.back().second;
+    if (OpIdx == 2) {
+      Stack.pop_back();
+      continue;
+    }
+    ++Stack.back().second;
+    Value *Op = I->getOperand(OpIdx);
+    if (isInnerReductionOp(Op, Opcode, BB)) {
+      ReductionOps.push_back(Op);
+      Stack.push_back(std::make_pair(cast<Instruction>(Op), 0U));
+    } else {
+      Leaves.push_back(std::make_pair(I, OpIdx));
+    }
+  }
+
+  // The reduction can be reassociated, so put the leaves in the order of the
+  // block, which is usually the order of the memory they access.
+  SmallVector<std::pair<unsigned, unsigned>, 16> Order;
+  for (unsigned i = 0, e = Leaves.size(); i < e; ++i) {
+    Instruction *I = dyn_cast<Instruction>(
+      Leaves[i].first->getOperand(Leaves[i].second));
+    unsigned Pos = I && I->getParent() == BB ? R.getPosition(I) : UINT_MAX;
+    Order.push_back(std::make_pair(Pos, i));
+  }
+  std::stable_sort(Order.begin(), Order.end());
+  SmallVector<std::pair<Instruction *, unsigned>, 16> SortedLeaves;
+  for (unsigned i = 0, e = Order.size(); i < e; ++i)
+    SortedLeaves.push_back(Leaves[Order[i].second]);
+  Leaves.swap(SortedLeaves);
+
+  unsigned NumLeaves = Leaves.size();
+  // The shuffles of the reduction need a power of two.
+  unsigned VF = 1U << Log2_32(std::min(MaxVF, NumLeaves));
+  if (VF < 2)
+    return false;
+
+  DEBUG(dbgs() << "SLP: Analyzing a reduction of " << NumLeaves <<
+        " values with " << *Root << ".\n");
+
+  // The scalar reduction of VF leaves is replaced by log2(VF) vector
+  // operations on shuffled vectors and an extract.
+  VectorType *VecTy = VectorType::get(Ty, VF);
+  int ScalarRdxCost = (VF - 1) * TTI->getArithmeticInstrCost(Opcode, Ty);
+  int VecRdxCost =
+    TTI->getVectorInstrCost(Instruction::ExtractElement, VecTy, 0);
+  for (unsigned i = VF; i > 1; i /= 2)
+    VecRdxCost += TTI->getArithmeticInstrCost(Opcode, VecTy) +
+      TTI->getShuffleCost(TargetTransformInfo::SK_ExtractSubvector, VecTy,
+                          i / 2, VectorType::get(Ty, i / 2));
+
+  IRBuilder<> Builder(Root);
+  SmallVector<Value *, 16> Reduced;
+  SmallVector<bool, 16> IsVectorized(NumLeaves, false);
+  for (unsigned i = 0; i + VF <= NumLeaves; i += VF) {
+    BoUpSLP::ValueList VL;
+    for (unsigned j = 0; j < VF; ++j)
+      VL.push_back(Leaves[i + j].first->getOperand(Leaves[i + j].second));
+    // The reduction operations that are rebuilt from the vector result are
+    // not users of the scalars. A leaf can appear more than once though, and
+    // an operation that also reads it in a slot outside of this chunk needs
+    // the extract of the scalar.
+    SmallPtrSet<Value *, 16> InChunk(VL.begin(), VL.end());
+    SmallVector<Value *, 16> IgnoredOps;
+    for (unsigned k = 0, ke = ReductionOps.size(); k < ke; ++k) {
+      Instruction *Op = cast<Instruction>(ReductionOps[k]);
+      bool ReadsOutside = false;
+      for (unsigned OpIdx = 0; OpIdx < 2; ++OpIdx) {
+        if (!InChunk.count(Op->getOperand(OpIdx)))
+          continue;
+        std::pair<Instruction *, unsigned> Slot(Op, OpIdx);
+        if (std::find(Leaves.begin() + i, Leaves.begin() + i + VF, Slot) ==
+            Leaves.begin() + i + VF)
+          ReadsOutside = true;
+      }
+      if (!ReadsOutside)
+        IgnoredOps.push_back(Op);
+    }
+    R.buildTree(VL, IgnoredOps);
+    int Cost = R.getTreeCost();
+    if (Cost != INT_MAX)
+      Cost += VecRdxCost - ScalarRdxCost;
+    DEBUG(dbgs() << "SLP: Found a reduction tree of cost " << Cost << ".\n");
+    if (Cost >= -SLPCostThreshold) {
+      R.deleteTree();
+      continue;
+    }
+
+    Value *TmpVec = R.vectorizeTree();
+    ++NumVectorizedTrees;
+    for (unsigned Half = VF / 2; Half >= 1; Half /= 2) {
+      SmallVector<Constant *, 16> Mask;
+      for (unsigned j = 0; j < VF; ++j)
+        Mask.push_back(j < Half ? cast<Constant>(Builder.getInt32(Half + j)) :
+                       UndefValue::get(Builder.getInt32Ty()));
+      Value *Shuf = Builder.CreateShuffleVector(TmpVec,
+                                                UndefValue::get(VecTy),
+                                                ConstantVector::get(Mask));
+      TmpVec = Builder.CreateBinOp(static_cast<Instruction::BinaryOps>(Opcode),
+                                   TmpVec, Shuf);
+      if (Ty->isFloatingPointTy() && isa<Instruction>(TmpVec))
+        cast<Instruction>(TmpVec)->copyFastMathFlags(Root);
+    }
+    Reduced.push_back(Builder.CreateExtractElement(TmpVec,
+                                                   Builder.getInt32(0)));
+    for (unsigned j = 0; j < VF; ++j)
+      IsVectorized[i + j] = true;
+  }
+
+  if (Reduced.empty())
+    return false;
+
+  // Rebuild the reduction out of the vector results and the other leaves,
+  // and remove the scalar operations.
+  for (unsigned i = 0; i < NumLeaves; ++i)
+    if (!IsVectorized[i])
+      Reduced.push_back(Leaves[i].first->getOperand(Leaves[i].second));
+  Value *Result = Reduced[0];
+  for (unsigned i = 1, e = Reduced.size(); i < e; ++i) {
+    Result = Builder.CreateBinOp(static_cast<Instruction::BinaryOps>(Opcode),
+                                 Result, Reduced[i]);
+    if (Ty->isFloatingPointTy() && isa<Instruction>(Result))
+      cast<Instruction>(Result)->copyFastMathFlags(Root);
+  }
+  Root->replaceAllUsesWith(Result);
+  for (unsigned i = 0, e = ReductionOps.size(); i < e; ++i)
+    cast<Instruction>(ReductionOps[i])->dropAllReferences();
+  for (unsigned i = 0, e = ReductionOps.size(); i < e; ++i)
+    cast<Instruction>(ReductionOps[i])->eraseFromParent();
+  R.invalidatePositions();
+
+  ++NumReductions;
+  return true;
+}
+
+} // end anonymous namespace
+
+char SLPVectorizer::ID = 0;
+static const char lv_name[] = "SLP Vectorizer";
+INITIALIZE_PASS_BEGIN(SLPVectorizer, SV_NAME, lv_name, false, false)
+INITIALIZE_AG_DEPENDENCY(AliasAnalysis)
+INITIALIZE_AG_DEPENDENCY(TargetTransformInfo)
+INITIALIZE_PASS_DEPENDENCY(ScalarEvolution)
+INITIALIZE_PASS_END(SLPVectorizer, SV_NAME, lv_name, false, false)
+
+namespace llvm {
+  Pass *createSLPVectorizerPass() {
+    return new SLPVectorizer();
+  }
+}
@@ -0,0 +1,94 @@
+; RUN: opt < %s -basicaa -basicaa-cache -count-aa -count-aa-print-all-queries=false -dse -gvn -dse -S 2>%t | FileCheck %s
+; RUN: FileCheck --check-prefix=COUNT %s < %t
+; RUN: opt < %s -basicaa -basicaa-cache -count-aa -count-aa-print-all-queries=false -licm -S 2>%t.licm | FileCheck --check-prefix=LICM %s
+; RUN: FileCheck --check-prefix=LICM-AA %s < %t.licm
+
+target datalayout = "e-p:64:64:64-i32:32:32-i64:64:64"
+
+; DSE and GVN ask about the same pairs of fields many times and get the
+; answers from the cache.
+define i32 @fields(i32* %p) {
+  %f1 = getelementptr i32* %p, i64 1
+  %f2 = getelementptr i32* %p, i64 2
+  store i32 0, i32* %p
+  store i32 1, i32* %f1
+  store i32 2, i32* %f2
+  store i32 3, i32* %p
+  %a = load i32* %f1
+  %b = load i32* %f2
+  %c = add i32 %a, %b
+  ret i32 %c
+; CHECK: @fields
+; CHECK-NOT: store i32 0
+; CHECK: ret i32 3
+}
+
+; GVN replaces %g2 with %g1 and deletes it, which drops the cached results
+; about %g2.
+define i32 @replaced(i32* %p, i64 %i) {
+  %g1 = getelementptr i32* %p, i64 %i
+  store i32 1, i32* %g1
+  %q = getelementptr i32* %p, i64 1
+  store i32 2, i32* %q
+  %g2 = getelementptr i32* %p, i64 %i
+  %v = load i32* %g2
+  ret i32 %v
+; CHECK: @replaced
+; CHECK: store i32 2, i32* %q
+; CHECK-NEXT: %v = load i32* %g1
+}
+
+; GVN knows that %p == %q in %eq and rewrites the operand of %g in place,
+; without a handle seeing it.  The cache of the first DSE ends with the pass,
+; so the second DSE finds that %g doesn't alias %p and deletes the first
+; store.
+define i32 @inplace(i32* %p, i32* %q) {
+entry:
+  %c = icmp eq i32* %p, %q
+  br i1 %c, label %eq, label %exit
+eq:
+  %g = getelementptr i32* %q, i64 1
+  store i32 0, i32* %p
+  %v = load i32* %g
+  store i32 2, i32* %p
+  ret i32 %v
+exit:
+  ret i32 0
+; CHECK: @inplace
+; CHECK: eq:
+; CHECK-NEXT: %g = getelementptr i32* %p, i64 1
+; CHECK-NEXT: %v = load i32* %g
+; CHECK-NEXT: store i32 2, i32* %p
+}
+
+; LICM asks about the fields of %p for every access in the loop.
+define void @loop(i32* %p, i64 %n) {
+entry:
+  %f1 = getelementptr i32* %p, i64 1
+  %f2 = getelementptr i32* %p, i64 2
+  br label %loop
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %a = load i32* %f1
+  %b = load i32* %f2
+  %s = add i32 %a, %b
+  %t = load i32* %p
+  %u = add i32 %t, %s
+  store i32 %u, i32* %p
+  %i.next = add i64 %i, 1
+  %c = icmp eq i64 %i.next, %n
+  br i1 %c, label %exit, label %loop
+exit:
+  ret void
+; LICM: @loop
+; LICM: %a = load i32* %f1
+; LICM-NEXT: %b = load i32* %f2
+; LICM: %p.promoted = load i32* %p
+; LICM: loop:
+; LICM-NOT: load
+; LICM: exit:
+}
+
+; COUNT: Alias Query Cache Lookups, {{[1-9][0-9]*}} hits
+; COUNT: GEP Decomposition Cache Lookups, {{[1-9][0-9]*}} hits
+; LICM-AA: GEP Decomposition Cache Lookups, {{[1-9][0-9]*}} hits
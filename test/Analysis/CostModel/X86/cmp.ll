@@ -1,3 +1,4 @@
+; RUN: opt < %s  -cost-model -analyze -mtriple=x86_64-apple-macosx10.8.0 -mcpu=core2 | FileCheck --check-prefix=SSE2 %s
 ; RUN: opt < %s  -cost-model -analyze -mtriple=x86_64-apple-macosx10.8.0 -mcpu=corei7-avx | FileCheck --check-prefix=AVX1 %s
 ; RUN: opt < %s  -cost-model -analyze -mtriple=x86_64-apple-macosx10.8.0 -mcpu=core-avx2 | FileCheck --check-prefix=AVX2 %s
 
@@ -9,6 +10,7 @@ define i32 @cmp(i32 %arg) {
   ;AVX1: cost of 1 {{.*}} fcmp
   ;AVX2: cost of 1 {{.*}} fcmp
   %A = fcmp olt <2 x float> undef, undef
+  ;SSE2: cost of 1 {{.*}} fcmp
   ;AVX1: cost of 1 {{.*}} fcmp
   ;AVX2: cost of 1 {{.*}} fcmp
   %B = fcmp olt <4 x float> undef, undef
@@ -24,12 +26,15 @@ define i32 @cmp(i32 %arg) {
 
   ;  -- integers --
 
+  ;SSE2: cost of 1 {{.*}} icmp
   ;AVX1: cost of 1 {{.*}} icmp
   ;AVX2: cost of 1 {{.*}} icmp
   %F = icmp eq <16 x i8> undef, undef
+  ;SSE2: cost of 1 {{.*}} icmp
   ;AVX1: cost of 1 {{.*}} icmp
   ;AVX2: cost of 1 {{.*}} icmp
   %G = icmp eq <8 x i16> undef, undef
+  ;SSE2: cost of 1 {{.*}} icmp
   ;AVX1: cost of 1 {{.*}} icmp
   ;AVX2: cost of 1 {{.*}} icmp
   %H = icmp eq <4 x i32> undef, undef
@@ -0,0 +1,61 @@
+; RUN: opt < %s -basicaa -print-memoryssa -analyze | FileCheck %s
+
+; Each store defines a new version, loads use the version that reaches them,
+; and the walker skips the stores that don't alias the loaded location.
+
+; CHECK: define i32 @straight
+; CHECK: 1 = MemoryDef(liveOnEntry)
+; CHECK-NEXT: store i32 0, i32* %p
+; CHECK-NEXT: 2 = MemoryDef(1)
+; CHECK-NEXT: store i32 1, i32* %q
+; CHECK-NEXT: MemoryUse(2) clobbered by 1
+; CHECK-NEXT: %v = load i32* %p
+; CHECK-NEXT: ; MemoryUse(2){{$}}
+; CHECK-NEXT: %w = load i32* %q
+define i32 @straight(i32* noalias %p, i32* noalias %q) {
+entry:
+  store i32 0, i32* %p
+  store i32 1, i32* %q
+  %v = load i32* %p
+  %w = load i32* %q
+  %s = add i32 %v, %w
+  ret i32 %s
+}
+
+declare void @clobber()
+declare i32 @pure(i32*) readonly
+
+; Calls that only read memory are uses.
+; CHECK: define i32 @calls
+; CHECK: ; MemoryUse(liveOnEntry){{$}}
+; CHECK-NEXT: %a = load i32* %p
+; CHECK-NEXT: ; MemoryUse(liveOnEntry){{$}}
+; CHECK-NEXT: %b = call i32 @pure(i32* %p)
+; CHECK-NEXT: 1 = MemoryDef(liveOnEntry)
+; CHECK-NEXT: call void @clobber()
+; CHECK-NEXT: ; MemoryUse(1){{$}}
+; CHECK-NEXT: %c = load i32* %p
+define i32 @calls(i32* noalias %p) {
+entry:
+  %a = load i32* %p
+  %b = call i32 @pure(i32* %p)
+  call void @clobber()
+  %c = load i32* %p
+  %s = add i32 %a, %b
+  %t = add i32 %s, %c
+  ret i32 %t
+}
+
+; CHECK: define i32 @alloca
+; CHECK: 1 = MemoryDef(liveOnEntry)
+; CHECK-NEXT: store i32 1, i32* %y
+; CHECK-NEXT: MemoryUse(1) clobbered by liveOnEntry
+; CHECK-NEXT: %v = load i32* %x
+define i32 @alloca() {
+entry:
+  %x = alloca i32
+  %y = alloca i32
+  store i32 1, i32* %y
+  %v = load i32* %x
+  ret i32 %v
+}
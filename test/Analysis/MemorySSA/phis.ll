@@ -0,0 +1,89 @@
+; RUN: opt < %s -basicaa -print-memoryssa -analyze | FileCheck %s
+
+; MemoryPhis are placed where different versions meet, and the walker looks
+; through them when all the incoming versions have the same clobber.
+
+; CHECK: define i32 @diamond
+; CHECK: entry:
+; CHECK-NEXT: 1 = MemoryDef(liveOnEntry)
+; CHECK: then:
+; CHECK-NEXT: 2 = MemoryDef(1)
+; CHECK: else:
+; CHECK-NEXT: 4 = MemoryDef(1)
+; CHECK: join:
+; CHECK-NEXT: 3 = MemoryPhi({%then,2},{%else,4})
+; CHECK-NEXT: MemoryUse(3) clobbered by 1
+; CHECK-NEXT: %v = load i32* %p
+; CHECK-NEXT: ; MemoryUse(3){{$}}
+; CHECK-NEXT: %w = load i32* %q
+define i32 @diamond(i1 %c, i32* noalias %p, i32* noalias %q) {
+entry:
+  store i32 0, i32* %p
+  br i1 %c, label %then, label %else
+
+then:
+  store i32 1, i32* %q
+  br label %join
+
+else:
+  store i32 2, i32* %q
+  br label %join
+
+join:
+  %v = load i32* %p
+  %w = load i32* %q
+  %s = add i32 %v, %w
+  ret i32 %s
+}
+
+; CHECK: define i32 @loop
+; CHECK: loop:
+; CHECK-NEXT: 2 = MemoryPhi({%entry,1},{%loop,3})
+; CHECK: MemoryUse(2) clobbered by 1
+; CHECK-NEXT: %v = load i32* %p
+; CHECK-NEXT: 3 = MemoryDef(2)
+; CHECK: exit:
+; CHECK-NEXT: ; MemoryUse(3){{$}}
+; CHECK-NEXT: %w = load i32* %q
+define i32 @loop(i32* noalias %p, i32* noalias %q, i32 %n) {
+entry:
+  store i32 0, i32* %p
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %v = load i32* %p
+  store i32 %v, i32* %q
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %w = load i32* %q
+  ret i32 %w
+}
+
+; The address of the load changes in each iteration, so the walker must not
+; look through the MemoryPhi of the loop.
+; CHECK: define void @varying
+; CHECK: loop:
+; CHECK-NEXT: 1 = MemoryPhi({%entry,liveOnEntry},{%loop,2})
+; CHECK: ; MemoryUse(1){{$}}
+; CHECK-NEXT: %v = load i32* %p
+define void @varying(i32* %a, i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %i.next = add i32 %i, 1
+  %p = getelementptr i32* %a, i32 %i
+  %v = load i32* %p
+  %q = getelementptr i32* %a, i32 %i.next
+  store i32 %v, i32* %q
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
@@ -0,0 +1,24 @@
+; RUN: llvm-as < %s > %t.bc
+; RUN: echo "" | llvm-as > %t.empty.bc
+; RUN: llvm-link %t.empty.bc %t.bc -bitcode-decode-threads=2 -stats -o /dev/null 2>&1 \
+; RUN:     | FileCheck %s
+; REQUIRES: asserts
+
+; The linker reads @a from the stream, and @b and @c from the blocks decoded
+; while it links @a.
+; CHECK: 2 bitcode-reader - Number of function bodies decoded ahead of time
+
+define i32 @a(i32 %x) {
+  %r = add i32 %x, 1
+  ret i32 %r
+}
+
+define i32 @b(i32 %x) {
+  %r = call i32 @a(i32 %x)
+  ret i32 %r
+}
+
+define i32 @c(i32 %x) {
+  %r = call i32 @b(i32 %x)
+  ret i32 %r
+}
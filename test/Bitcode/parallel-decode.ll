@@ -0,0 +1,57 @@
+; RUN: llvm-as < %s | opt -S -bitcode-decode-threads=2 | FileCheck %s
+; RUN: llvm-as < %s | opt -S -bitcode-decode-threads=1 | FileCheck %s
+
+; The linker materializes one function at a time, the bodies after the first
+; are decoded ahead of it.
+; RUN: llvm-as < %s > %t.bc
+; RUN: echo "" | llvm-as > %t.empty.bc
+; RUN: llvm-link %t.empty.bc %t.bc -bitcode-decode-threads=2 -S | FileCheck %s
+; RUN: llvm-extract -func=second -bitcode-decode-threads=2 %t.bc -S \
+; RUN:     | FileCheck --check-prefix=EXTRACT %s
+
+; Function bodies decoded ahead of time on other threads, with the constants,
+; metadata and symbol tables nested in them, read back the same.
+
+@addr = global i8* blockaddress(@second, %target)
+
+; CHECK: define i32 @first(i32 %x)
+; CHECK-NEXT: entry:
+; CHECK-NEXT: %sum = add i32 %x, 12345678, !note !0
+; CHECK-NEXT: %cmp = icmp ugt i32 %sum, 7
+; CHECK-NEXT: %sel = select i1 %cmp, i32 %sum, i32 -1
+; CHECK-NEXT: ret i32 %sel
+define i32 @first(i32 %x) {
+entry:
+  %sum = add i32 %x, 12345678, !note !0
+  %cmp = icmp ugt i32 %sum, 7
+  %sel = select i1 %cmp, i32 %sum, i32 -1
+  ret i32 %sel
+}
+
+; CHECK: define i32 @second(i32 %y)
+; CHECK: target:
+; CHECK-NEXT: %r = call i32 @first(i32 %y)
+; CHECK-NEXT: ret i32 %r
+define i32 @second(i32 %y) {
+entry:
+  br label %target
+target:
+  %r = call i32 @first(i32 %y)
+  ret i32 %r
+}
+
+; CHECK: define float @third(float %z)
+; CHECK-NEXT: %m = fmul float %z, 2.500000e+00
+define float @third(float %z) {
+  %m = fmul float %z, 2.500000e+00
+  ret float %m
+}
+
+; CHECK: !0 = metadata !{i32 0, i32 100}
+!0 = metadata !{i32 0, i32 100}
+
+; A function read out of order comes from the stream.
+; EXTRACT: declare i32 @first(i32)
+; EXTRACT: define i32 @second(i32 %y)
+; EXTRACT: %r = call i32 @first(i32 %y)
+; EXTRACT-NOT: define
@@ -0,0 +1,27 @@
+; RUN: rm -rf %t.cache
+; RUN: llc < %s -object-cache-dir=%t.cache -o %t1.s
+; RUN: ls %t.cache | count 1
+; RUN: llc < %s -object-cache-dir=%t.cache -o %t2.s
+; RUN: ls %t.cache | count 1
+; RUN: diff %t1.s %t2.s
+; RUN: llc < %s -object-cache-dir=%t.cache -O0 -o %t3.s
+; RUN: ls %t.cache | count 2
+
+; The module identifier is the input file name, which ends up in the output.
+; RUN: rm -rf %t.dir && mkdir %t.dir
+; RUN: cp %s %t.dir/a.ll && cp %s %t.dir/b.ll
+; RUN: llc %t.dir/a.ll -object-cache-dir=%t.cache -o %t.dir/a.s
+; RUN: ls %t.cache | count 3
+; RUN: llc %t.dir/b.ll -object-cache-dir=%t.cache -o %t.dir/b.s
+; RUN: ls %t.cache | count 4
+; RUN: llc %t.dir/b.ll -object-cache-dir=%t.cache -o %t.dir/b2.s
+; RUN: ls %t.cache | count 4
+; RUN: diff %t.dir/b.s %t.dir/b2.s
+; RUN: FileCheck %s < %t.dir/b2.s
+
+; CHECK: .file "{{.*}}b.ll"
+
+define i32 @f(i32 %x) {
+  %y = add i32 %x, 1
+  ret i32 %y
+}
@@ -0,0 +1,49 @@
+; RUN: llc < %s -mtriple=x86_64-linux -enable-misched -codegen-budget=1000 \
+; RUN:   -codegen-budget-report 2>&1 | FileCheck %s -check-prefix=LARGE
+; RUN: llc < %s -mtriple=x86_64-linux -enable-misched -codegen-budget=50 \
+; RUN:   -codegen-budget-report 2>&1 | FileCheck %s -check-prefix=SMALL
+
+; With a large enough budget every pass runs in full.
+; LARGE: codegen-budget: sum: machinelicm full, 21 instrs, cost 84 of 1000
+; LARGE: codegen-budget: sum: machine-cse full, 20 instrs, cost 60 of 916
+; LARGE: codegen-budget: sum: misched full, 18 instrs, cost 144 of 856
+; LARGE: codegen-budget: sum: greedy-splitting full, 18 instrs, cost 144 of 712
+; LARGE: codegen-budget: sum: machinelicm full, 14 instrs, cost 56 of 568
+; LARGE: codegen-budget: sum: block-placement full, 12 instrs, cost 24 of 512
+; LARGE: imull
+; LARGE: %loop
+
+; With a small budget only the cheap variant of the scheduler fits, and the
+; multiplication isn't hoisted out of the loop.  Greedy cannot skip the
+; function, so it splits without regions even though that overdraws the
+; budget.
+; SMALL: codegen-budget: sum: machinelicm skip, 21 instrs, cost 0 of 50
+; SMALL: codegen-budget: sum: machine-cse skip, 21 instrs, cost 0 of 50
+; SMALL: codegen-budget: sum: misched cheap, 18 instrs, cost 36 of 50
+; SMALL: codegen-budget: sum: greedy-splitting cheap, 18 instrs, cost 36 of 14
+; SMALL: codegen-budget: sum: machinelicm skip, 14 instrs, cost 0 of 0
+; SMALL: codegen-budget: sum: block-placement skip, 12 instrs, cost 0 of 0
+; SMALL: %loop
+; SMALL: imull
+
+define i32 @sum(i32* %p, i32 %n, i32 %k) nounwind {
+entry:
+  %cmp1 = icmp sgt i32 %n, 0
+  br i1 %cmp1, label %loop, label %exit
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %s = phi i32 [ 0, %entry ], [ %s.next, %loop ]
+  %kk = mul i32 %k, %k
+  %addr = getelementptr i32* %p, i32 %i
+  %v = load i32* %addr
+  %t = add i32 %v, %kk
+  %s.next = add i32 %s, %t
+  %i.next = add i32 %i, 1
+  %cmp = icmp slt i32 %i.next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  %r = phi i32 [ 0, %entry ], [ %s.next, %loop ]
+  ret i32 %r
+}
@@ -23,3 +23,15 @@ entry:
   %add2 = add nsw i64 %add, %conv1
   ret i64 %add2
 }
+
+define void @t4(i64* noalias sret %r, i64 %a) {
+entry:
+  store i64 %a, i64* %r
+  ret void
+}
+
+define <4 x float> @t5(double %a, i32 %b, <4 x float> %c, float %d) {
+entry:
+  %add = fadd <4 x float> %c, %c
+  ret <4 x float> %add
+}
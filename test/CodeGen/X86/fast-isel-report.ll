@@ -0,0 +1,45 @@
+; RUN: llc < %s -O0 -fast-isel -fast-isel-report -mtriple=x86_64-unknown-linux-gnu -o /dev/null 2>&1 | FileCheck %s
+
+; Check the report of the instructions FastISel leaves to SelectionDAG.  Blocks
+; are selected bottom-up, so a miss also leaves the instructions above it in its
+; block to SelectionDAG, except for calls, which are lowered on their own.
+
+; CHECK:      FastISel fallbacks in function 'f':
+; CHECK-NEXT:   misses    insts  opcode                   type
+; CHECK-NEXT:        1        1  insertelement            <4 x i32>
+; CHECK-NEXT:        1        1  total
+define void @f(i32 %x, <4 x i32>* %p) {
+  %v = insertelement <4 x i32> undef, i32 %x, i32 0
+  %w = add <4 x i32> %v, %v
+  store <4 x i32> %w, <4 x i32>* %p
+  ret void
+}
+
+; Nothing is reported for functions FastISel selects entirely.
+; CHECK-NOT:  function 'g'
+define i32 @g(i32 %x) {
+  %y = add i32 %x, 1
+  ret i32 %y
+}
+
+; CHECK:      FastISel fallbacks in function 'h':
+; CHECK-NEXT:   misses    insts  opcode                   type
+; CHECK-NEXT:        1        0  arguments                void (i16)
+; CHECK-NEXT:        1        1  call llvm.memset         void (i8*, i8, i64, i32, i1)
+; CHECK-NEXT:        1        1  insertelement            <4 x i32>
+; CHECK-NEXT:        3        2  total
+define void @h(i16 %x) {
+  %v = insertelement <4 x i32> undef, i32 0, i32 0
+  store <4 x i32> %v, <4 x i32>* null
+  call void @llvm.memset.p0i8.i64(i8* null, i8 0, i64 4, i32 1, i1 true)
+  ret void
+}
+
+declare void @llvm.memset.p0i8.i64(i8*, i8, i64, i32, i1)
+
+; CHECK:      FastISel fallbacks in module '<stdin>':
+; CHECK-NEXT:   misses    insts  opcode                   type
+; CHECK-NEXT:        1        0  arguments                void (i16)
+; CHECK-NEXT:        1        1  call llvm.memset         void (i8*, i8, i64, i32, i1)
+; CHECK-NEXT:        2        2  insertelement            <4 x i32>
+; CHECK-NEXT:        4        3  total
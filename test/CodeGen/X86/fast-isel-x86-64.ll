@@ -304,3 +304,92 @@ define void @test23(i8* noalias sret %result) {
 }
 
 declare i8* @foo23()
+
+; Vector loads and stores use the unaligned moves when they are under-aligned.
+define void @test24(<4 x float>* %p, <4 x float>* %q) {
+  %a = load <4 x float>* %p, align 4
+  %b = load <4 x float>* %q
+  %c = fadd <4 x float> %a, %b
+  store <4 x float> %c, <4 x float>* %q, align 1
+  ret void
+; CHECK: test24:
+; CHECK: movups (%rdi), [[A:%xmm[0-9]+]]
+; CHECK: movaps (%rsi), [[B:%xmm[0-9]+]]
+; CHECK: addps [[B]], [[A]]
+; CHECK: movups [[A]], (%rsi)
+; AVX: test24:
+; AVX: vmovups (%rdi), [[A:%xmm[0-9]+]]
+; AVX: vaddps (%rsi), [[A]], [[C:%xmm[0-9]+]]
+; AVX: vmovups [[C]], (%rsi)
+}
+
+define <4 x i32> @test25(<4 x i32>* %p, <4 x i32> %x) {
+  %a = load <4 x i32>* %p
+  %b = and <4 x i32> %a, %x
+  %c = xor <4 x i32> %b, %x
+  ret <4 x i32> %c
+; CHECK: test25:
+; CHECK: movdqa (%rdi)
+; CHECK: pand
+; CHECK: pxor
+; AVX: test25:
+; AVX: vmovdqa (%rdi)
+; AVX: vpand
+; AVX: vpxor
+}
+
+; Scalar SSE selects go through general purpose registers.
+define double @test26(i1 %c, double %a, double %b) {
+  %r = select i1 %c, double %a, double %b
+  ret double %r
+; CHECK: test26:
+; CHECK: movd %xmm0, [[A:%r[a-z0-9]+]]
+; CHECK: movd %xmm1, [[B:%r[a-z0-9]+]]
+; CHECK: testb
+; CHECK: cmoveq [[B]], [[A]]
+; CHECK: movd [[A]], %xmm0
+}
+
+define float @test27(i1 %c, float %a, float %b) {
+  %r = select i1 %c, float %a, float %b
+  ret float %r
+; CHECK: test27:
+; CHECK: movd %xmm0, [[A:%e[a-z0-9]+]]
+; CHECK: movd %xmm1, [[B:%e[a-z0-9]+]]
+; CHECK: testb
+; CHECK: cmovel [[B]], [[A]]
+; CHECK: movd [[A]], %xmm0
+}
+
+; Small memsets of a constant are done with stores, memmoves are calls.
+define void @test28(i8* %p, i8* %q, i64 %n) {
+  call void @llvm.memset.p0i8.i64(i8* %p, i8 65, i64 13, i32 1, i1 false)
+  call void @llvm.memmove.p0i8.p0i8.i64(i8* %p, i8* %q, i64 %n, i32 1, i1 false)
+  ret void
+; CHECK: test28:
+; CHECK: movabsq $4702111234474983745, [[R:%r[a-z]+]]
+; CHECK: movq [[R]], (%rdi)
+; CHECK: movl $1094795585, 8(%rdi)
+; CHECK: movb $65, 12(%rdi)
+; CHECK: callq _memmove
+}
+
+declare void @llvm.memset.p0i8.i64(i8*, i8, i64, i32, i1)
+declare void @llvm.memmove.p0i8.p0i8.i64(i8*, i8*, i64, i32, i1)
+
+; Large byval arguments are copied with a rep;movs, before the arguments in
+; registers are set up.
+%struct.big = type { [41 x i32] }
+define void @test29(%struct.big* %b) nounwind {
+  call void @foo29(i32 1, %struct.big* byval align 4 %b, i32 2)
+  ret void
+; CHECK: test29:
+; CHECK: movq $20, %rcx
+; CHECK: rep;movsq
+; CHECK: movl 160(
+; CHECK: movl {{.*}}, 160(%rsp)
+; CHECK: movl {{.*}}, %edi
+; CHECK: callq _foo29
+}
+
+declare void @foo29(i32, %struct.big* byval align 4, i32)
@@ -0,0 +1,54 @@
+; REQUIRES: asserts
+; RUN: llc < %s -mtriple=x86_64-pc-linux-gnu -o /dev/null -stats \
+; RUN:   -function-pass-threads=2 2>&1 | FileCheck %s
+
+; Every IR pass before instruction selection runs on the worker threads.  The
+; dominator tree that the passes after them use is computed again on the
+; calling thread rather than stopping the workers before it.
+
+; CHECK: 2 function-shards {{ *}}- Number of functions run on worker threads
+; CHECK: 15 function-shards {{ *}}- Number of passes run on worker threads
+
+%node = type { %node*, i64 }
+
+define i64 @walk(%node* %n) {
+entry:
+  %z = icmp eq %node* %n, null
+  br i1 %z, label %exit, label %loop
+
+loop:
+  %p = phi %node* [ %n, %entry ], [ %next, %loop ]
+  %acc = phi i64 [ 0, %entry ], [ %acc.next, %loop ]
+  %vp = getelementptr %node* %p, i64 0, i32 1
+  %v = load i64* %vp
+  %acc.next = add i64 %acc, %v
+  %np = getelementptr %node* %p, i64 0, i32 0
+  %next = load %node** %np
+  %done = icmp eq %node* %next, null
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %r = phi i64 [ 0, %entry ], [ %acc.next, %loop ]
+  ret i64 %r
+}
+
+define i64 @strided(i64* %p, i64 %n) {
+entry:
+  %z = icmp eq i64 %n, 0
+  br i1 %z, label %exit, label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %acc = phi i64 [ 0, %entry ], [ %acc.next, %loop ]
+  %j = mul i64 %i, 3
+  %addr = getelementptr i64* %p, i64 %j
+  %v = load i64* %addr
+  %acc.next = add i64 %acc, %v
+  %i.next = add i64 %i, 1
+  %c = icmp slt i64 %i.next, %n
+  br i1 %c, label %loop, label %exit
+
+exit:
+  %r = phi i64 [ 0, %entry ], [ %acc.next, %loop ]
+  ret i64 %r
+}
@@ -0,0 +1,102 @@
+; RUN: llc < %s -mtriple=x86_64-pc-linux-gnu -filetype=obj -o %t1
+; RUN: llc < %s -mtriple=x86_64-pc-linux-gnu -filetype=obj -o %t2 \
+; RUN:   -function-pass-threads=2
+; RUN: llc < %s -mtriple=x86_64-pc-linux-gnu -filetype=obj -o %t3 \
+; RUN:   -function-pass-threads=8
+; RUN: diff %t1 %t2
+; RUN: diff %t1 %t3
+; RUN: llc < %s -mtriple=x86_64-pc-linux-gnu -o %t4
+; RUN: llc < %s -mtriple=x86_64-pc-linux-gnu -o %t5 -function-pass-threads=4
+; RUN: diff %t4 %t5
+
+; The IR passes before instruction selection may run on worker threads, but
+; instruction selection and emission stay in module order on the calling
+; thread, so the object file does not change.
+
+@buf = global [64 x i8] zeroinitializer, align 16
+
+declare void @use(i8*)
+declare i32 @__gxx_personality_v0(...)
+
+define void @stack() ssp {
+entry:
+  %a = alloca [32 x i8]
+  %p = getelementptr [32 x i8]* %a, i64 0, i64 0
+  call void @use(i8* %p)
+  ret void
+}
+
+define i64 @strided(i64* %p, i64 %n) {
+entry:
+  %z = icmp eq i64 %n, 0
+  br i1 %z, label %exit, label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %acc = phi i64 [ 0, %entry ], [ %acc.next, %loop ]
+  %j = mul i64 %i, 3
+  %addr = getelementptr i64* %p, i64 %j
+  %v = load i64* %addr
+  %acc.next = add i64 %acc, %v
+  %i.next = add i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %r = phi i64 [ 0, %entry ], [ %acc.next, %loop ]
+  ret i64 %r
+}
+
+define i32 @sink(i32 %x, i8* %q, i1 %c) {
+entry:
+  %addr = getelementptr i8* %q, i64 40
+  %ext = sext i32 %x to i64
+  br i1 %c, label %then, label %else
+
+then:
+  %v = load i8* %addr
+  %w = zext i8 %v to i32
+  ret i32 %w
+
+else:
+  %u = trunc i64 %ext to i32
+  ret i32 %u
+}
+
+define void @may_throw(i8* %p) {
+entry:
+  invoke void @use(i8* %p)
+          to label %cont unwind label %lpad
+
+cont:
+  ret void
+
+lpad:
+  %lp = landingpad { i8*, i32 } personality i32 (...)* @__gxx_personality_v0
+          cleanup
+  resume { i8*, i32 } %lp
+}
+
+define void @dead(i1 %c) {
+entry:
+  br i1 %c, label %a, label %b
+
+a:
+  call void @use(i8* getelementptr ([64 x i8]* @buf, i64 0, i64 0))
+  ret void
+
+b:
+  ret void
+
+unreachable.bb:
+  call void @use(i8* null)
+  br label %b
+}
+
+define double @fp(double %a, double %b) {
+entry:
+  %c = fcmp olt double %a, %b
+  %m = select i1 %c, double %a, double %b
+  %d = fmul double %m, 2.500000e-01
+  ret double %d
+}
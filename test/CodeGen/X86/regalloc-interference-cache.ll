@@ -0,0 +1,103 @@
+; REQUIRES: asserts
+; RUN: llc < %s -mtriple=x86_64-linux -stats 2>&1 | FileCheck %s
+; RUN: llc < %s -mtriple=x86_64-linux -o %t1
+; RUN: llc < %s -mtriple=x86_64-linux -regalloc-interference-cache=false \
+; RUN:   -o %t2
+; RUN: diff %t1 %t2
+
+; Greedy checks the interference of the same live range with the same
+; registers over and over while trying to assign, evict and split it.  The
+; results are remembered until the range or the assignments change, which
+; must not change the allocation.
+
+; CHECK: {{[1-9][0-9]*}} regalloc - Number of collections answered by the query state
+; CHECK: {{[1-9][0-9]*}} regalloc - Number of interference checks
+; CHECK: {{[1-9][0-9]*}} regalloc - Number of interference checks answered from cache
+; CHECK: {{[1-9][0-9]*}} regalloc - Number of interfering vreg collections
+
+declare void @g()
+
+define i32 @f(i32* %p) nounwind {
+entry:
+  %p0 = getelementptr i32* %p, i32 0
+  %a0 = load volatile i32* %p0
+  %p1 = getelementptr i32* %p, i32 1
+  %a1 = load volatile i32* %p1
+  %p2 = getelementptr i32* %p, i32 2
+  %a2 = load volatile i32* %p2
+  %p3 = getelementptr i32* %p, i32 3
+  %a3 = load volatile i32* %p3
+  %p4 = getelementptr i32* %p, i32 4
+  %a4 = load volatile i32* %p4
+  %p5 = getelementptr i32* %p, i32 5
+  %a5 = load volatile i32* %p5
+  %p6 = getelementptr i32* %p, i32 6
+  %a6 = load volatile i32* %p6
+  %p7 = getelementptr i32* %p, i32 7
+  %a7 = load volatile i32* %p7
+  %p8 = getelementptr i32* %p, i32 8
+  %a8 = load volatile i32* %p8
+  %p9 = getelementptr i32* %p, i32 9
+  %a9 = load volatile i32* %p9
+  %p10 = getelementptr i32* %p, i32 10
+  %a10 = load volatile i32* %p10
+  %p11 = getelementptr i32* %p, i32 11
+  %a11 = load volatile i32* %p11
+  %p12 = getelementptr i32* %p, i32 12
+  %a12 = load volatile i32* %p12
+  %p13 = getelementptr i32* %p, i32 13
+  %a13 = load volatile i32* %p13
+  %p14 = getelementptr i32* %p, i32 14
+  %a14 = load volatile i32* %p14
+  %p15 = getelementptr i32* %p, i32 15
+  %a15 = load volatile i32* %p15
+  %p16 = getelementptr i32* %p, i32 16
+  %a16 = load volatile i32* %p16
+  %p17 = getelementptr i32* %p, i32 17
+  %a17 = load volatile i32* %p17
+  %p18 = getelementptr i32* %p, i32 18
+  %a18 = load volatile i32* %p18
+  %p19 = getelementptr i32* %p, i32 19
+  %a19 = load volatile i32* %p19
+  call void @g()
+  %s1 = add i32 %a0, %a1
+  %s2 = mul i32 %s1, %a2
+  %s3 = add i32 %s2, %a3
+  %s4 = mul i32 %s3, %a4
+  %s5 = add i32 %s4, %a5
+  %s6 = mul i32 %s5, %a6
+  %s7 = add i32 %s6, %a7
+  %s8 = mul i32 %s7, %a8
+  %s9 = add i32 %s8, %a9
+  %s10 = mul i32 %s9, %a10
+  %s11 = add i32 %s10, %a11
+  %s12 = mul i32 %s11, %a12
+  %s13 = add i32 %s12, %a13
+  %s14 = mul i32 %s13, %a14
+  %s15 = add i32 %s14, %a15
+  %s16 = mul i32 %s15, %a16
+  %s17 = add i32 %s16, %a17
+  %s18 = mul i32 %s17, %a18
+  %s19 = add i32 %s18, %a19
+  store volatile i32 %a0, i32* %p0
+  store volatile i32 %a1, i32* %p1
+  store volatile i32 %a2, i32* %p2
+  store volatile i32 %a3, i32* %p3
+  store volatile i32 %a4, i32* %p4
+  store volatile i32 %a5, i32* %p5
+  store volatile i32 %a6, i32* %p6
+  store volatile i32 %a7, i32* %p7
+  store volatile i32 %a8, i32* %p8
+  store volatile i32 %a9, i32* %p9
+  store volatile i32 %a10, i32* %p10
+  store volatile i32 %a11, i32* %p11
+  store volatile i32 %a12, i32* %p12
+  store volatile i32 %a13, i32* %p13
+  store volatile i32 %a14, i32* %p14
+  store volatile i32 %a15, i32* %p15
+  store volatile i32 %a16, i32* %p16
+  store volatile i32 %a17, i32* %p17
+  store volatile i32 %a18, i32* %p18
+  store volatile i32 %a19, i32* %p19
+  ret i32 %s19
+}
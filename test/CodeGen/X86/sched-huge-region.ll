@@ -0,0 +1,71 @@
+; RUN: llc < %s -march=x86-64 -enable-misched -sched-mem-dep-budget=4 \
+; RUN:     -verify-machineinstrs -stats 2>&1 | FileCheck %s --check-prefix=BUDGET
+; RUN: llc < %s -march=x86-64 -enable-misched -post-RA-scheduler \
+; RUN:     -sched-max-region-size=8 -verify-machineinstrs -stats 2>&1 \
+; RUN:     | FileCheck %s --check-prefix=SPLIT
+; REQUIRES: asserts
+;
+; Bound the cost of building the scheduling graph of large blocks: memory
+; dependencies are truncated once too many memory operations are tracked, and
+; regions are split once they reach the maximum size.
+
+; BUDGET: 1 misched {{.*}} Number of scheduling regions with truncated memory dependencies
+
+; SPLIT: 5 misched {{.*}} Number of scheduling regions split by size
+; SPLIT: 5 post-RA-sched {{.*}} Number of scheduling regions split by size
+
+@a = global [32 x i32] zeroinitializer
+@b = global [32 x i32] zeroinitializer
+
+define void @f() nounwind {
+entry:
+  %v0 = load i32* getelementptr ([32 x i32]* @a, i64 0, i64 0)
+  %w0 = add i32 %v0, 0
+  store i32 %w0, i32* getelementptr ([32 x i32]* @b, i64 0, i64 0)
+  %v1 = load i32* getelementptr ([32 x i32]* @a, i64 0, i64 1)
+  %w1 = add i32 %v1, 1
+  store i32 %w1, i32* getelementptr ([32 x i32]* @b, i64 0, i64 1)
+  %v2 = load i32* getelementptr ([32 x i32]* @a, i64 0, i64 2)
+  %w2 = add i32 %v2, 2
+  store i32 %w2, i32* getelementptr ([32 x i32]* @b, i64 0, i64 2)
+  %v3 = load i32* getelementptr ([32 x i32]* @a, i64 0, i64 3)
+  %w3 = add i32 %v3, 3
+  store i32 %w3, i32* getelementptr ([32 x i32]* @b, i64 0, i64 3)
+  %v4 = load i32* getelementptr ([32 x i32]* @a, i64 0, i64 4)
+  %w4 = add i32 %v4, 4
+  store i32 %w4, i32* getelementptr ([32 x i32]* @b, i64 0, i64 4)
+  %v5 = load i32* getelementptr ([32 x i32]* @a, i64 0, i64 5)
+  %w5 = add i32 %v5, 5
+  store i32 %w5, i32* getelementptr ([32 x i32]* @b, i64 0, i64 5)
+  %v6 = load i32* getelementptr ([32 x i32]* @a, i64 0, i64 6)
+  %w6 = add i32 %v6, 6
+  store i32 %w6, i32* getelementptr ([32 x i32]* @b, i64 0, i64 6)
+  %v7 = load i32* getelementptr ([32 x i32]* @a, i64 0, i64 7)
+  %w7 = add i32 %v7, 7
+  store i32 %w7, i32* getelementptr ([32 x i32]* @b, i64 0, i64 7)
+  %v8 = load i32* getelementptr ([32 x i32]* @a, i64 0, i64 8)
+  %w8 = add i32 %v8, 8
+  store i32 %w8, i32* getelementptr ([32 x i32]* @b, i64 0, i64 8)
+  %v9 = load i32* getelementptr ([32 x i32]* @a, i64 0, i64 9)
+  %w9 = add i32 %v9, 9
+  store i32 %w9, i32* getelementptr ([32 x i32]* @b, i64 0, i64 9)
+  %v10 = load i32* getelementptr ([32 x i32]* @a, i64 0, i64 10)
+  %w10 = add i32 %v10, 10
+  store i32 %w10, i32* getelementptr ([32 x i32]* @b, i64 0, i64 10)
+  %v11 = load i32* getelementptr ([32 x i32]* @a, i64 0, i64 11)
+  %w11 = add i32 %v11, 11
+  store i32 %w11, i32* getelementptr ([32 x i32]* @b, i64 0, i64 11)
+  %v12 = load i32* getelementptr ([32 x i32]* @a, i64 0, i64 12)
+  %w12 = add i32 %v12, 12
+  store i32 %w12, i32* getelementptr ([32 x i32]* @b, i64 0, i64 12)
+  %v13 = load i32* getelementptr ([32 x i32]* @a, i64 0, i64 13)
+  %w13 = add i32 %v13, 13
+  store i32 %w13, i32* getelementptr ([32 x i32]* @b, i64 0, i64 13)
+  %v14 = load i32* getelementptr ([32 x i32]* @a, i64 0, i64 14)
+  %w14 = add i32 %v14, 14
+  store i32 %w14, i32* getelementptr ([32 x i32]* @b, i64 0, i64 14)
+  %v15 = load i32* getelementptr ([32 x i32]* @a, i64 0, i64 15)
+  %w15 = add i32 %v15, 15
+  store i32 %w15, i32* getelementptr ([32 x i32]* @b, i64 0, i64 15)
+  ret void
+}
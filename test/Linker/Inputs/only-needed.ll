@@ -0,0 +1,19 @@
+define i32 @needed() {
+  %r = call i32 @needed_transitively()
+  ret i32 %r
+}
+
+define i32 @needed_transitively() {
+  ret i32 1
+}
+
+define i32 @not_needed() {
+  %r = call i32 @needed()
+  ret i32 %r
+}
+
+@gv = global i32 ()* @from_global
+
+define i32 @from_global() {
+  ret i32 2
+}
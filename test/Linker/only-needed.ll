@@ -0,0 +1,19 @@
+; RUN: llvm-as %S/Inputs/only-needed.ll -o %t.b.bc
+; RUN: llvm-as %s -o %t.a.bc
+; RUN: llvm-link -only-needed -S %t.a.bc %t.b.bc | FileCheck %s
+; RUN: llvm-link -S %t.a.bc %t.b.bc | FileCheck %s -check-prefix=ALL
+
+; CHECK: define i32 @main()
+; CHECK: define i32 @needed()
+; CHECK: define i32 @needed_transitively()
+; CHECK: define i32 @from_global()
+; CHECK-NOT: @not_needed
+
+; ALL: define i32 @not_needed()
+
+declare i32 @needed()
+
+define i32 @main() {
+  %r = call i32 @needed()
+  ret i32 %r
+}
@@ -0,0 +1,53 @@
+// RUN: llvm-mc -filetype=obj -triple x86_64-pc-linux-gnu %s -o %t1
+// RUN: llvm-mc -filetype=obj -triple x86_64-pc-linux-gnu %s -o %t2 \
+// RUN:   -elf-write-threads=3
+// RUN: llvm-mc -filetype=obj -triple x86_64-pc-linux-gnu %s -o - \
+// RUN:   -elf-write-threads=1 > %t3
+// RUN: diff %t1 %t2
+// RUN: diff %t1 %t3
+
+// RUN: llvm-mc -filetype=obj -triple i386-pc-linux-gnu %s -o %t4
+// RUN: llvm-mc -filetype=obj -triple i386-pc-linux-gnu %s -o %t5 \
+// RUN:   -elf-write-threads=4
+// RUN: diff %t4 %t5
+
+// Test that writing the sections concurrently, straight into the output file
+// or into a buffer written to the stream, gives the same object file as
+// writing them one after the other.  The sections need padding between them
+// and the file has relocations, a section group and a line table.
+
+	.file	1 "t.c"
+	.text
+	.globl	f
+	.p2align 4, 0x90
+f:
+	.loc	1 1 0
+	jmp	g
+	.fill	300, 1, 0x90
+	.p2align 4
+	call	h
+	ret
+
+	.section	.text.g,"axG",@progbits,g,comdat
+	.globl	g
+g:
+	.loc	1 2 0
+	movl	$1, %eax
+	.org	.+40, 0xcc
+	ret
+
+	.data
+	.p2align 3
+d:
+	.long	f
+	.long	g + 8
+	.long	d - .
+	.uleb128	. - d
+
+	.bss
+	.zero	100
+
+	.section	.rodata,"a",@progbits
+	.asciz	"hello"
+	.p2align 5
+	.short	1, 2, 3
@@ -0,0 +1,33 @@
+// RUN: llvm-mc -filetype=obj -triple x86_64-pc-linux-gnu %s -o - \
+// RUN:   | llvm-objdump -disassemble -no-show-raw-insn - | FileCheck %s
+
+// Test a chain of relaxations: each jump only needs to be relaxed once the
+// jump after it has been.  The padding of the alignment after the chain
+// shrinks, and the backward jump across the chain has to see the final
+// offsets.
+
+// CHECK:       0: jmpq 130
+// CHECK:      5a: jmpq 130
+// CHECK:      b4: jmpq 285
+// CHECK:     1d8: jmpq -477
+// CHECK-NEXT: 1dd: jmp -7
+// CHECK-NEXT: 1df: ret
+
+	.text
+foo:
+	jmp	.L0
+	.fill	85, 1, 0x90
+	jmp	.L1
+	.fill	40, 1, 0x90
+.L0:
+	.fill	45, 1, 0x90
+	jmp	.L2
+	.fill	40, 1, 0x90
+.L1:
+	.fill	245, 1, 0x90
+.L2:
+	.p2align 3
+bar:
+	jmp	foo
+	jmp	bar
+	ret
@@ -0,0 +1,15 @@
+@target = global i8* blockaddress(@first, %next)
+
+define i32 @first(i32 %x) {
+entry:
+  %a = add i32 %x, 0
+  br label %next
+
+next:
+  ret i32 %a
+}
+
+define i32 @second(i32 %x) {
+  %a = mul i32 %x, 1
+  ret i32 %a
+}
@@ -0,0 +1,43 @@
+; REQUIRES: asserts
+; RUN: opt < %s -disable-output -stats -instcombine -function-pass-threads=2 \
+; RUN:   -info-output-file - | FileCheck %s
+; RUN: opt < %S/Inputs/function-pass-threads-blockaddress.ll -disable-output \
+; RUN:   -stats -instcombine -function-pass-threads=2 -info-output-file - \
+; RUN:   | FileCheck %s --check-prefix=BLOCKADDRESS
+; RUN: opt < %s -disable-output -stats -instcombine -function-pass-threads=2 \
+; RUN:   -time-passes -info-output-file - | FileCheck %s --check-prefix=TIMERS
+; RUN: opt < %s -S -instcombine -o %t1
+; RUN: opt < %s -S -instcombine -function-pass-threads=2 -o %t2
+; RUN: diff %t1 %t2
+
+; Definitions are run on worker threads, unless the module takes the address
+; of a block or the passes are timed.  @second is run again on the calling
+; thread, because the string that printf is turned into ends up named @str1,
+; which may have been renamed differently in the worker's copy of the module.
+
+; CHECK: 2 function-shards {{ *}}- Number of functions run on worker threads
+; BLOCKADDRESS-NOT: Number of functions run on worker threads
+; TIMERS-NOT: Number of functions run on worker threads
+
+@str = private constant [7 x i8] c"hello\0A\00"
+
+declare i32 @printf(i8*, ...)
+
+define i32 @first(i32 %x) {
+  %a = add i32 %x, 0
+  %b = mul i32 %a, 1
+  ret i32 %b
+}
+
+define void @second() {
+  %p = getelementptr [7 x i8]* @str, i32 0, i32 0
+  %r = call i32 (i8*, ...)* @printf(i8* %p)
+  ret void
+}
+
+define i1 @third(i32 %x) {
+  %a = xor i32 %x, -1
+  %b = xor i32 %a, -1
+  %c = icmp eq i32 %b, %x
+  ret i1 %c
+}
@@ -0,0 +1,137 @@
+; RUN: opt -S -sroa -early-cse -instcombine -memcpyopt -gvn -licm \
+; RUN:   -loop-rotate -indvars -simplifycfg %s -o %t1
+; RUN: opt -S -sroa -early-cse -instcombine -memcpyopt -gvn -licm \
+; RUN:   -loop-rotate -indvars -simplifycfg %s -o %t2 -function-pass-threads=3
+; RUN: opt -S -sroa -early-cse -instcombine -memcpyopt -gvn -licm \
+; RUN:   -loop-rotate -indvars -simplifycfg %s -o %t3 -function-pass-threads=16
+; RUN: diff %t1 %t2
+; RUN: diff %t1 %t3
+
+; Functions run on worker threads come back in module order, with the same
+; value names, types, constants and new declarations as a serial run.
+
+%pair = type { i32, i32 }
+%node = type { %node*, i64 }
+
+@table = internal global [16 x i32] zeroinitializer, align 16
+@head = global %node* null
+
+define i32 @sum(i32* %p, i32 %n) {
+entry:
+  %acc = alloca i32
+  store i32 0, i32* %acc
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %idx = sext i32 %i to i64
+  %addr = getelementptr i32* %p, i64 %idx
+  %v = load i32* %addr
+  %old = load i32* %acc
+  %new = add i32 %old, %v
+  store i32 %new, i32* %acc
+  %i.next = add i32 %i, 1
+  %done = icmp sge i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %r = load i32* %acc
+  ret i32 %r
+}
+
+define void @clear(i8* %dst) {
+entry:
+  %a = getelementptr i8* %dst, i64 0
+  store i8 0, i8* %a
+  %b = getelementptr i8* %dst, i64 1
+  store i8 0, i8* %b
+  %c = getelementptr i8* %dst, i64 2
+  store i8 0, i8* %c
+  %d = getelementptr i8* %dst, i64 3
+  store i8 0, i8* %d
+  %e = getelementptr i8* %dst, i64 4
+  store i8 0, i8* %e
+  %f = getelementptr i8* %dst, i64 5
+  store i8 0, i8* %f
+  %g = getelementptr i8* %dst, i64 6
+  store i8 0, i8* %g
+  %h = getelementptr i8* %dst, i64 7
+  store i8 0, i8* %h
+  ret void
+}
+
+define i32 @swap(%pair* %p) {
+entry:
+  %tmp = alloca %pair
+  %x.addr = getelementptr %pair* %p, i32 0, i32 0
+  %y.addr = getelementptr %pair* %p, i32 0, i32 1
+  %x = load i32* %x.addr
+  %y = load i32* %y.addr
+  %t.x = getelementptr %pair* %tmp, i32 0, i32 0
+  %t.y = getelementptr %pair* %tmp, i32 0, i32 1
+  store i32 %y, i32* %t.x
+  store i32 %x, i32* %t.y
+  %t = load %pair* %tmp
+  store %pair %t, %pair* %p
+  %s = add i32 %x, %y
+  %s2 = add i32 %y, %x
+  %r = mul i32 %s, %s2
+  ret i32 %r
+}
+
+define i64 @length() {
+entry:
+  %first = load %node** @head
+  %empty = icmp eq %node* %first, null
+  br i1 %empty, label %exit, label %loop
+
+loop:
+  %n = phi %node* [ %first, %entry ], [ %next, %loop ]
+  %len = phi i64 [ 0, %entry ], [ %len.next, %loop ]
+  %w.addr = getelementptr %node* %n, i32 0, i32 1
+  %w = load i64* %w.addr
+  %len.next = add i64 %len, %w
+  %next.addr = getelementptr %node* %n, i32 0, i32 0
+  %next = load %node** %next.addr
+  %end = icmp eq %node* %next, null
+  br i1 %end, label %exit, label %loop
+
+exit:
+  %l = phi i64 [ 0, %entry ], [ %len.next, %loop ]
+  ret i64 %l
+}
+
+define i32 @lookup(i32 %i) {
+entry:
+  %c = icmp ult i32 %i, 16
+  br i1 %c, label %in, label %out
+
+in:
+  %idx = zext i32 %i to i64
+  %addr = getelementptr [16 x i32]* @table, i64 0, i64 %idx
+  %v = load i32* %addr
+  %v2 = load i32* %addr
+  %s = add i32 %v, %v2
+  br label %out
+
+out:
+  %r = phi i32 [ %s, %in ], [ -1, %entry ]
+  ret i32 %r
+}
+
+define void @fill(i32 %x) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %addr = getelementptr [16 x i32]* @table, i64 0, i64 %i
+  %y = mul i32 %x, 3
+  store i32 %y, i32* %addr
+  %i.next = add i64 %i, 1
+  %done = icmp eq i64 %i.next, 16
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
@@ -0,0 +1,14 @@
+; RUN: opt < %s -instcombine -pass-trace=%t -disable-output
+; RUN: FileCheck %s < %t
+
+; CHECK: {"traceEvents":[
+; CHECK: {"name":"Combine redundant instructions","cat":"pass","ph":"X",{{.*}}"args":{"unit":"foo","insts_before":3,"insts_after":1,
+; CHECK: {"name":"Function Pass Manager",{{.*}}"args":{"unit":"foo",
+; CHECK: {"name":"Function Pass Manager",{{.*}}"args":{"unit":"<stdin>",
+; CHECK: ]}
+
+define i32 @foo(i32 %x) {
+  %a = add i32 %x, 0
+  %b = mul i32 %a, 1
+  ret i32 %b
+}
@@ -0,0 +1,92 @@
+; RUN: opt < %s -basicaa -dse -enable-dse-memoryssa -S | FileCheck %s
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+
+; Dead store elimination with Memory SSA instead of memory dependence analysis.
+
+declare void @f()
+declare i32 @g(i32*) readonly
+
+; The first store to %p is overwritten before anything reads it.
+define void @overwrite(i32* noalias %p, i32* noalias %q) {
+; CHECK: @overwrite
+; CHECK-NEXT: entry:
+; CHECK-NEXT: store i32 2, i32* %q
+; CHECK-NEXT: %v = load i32* %q
+; CHECK-NEXT: call i32 @g(i32* %q)
+; CHECK-NEXT: store i32 3, i32* %p
+entry:
+  store i32 1, i32* %p
+  store i32 2, i32* %q
+  %v = load i32* %q
+  call i32 @g(i32* %q)
+  store i32 3, i32* %p
+  ret void
+}
+
+; A load of %p in between keeps the store alive.
+define i32 @read(i32* %p) {
+; CHECK: @read
+; CHECK: store i32 1, i32* %p
+; CHECK: store i32 2, i32* %p
+entry:
+  store i32 1, i32* %p
+  %v = load i32* %p
+  store i32 2, i32* %p
+  ret i32 %v
+}
+
+; So does a call that may read it.
+define void @call(i32* %p) {
+; CHECK: @call
+; CHECK: store i32 1, i32* %p
+; CHECK: store i32 2, i32* %p
+entry:
+  store i32 1, i32* %p
+  call void @f()
+  store i32 2, i32* %p
+  ret void
+}
+
+; Storing back the value loaded from the same address is a no-op if nothing
+; wrote the address in between.  The load is then dead as well.
+define void @storeload(i32* noalias %p, i32* noalias %q) {
+; CHECK: @storeload
+; CHECK-NEXT: entry:
+; CHECK-NEXT: store i32 0, i32* %q
+; CHECK-NEXT: ret void
+entry:
+  %v = load i32* %p
+  store i32 0, i32* %q
+  store i32 %v, i32* %p
+  ret void
+}
+
+define void @storeload_clobbered(i32* %p, i32* %q) {
+; CHECK: @storeload_clobbered
+; CHECK: store i32 %v, i32* %p
+entry:
+  %v = load i32* %p
+  store i32 0, i32* %q
+  store i32 %v, i32* %p
+  ret void
+}
+
+; The load and the store see the same memory through the loop.
+define void @storeload_loop(i32* noalias %p, i32* noalias %q, i32 %n) {
+; CHECK: @storeload_loop
+; CHECK-NOT: store i32 %v, i32* %p
+entry:
+  %v = load i32* %p
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  store i32 %i, i32* %q
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  store i32 %v, i32* %p
+  ret void
+}
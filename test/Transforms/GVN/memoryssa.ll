@@ -0,0 +1,147 @@
+; RUN: opt < %s -basicaa -gvn -enable-gvn-memoryssa -S | FileCheck %s
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+
+; Load elimination with Memory SSA instead of memory dependence analysis.
+
+; The stored value is forwarded past stores that don't alias.
+define i32 @forward(i32* noalias %p, i32* noalias %q) {
+; CHECK: @forward
+; CHECK-NOT: load
+; CHECK: ret i32 1
+entry:
+  store i32 1, i32* %p
+  store i32 2, i32* %q
+  store i32 3, i32* %q
+  %v = load i32* %p
+  ret i32 %v
+}
+
+; Loads of an address that see the same memory are redundant, also in a loop
+; that only writes other memory.
+define i32 @redundant(i32* noalias %p, i32* noalias %q, i32 %n) {
+; CHECK: @redundant
+; CHECK: load i32* %p
+; CHECK-NOT: load
+; CHECK: ret i32
+entry:
+  %a = load i32* %p
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %b = load i32* %p
+  store i32 %b, i32* %q
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %c = load i32* %p
+  %s = add i32 %a, %c
+  ret i32 %s
+}
+
+; A load clobbered by a MemoryPhi gets a phi of the values stored in each
+; predecessor.
+define i32 @diamond(i1 %c, i32* noalias %p, i32* noalias %q) {
+; CHECK: @diamond
+; CHECK: join:
+; CHECK-NEXT: %v = phi i32 [ 2, %else ], [ 1, %then ]
+; CHECK-NEXT: ret i32 %v
+entry:
+  br i1 %c, label %then, label %else
+
+then:
+  store i32 1, i32* %p
+  store i32 5, i32* %q
+  br label %join
+
+else:
+  store i32 2, i32* %p
+  br label %join
+
+join:
+  %v = load i32* %p
+  ret i32 %v
+}
+
+; Not all the predecessors write the loaded memory.
+define i32 @partial(i1 %c, i32* %p) {
+; CHECK: @partial
+; CHECK: %v = load i32* %p
+entry:
+  br i1 %c, label %then, label %join
+
+then:
+  store i32 1, i32* %p
+  br label %join
+
+join:
+  %v = load i32* %p
+  ret i32 %v
+}
+
+; A store that may alias the load clobbers it.
+define i32 @mayalias(i32* %p, i32* %q) {
+; CHECK: @mayalias
+; CHECK: store i32 2, i32* %q
+; CHECK-NEXT: %v = load i32* %p
+entry:
+  store i32 1, i32* %p
+  store i32 2, i32* %q
+  %v = load i32* %p
+  ret i32 %v
+}
+
+; Nothing writes the alloca before it is loaded.
+define i32 @uninit() {
+; CHECK: @uninit
+; CHECK: ret i32 undef
+entry:
+  %x = alloca i32
+  %y = alloca i32
+  store i32 1, i32* %y
+  %v = load i32* %x
+  ret i32 %v
+}
+
+; Part of a memset is forwarded.
+declare void @llvm.memset.p0i8.i64(i8* nocapture, i8, i64, i32, i1) nounwind
+
+define i16 @memset(i8* %p) {
+; CHECK: @memset
+; CHECK-NOT: load
+; CHECK: ret i16 257
+entry:
+  call void @llvm.memset.p0i8.i64(i8* %p, i8 1, i64 16, i32 1, i1 false)
+  %q = getelementptr i8* %p, i64 4
+  %r = bitcast i8* %q to i16*
+  %v = load i16* %r
+  ret i16 %v
+}
+
+; The address of the load is different in each iteration, so the store of the
+; previous iteration is not forwarded.
+define void @varying(i32* %a, i32 %n) {
+; CHECK: @varying
+; CHECK: loop:
+; CHECK: %v = load i32* %p
+entry:
+  store i32 0, i32* %a
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %i.next = add i64 %i, 1
+  %p = getelementptr i32* %a, i64 %i
+  %v = load i32* %p
+  %v.next = add i32 %v, 1
+  %q = getelementptr i32* %a, i64 %i.next
+  store i32 %v.next, i32* %q
+  %t = trunc i64 %i.next to i32
+  %done = icmp eq i32 %t, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
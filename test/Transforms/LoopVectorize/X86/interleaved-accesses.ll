@@ -0,0 +1,74 @@
+; RUN: opt < %s -loop-vectorize -mtriple=x86_64-unknown-linux-gnu -mcpu=core2 -force-vector-unroll=1 -S | FileCheck %s
+; RUN: opt < %s -loop-vectorize -mtriple=x86_64-unknown-linux-gnu -mcpu=core2 -force-vector-unroll=1 -enable-interleaved-mem-accesses=false -S | FileCheck %s --check-prefix=DISABLED
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; Splitting pairs of i32 takes a shuffle per register, which makes the loop
+; profitable to vectorize.
+;   for (i = 0; i < 1024; ++i)
+;     out[i] = in[2*i] + in[2*i+1];
+
+;CHECK: @load_pairs(
+;CHECK: load <8 x i32>*
+;CHECK: shufflevector <8 x i32>
+;CHECK: shufflevector <8 x i32>
+;CHECK: ret void
+;DISABLED: @load_pairs(
+;DISABLED-NOT: <4 x i32>
+;DISABLED: ret void
+define void @load_pairs(i32* noalias nocapture %in, i32* noalias nocapture %out) {
+entry:
+  br label %for.body
+
+for.body:
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.body ]
+  %0 = shl nsw i64 %indvars.iv, 1
+  %arrayidx = getelementptr inbounds i32* %in, i64 %0
+  %1 = load i32* %arrayidx, align 4
+  %2 = or i64 %0, 1
+  %arrayidx3 = getelementptr inbounds i32* %in, i64 %2
+  %3 = load i32* %arrayidx3, align 4
+  %add = add nsw i32 %1, %3
+  %arrayidx5 = getelementptr inbounds i32* %out, i64 %indvars.iv
+  store i32 %add, i32* %arrayidx5, align 4
+  %indvars.iv.next = add i64 %indvars.iv, 1
+  %lftr.wideiv = trunc i64 %indvars.iv.next to i32
+  %exitcond = icmp eq i32 %lftr.wideiv, 1024
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; A stride of three is mostly scalarized by the legalizer, so we don't
+; vectorize it.
+;   for (i = 0; i < 1024; ++i)
+;     out[i] = in[3*i] * in[3*i+1];
+
+;CHECK: @load_triples(
+;CHECK-NOT: <4 x i32>
+;CHECK: ret void
+define void @load_triples(i32* noalias nocapture %in, i32* noalias nocapture %out) {
+entry:
+  br label %for.body
+
+for.body:
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.body ]
+  %0 = mul nsw i64 %indvars.iv, 3
+  %arrayidx = getelementptr inbounds i32* %in, i64 %0
+  %1 = load i32* %arrayidx, align 4
+  %2 = add nsw i64 %0, 1
+  %arrayidx3 = getelementptr inbounds i32* %in, i64 %2
+  %3 = load i32* %arrayidx3, align 4
+  %mul = mul nsw i32 %1, %3
+  %arrayidx5 = getelementptr inbounds i32* %out, i64 %indvars.iv
+  store i32 %mul, i32* %arrayidx5, align 4
+  %indvars.iv.next = add i64 %indvars.iv, 1
+  %lftr.wideiv = trunc i64 %indvars.iv.next to i32
+  %exitcond = icmp eq i32 %lftr.wideiv, 1024
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
@@ -0,0 +1,415 @@
+; RUN: opt < %s -loop-vectorize -force-vector-unroll=1 -force-vector-width=4 -dce -instcombine -S | FileCheck %s
+; RUN: opt < %s -loop-vectorize -force-vector-unroll=2 -force-vector-width=4 -dce -instcombine -S | FileCheck %s --check-prefix=UNROLL
+; RUN: opt < %s -loop-vectorize -force-vector-unroll=1 -force-vector-width=4 -enable-interleaved-mem-accesses=false -dce -instcombine -S | FileCheck %s --check-prefix=DISABLED
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+
+%struct.pair = type { i32, i32 }
+
+; Two loads with a stride of two elements are done with one wide load and
+; two shuffles.
+;   for (i = 0; i < 1024; ++i)
+;     out[i] = in[2*i] + in[2*i+1];
+
+;CHECK: @load_pairs(
+;CHECK: %wide.vec = load <8 x i32>* {{.*}}, align 4
+;CHECK: %strided.vec = shufflevector <8 x i32> %wide.vec, <8 x i32> undef, <4 x i32> <i32 0, i32 2, i32 4, i32 6>
+;CHECK: %strided.vec1 = shufflevector <8 x i32> %wide.vec, <8 x i32> undef, <4 x i32> <i32 1, i32 3, i32 5, i32 7>
+;CHECK: add nsw <4 x i32> %strided.vec, %strided.vec1
+;CHECK: ret void
+;UNROLL: @load_pairs(
+;UNROLL: load <8 x i32>*
+;UNROLL: load <8 x i32>*
+;UNROLL: ret void
+;DISABLED: @load_pairs(
+;DISABLED-NOT: load <8 x i32>*
+;DISABLED: ret void
+define void @load_pairs(i32* noalias nocapture %in, i32* noalias nocapture %out) {
+entry:
+  br label %for.body
+
+for.body:
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.body ]
+  %0 = shl nsw i64 %indvars.iv, 1
+  %arrayidx = getelementptr inbounds i32* %in, i64 %0
+  %1 = load i32* %arrayidx, align 4
+  %2 = or i64 %0, 1
+  %arrayidx3 = getelementptr inbounds i32* %in, i64 %2
+  %3 = load i32* %arrayidx3, align 4
+  %add = add nsw i32 %1, %3
+  %arrayidx5 = getelementptr inbounds i32* %out, i64 %indvars.iv
+  store i32 %add, i32* %arrayidx5, align 4
+  %indvars.iv.next = add i64 %indvars.iv, 1
+  %lftr.wideiv = trunc i64 %indvars.iv.next to i32
+  %exitcond = icmp eq i32 %lftr.wideiv, 1024
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; The fields of an array of structs.
+;   for (i = 0; i < 1024; ++i)
+;     out[i] = p[i].y - p[i].x;
+
+;CHECK: @load_struct(
+;CHECK: %wide.vec = load <8 x i32>*
+;CHECK: %strided.vec = shufflevector <8 x i32> %wide.vec, <8 x i32> undef, <4 x i32> <i32 0, i32 2, i32 4, i32 6>
+;CHECK: %strided.vec1 = shufflevector <8 x i32> %wide.vec, <8 x i32> undef, <4 x i32> <i32 1, i32 3, i32 5, i32 7>
+;CHECK: sub nsw <4 x i32> %strided.vec1, %strided.vec
+;CHECK: ret void
+define void @load_struct(%struct.pair* noalias nocapture %p, i32* noalias nocapture %out) {
+entry:
+  br label %for.body
+
+for.body:
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.body ]
+  %x = getelementptr inbounds %struct.pair* %p, i64 %indvars.iv, i32 0
+  %0 = load i32* %x, align 4
+  %y = getelementptr inbounds %struct.pair* %p, i64 %indvars.iv, i32 1
+  %1 = load i32* %y, align 4
+  %sub = sub nsw i32 %1, %0
+  %arrayidx = getelementptr inbounds i32* %out, i64 %indvars.iv
+  store i32 %sub, i32* %arrayidx, align 4
+  %indvars.iv.next = add i64 %indvars.iv, 1
+  %lftr.wideiv = trunc i64 %indvars.iv.next to i32
+  %exitcond = icmp eq i32 %lftr.wideiv, 1024
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; A group with a gap at its end reads past the last element that the loop
+; uses, so the last iteration always runs in the scalar loop. The wide load
+; starts at the first member even if the group is found at the second one.
+;   for (i = 0; i < n; ++i)
+;     out[i] = in[3*i+1] * in[3*i];
+
+;CHECK: @load_gap(
+;CHECK: %n.mod.vf = and i64 %n, 3
+;CHECK: [[ZERO:%[0-9]+]] = icmp eq i64 %n.mod.vf, 0
+;CHECK: [[REM:%[0-9]+]] = select i1 [[ZERO]], i64 4, i64 %n.mod.vf
+;CHECK: %n.vec = sub i64 %n, [[REM]]
+;CHECK: vector.body:
+;CHECK: %wide.vec = load <12 x i32>*
+;CHECK: %strided.vec = shufflevector <12 x i32> %wide.vec, <12 x i32> undef, <4 x i32> <i32 0, i32 3, i32 6, i32 9>
+;CHECK: %strided.vec1 = shufflevector <12 x i32> %wide.vec, <12 x i32> undef, <4 x i32> <i32 1, i32 4, i32 7, i32 10>
+;CHECK: mul nsw <4 x i32> %strided.vec1, %strided.vec
+;CHECK: ret void
+define void @load_gap(i32* noalias nocapture %in, i32* noalias nocapture %out, i64 %n) {
+entry:
+  br label %for.body
+
+for.body:
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.body ]
+  %0 = mul nsw i64 %indvars.iv, 3
+  %1 = add nsw i64 %0, 1
+  %arrayidx = getelementptr inbounds i32* %in, i64 %1
+  %2 = load i32* %arrayidx, align 4
+  %arrayidx2 = getelementptr inbounds i32* %in, i64 %0
+  %3 = load i32* %arrayidx2, align 4
+  %mul = mul nsw i32 %2, %3
+  %arrayidx4 = getelementptr inbounds i32* %out, i64 %indvars.iv
+  store i32 %mul, i32* %arrayidx4, align 4
+  %indvars.iv.next = add i64 %indvars.iv, 1
+  %exitcond = icmp eq i64 %indvars.iv.next, %n
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; A full group of stores is done with one shuffle and one wide store.
+;   for (i = 0; i < 1024; ++i) {
+;     out[2*i] = in[i];
+;     out[2*i+1] = in[i] + 1;
+;   }
+
+;CHECK: @store_pairs(
+;CHECK: %wide.load = load <4 x i32>*
+;CHECK: [[INC:%[0-9]+]] = add nsw <4 x i32> %wide.load, <i32 1, i32 1, i32 1, i32 1>
+;CHECK: %interleaved.vec = shufflevector <4 x i32> %wide.load, <4 x i32> [[INC]], <8 x i32> <i32 0, i32 4, i32 1, i32 5, i32 2, i32 6, i32 3, i32 7>
+;CHECK: store <8 x i32> %interleaved.vec, <8 x i32>* {{.*}}, align 4
+;CHECK: ret void
+;DISABLED: @store_pairs(
+;DISABLED-NOT: store <8 x i32>
+;DISABLED: ret void
+define void @store_pairs(i32* noalias nocapture %in, i32* noalias nocapture %out) {
+entry:
+  br label %for.body
+
+for.body:
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.body ]
+  %arrayidx = getelementptr inbounds i32* %in, i64 %indvars.iv
+  %0 = load i32* %arrayidx, align 4
+  %add = add nsw i32 %0, 1
+  %1 = shl nsw i64 %indvars.iv, 1
+  %arrayidx2 = getelementptr inbounds i32* %out, i64 %1
+  store i32 %0, i32* %arrayidx2, align 4
+  %2 = or i64 %1, 1
+  %arrayidx5 = getelementptr inbounds i32* %out, i64 %2
+  store i32 %add, i32* %arrayidx5, align 4
+  %indvars.iv.next = add i64 %indvars.iv, 1
+  %lftr.wideiv = trunc i64 %indvars.iv.next to i32
+  %exitcond = icmp eq i32 %lftr.wideiv, 1024
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; Three stores with a stride of three, concatenated before the shuffle.
+;   for (i = 0; i < 1024; ++i) {
+;     out[3*i] = in[i];
+;     out[3*i+1] = in[i] * 2;
+;     out[3*i+2] = in[i] * 3;
+;   }
+
+;CHECK: @store_triples(
+;CHECK: shufflevector <4 x float> %{{.*}}, <4 x float> %{{.*}}, <8 x i32> <i32 0, i32 1, i32 2, i32 3, i32 4, i32 5, i32 6, i32 7>
+;CHECK: shufflevector <4 x float> %{{.*}}, <4 x float> undef, <8 x i32> <i32 0, i32 1, i32 2, i32 3, i32 undef, i32 undef, i32 undef, i32 undef>
+;CHECK: %interleaved.vec = shufflevector <8 x float> %{{.*}}, <8 x float> %{{.*}}, <12 x i32> <i32 0, i32 4, i32 8, i32 1, i32 5, i32 9, i32 2, i32 6, i32 10, i32 3, i32 7, i32 11>
+;CHECK: store <12 x float> %interleaved.vec
+;CHECK: ret void
+define void @store_triples(float* noalias nocapture %in, float* noalias nocapture %out) {
+entry:
+  br label %for.body
+
+for.body:
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.body ]
+  %arrayidx = getelementptr inbounds float* %in, i64 %indvars.iv
+  %0 = load float* %arrayidx, align 4
+  %1 = mul nsw i64 %indvars.iv, 3
+  %arrayidx2 = getelementptr inbounds float* %out, i64 %1
+  store float %0, float* %arrayidx2, align 4
+  %mul = fmul float %0, 2.000000e+00
+  %2 = add nsw i64 %1, 1
+  %arrayidx5 = getelementptr inbounds float* %out, i64 %2
+  store float %mul, float* %arrayidx5, align 4
+  %mul6 = fmul float %0, 3.000000e+00
+  %3 = add nsw i64 %1, 2
+  %arrayidx9 = getelementptr inbounds float* %out, i64 %3
+  store float %mul6, float* %arrayidx9, align 4
+  %indvars.iv.next = add i64 %indvars.iv, 1
+  %lftr.wideiv = trunc i64 %indvars.iv.next to i32
+  %exitcond = icmp eq i32 %lftr.wideiv, 1024
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; Loads and stores of the same elements in one iteration.
+;   for (i = 0; i < 1024; ++i) {
+;     a[2*i] *= s;
+;     a[2*i+1] *= s;
+;   }
+
+;CHECK: @scale_pairs(
+;CHECK: %wide.vec = load <8 x float>*
+;CHECK: %strided.vec = shufflevector <8 x float> %wide.vec
+;CHECK: %strided.vec1 = shufflevector <8 x float> %wide.vec
+;CHECK: fmul <4 x float> %strided.vec
+;CHECK: fmul <4 x float> %strided.vec1
+;CHECK: %interleaved.vec = shufflevector <4 x float>
+;CHECK: store <8 x float> %interleaved.vec
+;CHECK: ret void
+define void @scale_pairs(float* noalias nocapture %a, float %s) {
+entry:
+  br label %for.body
+
+for.body:
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.body ]
+  %0 = shl nsw i64 %indvars.iv, 1
+  %arrayidx = getelementptr inbounds float* %a, i64 %0
+  %1 = load float* %arrayidx, align 4
+  %mul = fmul float %1, %s
+  store float %mul, float* %arrayidx, align 4
+  %2 = or i64 %0, 1
+  %arrayidx3 = getelementptr inbounds float* %a, i64 %2
+  %3 = load float* %arrayidx3, align 4
+  %mul4 = fmul float %3, %s
+  store float %mul4, float* %arrayidx3, align 4
+  %indvars.iv.next = add i64 %indvars.iv, 1
+  %lftr.wideiv = trunc i64 %indvars.iv.next to i32
+  %exitcond = icmp eq i32 %lftr.wideiv, 1024
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; The groups are in order, but the stores of an iteration are read by the
+; loads of the next one.
+;   for (i = 0; i < 1024; ++i) {
+;     a[2*i+2] = a[2*i] + 1;
+;     a[2*i+3] = a[2*i+1] + 1;
+;   }
+
+;CHECK: @carried_dep(
+;CHECK-NOT: <4 x i32>
+;CHECK: ret void
+define void @carried_dep(i32* noalias nocapture %a) {
+entry:
+  br label %for.body
+
+for.body:
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.body ]
+  %0 = shl nsw i64 %indvars.iv, 1
+  %arrayidx = getelementptr inbounds i32* %a, i64 %0
+  %1 = load i32* %arrayidx, align 4
+  %2 = or i64 %0, 1
+  %arrayidx3 = getelementptr inbounds i32* %a, i64 %2
+  %3 = load i32* %arrayidx3, align 4
+  %add = add nsw i32 %1, 1
+  %4 = add nsw i64 %0, 2
+  %arrayidx6 = getelementptr inbounds i32* %a, i64 %4
+  store i32 %add, i32* %arrayidx6, align 4
+  %add7 = add nsw i32 %3, 1
+  %5 = add nsw i64 %0, 3
+  %arrayidx10 = getelementptr inbounds i32* %a, i64 %5
+  store i32 %add7, i32* %arrayidx10, align 4
+  %indvars.iv.next = add i64 %indvars.iv, 1
+  %lftr.wideiv = trunc i64 %indvars.iv.next to i32
+  %exitcond = icmp eq i32 %lftr.wideiv, 1024
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; Only every other element is stored, so the stores can't be grouped.
+;   for (i = 0; i < 1024; ++i)
+;     out[2*i] = in[i];
+
+;CHECK: @store_gap(
+;CHECK-NOT: store <8 x i32>
+;CHECK: ret void
+define void @store_gap(i32* noalias nocapture %in, i32* noalias nocapture %out) {
+entry:
+  br label %for.body
+
+for.body:
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.body ]
+  %arrayidx = getelementptr inbounds i32* %in, i64 %indvars.iv
+  %0 = load i32* %arrayidx, align 4
+  %1 = shl nsw i64 %indvars.iv, 1
+  %arrayidx2 = getelementptr inbounds i32* %out, i64 %1
+  store i32 %0, i32* %arrayidx2, align 4
+  %indvars.iv.next = add i64 %indvars.iv, 1
+  %lftr.wideiv = trunc i64 %indvars.iv.next to i32
+  %exitcond = icmp eq i32 %lftr.wideiv, 1024
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; The second load reads the value of the first store in the same iteration,
+; which the wide load would miss.
+;   for (i = 0; i < 1024; ++i) {
+;     a[2*i+1] = a[2*i] * 2;
+;     a[2*i] = a[2*i+1] + 1;
+;   }
+
+;CHECK: @store_to_load_order(
+;CHECK-NOT: <4 x i32>
+;CHECK: ret void
+define void @store_to_load_order(i32* noalias nocapture %a) {
+entry:
+  br label %for.body
+
+for.body:
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.body ]
+  %0 = shl nsw i64 %indvars.iv, 1
+  %arrayidx = getelementptr inbounds i32* %a, i64 %0
+  %1 = load i32* %arrayidx, align 4
+  %mul = shl nsw i32 %1, 1
+  %2 = or i64 %0, 1
+  %arrayidx3 = getelementptr inbounds i32* %a, i64 %2
+  store i32 %mul, i32* %arrayidx3, align 4
+  %3 = load i32* %arrayidx3, align 4
+  %add = add nsw i32 %3, 1
+  store i32 %add, i32* %arrayidx, align 4
+  %indvars.iv.next = add i64 %indvars.iv, 1
+  %lftr.wideiv = trunc i64 %indvars.iv.next to i32
+  %exitcond = icmp eq i32 %lftr.wideiv, 1024
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; Without noalias, the pointers are checked at runtime.  The members of a
+; group, and groups on the same array, always overlap, but they have been
+; checked against each other already, so only %x and %y are compared.
+;   for (i = 0; i < 1024; ++i)
+;     y[i] = x[2*i] + x[2*i+1];
+
+;CHECK: @load_pairs_may_alias(
+;CHECK: vector.memcheck:
+;CHECK: %conflict.rdx = or i1 %found.conflict{{[0-9]*}}, %found.conflict{{[0-9]*}}
+;CHECK-NEXT: br i1 %conflict.rdx, label %middle.block, label %vector.ph
+;CHECK: %wide.vec = load <8 x i32>* {{.*}}, align 4
+;CHECK: ret void
+define void @load_pairs_may_alias(i32* nocapture %x, i32* nocapture %y) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %idx0 = shl nsw i64 %i, 1
+  %idx1 = or i64 %idx0, 1
+  %p0 = getelementptr inbounds i32* %x, i64 %idx0
+  %p1 = getelementptr inbounds i32* %x, i64 %idx1
+  %a = load i32* %p0, align 4
+  %b = load i32* %p1, align 4
+  %s = add nsw i32 %a, %b
+  %q = getelementptr inbounds i32* %y, i64 %i
+  store i32 %s, i32* %q, align 4
+  %i.next = add i64 %i, 1
+  %done = icmp eq i64 %i.next, 1024
+  br i1 %done, label %exit, label %for.body
+
+exit:
+  ret void
+}
+
+;   for (i = 0; i < 1024; ++i) {
+;     a[2*i] *= s[i];
+;     a[2*i+1] *= s[i];
+;   }
+
+;CHECK: @scale_pairs_may_alias(
+;CHECK: vector.memcheck:
+;CHECK: %conflict.rdx = or i1 %found.conflict{{[0-9]*}}, %found.conflict{{[0-9]*}}
+;CHECK-NEXT: br i1 %conflict.rdx, label %middle.block, label %vector.ph
+;CHECK: %wide.vec = load <8 x float>* {{.*}}, align 4
+;CHECK: store <8 x float> %interleaved.vec, <8 x float>* {{.*}}, align 4
+;CHECK: ret void
+define void @scale_pairs_may_alias(float* nocapture %a, float* nocapture %s) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %idx0 = shl nsw i64 %i, 1
+  %idx1 = or i64 %idx0, 1
+  %ps = getelementptr inbounds float* %s, i64 %i
+  %f = load float* %ps, align 4
+  %p0 = getelementptr inbounds float* %a, i64 %idx0
+  %p1 = getelementptr inbounds float* %a, i64 %idx1
+  %a0 = load float* %p0, align 4
+  %a1 = load float* %p1, align 4
+  %m0 = fmul float %a0, %f
+  %m1 = fmul float %a1, %f
+  store float %m0, float* %p0, align 4
+  store float %m1, float* %p1, align 4
+  %i.next = add i64 %i, 1
+  %done = icmp eq i64 %i.next, 1024
+  br i1 %done, label %exit, label %for.body
+
+exit:
+  ret void
+}
@@ -0,0 +1,135 @@
+; RUN: opt < %s -basicaa -slp-vectorizer -dce -S -mtriple=x86_64-apple-macosx10.8.0 -mcpu=corei7 | FileCheck %s
+; RUN: opt < %s -basicaa -slp-vectorizer -slp-vectorize-hor=false -dce -S -mtriple=x86_64-apple-macosx10.8.0 -mcpu=corei7 | FileCheck %s -check-prefix=NOHOR
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+target triple = "x86_64-apple-macosx10.8.0"
+
+; int dot(int *a, int *b) {
+;   return a[0]*b[0] + a[1]*b[1] + a[2]*b[2] + a[3]*b[3];
+; }
+; CHECK: @dot
+; CHECK: load <4 x i32>
+; CHECK: load <4 x i32>
+; CHECK: mul <4 x i32>
+; CHECK: shufflevector <4 x i32> {{.*}} <i32 2, i32 3, i32 undef, i32 undef>
+; CHECK: add <4 x i32>
+; CHECK: shufflevector <4 x i32> {{.*}} <i32 1, i32 undef, i32 undef, i32 undef>
+; CHECK: add <4 x i32>
+; CHECK: [[R:%[a-z0-9.]+]] = extractelement <4 x i32> {{.*}}, i32 0
+; CHECK: ret i32 [[R]]
+; NOHOR: @dot
+; NOHOR-NOT: <4 x i32>
+; NOHOR: ret
+define i32 @dot(i32* noalias %a, i32* noalias %b) {
+entry:
+  %a0 = load i32* %a, align 4
+  %b0 = load i32* %b, align 4
+  %m0 = mul nsw i32 %b0, %a0
+  %pa1 = getelementptr inbounds i32* %a, i64 1
+  %a1 = load i32* %pa1, align 4
+  %pb1 = getelementptr inbounds i32* %b, i64 1
+  %b1 = load i32* %pb1, align 4
+  %m1 = mul nsw i32 %b1, %a1
+  %s1 = add nsw i32 %m1, %m0
+  %pa2 = getelementptr inbounds i32* %a, i64 2
+  %a2 = load i32* %pa2, align 4
+  %pb2 = getelementptr inbounds i32* %b, i64 2
+  %b2 = load i32* %pb2, align 4
+  %m2 = mul nsw i32 %b2, %a2
+  %s2 = add nsw i32 %s1, %m2
+  %pa3 = getelementptr inbounds i32* %a, i64 3
+  %a3 = load i32* %pa3, align 4
+  %pb3 = getelementptr inbounds i32* %b, i64 3
+  %b3 = load i32* %pb3, align 4
+  %m3 = mul nsw i32 %b3, %a3
+  %s3 = add nsw i32 %s2, %m3
+  ret i32 %s3
+}
+
+; Floating point reductions are only reassociated under fast-math.
+; CHECK: @fdot_fast
+; CHECK: fmul <4 x float>
+; CHECK: fadd fast <4 x float>
+; CHECK: ret float
+define float @fdot_fast(float* noalias %a, float* noalias %b) {
+entry:
+  %a0 = load float* %a, align 4
+  %b0 = load float* %b, align 4
+  %m0 = fmul fast float %a0, %b0
+  %pa1 = getelementptr inbounds float* %a, i64 1
+  %a1 = load float* %pa1, align 4
+  %pb1 = getelementptr inbounds float* %b, i64 1
+  %b1 = load float* %pb1, align 4
+  %m1 = fmul fast float %a1, %b1
+  %s1 = fadd fast float %m0, %m1
+  %pa2 = getelementptr inbounds float* %a, i64 2
+  %a2 = load float* %pa2, align 4
+  %pb2 = getelementptr inbounds float* %b, i64 2
+  %b2 = load float* %pb2, align 4
+  %m2 = fmul fast float %a2, %b2
+  %s2 = fadd fast float %s1, %m2
+  %pa3 = getelementptr inbounds float* %a, i64 3
+  %a3 = load float* %pa3, align 4
+  %pb3 = getelementptr inbounds float* %b, i64 3
+  %b3 = load float* %pb3, align 4
+  %m3 = fmul fast float %a3, %b3
+  %s3 = fadd fast float %s2, %m3
+  ret float %s3
+}
+
+; CHECK: @fdot_strict
+; CHECK-NOT: <4 x float>
+; CHECK: ret float
+define float @fdot_strict(float* noalias %a, float* noalias %b) {
+entry:
+  %a0 = load float* %a, align 4
+  %b0 = load float* %b, align 4
+  %m0 = fmul float %a0, %b0
+  %pa1 = getelementptr inbounds float* %a, i64 1
+  %a1 = load float* %pa1, align 4
+  %pb1 = getelementptr inbounds float* %b, i64 1
+  %b1 = load float* %pb1, align 4
+  %m1 = fmul float %a1, %b1
+  %s1 = fadd float %m0, %m1
+  %pa2 = getelementptr inbounds float* %a, i64 2
+  %a2 = load float* %pa2, align 4
+  %pb2 = getelementptr inbounds float* %b, i64 2
+  %b2 = load float* %pb2, align 4
+  %m2 = fmul float %a2, %b2
+  %s2 = fadd float %s1, %m2
+  %pa3 = getelementptr inbounds float* %a, i64 3
+  %a3 = load float* %pa3, align 4
+  %pb3 = getelementptr inbounds float* %b, i64 3
+  %b3 = load float* %pb3, align 4
+  %m3 = fmul float %a3, %b3
+  %s3 = fadd float %s2, %m3
+  ret float %s3
+}
+
+; The last product is reduced twice, once in the vectorized leaves and once in
+; the scalar remainder, which must read its extract.
+; CHECK: @repeated_leaf
+; CHECK: mul <4 x i32>
+; CHECK: [[X:%[a-z0-9.]+]] = extractelement <4 x i32> {{.*}}, i32 3
+; CHECK: [[R:%[a-z0-9.]+]] = extractelement <4 x i32> {{.*}}, i32 0
+; CHECK: [[S:%[a-z0-9.]+]] = add i32 [[R]], [[X]]
+; CHECK: ret i32 [[S]]
+define i32 @repeated_leaf(i32* noalias %a) {
+entry:
+  %a0 = load i32* %a, align 4
+  %m0 = mul nsw i32 %a0, 3
+  %pa1 = getelementptr inbounds i32* %a, i64 1
+  %a1 = load i32* %pa1, align 4
+  %m1 = mul nsw i32 %a1, 3
+  %s1 = add nsw i32 %m1, %m0
+  %pa2 = getelementptr inbounds i32* %a, i64 2
+  %a2 = load i32* %pa2, align 4
+  %m2 = mul nsw i32 %a2, 3
+  %s2 = add nsw i32 %s1, %m2
+  %pa3 = getelementptr inbounds i32* %a, i64 3
+  %a3 = load i32* %pa3, align 4
+  %m3 = mul nsw i32 %a3, 3
+  %s3 = add nsw i32 %s2, %m3
+  %s4 = add nsw i32 %s3, %m3
+  ret i32 %s4
+}
@@ -0,0 +1,121 @@
+; RUN: opt < %s -basicaa -slp-vectorizer -dce -S -mtriple=x86_64-apple-macosx10.8.0 -mcpu=corei7-avx | FileCheck %s
+; RUN: opt < %s -O3 -vectorize-slp -S -mtriple=x86_64-apple-macosx10.8.0 -mcpu=corei7-avx | FileCheck %s -check-prefix=O3
+; RUN: opt < %s -O3 -S -mtriple=x86_64-apple-macosx10.8.0 -mcpu=corei7-avx | FileCheck %s -check-prefix=NOSLP
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+target triple = "x86_64-apple-macosx10.8.0"
+
+; Simple 2-wide vectorization of a multiplication of loads.
+; CHECK: @test1
+; CHECK: load <2 x double>
+; CHECK: load <2 x double>
+; CHECK: fmul <2 x double>
+; CHECK: store <2 x double>
+; CHECK-NOT: store double
+; CHECK: ret
+; O3: @test1
+; O3: fmul <2 x double>
+; O3: ret
+; NOSLP: @test1
+; NOSLP-NOT: <2 x double>
+; NOSLP: ret
+define void @test1(double* noalias %a, double* noalias %b, double* noalias %c) {
+entry:
+  %i0 = load double* %a, align 8
+  %i1 = load double* %b, align 8
+  %mul = fmul double %i0, %i1
+  %arrayidx3 = getelementptr inbounds double* %a, i64 1
+  %i3 = load double* %arrayidx3, align 8
+  %arrayidx4 = getelementptr inbounds double* %b, i64 1
+  %i4 = load double* %arrayidx4, align 8
+  %mul5 = fmul double %i3, %i4
+  store double %mul, double* %c, align 8
+  %arrayidx5 = getelementptr inbounds double* %c, i64 1
+  store double %mul5, double* %arrayidx5, align 8
+  ret void
+}
+
+; The stores are not in the order of the addresses, and the operands of the
+; second addition are swapped.
+; CHECK: @test_order
+; CHECK: load <4 x i32>
+; CHECK: add <4 x i32>
+; CHECK: store <4 x i32>
+; CHECK-NOT: store i32
+; CHECK: ret
+define void @test_order(i32* noalias %a, i32* noalias %b, i32 %k) {
+entry:
+  %a1 = getelementptr inbounds i32* %a, i64 1
+  %a2 = getelementptr inbounds i32* %a, i64 2
+  %a3 = getelementptr inbounds i32* %a, i64 3
+  %b1 = getelementptr inbounds i32* %b, i64 1
+  %b2 = getelementptr inbounds i32* %b, i64 2
+  %b3 = getelementptr inbounds i32* %b, i64 3
+  %l0 = load i32* %a, align 4
+  %l1 = load i32* %a1, align 4
+  %l2 = load i32* %a2, align 4
+  %l3 = load i32* %a3, align 4
+  %x0 = add i32 %l0, %k
+  %x1 = add i32 %k, %l1
+  %x2 = add i32 %l2, %k
+  %x3 = add i32 %l3, %k
+  store i32 %x2, i32* %b2, align 4
+  store i32 %x0, i32* %b, align 4
+  store i32 %x3, i32* %b3, align 4
+  store i32 %x1, i32* %b1, align 4
+  ret void
+}
+
+; The scalar %mul is still used outside of the tree and is extracted.
+; CHECK: @extr_user
+; CHECK: [[V:%[0-9]+]] = fmul <2 x double>
+; CHECK: [[E:%[0-9]+]] = extractelement <2 x double> [[V]], i32 0
+; CHECK: store <2 x double> [[V]]
+; CHECK: ret double [[E]]
+define double @extr_user(double* noalias %a, double* noalias %b, double* noalias %c) {
+entry:
+  %i0 = load double* %a, align 8
+  %i1 = load double* %b, align 8
+  %mul = fmul double %i0, %i1
+  %arrayidx3 = getelementptr inbounds double* %a, i64 1
+  %i3 = load double* %arrayidx3, align 8
+  %arrayidx4 = getelementptr inbounds double* %b, i64 1
+  %i4 = load double* %arrayidx4, align 8
+  %mul5 = fmul double %i3, %i4
+  store double %mul, double* %c, align 8
+  %arrayidx5 = getelementptr inbounds double* %c, i64 1
+  store double %mul5, double* %arrayidx5, align 8
+  ret double %mul
+}
+
+; The loads can't be moved across the store to %c, which may alias them.
+; CHECK: @may_alias
+; CHECK-NOT: load <2 x double>
+; CHECK: ret
+define void @may_alias(double* %a, double* %c) {
+entry:
+  %i0 = load double* %a, align 8
+  %mul = fmul double %i0, %i0
+  store double %mul, double* %c, align 8
+  %arrayidx3 = getelementptr inbounds double* %a, i64 1
+  %i3 = load double* %arrayidx3, align 8
+  %mul5 = fmul double %i3, %i3
+  %arrayidx5 = getelementptr inbounds double* %c, i64 1
+  store double %mul5, double* %arrayidx5, align 8
+  ret void
+}
+
+; Volatile accesses are not vectorized.
+; CHECK: @volatile_store
+; CHECK-NOT: store <2 x double>
+; CHECK: ret
+define void @volatile_store(double* noalias %a, double* noalias %c) {
+entry:
+  %i0 = load double* %a, align 8
+  %arrayidx3 = getelementptr inbounds double* %a, i64 1
+  %i3 = load double* %arrayidx3, align 8
+  store volatile double %i0, double* %c, align 8
+  %arrayidx5 = getelementptr inbounds double* %c, i64 1
+  store volatile double %i3, double* %arrayidx5, align 8
+  ret void
+}
@@ -77,6 +77,7 @@ namespace options {
   static std::string extra_library_path;
   static std::string triple;
   static std::string mcpu;
+  static unsigned partitions = 1;
   // Additional options to pass into the code generator.
   // Note: This array will contain all plugin options which are not claimed
   // as plugin exclusive to pass to the code generator.
@@ -96,6 +97,12 @@ namespace options {
       mcpu = opt.substr(strlen("mcpu="));
     } else if (opt.startswith("extra-library-path=")) {
       extra_library_path = opt.substr(strlen("extra_library_path="));
+    } else if (opt.startswith("partitions=")) {
+      if (opt.substr(strlen("partitions=")).getAsInteger(10, partitions) ||
+          partitions == 0) {
+        (*message)(LDPL_WARNING, "Ignoring invalid partition count %s", opt_);
+        partitions = 1;
+      }
     } else if (opt.startswith("mtriple=")) {
       triple = opt.substr(strlen("mtriple="));
     } else if (opt.startswith("obj-path=")) {
@@ -397,6 +404,7 @@ static ld_plugin_status all_symbols_read_hook(void) {
   lto_codegen_set_debug_model(code_gen, LTO_DEBUG_MODEL_DWARF);
   if (!options::mcpu.empty())
     lto_codegen_set_cpu(code_gen, options::mcpu.c_str());
+  lto_codegen_set_num_partitions(code_gen, options::partitions);
 
   // Pass through extra options to the code generator.
   if (!options::extra.empty()) {
@@ -420,10 +428,13 @@ static ld_plugin_status all_symbols_read_hook(void) {
     if (options::generate_bc_file == options::BC_ONLY)
       exit(0);
   }
-  const char *objPath;
-  if (lto_codegen_compile_to_file(code_gen, &objPath)) {
+  const char **objNames = NULL;
+  unsigned numObjs = 0;
+  if (lto_codegen_compile_to_files(code_gen, &objNames, &numObjs)) {
     (*message)(LDPL_ERROR, "Could not produce a combined object file\n");
   }
+  // The names are owned by the code generator, so copy them out.
+  std::vector<std::string> objPaths(objNames, objNames + numObjs);
 
   lto_codegen_dispose(code_gen);
   for (std::list<claimed_file>::iterator I = Modules.begin(),
@@ -434,10 +445,12 @@ static ld_plugin_status all_symbols_read_hook(void) {
     }
   }
 
-  if ((*add_input_file)(objPath) != LDPS_OK) {
-    (*message)(LDPL_ERROR, "Unable to add .o file to the link.");
-    (*message)(LDPL_ERROR, "File left behind in: %s", objPath);
-    return LDPS_ERR;
+  for (unsigned i = 0; i != numObjs; ++i) {
+    if ((*add_input_file)(objPaths[i].c_str()) != LDPS_OK) {
+      (*message)(LDPL_ERROR, "Unable to add .o file to the link.");
+      (*message)(LDPL_ERROR, "File left behind in: %s", objPaths[i].c_str());
+      return LDPS_ERR;
+    }
   }
 
   if (!options::extra_library_path.empty() &&
@@ -447,7 +460,8 @@ static ld_plugin_status all_symbols_read_hook(void) {
   }
 
   if (options::obj_path.empty())
-    Cleanup.push_back(sys::Path(objPath));
+    for (unsigned i = 0; i != numObjs; ++i)
+      Cleanup.push_back(sys::Path(objPaths[i]));
 
   return LDPS_OK;
 }
@@ -16,9 +16,11 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Assembly/PrintModulePass.h"
+#include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/CodeGen/CommandFlags.h"
 #include "llvm/CodeGen/LinkAllAsmWriterComponents.h"
 #include "llvm/CodeGen/LinkAllCodegenComponents.h"
+#include "llvm/Config/config.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/Module.h"
 #include "llvm/MC/SubtargetFeature.h"
@@ -26,10 +28,12 @@
 #include "llvm/PassManager.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/FileCache.h"
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/Host.h"
 #include "llvm/Support/IRReader.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/PluginLoader.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
@@ -38,6 +42,7 @@
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Target/TargetLibraryInfo.h"
 #include "llvm/Target/TargetMachine.h"
+#include "llvm/Transforms/Utils/FunctionShards.h"
 #include <memory>
 using namespace llvm;
 
@@ -76,6 +81,17 @@ DisableSimplifyLibCalls("disable-simplify-libcalls",
                         cl::desc("Disable simplify-libcalls"),
                         cl::init(false));
 
+static cl::opt<std::string>
+ObjectCacheDir("object-cache-dir",
+               cl::desc("Reuse previously generated output files from this "
+                        "directory"),
+               cl::value_desc("directory"));
+
+static cl::opt<unsigned>
+ObjectCacheSize("object-cache-size", cl::init(0), cl::value_desc("MB"),
+                cl::desc("Evict the least recently used files from the "
+                         "object cache beyond this size (default: unbounded)"));
+
 static int compileModule(char**, LLVMContext&);
 
 // GetFileNameRoot - Helper function to get the basename of a filename.
@@ -156,6 +172,39 @@ static tool_output_file *GetOutputStream(const char *TargetName,
   return FDOut;
 }
 
+/// computeCacheKey - Hash everything that determines the output of llc: the
+/// module and its identifier, which is printed in the .file directive, the
+/// target triple and the rest of the command line, which carries the CPU, the
+/// target features, the TargetOptions and any code generator flags.
+static std::string computeCacheKey(char **argv, Module *M,
+                                   const Triple &TheTriple) {
+  FileCache::Key Key;
+  Key.add(PACKAGE_VERSION);
+
+  std::string Bitcode;
+  raw_string_ostream BitcodeOS(Bitcode);
+  WriteBitcodeToFile(M, BitcodeOS);
+  Key.add(BitcodeOS.str());
+  Key.add(M->getModuleIdentifier());
+  Key.add(InputFilename);
+  Key.add(TheTriple.getTriple());
+
+  // The output file name does not affect the output.
+  for (char **Arg = argv + 1; *Arg; ++Arg) {
+    StringRef Opt = StringRef(*Arg).ltrim("-");
+    if (*Arg == InputFilename || Opt.startswith("o=") ||
+        Opt.startswith("object-cache-"))
+      continue;
+    if (Opt == "o") {
+      if (*++Arg == 0)
+        break;
+      continue;
+    }
+    Key.add(*Arg);
+  }
+  return Key.str();
+}
+
 // main - Entry point for the llc compiler.
 //
 int main(int argc, char **argv) {
@@ -183,6 +232,10 @@ int main(int argc, char **argv) {
   initializeLowerIntrinsicsPass(*Registry);
   initializeUnreachableBlockElimPass(*Registry);
 
+  // Let -function-pass-threads run the IR passes before instruction selection
+  // on worker threads.
+  enableFunctionPassThreads();
+
   // Register the target printer for --version.
   cl::AddExtraVersionPrinter(TargetRegistry::printRegisteredTargetsForVersion);
 
@@ -310,6 +363,21 @@ static int compileModule(char **argv, LLVMContext &Context) {
     (GetOutputStream(TheTarget->getName(), TheTriple.getOS(), argv[0]));
   if (!Out) return 1;
 
+  // If the output is already in the object cache, there is nothing to do.
+  OwningPtr<FileCache> Cache;
+  std::string CacheKey;
+  if (!ObjectCacheDir.empty()) {
+    Cache.reset(new FileCache(ObjectCacheDir,
+                              uint64_t(ObjectCacheSize) * 1024 * 1024));
+    CacheKey = computeCacheKey(argv, mod, TheTriple);
+    OwningPtr<MemoryBuffer> Cached;
+    if (Cache->lookup(CacheKey, Cached)) {
+      Out->os() << Cached->getBuffer();
+      Out->keep();
+      return 0;
+    }
+  }
+
   // Build up all of the passes that we want to do to the module.
   PassManager PM;
 
@@ -339,8 +407,13 @@ static int compileModule(char **argv, LLVMContext &Context) {
       Target.setMCRelaxAll(true);
   }
 
+  // When caching, generate the output into memory so that it can be stored.
+  SmallString<0> CacheBuffer;
+  raw_svector_ostream CacheOS(CacheBuffer);
+
   {
-    formatted_raw_ostream FOS(Out->os());
+    formatted_raw_ostream FOS(Cache ? static_cast<raw_ostream &>(CacheOS)
+                                    : Out->os());
 
     AnalysisID StartAfterID = 0;
     AnalysisID StopAfterID = 0;
@@ -376,6 +449,15 @@ static int compileModule(char **argv, LLVMContext &Context) {
     PM.run(*mod);
   }
 
+  if (Cache) {
+    StringRef Output = CacheOS.str();
+    Out->os() << Output;
+    if (error_code EC = Cache->store(CacheKey, Output))
+      errs() << argv[0] << ": warning: could not add output to object cache: "
+             << EC.message() << '\n';
+    Cache->prune();
+  }
+
   // Declare success.
   Out->keep();
 
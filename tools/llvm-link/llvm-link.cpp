@@ -46,15 +46,23 @@ OutputAssembly("S",
 static cl::opt<bool>
 Verbose("v", cl::desc("Print information about actions taken"));
 
+static cl::opt<bool>
+OnlyNeeded("only-needed",
+           cl::desc("Only link in functions that the modules linked so far "
+                    "refer to"));
+
 static cl::opt<bool>
 DumpAsm("d", cl::desc("Print assembly as linked"), cl::Hidden);
 
 // LoadFile - Read the specified bitcode file in and return it.  This routine
-// searches the link path for the specified file to try to find it...
+// searches the link path for the specified file to try to find it...  If Lazy
+// is set, function bodies are only read from bitcode when the linker asks for
+// them.
 //
 static inline std::auto_ptr<Module> LoadFile(const char *argv0,
                                              const std::string &FN, 
-                                             LLVMContext& Context) {
+                                             LLVMContext& Context,
+                                             bool Lazy = false) {
   sys::Path Filename;
   if (!Filename.set(FN)) {
     errs() << "Invalid file name: '" << FN << "'\n";
@@ -66,7 +74,8 @@ static inline std::auto_ptr<Module> LoadFile(const char *argv0,
   Module* Result = 0;
   
   const std::string &FNStr = Filename.str();
-  Result = ParseIRFile(FNStr, Err, Context);
+  Result = Lazy ? getLazyIRFileModule(FNStr, Err, Context)
+              : ParseIRFile(FNStr, Err, Context);
   if (Result) return std::auto_ptr<Module>(Result);   // Load successful!
 
   Err.print(argv0, errs());
@@ -94,8 +103,10 @@ int main(int argc, char **argv) {
   }
 
   for (unsigned i = BaseArg+1; i < InputFilenames.size(); ++i) {
+    // The linker reads the function bodies it links in one at a time, so
+    // the inputs never have to be held in memory in full.
     std::auto_ptr<Module> M(LoadFile(argv[0],
-                                     InputFilenames[i], Context));
+                                     InputFilenames[i], Context, true));
     if (M.get() == 0) {
       errs() << argv[0] << ": error loading file '" <<InputFilenames[i]<< "'\n";
       return 1;
@@ -103,8 +114,10 @@ int main(int argc, char **argv) {
 
     if (Verbose) errs() << "Linking in '" << InputFilenames[i] << "'\n";
 
-    if (Linker::LinkModules(Composite.get(), M.get(), Linker::DestroySource,
-                            &ErrorMessage)) {
+    unsigned Mode = Linker::DestroySource;
+    if (OnlyNeeded)
+      Mode |= Linker::LinkOnlyNeeded;
+    if (Linker::LinkModules(Composite.get(), M.get(), Mode, &ErrorMessage)) {
       errs() << argv[0] << ": link error in '" << InputFilenames[i]
              << "': " << ErrorMessage << "\n";
       return 1;
@@ -30,12 +30,14 @@
 #include "llvm/MC/SubtargetFeature.h"
 #include "llvm/PassManager.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileCache.h"
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/Host.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/system_error.h"
 #include "llvm/Target/Mangler.h"
@@ -44,6 +46,8 @@
 #include "llvm/Target/TargetRegisterInfo.h"
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "llvm/Transforms/Utils/FunctionShards.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
 using namespace llvm;
 
 static cl::opt<bool>
@@ -58,6 +62,16 @@ static cl::opt<bool>
 DisableGVNLoadPRE("disable-gvn-loadpre", cl::init(false),
   cl::desc("Do not run the GVN load PRE pass"));
 
+static cl::opt<std::string>
+CacheDir("lto-cache-dir",
+  cl::desc("Reuse previously generated native objects from this directory"),
+  cl::value_desc("directory"));
+
+static cl::opt<unsigned>
+CacheSize("lto-cache-size", cl::init(0), cl::value_desc("MB"),
+  cl::desc("Evict the least recently used objects from the cache beyond "
+           "this size (default: unbounded)"));
+
 const char* LTOCodeGenerator::getVersionString() {
 #ifdef LLVM_VERSION_INFO
   return PACKAGE_NAME " version " PACKAGE_VERSION ", " LLVM_VERSION_INFO;
@@ -71,10 +85,16 @@ LTOCodeGenerator::LTOCodeGenerator()
     _linker("LinkTimeOptimizer", "ld-temp.o", _context), _target(NULL),
     _emitDwarfDebugInfo(false), _scopeRestrictionsDone(false),
     _codeModel(LTO_CODEGEN_PIC_MODEL_DYNAMIC),
-    _nativeObjectFile(NULL) {
+    _nativeObjectFile(NULL), _codegenOptionsParsed(false),
+    _numPartitions(1) {
   InitializeAllTargets();
   InitializeAllTargetMCs();
   InitializeAllAsmPrinters();
+
+  // Let -function-pass-threads, given as a code generator option, run the IR
+  // passes before instruction selection on worker threads once the merged
+  // module has been optimized.
+  enableFunctionPassThreads();
 }
 
 LTOCodeGenerator::~LTOCodeGenerator() {
@@ -218,19 +238,62 @@ const void* LTOCodeGenerator::compile(size_t* length, std::string& errMsg) {
   return _nativeObjectFile->getBufferStart();
 }
 
+/// getTargetTriple - Return the triple to generate code for \p M.
+static std::string getTargetTriple(const Module *M) {
+  std::string TripleStr = M->getTargetTriple();
+  if (TripleStr.empty())
+    TripleStr = sys::getDefaultTargetTriple();
+  return TripleStr;
+}
+
+bool LTOCodeGenerator::compile_to_files(const char ***names, unsigned *count,
+                                        std::string &errMsg) {
+  _nativeObjectNames.clear();
+
+  if (_numPartitions == 1) {
+    const char *name;
+    if (compile_to_file(&name, errMsg))
+      return true;
+    _nativeObjectNames.push_back(name);
+  } else {
+    if (generatePartitionedObjectFiles(errMsg))
+      return true;
+    for (unsigned i = 0, e = _nativeObjectPaths.size(); i != e; ++i)
+      _nativeObjectNames.push_back(_nativeObjectPaths[i].c_str());
+  }
+
+  *names = &_nativeObjectNames[0];
+  *count = _nativeObjectNames.size();
+  return false;
+}
+
 bool LTOCodeGenerator::determineTarget(std::string& errMsg) {
   if (_target != NULL)
     return false;
 
-  std::string TripleStr = _linker.getModule()->getTargetTriple();
-  if (TripleStr.empty())
-    TripleStr = sys::getDefaultTargetTriple();
+  // Set a default CPU for Darwin triples.
+  llvm::Triple Triple(getTargetTriple(_linker.getModule()));
+  if (_mCpu.empty() && Triple.isOSDarwin()) {
+    if (Triple.getArch() == llvm::Triple::x86_64)
+      _mCpu = "core2";
+    else if (Triple.getArch() == llvm::Triple::x86)
+      _mCpu = "yonah";
+  }
+
+  _target = createTargetMachine(errMsg);
+  return _target == NULL;
+}
+
+/// createTargetMachine - Create a new target machine for the merged modules.
+/// This is safe to call from several threads once determineTarget has run.
+TargetMachine *LTOCodeGenerator::createTargetMachine(std::string &errMsg) {
+  std::string TripleStr = getTargetTriple(_linker.getModule());
   llvm::Triple Triple(TripleStr);
 
   // create target machine from info for merged modules
   const Target *march = TargetRegistry::lookupTarget(TripleStr, errMsg);
   if (march == NULL)
-    return true;
+    return NULL;
 
   // The relocation model is actually a static member of TargetMachine and
   // needs to be set before the TargetMachine is instantiated.
@@ -251,19 +314,11 @@ bool LTOCodeGenerator::determineTarget(std::string& errMsg) {
   SubtargetFeatures Features;
   Features.getDefaultSubtargetFeatures(Triple);
   std::string FeatureStr = Features.getString();
-  // Set a default CPU for Darwin triples.
-  if (_mCpu.empty() && Triple.isOSDarwin()) {
-    if (Triple.getArch() == llvm::Triple::x86_64)
-      _mCpu = "core2";
-    else if (Triple.getArch() == llvm::Triple::x86)
-      _mCpu = "yonah";
-  }
   TargetOptions Options;
   LTOModule::getTargetOptions(Options);
-  _target = march->createTargetMachine(TripleStr, _mCpu, FeatureStr, Options,
-                                       RelocModel, CodeModel::Default,
-                                       CodeGenOpt::Aggressive);
-  return false;
+  return march->createTargetMachine(TripleStr, _mCpu, FeatureStr, Options,
+                                    RelocModel, CodeModel::Default,
+                                    CodeGenOpt::Aggressive);
 }
 
 void LTOCodeGenerator::
@@ -352,17 +407,14 @@ void LTOCodeGenerator::applyScopeRestrictions() {
 }
 
 /// Optimize merged modules using various IPO passes
-bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
-                                          std::string &errMsg) {
+bool LTOCodeGenerator::optimize(std::string &errMsg) {
   if (this->determineTarget(errMsg))
     return true;
 
   Module* mergedModule = _linker.getModule();
 
   // if options were requested, set them
-  if (!_codegenOptions.empty())
-    cl::ParseCommandLineOptions(_codegenOptions.size(),
-                                const_cast<char **>(&_codegenOptions[0]));
+  this->parseCodeGenDebugOptions();
 
   // mark which symbols can not be internalized
   this->applyScopeRestrictions();
@@ -390,28 +442,243 @@ bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
   // Make sure everything is still good.
   passes.add(createVerifierPass());
 
+  // Run our queue of passes all at once now, efficiently.
+  passes.run(*mergedModule);
+
+  return false; // success
+}
+
+/// Run the code generator for \p TM on the (already optimized) module \p M,
+/// writing an object file to \p out.
+bool LTOCodeGenerator::generateCode(Module &M, TargetMachine &TM,
+                                    raw_ostream &out, std::string &errMsg) {
   PassManager codeGenPasses;
 
-  codeGenPasses.add(new DataLayout(*_target->getDataLayout()));
-  _target->addAnalysisPasses(codeGenPasses);
+  codeGenPasses.add(new DataLayout(*TM.getDataLayout()));
+  TM.addAnalysisPasses(codeGenPasses);
 
   formatted_raw_ostream Out(out);
 
-  if (_target->addPassesToEmitFile(codeGenPasses, Out,
-                                   TargetMachine::CGFT_ObjectFile)) {
+  if (TM.addPassesToEmitFile(codeGenPasses, Out,
+                             TargetMachine::CGFT_ObjectFile)) {
     errMsg = "target file type not supported";
     return true;
   }
 
-  // Run our queue of passes all at once now, efficiently.
-  passes.run(*mergedModule);
-
   // Run the code generator, and write assembly file
-  codeGenPasses.run(*mergedModule);
+  codeGenPasses.run(M);
 
   return false; // success
 }
 
+/// Append the keys of \p Set to \p Key in a deterministic order.
+static void addSortedKeys(FileCache::Key &Key, const StringMap<uint8_t> &Set) {
+  std::vector<StringRef> Keys;
+  for (StringMap<uint8_t>::const_iterator I = Set.begin(), E = Set.end();
+       I != E; ++I)
+    Keys.push_back(I->getKey());
+  std::sort(Keys.begin(), Keys.end());
+  Key.add(Keys.size());
+  for (unsigned i = 0, e = Keys.size(); i != e; ++i)
+    Key.add(Keys[i]);
+}
+
+/// computeCacheKey - Hash everything that determines the native object for
+/// the merged module: the module itself, the symbols that must be preserved,
+/// the target and the optimization and code generator options.
+std::string LTOCodeGenerator::computeCacheKey() {
+  FileCache::Key Key;
+  Key.add(getVersionString());
+
+  std::string Bitcode;
+  raw_string_ostream BitcodeOS(Bitcode);
+  WriteBitcodeToFile(_linker.getModule(), BitcodeOS);
+  Key.add(BitcodeOS.str());
+
+  addSortedKeys(Key, _mustPreserveSymbols);
+  addSortedKeys(Key, _asmUndefinedRefs);
+
+  Key.add(getTargetTriple(_linker.getModule()));
+  Key.add(_mCpu);
+  Key.add(uint64_t(_codeModel));
+  Key.add(_emitDwarfDebugInfo);
+  Key.add(DisableOpt).add(DisableInline).add(DisableGVNLoadPRE);
+
+  // Any other code generator flags, including the ones that determine the
+  // TargetOptions, can only be set through the debug options.
+  Key.add(_codegenOptions.size());
+  for (unsigned i = 0, e = _codegenOptions.size(); i != e; ++i)
+    Key.add(_codegenOptions[i]);
+  return Key.str();
+}
+
+bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
+                                          std::string &errMsg) {
+  if (this->determineTarget(errMsg))
+    return true;
+  this->parseCodeGenDebugOptions();
+
+  if (CacheDir.empty()) {
+    if (optimize(errMsg))
+      return true;
+    return generateCode(*_linker.getModule(), *_target, out, errMsg);
+  }
+
+  // Look the object up before doing any work on the merged module.
+  FileCache Cache(CacheDir, uint64_t(CacheSize) * 1024 * 1024);
+  std::string Key = computeCacheKey();
+  OwningPtr<MemoryBuffer> Cached;
+  if (Cache.lookup(Key, Cached)) {
+    out << Cached->getBuffer();
+    return false;
+  }
+
+  SmallString<0> Buffer;
+  raw_svector_ostream BufferOS(Buffer);
+  if (optimize(errMsg) ||
+      generateCode(*_linker.getModule(), *_target, BufferOS, errMsg))
+    return true;
+
+  StringRef Object = BufferOS.str();
+  out << Object;
+  // A failure to update the cache does not affect the result.
+  Cache.store(Key, Object);
+  Cache.prune();
+  return false;
+}
+
+//===----------------------------------------------------------------------===//
+// Partitioned code generation
+//===----------------------------------------------------------------------===//
+
+/// PartitionJob - The work to code generate one partition of the merged
+/// module on its own thread.  Each job reads the module into a private
+/// LLVMContext, so that jobs do not share any IR.
+struct LTOCodeGenerator::PartitionJob {
+  LTOCodeGenerator *CodeGen;
+  StringRef Bitcode;
+  llvm::StringSet<> Defined;
+  bool KeepAppending;
+  std::string ObjPath;
+  std::string ErrMsg;
+  bool Failed;
+};
+
+void LTOCodeGenerator::runPartitionJob(void *job) {
+  PartitionJob &Job = *static_cast<PartitionJob*>(job);
+  Job.Failed = true;
+
+  LLVMContext Context;
+  OwningPtr<MemoryBuffer> Buffer(
+    MemoryBuffer::getMemBuffer(Job.Bitcode, "ld-temp.o", false));
+  OwningPtr<Module> M(ParseBitcodeFile(Buffer.get(), Context, &Job.ErrMsg));
+  if (!M)
+    return;
+  restrictToPartition(*M, Job.Defined, Job.KeepAppending);
+
+  OwningPtr<TargetMachine> TM(Job.CodeGen->createTargetMachine(Job.ErrMsg));
+  if (!TM)
+    return;
+
+  tool_output_file objFile(Job.ObjPath.c_str(), Job.ErrMsg,
+                           raw_fd_ostream::F_Binary);
+  if (!Job.ErrMsg.empty())
+    return;
+  bool genResult = Job.CodeGen->generateCode(*M, *TM, objFile.os(),
+                                             Job.ErrMsg);
+  objFile.os().close();
+  if (objFile.os().has_error()) {
+    objFile.os().clear_error();
+    Job.ErrMsg = "could not write object file: " + Job.ObjPath;
+    return;
+  }
+  if (genResult)
+    return;
+
+  objFile.keep();
+  Job.Failed = false;
+}
+
+/// generatePartitionedObjectFiles - Optimize the merged module, split it into
+/// _numPartitions modules and code generate those in parallel, each into its
+/// own object file.  References between partitions become external symbols.
+bool LTOCodeGenerator::generatePartitionedObjectFiles(std::string &errMsg) {
+  if (optimize(errMsg))
+    return true;
+
+  Module *mergedModule = _linker.getModule();
+  ModulePartitionMap Partitions;
+  partitionModule(*mergedModule, _numPartitions, Partitions);
+  promoteCrossPartitionReferences(*mergedModule, Partitions);
+
+  // Every job starts from the same serialized copy of the merged module.
+  std::string BitcodeStr;
+  {
+    raw_string_ostream OS(BitcodeStr);
+    WriteBitcodeToFile(mergedModule, OS);
+  }
+
+  std::vector<PartitionJob> Jobs(_numPartitions);
+  for (unsigned i = 0; i != _numPartitions; ++i) {
+    Jobs[i].CodeGen = this;
+    Jobs[i].Bitcode = BitcodeStr;
+    Jobs[i].KeepAppending = i == 0;
+    Jobs[i].Failed = true;
+  }
+  for (ModulePartitionMap::iterator I = Partitions.begin(),
+       E = Partitions.end(); I != E; ++I)
+    Jobs[I->second].Defined.insert(I->first->getName());
+
+  // Create the output files up front, on this thread.
+  _nativeObjectPaths.clear();
+  for (unsigned i = 0; i != _numPartitions; ++i) {
+    sys::PathWithStatus uniqueObjPath("lto-llvm.o");
+    if (uniqueObjPath.createTemporaryFileOnDisk(false, &errMsg)) {
+      uniqueObjPath.eraseFromDisk();
+      for (unsigned j = 0; j != i; ++j)
+        sys::Path(Jobs[j].ObjPath).eraseFromDisk();
+      return true;
+    }
+    sys::RemoveFileOnSignal(uniqueObjPath);
+    Jobs[i].ObjPath = uniqueObjPath.str();
+  }
+
+  if (!llvm_is_multithreaded())
+    llvm_start_multithreaded();
+
+  std::vector<void*> JobPtrs;
+  for (unsigned i = 0; i != _numPartitions; ++i)
+    JobPtrs.push_back(&Jobs[i]);
+  llvm_execute_on_threads(runPartitionJob, JobPtrs);
+
+  bool Failed = false;
+  for (unsigned i = 0; i != _numPartitions; ++i)
+    if (Jobs[i].Failed && !Failed) {
+      errMsg = Jobs[i].ErrMsg;
+      Failed = true;
+    }
+  if (Failed) {
+    for (unsigned i = 0; i != _numPartitions; ++i)
+      sys::Path(Jobs[i].ObjPath).eraseFromDisk();
+    return true;
+  }
+
+  for (unsigned i = 0; i != _numPartitions; ++i)
+    _nativeObjectPaths.push_back(Jobs[i].ObjPath);
+  return false;
+}
+
+/// parseCodeGenDebugOptions - Apply the options given to
+/// setCodeGenDebugOptions.  They are parsed only once, since options may only
+/// occur once on a command line.
+void LTOCodeGenerator::parseCodeGenDebugOptions() {
+  if (_codegenOptionsParsed || _codegenOptions.empty())
+    return;
+  cl::ParseCommandLineOptions(_codegenOptions.size(),
+                              const_cast<char **>(&_codegenOptions[0]));
+  _codegenOptionsParsed = true;
+}
+
 /// setCodeGenDebugOptions - Set codegen debugging options to aid in debugging
 /// LTO problems.
 void LTOCodeGenerator::setCodeGenDebugOptions(const char *options) {
@@ -19,12 +19,14 @@
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Linker.h"
 #include <string>
+#include <vector>
 
 namespace llvm {
   class LLVMContext;
   class GlobalValue;
   class Mangler;
   class MemoryBuffer;
+  class Module;
   class TargetMachine;
   class raw_ostream;
 }
@@ -45,23 +47,40 @@ struct LTOCodeGenerator {
 
   void setCpu(const char* mCpu) { _mCpu = mCpu; }
 
+  /// setNumPartitions - Set the number of partitions the merged module is
+  /// split into by compile_to_files.  Each partition is code generated on its
+  /// own thread.
+  void setNumPartitions(unsigned num) { _numPartitions = num ? num : 1; }
+
   void addMustPreserveSymbol(const char* sym) {
     _mustPreserveSymbols[sym] = 1;
   }
 
   bool writeMergedModules(const char *path, std::string &errMsg);
   bool compile_to_file(const char **name, std::string &errMsg);
+  bool compile_to_files(const char ***names, unsigned *count,
+                        std::string &errMsg);
   const void *compile(size_t *length, std::string &errMsg);
   void setCodeGenDebugOptions(const char *opts);
 
 private:
+  struct PartitionJob;
+
+  void parseCodeGenDebugOptions();
+  std::string computeCacheKey();
+  bool optimize(std::string &errMsg);
+  bool generateCode(llvm::Module &M, llvm::TargetMachine &TM,
+                    llvm::raw_ostream &out, std::string &errMsg);
   bool generateObjectFile(llvm::raw_ostream &out, std::string &errMsg);
+  bool generatePartitionedObjectFiles(std::string &errMsg);
+  static void runPartitionJob(void *job);
   void applyScopeRestrictions();
   void applyRestriction(llvm::GlobalValue &GV,
                         std::vector<const char*> &mustPreserveList,
                         llvm::SmallPtrSet<llvm::GlobalValue*, 8> &asmUsed,
                         llvm::Mangler &mangler);
   bool determineTarget(std::string &errMsg);
+  llvm::TargetMachine *createTargetMachine(std::string &errMsg);
 
   typedef llvm::StringMap<uint8_t> StringSet;
 
@@ -75,8 +94,12 @@ private:
   StringSet                   _asmUndefinedRefs;
   llvm::MemoryBuffer*         _nativeObjectFile;
   std::vector<char*>          _codegenOptions;
+  bool                        _codegenOptionsParsed;
   std::string                 _mCpu;
   std::string                 _nativeObjectPath;
+  unsigned                    _numPartitions;
+  std::vector<std::string>    _nativeObjectPaths;
+  std::vector<const char*>    _nativeObjectNames;
 };
 
 #endif // LTO_CODE_GENERATOR_H
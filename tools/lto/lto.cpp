@@ -162,6 +162,12 @@ void lto_codegen_set_cpu(lto_code_gen_t cg, const char *cpu) {
   return cg->setCpu(cpu);
 }
 
+/// lto_codegen_set_num_partitions - Sets the number of partitions the merged
+/// module is split into by lto_codegen_compile_to_files.
+void lto_codegen_set_num_partitions(lto_code_gen_t cg, unsigned num) {
+  return cg->setNumPartitions(num);
+}
+
 /// lto_codegen_set_assembler_path - Sets the path to the assembler tool.
 void lto_codegen_set_assembler_path(lto_code_gen_t cg, const char *path) {
   // In here only for backwards compatibility. We use MC now.
@@ -206,6 +212,14 @@ bool lto_codegen_compile_to_file(lto_code_gen_t cg, const char **name) {
   return cg->compile_to_file(name, sLastErrorString);
 }
 
+/// lto_codegen_compile_to_files - Generates code for all added modules into
+/// one native object file per partition. The names of the files are written
+/// to names and their number to count. Returns true on error.
+bool lto_codegen_compile_to_files(lto_code_gen_t cg, const char ***names,
+                                  unsigned *count) {
+  return cg->compile_to_files(names, count, sLastErrorString);
+}
+
 /// lto_codegen_debug_options - Used to pass extra options to the code
 /// generator.
 void lto_codegen_debug_options(lto_code_gen_t cg, const char *opt) {
@@ -0,0 +1,97 @@
+//===- llvm/unittest/ADT/StatisticTest.cpp - Statistic unit tests ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// Exercise the statistics even in builds without assertions.
+#define LLVM_ENABLE_STATS 1
+#define DEBUG_TYPE "unittest"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/Threading.h"
+#include "gtest/gtest.h"
+#include <cstring>
+
+using namespace llvm;
+
+namespace {
+
+STATISTIC(Counter, "Counts things");
+STATISTIC(ThreadCounter, "Counts things on several threads");
+
+unsigned findStatistic(const std::vector<StatisticValue> &Values,
+                       const char *Desc) {
+  for (unsigned i = 0, e = Values.size(); i != e; ++i)
+    if (std::strcmp(Values[i].Desc, Desc) == 0)
+      return Values[i].Value;
+  return ~0U;
+}
+
+void bumpThreadCounter(void *) {
+  for (unsigned i = 0; i != 1000; ++i)
+    ++ThreadCounter;
+}
+
+TEST(StatisticTest, Operators) {
+  Counter = 0;
+  ++Counter;
+  Counter += 4;
+  EXPECT_EQ(5u, Counter.getValue());
+  Counter -= 2;
+  --Counter;
+  EXPECT_EQ(2u, Counter.getValue());
+  Counter *= 6;
+  Counter /= 4;
+  EXPECT_EQ(3u, Counter.getValue());
+  EXPECT_EQ(3u, Counter++);
+  EXPECT_EQ(4u, (unsigned)Counter);
+}
+
+TEST(StatisticTest, Threads) {
+  ThreadCounter = 5;
+  void *Args[4] = { 0, 0, 0, 0 };
+  llvm_execute_on_threads(bumpThreadCounter, Args);
+  EXPECT_EQ(4005u, ThreadCounter.getValue());
+
+  // Assignment applies to the sum over all threads.
+  ThreadCounter = 7;
+  EXPECT_EQ(7u, ThreadCounter.getValue());
+}
+
+TEST(StatisticTest, ExitedThreads) {
+  // The counts of a thread outlive it.
+  ThreadCounter = 0;
+  void *Args[4] = { 0, 0, 0, 0 };
+  for (unsigned i = 0; i != 25; ++i)
+    llvm_execute_on_threads(bumpThreadCounter, Args);
+  EXPECT_EQ(100000u, ThreadCounter.getValue());
+  ThreadCounter = 3;
+  EXPECT_EQ(3u, ThreadCounter.getValue());
+}
+
+TEST(StatisticTest, SnapshotAndReset) {
+  Counter = 10;
+  ResetStatistics(true);
+  Counter += 3;
+
+  std::vector<StatisticValue> All = GetStatistics();
+  EXPECT_EQ(13u, findStatistic(All, "Counts things"));
+  std::vector<StatisticValue> Mine = GetStatistics(true);
+  EXPECT_EQ(3u, findStatistic(Mine, "Counts things"));
+
+  // Forgetting this thread's counts leaves the values alone.
+  ResetStatistics(true);
+  EXPECT_EQ(0u, findStatistic(GetStatistics(true), "Counts things"));
+  EXPECT_EQ(13u, Counter.getValue());
+
+  ResetStatistics();
+  EXPECT_EQ(0u, Counter.getValue());
+  EXPECT_EQ(0u, findStatistic(GetStatistics(), "Counts things"));
+  ++Counter;
+  EXPECT_EQ(1u, Counter.getValue());
+}
+
+} // end anonymous namespace
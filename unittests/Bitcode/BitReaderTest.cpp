@@ -12,6 +12,7 @@
 #include "llvm/Bitcode/BitstreamWriter.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
@@ -61,5 +62,39 @@ TEST(BitReaderTest, MaterializeFunctionsForBlockAddr) { // PR11677
   passes.run(*m);
 }
 
+TEST(BitReaderTest, ReuseStructTypes) {
+  LLVMContext Context;
+  OwningPtr<Module> Mod(new Module("structs", Context));
+  StructType *Node = StructType::create(Context, "node");
+  Node->setBody(PointerType::getUnqual(Node), Type::getInt64Ty(Context), NULL);
+  StructType *Opaque = StructType::create(Context, "opaque");
+  new GlobalVariable(*Mod, Node, false, GlobalValue::ExternalLinkage, 0, "g");
+  new GlobalVariable(*Mod, PointerType::getUnqual(Opaque), false,
+                     GlobalValue::ExternalLinkage, 0, "h");
+
+  SmallString<1024> Mem;
+  raw_svector_ostream OS(Mem);
+  WriteBitcodeToFile(Mod.get(), OS);
+  OwningPtr<MemoryBuffer> Buffer(
+    MemoryBuffer::getMemBuffer(OS.str(), "structs", false));
+
+  // Read back into the same context, the structs are the existing ones.
+  StructType *Both[] = { Opaque, Node };
+  std::string ErrMsg;
+  OwningPtr<Module> Reused(ParseBitcodeFile(Buffer.get(), Context, Both,
+                                            &ErrMsg));
+  ASSERT_TRUE(Reused.get() != 0) << ErrMsg;
+  EXPECT_EQ(Node, Reused->getNamedGlobal("g")->getType()->getElementType());
+  EXPECT_EQ(PointerType::getUnqual(Opaque),
+            Reused->getNamedGlobal("h")->getType()->getElementType());
+  EXPECT_EQ(0, Mod->getTypeByName("node.0"));
+
+  // A struct that is not given is an error, and creates nothing either.
+  Reused.reset(ParseBitcodeFile(Buffer.get(), Context, Opaque, &ErrMsg));
+  EXPECT_EQ(0, Reused.get());
+  EXPECT_EQ(0, Mod->getTypeByName("node.0"));
+  EXPECT_EQ(0, Mod->getTypeByName("opaque.0"));
+}
+
 }
 }
@@ -168,5 +168,67 @@ TEST(MCJITMemoryManagerTest, ManyVariedAllocations) {
   }
 }
 
+TEST(MCJITMemoryManagerTest, AllocateAfterApplyPermissions) {
+  OwningPtr<SectionMemoryManager> MemMgr(new SectionMemoryManager());
+
+  uint8_t *code1 = MemMgr->allocateCodeSection(256, 0, 1);
+  uint8_t *rodata1 = MemMgr->allocateDataSection(256, 0, 2, true);
+  EXPECT_NE((uint8_t*)0, code1);
+  EXPECT_NE((uint8_t*)0, rodata1);
+
+  std::string Error;
+  EXPECT_FALSE(MemMgr->applyPermissions(&Error));
+
+  // The free space left in the protected blocks must not be handed out again;
+  // these writes would fault otherwise.
+  uint8_t *code2 = MemMgr->allocateCodeSection(256, 0, 3);
+  uint8_t *rodata2 = MemMgr->allocateDataSection(256, 0, 4, true);
+  EXPECT_NE((uint8_t*)0, code2);
+  EXPECT_NE((uint8_t*)0, rodata2);
+  for (unsigned i = 0; i < 256; ++i) {
+    code2[i] = 1;
+    rodata2[i] = 2;
+  }
+
+  EXPECT_FALSE(MemMgr->applyPermissions(&Error));
+}
+
+TEST(MCJITMemoryManagerTest, DeallocateSections) {
+  OwningPtr<SectionMemoryManager> MemMgr(new SectionMemoryManager());
+
+  uint8_t *code1 = MemMgr->allocateCodeSection(256, 0, 1);
+  uint8_t *code2 = MemMgr->allocateCodeSection(256, 0, 2);
+  uint8_t *data1 = MemMgr->allocateDataSection(256, 0, 3, false);
+  uint8_t *data2 = MemMgr->allocateDataSection(0x100000, 0, 4, false);
+
+  // Releasing one section of a block leaves the others usable.
+  MemMgr->deallocateSection(code1, 1);
+  MemMgr->deallocateSection(data2, 4);
+  for (unsigned i = 0; i < 256; ++i) {
+    code2[i] = 1;
+    data1[i] = 2;
+  }
+  for (unsigned i = 0; i < 256; ++i) {
+    EXPECT_EQ(1, code2[i]);
+    EXPECT_EQ(2, data1[i]);
+  }
+
+  MemMgr->deallocateSection(code2, 2);
+  MemMgr->deallocateSection(data1, 3);
+
+  // Everything was released; new sections come from fresh blocks.
+  uint8_t *code3 = MemMgr->allocateCodeSection(256, 0, 5);
+  uint8_t *data3 = MemMgr->allocateDataSection(256, 0, 6, true);
+  EXPECT_NE((uint8_t*)0, code3);
+  EXPECT_NE((uint8_t*)0, data3);
+  for (unsigned i = 0; i < 256; ++i) {
+    code3[i] = 3;
+    data3[i] = 4;
+  }
+
+  std::string Error;
+  EXPECT_FALSE(MemMgr->applyPermissions(&Error));
+}
+
 } // Namespace
 
@@ -14,6 +14,7 @@
 
 #include "llvm/ExecutionEngine/MCJIT.h"
 #include "MCJITTestBase.h"
+#include "llvm/Support/CommandLine.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -201,8 +202,6 @@ TEST_F(MCJITTest, multiple_empty_modules) {
 }
 */
 
-// FIXME: MCJIT must support multiple modules
-/*
 TEST_F(MCJITTest, multiple_modules) {
   SKIP_UNSUPPORTED_PLATFORM;
 
@@ -212,24 +211,222 @@ TEST_F(MCJITTest, multiple_modules) {
   // caller function is defined in a different module
   M.reset(createEmptyModule("<caller module>"));
 
-  Function *CalleeRef = insertExternalReferenceToFunction(M.get(), Callee);
-  Function *Caller = insertSimpleCallFunction(M.get(), CalleeRef);
+  Function *CalleeRef = insertExternalReferenceToFunction(M.get(), "add",
+                                                  Callee->getFunctionType());
+  Function *Caller =
+    insertSimpleCallFunction<int32_t(int32_t, int32_t)>(M.get(), CalleeRef);
 
   TheJIT->addModule(M.take());
 
   // get a function pointer in a module that was not used in EE construction
   void *vPtr = TheJIT->getPointerToFunction(Caller);
-  EXPECT_NE(0, vPtr)
+  TheJIT->finalizeObject();
+  static_cast<SectionMemoryManager*>(MM)->invalidateInstructionCache();
+  EXPECT_TRUE(0 != vPtr)
     << "Unable to get pointer to caller function from JIT";
 
   int(*FuncPtr)(int, int) = (int(*)(int, int))(intptr_t)vPtr;
   EXPECT_EQ(0, FuncPtr(0, 0));
   EXPECT_EQ(30, FuncPtr(10, 20));
   EXPECT_EQ(-30, FuncPtr(-10, -20));
+}
+
+TEST_F(MCJITTest, cross_module_lookup_compiles_callee) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  // The caller lives in the module the engine is created with and calls a
+  // function defined in a module that is only added afterwards.
+  Module *CallerModule = M.get();
+  FunctionType *AddTy =
+    TypeBuilder<int32_t(int32_t, int32_t), false>::get(Context);
+  Function *CalleeRef = insertExternalReferenceToFunction(CallerModule, "add",
+                                                          AddTy);
+  Function *Caller =
+    insertSimpleCallFunction<int32_t(int32_t, int32_t)>(CallerModule,
+                                                        CalleeRef);
+  createJIT(M.take());
 
-  // ensure caller is destroyed before callee (free use before def)
-  M.reset();
+  Module *CalleeModule = createEmptyModule("<callee module>");
+  Function *Callee = insertAddFunction(CalleeModule);
+  TheJIT->addModule(CalleeModule);
+
+  // Looking up the caller links in the callee's module on demand.
+  void *CallerPtr = TheJIT->getPointerToFunction(Caller);
+  TheJIT->finalizeObject();
+  static_cast<SectionMemoryManager*>(MM)->invalidateInstructionCache();
+  EXPECT_TRUE(0 != CallerPtr);
+
+  int(*FuncPtr)(int, int) = (int(*)(int, int))(intptr_t)CallerPtr;
+  EXPECT_EQ(30, FuncPtr(10, 20));
+
+  // The callee was compiled once, as part of the caller's lookup.
+  void *CalleePtr = TheJIT->getPointerToFunction(Callee);
+  EXPECT_TRUE(0 != CalleePtr);
+  EXPECT_EQ(CalleePtr, TheJIT->getPointerToFunction(CalleeRef));
+}
+
+TEST_F(MCJITTest, incremental_modules) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  Function *Main = insertMainFunction(M.get(), 1);
+  createJIT(M.take());
+  void *MainPtr = TheJIT->getPointerToFunction(Main);
+  TheJIT->finalizeObject();
+  static_cast<SectionMemoryManager*>(MM)->invalidateInstructionCache();
+  int32_t(*MainFn)(void) = (int32_t(*)(void))(intptr_t)MainPtr;
+  EXPECT_EQ(1, MainFn());
+
+  // Keep adding, running and removing modules that define the same symbol;
+  // code finalized earlier must keep working.
+  for (int32_t i = 0; i < 16; ++i) {
+    Module *Expr = createEmptyModule("<expression>");
+    Function *F = startFunction<int32_t(void)>(Expr, "expr");
+    endFunctionWithRet(F, ConstantInt::get(Context, APInt(32, i)));
+    TheJIT->addModule(Expr);
+
+    void *vPtr = TheJIT->getPointerToFunction(F);
+    TheJIT->finalizeObject();
+    static_cast<SectionMemoryManager*>(MM)->invalidateInstructionCache();
+    EXPECT_TRUE(0 != vPtr);
+
+    int32_t(*FuncPtr)(void) = (int32_t(*)(void))(intptr_t)vPtr;
+    EXPECT_EQ(i, FuncPtr());
+    EXPECT_EQ(1, MainFn());
+
+    EXPECT_TRUE(TheJIT->removeModule(Expr));
+    delete Expr;
+  }
+}
+
+TEST_F(MCJITTest, async_compile) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  Function *Main = insertMainFunction(M.get(), 1);
+  createJIT(M.take());
+
+  // Nothing else may use the context of a module while it is being compiled
+  // in the background, so each module gets a context of its own and the main
+  // thread keeps Context to itself.
+  const unsigned NumModules = 8;
+  SmallVector<LLVMContext*, NumModules> Contexts;
+  SmallVector<Function*, NumModules> Exprs;
+  for (unsigned i = 0; i < NumModules; ++i) {
+    std::stringstream Name;
+    Name << "expr_" << i;
+    LLVMContext *Ctx = new LLVMContext();
+    Module *Expr = new Module("<expression>", *Ctx);
+    Expr->setTargetTriple(Triple::normalize(HostTriple));
+    Function *F = Function::Create(TypeBuilder<int32_t(void), false>::get(*Ctx),
+                                   GlobalValue::ExternalLinkage, Name.str(),
+                                   Expr);
+    IRBuilder<> ExprBuilder(BasicBlock::Create(*Ctx, "entry", F));
+    ExprBuilder.CreateRet(ConstantInt::get(*Ctx, APInt(32, i * i)));
+    TheJIT->addModule(Expr);
+    Contexts.push_back(Ctx);
+    Exprs.push_back(F);
+  }
+
+  SmallVector<AsyncCompileHandle, NumModules> Handles;
+  for (unsigned i = 0; i < NumModules; ++i)
+    Handles.push_back(TheJIT->compileModuleAsync(Exprs[i]->getParent()));
+
+  // The engine stays usable while the workers run.
+  void *MainPtr = TheJIT->getPointerToFunction(Main);
+  EXPECT_TRUE(0 != MainPtr);
+
+  for (unsigned i = 0; i < NumModules; ++i) {
+    Handles[i].wait();
+    EXPECT_TRUE(Handles[i].isReady());
+  }
+
+  SmallVector<void*, NumModules> Ptrs;
+  for (unsigned i = 0; i < NumModules; ++i)
+    Ptrs.push_back(TheJIT->getPointerToFunction(Exprs[i]));
+  TheJIT->finalizeObject();
+  static_cast<SectionMemoryManager*>(MM)->invalidateInstructionCache();
+
+  int32_t(*MainFn)(void) = (int32_t(*)(void))(intptr_t)MainPtr;
+  EXPECT_EQ(1, MainFn());
+  for (unsigned i = 0; i < NumModules; ++i) {
+    EXPECT_TRUE(0 != Ptrs[i]);
+    int32_t(*FuncPtr)(void) = (int32_t(*)(void))(intptr_t)Ptrs[i];
+    EXPECT_EQ((int32_t)(i * i), FuncPtr());
+  }
+
+  // The engine would delete the modules after their contexts are gone.
+  for (unsigned i = 0; i < NumModules; ++i) {
+    Module *Expr = Exprs[i]->getParent();
+    EXPECT_TRUE(TheJIT->removeModule(Expr));
+    delete Expr;
+    delete Contexts[i];
+  }
+}
+
+TEST_F(MCJITTest, async_compile_remove_module) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  insertMainFunction(M.get(), 1);
+  createJIT(M.take());
+
+  Module *Expr = createEmptyModule("<expression>");
+  insertAddFunction(Expr);
+  TheJIT->addModule(Expr);
+
+  // Removing a module that is queued or being compiled cancels or waits for
+  // the job.
+  TheJIT->compileModuleAsync(Expr);
+  EXPECT_TRUE(TheJIT->removeModule(Expr));
+  EXPECT_TRUE(TheJIT->isAsyncCompileDone(Expr));
+  delete Expr;
+}
+
+TEST_F(MCJITTest, lookup_leaves_unrelated_module_queued) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  // Without worker threads, a queued module is only compiled once something
+  // needs it.
+  static bool NoWorkers = false;
+  if (!NoWorkers) {
+    const char *Args[] = { "MCJITTests", "-mcjit-async-compile-threads=0" };
+    cl::ParseCommandLineOptions(2, Args);
+    NoWorkers = true;
+  }
+
+  FunctionType *AddTy =
+    TypeBuilder<int32_t(int32_t, int32_t), false>::get(Context);
+  Function *CalleeRef = insertExternalReferenceToFunction(M.get(), "add",
+                                                          AddTy);
+  Function *Caller =
+    insertSimpleCallFunction<int32_t(int32_t, int32_t)>(M.get(), CalleeRef);
+  createJIT(M.take());
+
+  Module *CalleeModule = createEmptyModule("<callee module>");
+  insertAddFunction(CalleeModule);
+  TheJIT->addModule(CalleeModule);
+
+  Module *Unrelated = createEmptyModule("<unrelated module>");
+  Function *Other = insertAddFunction(Unrelated, "other_add");
+  TheJIT->addModule(Unrelated);
+  TheJIT->compileModuleAsync(Unrelated);
+
+  // Resolving the caller's reference to "add" only compiles the module that
+  // defines it.
+  void *CallerPtr = TheJIT->getPointerToFunction(Caller);
+  EXPECT_TRUE(0 != CallerPtr);
+  EXPECT_FALSE(TheJIT->isAsyncCompileDone(Unrelated));
+  EXPECT_TRUE(0 == TheJIT->getPointerToNamedFunction("nonexistent", false));
+  EXPECT_FALSE(TheJIT->isAsyncCompileDone(Unrelated));
+
+  void *OtherPtr = TheJIT->getPointerToFunction(Other);
+  TheJIT->finalizeObject();
+  static_cast<SectionMemoryManager*>(MM)->invalidateInstructionCache();
+  EXPECT_TRUE(TheJIT->isAsyncCompileDone(Unrelated));
+  EXPECT_TRUE(0 != OtherPtr);
+
+  int(*FuncPtr)(int, int) = (int(*)(int, int))(intptr_t)CallerPtr;
+  EXPECT_EQ(30, FuncPtr(10, 20));
+  FuncPtr = (int(*)(int, int))(intptr_t)OtherPtr;
+  EXPECT_EQ(30, FuncPtr(10, 20));
 }
-*/
 
 }
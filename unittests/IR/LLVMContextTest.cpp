@@ -0,0 +1,179 @@
+//===- llvm/unittest/IR/LLVMContextTest.cpp - LLVMContext unit tests ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/IR/Attributes.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/ValueHandle.h"
+#include "gtest/gtest.h"
+using namespace llvm;
+
+namespace {
+
+const unsigned NumThreads = 4;
+const unsigned NumValues = 500;
+
+// Everything one thread got back from the context, so that the results of the
+// threads can be compared afterwards.
+struct UniquingResults {
+  LLVMContext *Ctx;
+  SmallVector<Type*, 8> Types;
+  SmallVector<Value*, 8> Values;
+  SmallVector<Attribute, 8> Attrs;
+  unsigned NamedStructs;
+};
+
+void createUniquedObjects(void *Arg) {
+  UniquingResults &R = *static_cast<UniquingResults*>(Arg);
+  LLVMContext &C = *R.Ctx;
+
+  for (unsigned i = 0; i != NumValues; ++i) {
+    IntegerType *ITy = IntegerType::get(C, 2 + i % 100);
+    R.Types.push_back(ITy);
+    R.Types.push_back(PointerType::getUnqual(ITy));
+    R.Types.push_back(ArrayType::get(ITy, i));
+    R.Types.push_back(VectorType::get(ITy, 1 + i % 16));
+    Type *Params[] = { ITy, Type::getDoubleTy(C) };
+    R.Types.push_back(FunctionType::get(ITy, Params, false));
+    R.Types.push_back(StructType::get(C, Params));
+
+    Constant *CI = ConstantInt::get(ITy, i);
+    R.Values.push_back(CI);
+    R.Values.push_back(ConstantInt::get(Type::getInt64Ty(C), i * 1000003ULL));
+    R.Values.push_back(ConstantFP::get(Type::getDoubleTy(C), i * 0.5));
+    R.Values.push_back(UndefValue::get(ITy));
+    Constant *Null =
+      ConstantPointerNull::get(PointerType::getUnqual(ITy));
+    R.Values.push_back(ConstantExpr::getPtrToInt(Null, ITy));
+    Constant *Elts[] = { CI, CI };
+    R.Values.push_back(ConstantStruct::getAnon(Elts));
+    R.Values.push_back(MDString::get(C, "md" + utostr(i)));
+    Value *Ops[] = { CI, MDString::get(C, "shared") };
+    R.Values.push_back(MDNode::get(C, Ops));
+
+    // Value handles on shared values all go through the context's map.
+    WeakVH Handle(CI);
+    WeakVH Copy(Handle);
+    EXPECT_EQ(CI, Copy);
+
+    R.Attrs.push_back(Attribute::getWithAlignment(C, 1ULL << (i % 16)));
+
+    // Named structs are never uniqued; each thread must get its own.
+    if (StructType::create(C, "thread.struct")->getName() != "thread.struct")
+      ++R.NamedStructs;
+  }
+}
+
+TEST(LLVMContextTest, ConcurrentUniquing) {
+  LLVMContext C;
+  EXPECT_FALSE(C.isConcurrentUniquingEnabled());
+  C.enableConcurrentUniquing();
+  EXPECT_TRUE(C.isConcurrentUniquingEnabled());
+
+  UniquingResults Results[NumThreads];
+  void *Args[NumThreads];
+  for (unsigned i = 0; i != NumThreads; ++i) {
+    Results[i].Ctx = &C;
+    Results[i].NamedStructs = 0;
+    Args[i] = &Results[i];
+  }
+  llvm_execute_on_threads(createUniquedObjects, Args);
+
+  // Every thread must have been handed the same objects.
+  for (unsigned i = 1; i != NumThreads; ++i) {
+    ASSERT_EQ(Results[0].Types.size(), Results[i].Types.size());
+    for (unsigned j = 0, e = Results[0].Types.size(); j != e; ++j)
+      EXPECT_EQ(Results[0].Types[j], Results[i].Types[j]);
+    ASSERT_EQ(Results[0].Values.size(), Results[i].Values.size());
+    for (unsigned j = 0, e = Results[0].Values.size(); j != e; ++j)
+      EXPECT_EQ(Results[0].Values[j], Results[i].Values[j]);
+    ASSERT_EQ(Results[0].Attrs.size(), Results[i].Attrs.size());
+    for (unsigned j = 0, e = Results[0].Attrs.size(); j != e; ++j)
+      EXPECT_EQ(Results[0].Attrs[j], Results[i].Attrs[j]);
+  }
+
+  // All but the first "thread.struct" were renamed.
+  unsigned Renamed = 0;
+  for (unsigned i = 0; i != NumThreads; ++i)
+    Renamed += Results[i].NamedStructs;
+  EXPECT_EQ(NumThreads * NumValues - 1, Renamed);
+}
+
+const unsigned NumSharedConstants = 8;
+const unsigned NumInstructions = 16384;
+
+struct InstructionResults {
+  LLVMContext *Ctx;
+  Module *M;
+};
+
+// Build a function whose instructions all use the same few constants, then
+// delete half of them again, so that the threads keep updating the use lists
+// of those constants at the same time.
+void createInstructions(void *Arg) {
+  InstructionResults &R = *static_cast<InstructionResults*>(Arg);
+  LLVMContext &C = *R.Ctx;
+  Type *I32 = Type::getInt32Ty(C);
+  R.M = new Module("thread", C);
+  Function *F = Function::Create(FunctionType::get(I32, I32, false),
+                                 GlobalValue::ExternalLinkage, "f", R.M);
+  IRBuilder<> Builder(BasicBlock::Create(C, "entry", F));
+
+  SmallVector<Instruction*, 64> Dead;
+  Value *Sum = F->arg_begin();
+  for (unsigned i = 0; i != NumInstructions; ++i) {
+    Value *K = ConstantInt::get(I32, i % NumSharedConstants);
+    Dead.push_back(cast<Instruction>(Builder.CreateMul(F->arg_begin(), K)));
+    Sum = Builder.CreateAdd(Sum, K);
+  }
+  Builder.CreateRet(Sum);
+
+  for (unsigned i = 0, e = Dead.size(); i != e; ++i)
+    Dead[i]->eraseFromParent();
+}
+
+TEST(LLVMContextTest, ConcurrentInstructionCreation) {
+  LLVMContext C;
+  C.enableConcurrentUniquing();
+
+  InstructionResults Results[NumThreads];
+  void *Args[NumThreads];
+  for (unsigned i = 0; i != NumThreads; ++i) {
+    Results[i].Ctx = &C;
+    Args[i] = &Results[i];
+  }
+  llvm_execute_on_threads(createInstructions, Args);
+
+  // Each thread's adds are left using the constants.
+  for (unsigned i = 0; i != NumSharedConstants; ++i) {
+    Constant *K = ConstantInt::get(Type::getInt32Ty(C), i);
+    unsigned Uses = 0;
+    for (Value::use_iterator UI = K->use_begin(), UE = K->use_end(); UI != UE;
+         ++UI) {
+      EXPECT_EQ(Instruction::Add, cast<Instruction>(*UI)->getOpcode());
+      ++Uses;
+    }
+    EXPECT_EQ(NumThreads * NumInstructions / NumSharedConstants, Uses);
+  }
+
+  for (unsigned i = 0; i != NumThreads; ++i)
+    delete Results[i].M;
+  for (unsigned i = 0; i != NumSharedConstants; ++i)
+    EXPECT_TRUE(ConstantInt::get(Type::getInt32Ty(C), i)->use_empty());
+}
+
+}  // end anonymous namespace
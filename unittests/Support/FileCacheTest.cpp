@@ -0,0 +1,98 @@
+//===- llvm/unittest/Support/FileCacheTest.cpp - FileCache tests ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/FileCache.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/PathV1.h"
+#include "llvm/Support/PathV2.h"
+#include "llvm/Support/TimeValue.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace llvm::sys;
+
+namespace {
+
+class FileCacheTest : public testing::Test {
+protected:
+  SmallString<128> TestDirectory;
+
+  virtual void SetUp() {
+    int fd;
+    ASSERT_FALSE(fs::unique_file("FileCache-test-%%-%%-%%-%%/dir", fd,
+                                 TestDirectory));
+    ::close(fd);
+    TestDirectory = path::parent_path(TestDirectory);
+  }
+
+  virtual void TearDown() {
+    uint32_t Removed;
+    fs::remove_all(TestDirectory.str(), Removed);
+  }
+
+  /// Make the entry for \p Key look as if it was last used \p Age seconds
+  /// ago.
+  void age(StringRef Key, unsigned Age) {
+    SmallString<128> Entry(TestDirectory);
+    path::append(Entry, Twine("llvmcache-") + Key);
+    PathWithStatus P(Entry.str());
+    FileStatus Status = *P.getFileStatus();
+    Status.modTime = TimeValue::now() - TimeValue(Age, 0);
+    ASSERT_FALSE(P.setStatusInfoOnDisk(Status));
+  }
+};
+
+TEST_F(FileCacheTest, Key) {
+  FileCache::Key K1, K2, K3;
+  K1.add("ab").add("c");
+  K2.add("a").add("bc");
+  K3.add("ab").add("c");
+  std::string S1 = K1.str(), S2 = K2.str(), S3 = K3.str();
+  EXPECT_EQ(32u, S1.size());
+  EXPECT_NE(S1, S2);
+  EXPECT_EQ(S1, S3);
+}
+
+TEST_F(FileCacheTest, StoreAndLookup) {
+  FileCache Cache(TestDirectory);
+  OwningPtr<MemoryBuffer> Result;
+  EXPECT_FALSE(Cache.lookup("k1", Result));
+
+  ASSERT_FALSE(Cache.store("k1", "object one"));
+  ASSERT_TRUE(Cache.lookup("k1", Result));
+  EXPECT_EQ("object one", Result->getBuffer());
+
+  // Storing again replaces the entry.
+  ASSERT_FALSE(Cache.store("k1", "object two"));
+  ASSERT_TRUE(Cache.lookup("k1", Result));
+  EXPECT_EQ("object two", Result->getBuffer());
+}
+
+TEST_F(FileCacheTest, Prune) {
+  FileCache Cache(TestDirectory, 20);
+  ASSERT_FALSE(Cache.store("old", "0123456789"));
+  ASSERT_FALSE(Cache.store("used", "0123456789"));
+  ASSERT_FALSE(Cache.store("new", "0123456789"));
+  age("old", 300);
+  age("used", 200);
+  age("new", 100);
+
+  // Looking an entry up makes it the most recently used one.
+  OwningPtr<MemoryBuffer> Result;
+  ASSERT_TRUE(Cache.lookup("used", Result));
+
+  Cache.prune();
+  EXPECT_FALSE(Cache.lookup("old", Result));
+  EXPECT_TRUE(Cache.lookup("used", Result));
+  EXPECT_TRUE(Cache.lookup("new", Result));
+}
+
+} // anonymous namespace
@@ -0,0 +1,84 @@
+//===- llvm/unittest/Support/ThreadingTest.cpp - Threading tests ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/Threading.h"
+#include "llvm/Config/config.h"
+#include "llvm/Support/ThreadLocal.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+struct Job {
+  unsigned Input;
+  unsigned Output;
+};
+
+void square(void *Arg) {
+  Job *J = static_cast<Job*>(Arg);
+  J->Output = J->Input * J->Input;
+}
+
+TEST(Threading, ExecuteOnThreads) {
+  Job Jobs[8];
+  void *Args[8];
+  for (unsigned i = 0; i != 8; ++i) {
+    Jobs[i].Input = i + 1;
+    Jobs[i].Output = 0;
+    Args[i] = &Jobs[i];
+  }
+
+  llvm_execute_on_threads(square, Args);
+
+  for (unsigned i = 0; i != 8; ++i)
+    EXPECT_EQ((i + 1) * (i + 1), Jobs[i].Output);
+}
+
+TEST(Threading, ExecuteOnNoThreads) {
+  llvm_execute_on_threads(square, ArrayRef<void*>());
+}
+
+TEST(Threading, StartAndJoinThread) {
+  Job J = { 7, 0 };
+  if (void *Thread = llvm_start_thread(square, &J))
+    llvm_join_thread(Thread);
+  else
+    square(&J);
+  EXPECT_EQ(49u, J.Output);
+}
+
+struct ThreadLocalJob {
+  sys::ThreadLocal<const ThreadLocalJob> *Key;
+  bool Destroyed;
+};
+
+void setThreadLocal(void *Arg) {
+  ThreadLocalJob *J = static_cast<ThreadLocalJob*>(Arg);
+  J->Key->set(J);
+}
+
+void markDestroyed(void *Arg) {
+  static_cast<ThreadLocalJob*>(Arg)->Destroyed = true;
+}
+
+TEST(Threading, ThreadLocalDestructor) {
+  sys::ThreadLocal<const ThreadLocalJob> Key(markDestroyed);
+  ThreadLocalJob J = { &Key, false };
+  void *Thread = llvm_start_thread(setThreadLocal, &J);
+  if (!Thread)
+    return;
+  llvm_join_thread(Thread);
+#if defined(HAVE_PTHREAD_GETSPECIFIC)
+  EXPECT_TRUE(J.Destroyed);
+#endif
+  EXPECT_TRUE(Key.get() == 0);
+}
+
+} // anonymous namespace
@@ -0,0 +1,138 @@
+//===- SplitModule.cpp - Unit tests for module splitting -----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Utils/SplitModule.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/Assembly/Parser.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Linker.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+// @init is the largest function and @read_tls the next largest, so they end
+// up in different partitions.  Both partitions call the internal @bump and
+// read the internal @counter, and @read_tls reads a thread local variable
+// through an alias that stays with the variable.
+const char *ModuleString =
+  "@tls = thread_local(initialexec) global i32 1\n"
+  "@tls_alias = alias i32* @tls\n"
+  "@counter = internal global i32 0\n"
+  "@llvm.global_ctors = appending global [1 x { i32, void ()* }] "
+  "[{ i32, void ()* } { i32 65535, void ()* @init }]\n"
+  "define internal void @bump() {\n"
+  "  %v = load i32* @counter\n"
+  "  %n = add i32 %v, 1\n"
+  "  store i32 %n, i32* @counter\n"
+  "  ret void\n"
+  "}\n"
+  "define void @init() {\n"
+  "  call void @bump()\n"
+  "  call void @bump()\n"
+  "  call void @bump()\n"
+  "  call void @bump()\n"
+  "  call void @bump()\n"
+  "  ret void\n"
+  "}\n"
+  "define i32 @read_tls() {\n"
+  "  %v = load i32* @tls_alias\n"
+  "  %a = add i32 %v, 1\n"
+  "  %b = mul i32 %a, 3\n"
+  "  %c = sub i32 %b, 2\n"
+  "  ret i32 %c\n"
+  "}\n"
+  "define i32 @get() {\n"
+  "  call void @bump()\n"
+  "  %v = load i32* @counter\n"
+  "  ret i32 %v\n"
+  "}\n";
+
+std::string print(const GlobalValue *GV) {
+  if (!GV)
+    return "<missing>";
+  std::string S;
+  raw_string_ostream OS(S);
+  GV->print(OS);
+  return OS.str();
+}
+
+TEST(SplitModule, PartitionsLinkBack) {
+  LLVMContext Context;
+  SMDiagnostic Err;
+  OwningPtr<Module> M(ParseAssemblyString(ModuleString, 0, Err, Context));
+  ASSERT_TRUE(M.get() != 0);
+  const Function *Init = M->getFunction("init");
+  const Function *ReadTLS = M->getFunction("read_tls");
+  const Function *Bump = M->getFunction("bump");
+  const GlobalVariable *TLS = M->getNamedGlobal("tls");
+  const GlobalVariable *Counter = M->getNamedGlobal("counter");
+  ASSERT_TRUE(Init && ReadTLS && Bump && TLS && Counter);
+
+  ModulePartitionMap Partitions;
+  partitionModule(*M, 2, Partitions);
+  EXPECT_NE(Partitions.lookup(Init), Partitions.lookup(ReadTLS));
+  EXPECT_NE(Partitions.lookup(TLS), Partitions.lookup(ReadTLS));
+  EXPECT_EQ(Partitions.lookup(TLS),
+            Partitions.lookup(M->getNamedAlias("tls_alias")));
+
+  // The internal symbols that both partitions use become hidden externals.
+  promoteCrossPartitionReferences(*M, Partitions);
+  EXPECT_EQ(GlobalValue::ExternalLinkage, Bump->getLinkage());
+  EXPECT_EQ(GlobalValue::HiddenVisibility, Bump->getVisibility());
+  EXPECT_EQ(GlobalValue::ExternalLinkage, Counter->getLinkage());
+  EXPECT_EQ(GlobalValue::HiddenVisibility, Counter->getVisibility());
+
+  StringSet<> Defined[2];
+  for (ModulePartitionMap::iterator I = Partitions.begin(),
+       E = Partitions.end(); I != E; ++I)
+    Defined[I->second].insert(I->first->getName());
+
+  Module Linked("linked", Context);
+  for (unsigned i = 0; i != 2; ++i) {
+    Module *Part = CloneModule(M.get());
+    restrictToPartition(*Part, Defined[i], i == 0);
+
+    // The partition that only uses the alias declares it with the TLS model
+    // of the variable it stands for.
+    if (!Defined[i].count("tls_alias")) {
+      const GlobalVariable *Decl = Part->getNamedGlobal("tls_alias");
+      ASSERT_TRUE(Decl != 0);
+      EXPECT_TRUE(Decl->isDeclaration());
+      EXPECT_EQ(GlobalVariable::InitialExecTLSModel,
+                Decl->getThreadLocalMode());
+    }
+
+    std::string ErrMsg;
+    EXPECT_FALSE(Linker::LinkModules(&Linked, Part, Linker::DestroySource,
+                                     &ErrMsg)) << ErrMsg;
+    delete Part;
+  }
+
+  // Linking the partitions back together gives the module they were split
+  // from, with each definition once.
+  unsigned NumGlobals = 0;
+  for (Module::iterator F = M->begin(), E = M->end(); F != E; ++F, ++NumGlobals)
+    EXPECT_EQ(print(F), print(Linked.getFunction(F->getName())));
+  for (Module::global_iterator GV = M->global_begin(), E = M->global_end();
+       GV != E; ++GV, ++NumGlobals)
+    EXPECT_EQ(print(GV), print(Linked.getNamedGlobal(GV->getName())));
+  for (Module::alias_iterator A = M->alias_begin(), E = M->alias_end();
+       A != E; ++A, ++NumGlobals)
+    EXPECT_EQ(print(A), print(Linked.getNamedAlias(A->getName())));
+  EXPECT_EQ(NumGlobals, Linked.size() + Linked.getGlobalList().size() +
+                        Linked.getAliasList().size());
+}
+
+} // end anonymous namespace
@@ -15,6 +15,7 @@
 #include "CodeGenDAGPatterns.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FormattedStream.h"
@@ -30,6 +31,12 @@ static cl::opt<bool>
 OmitComments("omit-comments", cl::desc("Do not generate comments"),
              cl::init(false));
 
+static cl::opt<bool>
+DirectMatcher("direct-dag-isel",
+              cl::desc("Generate C++ code that checks the patterns directly "
+                       "instead of interpreting the matcher table"),
+              cl::init(false));
+
 namespace {
 class MatcherTableEmitter {
   const CodeGenDAGPatterns &CGP;
@@ -47,10 +54,21 @@ class MatcherTableEmitter {
   DenseMap<Record*, unsigned> NodeXFormMap;
   std::vector<Record*> NodeXForms;
 
+  /// TableIndices - The index in the table of each node creation matcher.
+  DenseMap<const Matcher*, unsigned> TableIndices;
+
 public:
   MatcherTableEmitter(const CodeGenDAGPatterns &cgp)
     : CGP(cgp) {}
 
+  /// getTableIndex - Return the index in the table of the specified node
+  /// creation matcher.
+  unsigned getTableIndex(const Matcher *N) const {
+    DenseMap<const Matcher*, unsigned>::const_iterator I = TableIndices.find(N);
+    assert(I != TableIndices.end() && "Matcher was not emitted!");
+    return I->second;
+  }
+
   unsigned EmitMatcherList(const Matcher *N, unsigned Indent,
                            unsigned StartIdx, formatted_raw_ostream &OS);
 
@@ -139,6 +157,12 @@ EmitMatcher(const Matcher *N, unsigned Indent, unsigned CurrentIdx,
             formatted_raw_ostream &OS) {
   OS.PadToColumn(Indent*2);
 
+  // Remember where the node creation starts, the direct matcher resumes the
+  // table there.  Scopes are emitted more than once while their size is being
+  // worked out; the last emission is the one that counts.
+  if (N->getKind() >= Matcher::EmitInteger)
+    TableIndices[N] = CurrentIdx;
+
   switch (N->getKind()) {
   case Matcher::Scope: {
     const ScopeMatcher *SM = cast<ScopeMatcher>(N);
@@ -616,6 +640,16 @@ void MatcherTableEmitter::EmitPredicateFunctions(formatted_raw_ostream &OS) {
     PFsByName[I->first->getName()] = I->second;
 
   if (!NodePredicates.empty()) {
+    // The direct matcher calls each predicate by name.
+    if (DirectMatcher) {
+      for (unsigned i = 0, e = NodePredicates.size(); i != e; ++i) {
+        TreePredicateFn PredFn = NodePredicates[i];
+        assert(!PredFn.isAlwaysTrue() && "No code in this predicate");
+        OS << "bool " << PredFn.getFnName() << "(SDNode *Node) const {\n";
+        OS << PredFn.getCodeToRunOnSDNode() << "\n}\n\n";
+      }
+    }
+
     OS << "virtual bool CheckNodePredicate(SDNode *Node,\n";
     OS << "                                unsigned PredNo) const {\n";
     OS << "  switch (PredNo) {\n";
@@ -624,6 +658,12 @@ void MatcherTableEmitter::EmitPredicateFunctions(formatted_raw_ostream &OS) {
       // Emit the predicate code corresponding to this pattern.
       TreePredicateFn PredFn = NodePredicates[i];
       
+      if (DirectMatcher) {
+        OS << "  case " << i << ": return " << PredFn.getFnName()
+           << "(Node);\n";
+        continue;
+      }
+
       assert(!PredFn.isAlwaysTrue() && "No code in this predicate");
       OS << "  case " << i << ": { // " << NodePredicates[i].getFnName() <<'\n';
       
@@ -784,6 +824,444 @@ void MatcherTableEmitter::EmitHistogram(const Matcher *M,
 }
 
 
+namespace {
+/// DirectMatcherEmitter - Emit the matcher as C++ code that checks the
+/// patterns directly, for targets built with -direct-dag-isel.  Scopes become
+/// blocks that jump to the next alternative on failure and the predicates and
+/// type checks are emitted inline.  Once the checks of a pattern are done the
+/// result nodes are emitted by the table interpreter, which is resumed at the
+/// table index of the first node creation matcher.
+class DirectMatcherEmitter {
+  const CodeGenDAGPatterns &CGP;
+  const MatcherTableEmitter &TableEmitter;
+  formatted_raw_ostream &OS;
+
+  /// NextNode/NextLabel - Numbers used to name the SDValues and labels of the
+  /// function being emitted.
+  unsigned NextNode, NextLabel;
+
+public:
+  DirectMatcherEmitter(const CodeGenDAGPatterns &cgp,
+                       const MatcherTableEmitter &TE,
+                       formatted_raw_ostream &os)
+    : CGP(cgp), TableEmitter(TE), OS(os) {}
+
+  void EmitMatchDirect(const Matcher *TheMatcher);
+
+private:
+  void EmitFunction(const std::string &Name, const Matcher *N);
+  void EmitMatcherList(const Matcher *N, unsigned Indent,
+                       std::vector<std::string> NodeStack,
+                       unsigned NumRecorded, unsigned NumMemRefs,
+                       const std::string &Fail);
+  void EmitScope(const ScopeMatcher *SM, unsigned Indent,
+                 const std::vector<std::string> &NodeStack,
+                 unsigned NumRecorded, unsigned NumMemRefs,
+                 const std::string &Fail);
+};
+} // end anonymous namespace.
+
+/// isNodeCreation - Return true if the specified matcher emits nodes, which
+/// the direct matcher leaves to the table interpreter.
+static bool isNodeCreation(const Matcher *N) {
+  return N->getKind() >= Matcher::EmitInteger;
+}
+
+/// CapturesGlueInput - Return true if the checks of the specified matcher list
+/// can change the input glue.
+static bool CapturesGlueInput(const Matcher *N) {
+  for (; N != 0 && !isNodeCreation(N); N = N->getNext()) {
+    if (isa<CaptureGlueInputMatcher>(N))
+      return true;
+    if (const ScopeMatcher *SM = dyn_cast<ScopeMatcher>(N)) {
+      for (unsigned i = 0, e = SM->getNumChildren(); i != e; ++i)
+        if (CapturesGlueInput(SM->getChild(i)))
+          return true;
+    } else if (const SwitchOpcodeMatcher *SOM =
+                 dyn_cast<SwitchOpcodeMatcher>(N)) {
+      for (unsigned i = 0, e = SOM->getNumCases(); i != e; ++i)
+        if (CapturesGlueInput(SOM->getCaseMatcher(i)))
+          return true;
+    } else if (const SwitchTypeMatcher *STM = dyn_cast<SwitchTypeMatcher>(N)) {
+      for (unsigned i = 0, e = STM->getNumCases(); i != e; ++i)
+        if (CapturesGlueInput(STM->getCaseMatcher(i)))
+          return true;
+    }
+  }
+  return false;
+}
+
+/// EmitInt64 - Emit the specified value as a C++ integer literal.
+static void EmitInt64(int64_t Val, raw_ostream &OS) {
+  if (Val == INT64_MIN)
+    OS << "INT64_MIN";
+  else if (Val == int32_t(Val))
+    OS << Val;
+  else
+    OS << "INT64_C(" << Val << ")";
+}
+
+/// EmitTypeCompare - Emit a comparison of the type VT, an EVT expression, with
+/// T.  iPTR stands for the pointer type of the target.
+static void EmitTypeCompare(StringRef VT, StringRef Op, MVT::SimpleValueType T,
+                            raw_ostream &OS) {
+  OS << VT << ' ' << Op << ' ';
+  if (T == MVT::iPTR)
+    OS << "TLI.getPointerTy()";
+  else
+    OS << getEnumName(T);
+}
+
+void DirectMatcherEmitter::EmitScope(const ScopeMatcher *SM, unsigned Indent,
+                                     const std::vector<std::string> &NodeStack,
+                                     unsigned NumRecorded, unsigned NumMemRefs,
+                                     const std::string &Fail) {
+  // The children are tried in order.  Each one that fails jumps to the next,
+  // which first restores the state the scope started with.
+  std::string SavedGlue;
+  if (CapturesGlueInput(SM)) {
+    SavedGlue = "Glue" + utostr(NextLabel++);
+    OS.indent(Indent*2) << "SDValue " << SavedGlue
+                        << " = State.InputGlue;\n";
+  }
+
+  for (unsigned i = 0, e = SM->getNumChildren(); i != e; ++i) {
+    std::string Label;
+    if (i+1 != e)
+      Label = "Fail" + utostr(NextLabel++);
+
+    OS.indent(Indent*2) << "{\n";
+    EmitMatcherList(SM->getChild(i), Indent+1, NodeStack, NumRecorded,
+                    NumMemRefs, Label.empty() ? Fail : "goto " + Label + ";");
+    OS.indent(Indent*2) << "}\n";
+    if (Label.empty())
+      continue;
+
+    OS << Label << ":\n";
+    OS.indent(Indent*2) << "State.RecordedNodes.resize(" << NumRecorded
+                        << ");\n";
+    OS.indent(Indent*2) << "State.MatchedMemRefs.resize(" << NumMemRefs
+                        << ");\n";
+    if (!SavedGlue.empty())
+      OS.indent(Indent*2) << "State.InputGlue = " << SavedGlue << ";\n";
+  }
+}
+
+/// EmitMatcherList - Emit the code for the specified matcher list.  NodeStack
+/// holds the names of the current node and its parents, NumRecorded and
+/// NumMemRefs are the number of nodes and memrefs recorded so far and Fail is
+/// the statement to run if the match fails.
+void DirectMatcherEmitter::EmitMatcherList(const Matcher *N, unsigned Indent,
+                                           std::vector<std::string> NodeStack,
+                                           unsigned NumRecorded,
+                                           unsigned NumMemRefs,
+                                           const std::string &Fail) {
+  for (; N != 0; N = N->getNext()) {
+    if (isa<MoveParentMatcher>(N)) {
+      NodeStack.pop_back();
+      assert(!NodeStack.empty() && "Node stack imbalance!");
+      continue;
+    }
+
+    if (const ScopeMatcher *SM = dyn_cast<ScopeMatcher>(N)) {
+      assert(N->getNext() == 0 && "Shouldn't have next after scope");
+      EmitScope(SM, Indent, NodeStack, NumRecorded, NumMemRefs, Fail);
+      return;
+    }
+
+    const std::string &Cur = NodeStack.back();
+    OS.indent(Indent*2);
+
+    if (isNodeCreation(N)) {
+      // Leave the rest of this pattern to the table interpreter.
+      if (!OmitComments) {
+        const Matcher *Last = N;
+        while (Last->getNext() && !isa<ScopeMatcher>(Last->getNext()))
+          Last = Last->getNext();
+        const PatternToMatch *Pattern = 0;
+        if (const MorphNodeToMatcher *MN = dyn_cast<MorphNodeToMatcher>(Last))
+          Pattern = &MN->getPattern();
+        else if (const CompleteMatchMatcher *CM =
+                   dyn_cast<CompleteMatchMatcher>(Last))
+          Pattern = &CM->getPattern();
+        if (Pattern) {
+          OS << "// Src: " << *Pattern->getSrcPattern() << " - Complexity = "
+             << Pattern->getPatternComplexity(CGP) << '\n';
+          OS.indent(Indent*2) << "// Dst: "
+                              << *Pattern->getDstPattern() << '\n';
+          OS.indent(Indent*2);
+        }
+      }
+      OS << "if (RunMatcherTable(State, " << Cur << ", "
+         << TableEmitter.getTableIndex(N) << ", Result)) return true;\n";
+      OS.indent(Indent*2) << Fail << '\n';
+      return;
+    }
+
+    switch (N->getKind()) {
+    default: llvm_unreachable("Unexpected matcher kind!");
+    case Matcher::RecordNode: {
+      assert(cast<RecordMatcher>(N)->getResultNo() == NumRecorded &&
+             "Recorded node out of order!");
+      OS << "State.RecordedNodes.push_back(std::make_pair(" << Cur << ", ";
+      if (NodeStack.size() > 1)
+        OS << NodeStack[NodeStack.size()-2] << ".getNode()));\n";
+      else
+        OS << "(SDNode*)0));\n";
+      ++NumRecorded;
+      break;
+    }
+
+    case Matcher::RecordChild: {
+      unsigned ChildNo = cast<RecordChildMatcher>(N)->getChildNo();
+      assert(cast<RecordChildMatcher>(N)->getResultNo() == NumRecorded &&
+             "Recorded node out of order!");
+      OS << "if (" << Cur << ".getNumOperands() <= " << ChildNo << ") "
+         << Fail << '\n';
+      OS.indent(Indent*2) << "State.RecordedNodes.push_back(std::make_pair("
+                          << Cur << ".getOperand(" << ChildNo << "), "
+                          << Cur << ".getNode()));\n";
+      ++NumRecorded;
+      break;
+    }
+
+    case Matcher::RecordMemRef:
+      OS << "State.MatchedMemRefs.push_back(cast<MemSDNode>(" << Cur
+         << ")->getMemOperand());\n";
+      ++NumMemRefs;
+      break;
+
+    case Matcher::CaptureGlueInput:
+      OS << "if (" << Cur << "->getNumOperands() != 0 &&\n";
+      OS.indent(Indent*2+4) << Cur << "->getOperand(" << Cur
+        << "->getNumOperands()-1).getValueType() == MVT::Glue)\n";
+      OS.indent(Indent*2+2) << "State.InputGlue = " << Cur
+        << "->getOperand(" << Cur << "->getNumOperands()-1);\n";
+      break;
+
+    case Matcher::MoveChild: {
+      unsigned ChildNo = cast<MoveChildMatcher>(N)->getChildNo();
+      std::string Child = "N" + utostr(NextNode++);
+      OS << "if (" << Cur << ".getNumOperands() <= " << ChildNo << ") "
+         << Fail << '\n';
+      OS.indent(Indent*2) << "SDValue " << Child << " = " << Cur
+                          << ".getOperand(" << ChildNo << ");\n";
+      NodeStack.push_back(Child);
+      break;
+    }
+
+    case Matcher::CheckSame:
+      OS << "if (" << Cur << " != State.RecordedNodes["
+         << cast<CheckSameMatcher>(N)->getMatchNumber() << "].first) " << Fail
+         << '\n';
+      break;
+
+    case Matcher::CheckPatternPredicate:
+      OS << "if (!(" << cast<CheckPatternPredicateMatcher>(N)->getPredicate()
+         << ")) " << Fail << '\n';
+      break;
+
+    case Matcher::CheckPredicate:
+      OS << "if (!"
+         << cast<CheckPredicateMatcher>(N)->getPredicate().getFnName() << '('
+         << Cur << ".getNode())) " << Fail << '\n';
+      break;
+
+    case Matcher::CheckOpcode:
+      OS << "if (" << Cur << ".getOpcode() != "
+         << cast<CheckOpcodeMatcher>(N)->getOpcode().getEnumName() << ") "
+         << Fail << '\n';
+      break;
+
+    case Matcher::SwitchOpcode: {
+      const SwitchOpcodeMatcher *SOM = cast<SwitchOpcodeMatcher>(N);
+      OS << "switch (" << Cur << ".getOpcode()) {\n";
+      OS.indent(Indent*2) << "default: " << Fail << '\n';
+      for (unsigned i = 0, e = SOM->getNumCases(); i != e; ++i) {
+        OS.indent(Indent*2) << "case "
+          << SOM->getCaseOpcode(i).getEnumName() << ": {\n";
+        EmitMatcherList(SOM->getCaseMatcher(i), Indent+1, NodeStack,
+                        NumRecorded, NumMemRefs, Fail);
+        OS.indent(Indent*2) << "}\n";
+      }
+      OS.indent(Indent*2) << "}\n";
+      assert(N->getNext() == 0 && "Shouldn't have next after switch");
+      return;
+    }
+
+    case Matcher::SwitchType: {
+      // The cases are tried in order; a case for iPTR matches the pointer type
+      // and may come after a case for the same concrete type.
+      const SwitchTypeMatcher *STM = cast<SwitchTypeMatcher>(N);
+      std::string VT = "VT" + utostr(NextLabel++);
+      OS << "{\n";
+      OS.indent(Indent*2+2) << "EVT " << VT << " = " << Cur
+                            << ".getValueType();\n";
+      for (unsigned i = 0, e = STM->getNumCases(); i != e; ++i) {
+        OS.indent(Indent*2+2) << "if (";
+        EmitTypeCompare(VT, "==", STM->getCaseType(i), OS);
+        OS << ") {\n";
+        EmitMatcherList(STM->getCaseMatcher(i), Indent+2, NodeStack,
+                        NumRecorded, NumMemRefs, Fail);
+        OS.indent(Indent*2+2) << "}\n";
+      }
+      OS.indent(Indent*2+2) << Fail << '\n';
+      OS.indent(Indent*2) << "}\n";
+      assert(N->getNext() == 0 && "Shouldn't have next after switch");
+      return;
+    }
+
+    case Matcher::CheckType:
+      assert(cast<CheckTypeMatcher>(N)->getResNo() == 0 &&
+             "FIXME: Add support for CheckType of resno != 0");
+      OS << "if (";
+      EmitTypeCompare(Cur + ".getValueType()", "!=",
+                      cast<CheckTypeMatcher>(N)->getType(), OS);
+      OS << ") " << Fail << '\n';
+      break;
+
+    case Matcher::CheckChildType: {
+      const CheckChildTypeMatcher *CCT = cast<CheckChildTypeMatcher>(N);
+      OS << "if (" << Cur << ".getNumOperands() <= " << CCT->getChildNo()
+         << " ||\n";
+      OS.indent(Indent*2+4);
+      EmitTypeCompare(Cur + ".getOperand(" + utostr(CCT->getChildNo()) +
+                      ").getValueType()", "!=", CCT->getType(), OS);
+      OS << ") " << Fail << '\n';
+      break;
+    }
+
+    case Matcher::CheckInteger:
+      OS << "if (!isa<ConstantSDNode>(" << Cur << ") ||\n";
+      OS.indent(Indent*2+4) << "cast<ConstantSDNode>(" << Cur
+                            << ")->getSExtValue() != ";
+      EmitInt64(cast<CheckIntegerMatcher>(N)->getValue(), OS);
+      OS << ") " << Fail << '\n';
+      break;
+
+    case Matcher::CheckCondCode:
+      OS << "if (cast<CondCodeSDNode>(" << Cur << ")->get() != ISD::"
+         << cast<CheckCondCodeMatcher>(N)->getCondCodeName() << ") " << Fail
+         << '\n';
+      break;
+
+    case Matcher::CheckValueType: {
+      StringRef TypeName = cast<CheckValueTypeMatcher>(N)->getTypeName();
+      OS << "if (cast<VTSDNode>(" << Cur << ")->getVT() != ";
+      if (TypeName == "iPTR")
+        OS << "TLI.getPointerTy()";
+      else
+        OS << "MVT::" << TypeName;
+      OS << ") " << Fail << '\n';
+      break;
+    }
+
+    case Matcher::CheckComplexPat: {
+      const CheckComplexPatMatcher *CCPM = cast<CheckComplexPatMatcher>(N);
+      const ComplexPattern &P = CCPM->getPattern();
+      unsigned NumOps = P.getNumOperands();
+      if (P.hasProperty(SDNPHasChain))
+        ++NumOps;  // Get the chained node too.
+      assert(CCPM->getFirstResult() == NumRecorded &&
+             "Recorded node out of order!");
+
+      std::string Rec =
+        "State.RecordedNodes[" + utostr(CCPM->getMatchNumber()) + "]";
+      OS << "State.RecordedNodes.resize(" << NumRecorded+NumOps << ");\n";
+      OS.indent(Indent*2) << "if (!" << P.getSelectFunc() << "(";
+      if (P.hasProperty(SDNPWantRoot))
+        OS << "State.NodeToMatch, ";
+      if (P.hasProperty(SDNPWantParent))
+        OS << Rec << ".second, ";
+      OS << Rec << ".first";
+      for (unsigned i = 0; i != NumOps; ++i)
+        OS << ",\n" << std::string(Indent*2+8, ' ')
+           << "State.RecordedNodes[" << NumRecorded+i << "].first";
+      OS << ")) " << Fail << '\n';
+      NumRecorded += NumOps;
+      break;
+    }
+
+    case Matcher::CheckAndImm:
+    case Matcher::CheckOrImm: {
+      bool IsAnd = isa<CheckAndImmMatcher>(N);
+      int64_t Val = IsAnd ? cast<CheckAndImmMatcher>(N)->getValue()
+                          : cast<CheckOrImmMatcher>(N)->getValue();
+      OS << "if (" << Cur << ".getOpcode() != "
+         << (IsAnd ? "ISD::AND" : "ISD::OR") << " ||\n";
+      OS.indent(Indent*2+4) << "!isa<ConstantSDNode>(" << Cur
+                            << ".getOperand(1)) ||\n";
+      OS.indent(Indent*2+4) << (IsAnd ? "!CheckAndMask(" : "!CheckOrMask(")
+        << Cur << ".getOperand(0), cast<ConstantSDNode>(" << Cur
+        << ".getOperand(1)), ";
+      EmitInt64(Val, OS);
+      OS << ")) " << Fail << '\n';
+      break;
+    }
+
+    case Matcher::CheckFoldableChainNode: {
+      assert(NodeStack.size() > 1 && "No parent node");
+      const std::string &Parent = NodeStack[NodeStack.size()-2];
+      // All intermediate nodes between the root and this one must have a
+      // single use.
+      OS << "if (";
+      for (unsigned i = 1, e = NodeStack.size()-1; i != e; ++i)
+        OS << '!' << NodeStack[i] << ".hasOneUse() ||\n"
+           << std::string(Indent*2+4, ' ');
+      OS << "!IsProfitableToFold(" << Cur << ", " << Parent
+         << ".getNode(), State.NodeToMatch) ||\n";
+      OS.indent(Indent*2+4) << "!IsLegalToFold(" << Cur << ", " << Parent
+        << ".getNode(), State.NodeToMatch, OptLevel, true)) " << Fail << '\n';
+      break;
+    }
+    }
+  }
+  llvm_unreachable("Matcher list does not end in a match!");
+}
+
+void DirectMatcherEmitter::EmitFunction(const std::string &Name,
+                                        const Matcher *N) {
+  NextNode = 1;
+  NextLabel = 0;
+  OS << "bool " << Name << "(MatcherState &State, SDNode *&Result) {\n";
+  OS << "  SDValue N0(State.NodeToMatch, 0);\n";
+  EmitMatcherList(N, 1, std::vector<std::string>(1, "N0"), 0, 0,
+                  "return false;");
+  OS << "}\n\n";
+}
+
+void DirectMatcherEmitter::EmitMatchDirect(const Matcher *TheMatcher) {
+  // If the matcher starts by switching on the opcode, emit a function for each
+  // opcode so that no function gets too large to compile.
+  const SwitchOpcodeMatcher *SOM = dyn_cast<SwitchOpcodeMatcher>(TheMatcher);
+  if (SOM == 0) {
+    EmitFunction("MatchDirect_Root", TheMatcher);
+    OS << "virtual bool MatchDirect(MatcherState &State, SDNode *&Result) {\n";
+    OS << "  return MatchDirect_Root(State, Result);\n";
+    OS << "}\n\n";
+    return;
+  }
+
+  std::vector<std::string> Names;
+  for (unsigned i = 0, e = SOM->getNumCases(); i != e; ++i) {
+    std::string Name = "MatchDirect_" + SOM->getCaseOpcode(i).getEnumName();
+    for (unsigned j = 0, je = Name.size(); j != je; ++j)
+      if (Name[j] == ':')
+        Name[j] = '_';
+    Names.push_back(Name);
+    EmitFunction(Name, SOM->getCaseMatcher(i));
+  }
+
+  OS << "virtual bool MatchDirect(MatcherState &State, SDNode *&Result) {\n";
+  OS << "  switch (State.NodeToMatch->getOpcode()) {\n";
+  OS << "  default: return false;\n";
+  for (unsigned i = 0, e = SOM->getNumCases(); i != e; ++i)
+    OS << "  case " << SOM->getCaseOpcode(i).getEnumName() << ": return "
+       << Names[i] << "(State, Result);\n";
+  OS << "  }\n";
+  OS << "}\n\n";
+}
+
 void llvm::EmitMatcherTable(const Matcher *TheMatcher,
                             const CodeGenDAGPatterns &CGP,
                             raw_ostream &O) {
@@ -804,8 +1282,15 @@ void llvm::EmitMatcherTable(const Matcher *TheMatcher,
   MatcherEmitter.EmitHistogram(TheMatcher, OS);
 
   OS << "  #undef TARGET_VAL\n";
-  OS << "  return SelectCodeCommon(N, MatcherTable,sizeof(MatcherTable));\n}\n";
-  OS << '\n';
+  if (DirectMatcher)
+    OS << "  return SelectCodeDirect(N, MatcherTable,sizeof(MatcherTable));\n";
+  else
+    OS << "  return SelectCodeCommon(N, MatcherTable,sizeof(MatcherTable));\n";
+  OS << "}\n\n";
+
+  // Next up, emit the direct matcher if it was asked for.
+  if (DirectMatcher)
+    DirectMatcherEmitter(CGP, MatcherEmitter, OS).EmitMatchDirect(TheMatcher);
 
   // Next up, emit the function for node and pattern predicates:
   MatcherEmitter.EmitPredicateFunctions(OS);
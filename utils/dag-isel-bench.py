@@ -0,0 +1,172 @@
+#!/usr/bin/env python
+
+"""Compare the compile time of the direct DAG instruction selector with the
+matcher table interpreter.
+
+Generates a large module of integer, floating point, vector and memory
+operations, compiles it with llc, once as built and once with
+-disable-direct-isel, and reports the "Instruction Selection" time from
+-time-passes for each.  llc must have been built with the target listed in
+LLVM_DIRECT_DAG_ISEL_TARGETS (or DIRECT_DAG_ISEL_TARGETS with make), otherwise
+both runs use the interpreter.
+
+  utils/dag-isel-bench.py --llc=build/bin/llc --functions=2000
+"""
+
+import argparse
+import os
+import random
+import re
+import subprocess
+import sys
+import tempfile
+
+INT_TYPES = ['i8', 'i16', 'i32', 'i64']
+INT_OPS = ['add', 'sub', 'mul', 'and', 'or', 'xor', 'shl', 'lshr', 'ashr']
+FP_TYPES = ['float', 'double', '<4 x float>', '<2 x double>']
+FP_OPS = ['fadd', 'fsub', 'fmul', 'fdiv']
+VEC_TYPES = ['<4 x i32>', '<8 x i16>', '<2 x i64>']
+VEC_OPS = ['add', 'sub', 'and', 'or', 'xor']
+PREDS = ['eq', 'ne', 'slt', 'sgt', 'ule', 'uge']
+
+def gen_function(rng, n, ops):
+  """Return the IR of a function doing ops operations on its arguments and on
+  memory."""
+  lines = []
+  lines.append('define void @f%d(i64* %%p, double* %%q, <4 x i32>* %%v, '
+               'i64 %%a, double %%b) {' % n)
+  vals = {'i64': ['%a'], 'double': ['%b']}
+  counter = [0]
+
+  def fresh():
+    counter[0] += 1
+    return '%%t%d' % counter[0]
+
+  def get(ty):
+    if ty in vals and rng.random() < 0.8:
+      return rng.choice(vals[ty])
+    if ty in INT_TYPES:
+      return str(rng.randint(-300, 300))
+    if ty in ('float', 'double'):
+      return '%d.0' % rng.randint(-8, 8)
+    return 'zeroinitializer'
+
+  def put(ty, v):
+    vals.setdefault(ty, []).append(v)
+
+  for i in range(ops):
+    kind = rng.randint(0, 6)
+    if kind <= 1:
+      ty = rng.choice(INT_TYPES)
+      v = fresh()
+      lines.append('  %s = %s %s %s, %s' %
+                   (v, rng.choice(INT_OPS), ty, get(ty), get(ty)))
+      put(ty, v)
+    elif kind == 2:
+      ty = rng.choice(FP_TYPES)
+      v = fresh()
+      lines.append('  %s = %s %s %s, %s' %
+                   (v, rng.choice(FP_OPS), ty, get(ty), get(ty)))
+      put(ty, v)
+    elif kind == 3:
+      ty = rng.choice(VEC_TYPES)
+      v = fresh()
+      lines.append('  %s = %s %s %s, %s' %
+                   (v, rng.choice(VEC_OPS), ty, get(ty), get(ty)))
+      put(ty, v)
+    elif kind == 4:
+      # A compare and select, which folds into cmov or setcc.
+      ty = rng.choice(INT_TYPES)
+      c, v = fresh(), fresh()
+      lines.append('  %s = icmp %s %s %s, %s' %
+                   (c, rng.choice(PREDS), ty, get(ty), get(ty)))
+      lines.append('  %s = select i1 %s, %s %s, %s %s' %
+                   (v, c, ty, get(ty), ty, get(ty)))
+      put(ty, v)
+    elif kind == 5:
+      # Loads at varying offsets, which fold into addressing modes.
+      addr, v = fresh(), fresh()
+      if rng.randint(0, 1):
+        lines.append('  %s = getelementptr i64* %%p, i64 %d' %
+                     (addr, rng.randint(0, 64)))
+        lines.append('  %s = load i64* %s' % (v, addr))
+        put('i64', v)
+      else:
+        lines.append('  %s = getelementptr double* %%q, i64 %d' %
+                     (addr, rng.randint(0, 64)))
+        lines.append('  %s = load double* %s' % (v, addr))
+        put('double', v)
+    else:
+      addr = fresh()
+      lines.append('  %s = getelementptr i64* %%p, i64 %d' %
+                   (addr, rng.randint(0, 64)))
+      lines.append('  store i64 %s, i64* %s' % (get('i64'), addr))
+
+  # Keep the results alive.
+  for ty, ptr in (('i64', '%p'), ('double', '%q')):
+    for v in vals.get(ty, [])[-4:]:
+      lines.append('  store volatile %s %s, %s* %s' % (ty, v, ty, ptr))
+  for ty in VEC_TYPES:
+    for v in vals.get(ty, [])[-2:]:
+      cast = fresh()
+      lines.append('  %s = bitcast %s %s to <4 x i32>' % (cast, ty, v))
+      lines.append('  store volatile <4 x i32> %s, <4 x i32>* %%v' % cast)
+  lines.append('  ret void')
+  lines.append('}')
+  return '\n'.join(lines) + '\n'
+
+def isel_time(llc, args, path):
+  """Run llc and return the wall time of the Instruction Selection timer."""
+  p = subprocess.Popen([llc] + args + ['-time-passes', '-o', os.devnull, path],
+                       stderr=subprocess.PIPE)
+  err = p.communicate()[1].decode('utf-8', 'replace')
+  if p.returncode != 0:
+    sys.stderr.write(err)
+    sys.exit('llc failed')
+  for line in err.splitlines():
+    if line.rstrip().endswith(' Instruction Selection'):
+      # The columns are user, system, user+system and wall time, each
+      # followed by a percentage.
+      times = re.findall(r'([0-9.]+) \(', line)
+      return float(times[-1])
+  sys.exit('no Instruction Selection timer in the output of llc')
+
+def main():
+  parser = argparse.ArgumentParser(description=__doc__,
+                      formatter_class=argparse.RawDescriptionHelpFormatter)
+  parser.add_argument('--llc', default='llc', help='llc binary to run')
+  parser.add_argument('--functions', type=int, default=2000,
+                      help='number of functions in the module')
+  parser.add_argument('--ops', type=int, default=60,
+                      help='number of operations in each function')
+  parser.add_argument('--runs', type=int, default=3,
+                      help='number of runs of each selector, the best is used')
+  parser.add_argument('--llc-args', default='-O2',
+                      help='extra arguments for llc')
+  args = parser.parse_args()
+
+  rng = random.Random(42)
+  fd, path = tempfile.mkstemp(suffix='.ll')
+  f = os.fdopen(fd, 'w')
+  f.write('target triple = "x86_64-unknown-linux-gnu"\n\n')
+  for n in range(args.functions):
+    f.write(gen_function(rng, n, args.ops))
+  f.close()
+
+  try:
+    llc_args = args.llc_args.split()
+    direct = min(isel_time(args.llc, llc_args, path)
+                 for i in range(args.runs))
+    table = min(isel_time(args.llc, llc_args + ['-disable-direct-isel'], path)
+                for i in range(args.runs))
+  finally:
+    os.remove(path)
+
+  print('%d functions of %d operations' % (args.functions, args.ops))
+  print('  matcher table interpreter: %8.3fs' % table)
+  print('  direct matcher:            %8.3fs' % direct)
+  if direct > 0:
+    print('  speedup:                   %8.2fx' % (table / direct))
+
+if __name__ == '__main__':
+  main()
@@ -0,0 +1,130 @@
+#!/usr/bin/env python
+
+"""Stress the relaxation of the MC assembler layout.
+
+Generates an x86-64 assembly file with one section per function, as
+-ffunction-sections does.  Each function is a chain of short jumps where every
+jump only needs to be relaxed once the next one has been, and every jump has a
+.loc, so there is a line table fragment for each of them.  The file is
+assembled with llvm-mc and the time taken is reported, along with the number of
+fixups evaluated during layout if llvm-mc was built with assertions.
+
+  utils/mc-relax-bench.py --llvm-mc=build/bin/llvm-mc --functions=2000
+  utils/mc-relax-bench.py --llvm-mc=new/llvm-mc --baseline=old/llvm-mc
+
+With --baseline the same file is also assembled with a second llvm-mc and the
+two object files are compared.
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import time
+
+def gen_function(out, n, chain, filler):
+  """Write a function made of a chain of jumps.  A jump to the label after the
+  next jump is 127 bytes away when the next jump is short, so relaxing the last
+  jump of the chain makes all the others need relaxation, one at a time."""
+  # The bytes before and after the target label of each jump.  The distance
+  # covered by a short jump is 2*Before + After + 2 bytes.
+  before = filler
+  after = 125 - 2 * before
+  out.write('\t.section\t.text.f%d,"ax",@progbits\n' % n)
+  out.write('\t.globl\tf%d\n' % n)
+  out.write('\t.p2align\t4, 0x90\n')
+  out.write('f%d:\n' % n)
+  out.write('\t.loc\t1 %d 0\n' % (n * (chain + 2) + 1))
+  for i in range(chain):
+    out.write('\t.loc\t1 %d 0\n' % (n * (chain + 2) + i + 2))
+    if i + 1 == chain:
+      # The last jump is too far to be short, which starts the cascade.
+      out.write('\tjmp\t.Lf%d_end\n' % n)
+    else:
+      out.write('\tjmp\t.Lf%d_%d\n' % (n, i))
+    out.write('\t.fill\t%d, 1, 0x90\n' % before)
+    if i:
+      out.write('.Lf%d_%d:\n' % (n, i - 1))
+    out.write('\t.fill\t%d, 1, 0x90\n' % after)
+  out.write('\t.fill\t%d, 1, 0x90\n' % before)
+  out.write('.Lf%d_%d:\n' % (n, chain - 1))
+  out.write('\t.fill\t200, 1, 0x90\n')
+  out.write('.Lf%d_end:\n' % n)
+  out.write('\tretq\n')
+
+def assemble(llvm_mc, src, obj):
+  """Assemble src into obj and return the wall time, the number of layout
+  steps and the number of evaluated fixups.  The counts are None if llvm-mc
+  doesn't report statistics."""
+  start = time.time()
+  p = subprocess.Popen([llvm_mc, '-triple=x86_64-unknown-linux-gnu',
+                        '-filetype=obj', '-stats', '-o', obj, src],
+                       stderr=subprocess.PIPE)
+  err = p.communicate()[1].decode('utf-8', 'replace')
+  elapsed = time.time() - start
+  if p.returncode != 0:
+    sys.stderr.write(err)
+    sys.exit('llvm-mc failed')
+  def stat(desc):
+    m = re.search(r'(\d+) assembler\s+- Number of ' + desc, err)
+    return m and int(m.group(1))
+  return (elapsed, stat('assembler layout and relaxation steps'),
+          stat('evaluated fixups'))
+
+def report(name, result):
+  elapsed, steps, fixups = result
+  line = '  %-10s %8.3fs' % (name + ':', elapsed)
+  if steps is not None:
+    line += '  %d layout steps, %d evaluated fixups' % (steps, fixups)
+  print(line)
+
+def main():
+  parser = argparse.ArgumentParser(description=__doc__,
+                      formatter_class=argparse.RawDescriptionHelpFormatter)
+  parser.add_argument('--llvm-mc', default='llvm-mc',
+                      help='llvm-mc binary to run')
+  parser.add_argument('--baseline', help='llvm-mc binary to compare with')
+  parser.add_argument('--functions', type=int, default=2000,
+                      help='number of functions, each in its own section')
+  parser.add_argument('--chain', type=int, default=50,
+                      help='number of jumps in the chain of each function')
+  parser.add_argument('--filler', type=int, default=40,
+                      help='bytes between a jump and the target of the '
+                           'previous one, at most 62')
+  parser.add_argument('--keep', help='write the assembly file here')
+  args = parser.parse_args()
+  if not 0 <= args.filler <= 62:
+    sys.exit('--filler must be between 0 and 62')
+
+  fd, src = tempfile.mkstemp(suffix='.s')
+  out = os.fdopen(fd, 'w')
+  out.write('\t.file\t1 "bench.c"\n')
+  for n in range(args.functions):
+    gen_function(out, n, args.chain, args.filler)
+  out.close()
+
+  obj = src + '.o'
+  base_obj = src + '.base.o'
+  try:
+    print('%d functions with chains of %d jumps' %
+          (args.functions, args.chain))
+    report('llvm-mc', assemble(args.llvm_mc, src, obj))
+    if args.baseline:
+      report('baseline', assemble(args.baseline, src, base_obj))
+      same = open(obj, 'rb').read() == open(base_obj, 'rb').read()
+      print('  object files %s' % ('match' if same else 'DIFFER'))
+      if not same:
+        sys.exit(1)
+  finally:
+    if args.keep:
+      os.rename(src, args.keep)
+    else:
+      os.remove(src)
+    for f in (obj, base_obj):
+      if os.path.exists(f):
+        os.remove(f)
+
+if __name__ == '__main__':
+  main()
@@ -0,0 +1,128 @@
+#!/usr/bin/env python
+
+"""Compare the compile time of GVN and DSE with and without Memory SSA.
+
+Generates one large function made of a chain of diamonds.  Every block stores
+to a few fields of a struct that don't alias each other, loads some of them
+back and calls a readnone function, so GVN has loads to forward from stores
+across blocks and DSE has stores to delete, and memory dependence analysis has
+long stretches of unrelated stores to scan on each query.  The function is run
+through opt -basicaa -gvn and -basicaa -dse, with the default memory dependence
+based code and with -enable-gvn-memoryssa / -enable-dse-memoryssa, and the
+times are reported along with the number of loads and stores deleted if opt was
+built with assertions.
+
+  utils/memoryssa-bench.py --opt=build/bin/opt --diamonds=2000
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import time
+
+def gen_function(out, diamonds, fields):
+  """Write @f, a chain of diamonds over a struct of the given number of i32
+  fields."""
+  out.write('%%S = type { %s }\n\n' % ', '.join(['i32'] * fields))
+  out.write('declare i32 @pure(i32) readnone\n\n')
+  out.write('define i32 @f(%S* noalias %s, i1 %c) {\n')
+  out.write('entry:\n')
+  for i in range(fields):
+    out.write('  %%p%d = getelementptr %%S* %%s, i32 0, i32 %d\n' % (i, i))
+  out.write('  store i32 0, i32* %p0\n')
+  out.write('  br label %d0\n')
+  acc = '0'
+  for d in range(diamonds):
+    # Both sides store the field loaded in the join.  The left side also
+    # stores every other field twice, and the first of those stores is dead.
+    f = d % fields
+    out.write('d%d:\n' % d)
+    out.write('  br i1 %%c, label %%l%d, label %%r%d\n' % (d, d))
+    out.write('l%d:\n' % d)
+    for i in range(fields):
+      if i != f:
+        out.write('  store i32 %d, i32* %%p%d\n' % (d, i))
+    for i in range(fields):
+      out.write('  store i32 %d, i32* %%p%d\n' % (d + i + 1, i))
+    out.write('  br label %%j%d\n' % d)
+    out.write('r%d:\n' % d)
+    out.write('  store i32 %d, i32* %%p%d\n' % (d + 7, f))
+    out.write('  br label %%j%d\n' % d)
+    out.write('j%d:\n' % d)
+    out.write('  %%v%d = load i32* %%p%d\n' % (d, f))
+    out.write('  %%w%d = call i32 @pure(i32 %%v%d)\n' % (d, d))
+    out.write('  %%x%d = load i32* %%p%d\n' % (d, f))
+    out.write('  %%a%d = add i32 %s, %%x%d\n' % (d, acc, d))
+    acc = '%%a%d' % d
+    out.write('  br label %%d%d\n' % (d + 1))
+  out.write('d%d:\n' % diamonds)
+  out.write('  ret i32 %s\n' % acc)
+  out.write('}\n')
+
+def run_opt(opt, src, passes, flags):
+  """Run opt over src and return the wall time and the statistics it
+  printed, or an empty dictionary if it doesn't report statistics."""
+  start = time.time()
+  p = subprocess.Popen([opt, '-disable-output', '-stats', '-basicaa'] +
+                       passes + flags + [src], stderr=subprocess.PIPE)
+  err = p.communicate()[1].decode('utf-8', 'replace')
+  elapsed = time.time() - start
+  if p.returncode != 0:
+    sys.stderr.write(err)
+    sys.exit('opt failed')
+  stats = {}
+  for m in re.finditer(r'^\s*(\d+) (\S+)\s+- (.*)$', err, re.M):
+    stats[(m.group(2), m.group(3))] = int(m.group(1))
+  return elapsed, stats
+
+def report(name, result, keys):
+  elapsed, stats = result
+  line = '  %-22s %8.3fs' % (name + ':', elapsed)
+  for key, label in keys:
+    if stats:
+      line += '  %d %s' % (stats.get(key, 0), label)
+  print(line)
+
+def main():
+  parser = argparse.ArgumentParser(description=__doc__,
+                      formatter_class=argparse.RawDescriptionHelpFormatter)
+  parser.add_argument('--opt', default='opt', help='opt binary to run')
+  parser.add_argument('--diamonds', type=int, default=2000,
+                      help='number of diamonds in the function')
+  parser.add_argument('--fields', type=int, default=8,
+                      help='number of fields stored in each diamond')
+  parser.add_argument('--keep', help='write the generated module here')
+  args = parser.parse_args()
+  if args.fields < 1:
+    sys.exit('--fields must be at least 1')
+
+  fd, src = tempfile.mkstemp(suffix='.ll')
+  out = os.fdopen(fd, 'w')
+  gen_function(out, args.diamonds, args.fields)
+  out.close()
+
+  gvn_keys = [(('gvn', 'Number of loads deleted'), 'loads deleted'),
+              (('memoryssa', 'Number of MemoryPhis created'), 'MemoryPhis')]
+  dse_keys = [(('dse', 'Number of stores deleted'), 'stores deleted'),
+              (('memoryssa', 'Number of MemoryPhis created'), 'MemoryPhis')]
+  try:
+    print('%d diamonds storing %d fields' % (args.diamonds, args.fields))
+    report('gvn', run_opt(args.opt, src, ['-gvn'], []), gvn_keys)
+    report('gvn memoryssa',
+           run_opt(args.opt, src, ['-gvn'], ['-enable-gvn-memoryssa']),
+           gvn_keys)
+    report('dse', run_opt(args.opt, src, ['-dse'], []), dse_keys)
+    report('dse memoryssa',
+           run_opt(args.opt, src, ['-dse'], ['-enable-dse-memoryssa']),
+           dse_keys)
+  finally:
+    if args.keep:
+      os.rename(src, args.keep)
+    else:
+      os.remove(src)
+
+if __name__ == '__main__':
+  main()